@@ -498,7 +498,8 @@ ApplicationWindow {
 
         const backlog = Math.max(0, Number(tickBacklog) || 0)
         const renderOverloaded = root.qosRenderOverloaded()
-        if (root.perfEmitOverBudgetCount > 0 || backlog >= 3 || renderOverloaded) {
+        const densityTightened = danmakuController.densityTier >= 3
+        if (root.perfEmitOverBudgetCount > 0 || backlog >= 3 || renderOverloaded || densityTightened) {
             root.qosOverBudgetStreak += 1
             root.qosStableStreak = 0
         } else {
@@ -688,6 +689,11 @@ ApplicationWindow {
         }
     }
 
+    PerfMetrics {
+        id: uiPerfMetrics
+        scope: "ui"
+    }
+
     Timer {
         id: perfLogTimer
         interval: 2000
@@ -696,22 +702,21 @@ ApplicationWindow {
         onTriggered: {
             const tickBacklog = Math.max(0, root.perfTickSentCount - root.perfTickResultCount)
             if (root.perfLogEnabled) {
-                console.log(
-                    "[perf-ui] window_ms=" + perfLogTimer.interval
-                    + " tick_sent=" + root.perfTickSentCount
-                    + " tick_result=" + root.perfTickResultCount
-                    + " tick_backlog=" + tickBacklog
-                    + " dropped_comments=" + root.perfDroppedCommentsCount
-                    + " coalesced_comments=" + root.perfCoalescedCommentsCount
-                    + " emit_over_budget=" + root.perfEmitOverBudgetCount
-                    + " comments_visible=" + (root.commentsVisible ? "1" : "0")
-                    + " position_ms=" + mpv.positionMs
-                    + " paused=" + (mpv.paused ? "1" : "0")
-                    + " speed=" + root.formatRate(mpv.speed)
-                    + " profile=" + root.perfProfile
-                    + " target_fps=" + root.targetFps
-                    + " emit_cap=" + root.maxEmitPerTick
-                )
+                uiPerfMetrics.setCounter("window_ms", perfLogTimer.interval)
+                uiPerfMetrics.setCounter("tick_sent", root.perfTickSentCount)
+                uiPerfMetrics.setCounter("tick_result", root.perfTickResultCount)
+                uiPerfMetrics.setCounter("tick_backlog", tickBacklog)
+                uiPerfMetrics.setCounter("dropped_comments", root.perfDroppedCommentsCount)
+                uiPerfMetrics.setCounter("coalesced_comments", root.perfCoalescedCommentsCount)
+                uiPerfMetrics.setCounter("emit_over_budget", root.perfEmitOverBudgetCount)
+                uiPerfMetrics.setGauge("comments_visible", root.commentsVisible ? 1 : 0, 0)
+                uiPerfMetrics.setGauge("position_ms", mpv.positionMs, 0)
+                uiPerfMetrics.setGauge("paused", mpv.paused ? 1 : 0, 0)
+                uiPerfMetrics.setLabel("speed", root.formatRate(mpv.speed))
+                uiPerfMetrics.setLabel("profile", root.perfProfile)
+                uiPerfMetrics.setGauge("target_fps", root.targetFps, 0)
+                uiPerfMetrics.setGauge("emit_cap", root.maxEmitPerTick, 0)
+                uiPerfMetrics.publish()
             }
             root.handleQosWindowFeedback(tickBacklog)
             root.perfTickSentCount = 0
@@ -1,21 +1,19 @@
 #pragma once
 
+#include "danmaku/DanmakuEngine.hpp"
+#include "danmaku/DanmakuFrameClock.hpp"
 #include "danmaku/DanmakuRenderFrame.hpp"
-#include "danmaku/DanmakuSoAState.hpp"
-#include "danmaku/DanmakuSpatialGrid.hpp"
-#include "danmaku/DanmakuTextSpriteCache.hpp"
+#include "danmaku/DanmakuRenderHandoff.hpp"
 
 #include <QObject>
-#include <QMutex>
-#include <QQueue>
-#include <QSet>
 #include <QString>
 #include <QThread>
-#include <QTimer>
 #include <QVariantList>
 #include <QVector>
 
-class DanmakuUpdateWorker;
+#include <memory>
+
+class DanmakuSessionRecorder;
 
 class DanmakuController : public QObject {
     Q_OBJECT
@@ -25,10 +23,10 @@ class DanmakuController : public QObject {
     Q_PROPERTY(int targetFps READ targetFps WRITE setTargetFps NOTIFY targetFpsChanged)
     Q_PROPERTY(bool perfLogEnabled READ perfLogEnabled WRITE setPerfLogEnabled NOTIFY perfLogEnabledChanged)
     Q_PROPERTY(bool glyphWarmupEnabled READ glyphWarmupEnabled WRITE setGlyphWarmupEnabled NOTIFY glyphWarmupEnabledChanged)
-    Q_PROPERTY(QString glyphWarmupText READ glyphWarmupText NOTIFY glyphWarmupTextChanged)
     Q_PROPERTY(double commentRenderFps READ commentRenderFps NOTIFY commentRenderFpsChanged)
     Q_PROPERTY(int activeCommentCount READ activeCommentCountMetric NOTIFY activeCommentCountChanged)
     Q_PROPERTY(qint64 overlayMetricsUpdatedAtMs READ overlayMetricsUpdatedAtMs NOTIFY overlayMetricsUpdatedAtMsChanged)
+    Q_PROPERTY(int densityTier READ densityTier NOTIFY densityTierChanged)
 
 public:
     explicit DanmakuController(QObject *parent = nullptr);
@@ -54,7 +52,7 @@ public:
 
     Q_INVOKABLE void applyNgUserFade(const QString &userId);
     Q_INVOKABLE void rollbackPendingNgUserFade(const QString &userId);
-    DanmakuRenderFrameConstPtr renderSnapshot() const;
+    DanmakuRenderFrameConstPtr renderSnapshot();
     QVector<DanmakuSpriteUpload> takePendingSpriteUploads();
 
     bool ngDropZoneVisible() const;
@@ -63,12 +61,18 @@ public:
     int targetFps() const;
     bool perfLogEnabled() const;
     bool glyphWarmupEnabled() const;
-    QString glyphWarmupText() const;
     double commentRenderFps() const;
     int activeCommentCountMetric() const;
     qint64 overlayMetricsUpdatedAtMs() const;
+    int densityTier() const;
     void recordPresentedCommentFrame(qint64 presentedAtMs = 0);
+    DanmakuFrameClockMode frameClockMode() const;
+    void advanceVsyncFrame();
+    bool wantsAnimationFrame() const;
     int widthMeasurementCountForTesting() const;
+    int pendingRasterCountForTesting() const;
+    void stepFrameForTesting(int elapsedMs);
+    bool workerBusyForTesting();
 
 signals:
     void ngDropZoneVisibleChanged();
@@ -77,188 +81,70 @@ signals:
     void targetFpsChanged();
     void perfLogEnabledChanged();
     void glyphWarmupEnabledChanged();
-    void glyphWarmupTextChanged();
     void commentRenderFpsChanged();
     void activeCommentCountChanged();
     void overlayMetricsUpdatedAtMsChanged();
+    void densityTierChanged();
     void ngDropRequested(const QString &userId);
     void renderSnapshotChanged();
 
 private:
-    struct LaneState {
-        qint64 nextAvailableAtMs = 0;
-        int lastAssignedRow = -1;
-    };
-
-    struct Item {
-        QString commentId;
-        QString userId;
-        QString text;
-        DanmakuSpriteId spriteId = 0;
-        qreal x = 0;
-        qreal y = 0;
-        qreal speedPxPerSec = 120;
-        qreal alpha = 1.0;
-        int lane = 0;
-        int originalLane = 0;
-        int widthEstimate = 120;
-        bool frozen = false;
-        bool dragging = false;
-        bool fading = false;
-        bool ngDropHovered = false;
-        bool active = false;
-        int fadeRemainingMs = 0;
-        bool pendingNgFade = false;
-        bool pendingNgDraggedOrigin = false;
-    };
-
-    void onFrame();
-    int laneCount() const;
-    int pickLane(qint64 nowMs);
-    bool laneHasCollision(int lane, const Item &candidate);
-    void recoverToLane(Item &item);
-    void ensureLaneStateSize();
-    void resetLaneStates();
-    qint64 estimateLaneCooldownMs(const Item &item) const;
-    int findItemIndexAt(qreal x, qreal y);
-    int acquireRow();
-    void releaseRow(int row);
-    void releaseRowsDescending(const QVector<int> &rowsDescending);
-    bool maybeCompactRows();
-    int activeItemCount() const;
-    bool hasDragging() const;
-    void updateNgZoneVisibility();
-    bool isItemInNgZone(const Item &item) const;
-    void observeGlyphText(const QString &text);
-    void queueGlyphCodepoint(char32_t codepoint);
-    void queueGlyphSeedCharacters();
-    void dispatchGlyphWarmupIfDue(qint64 nowMs);
-    void clearGlyphWarmupText();
-    void updateOverlayMetrics(qint64 nowMs);
-    void maybeWritePerfLog(qint64 nowMs);
-    void runFrameSingleThread(int elapsedMs, qint64 nowMs);
-    void rebuildSpatialIndex();
-    void rebuildRenderSnapshot();
-    DanmakuRenderInstance buildRenderInstance(const Item &item) const;
-    void queueSpatialUpsertRow(int row);
-    void queueSpatialUpsertRows(const QVector<int> &rows);
-    void queueSpatialRemoveRow(int row);
-    void queueSpatialRemoveRows(const QVector<int> &rows);
-    void queueSnapshotUpsertRow(int row);
-    void queueSnapshotUpsertRows(const QVector<int> &rows);
-    void queueSnapshotRemoveRow(int row);
-    void queueSnapshotRemoveRows(const QVector<int> &rows);
-    void queueFullSpatialRebuild();
-    void queueFullSnapshotRebuild();
-    bool applySnapshotRowUpsert(int row);
-    bool applySnapshotRowRemoval(int row);
-    void ensureRowToRenderIndexSize();
-    void ensureSpatialIndexFresh();
-    void markSpatialIndexDirty();
-    void publishRenderSnapshot();
-    void flushPendingDiffs(bool emitSnapshotSignal);
-    void scheduleWorkerFrame(int elapsedMs, qint64 nowMs);
-    void handleWorkerFrame(DanmakuWorkerFramePtr frame);
-    void invalidateWorkerGeneration();
-    DanmakuWorkerRowState buildWorkerRowState(int row) const;
-    QVector<DanmakuWorkerRowState> buildWorkerRowStates(const QVector<int> &rows) const;
-    QVector<DanmakuWorkerRowState> buildAllWorkerRowStates() const;
-    void syncWorkerRows(const QVector<int> &rows);
-    void syncWorkerRemoveRows(const QVector<int> &rows);
-    void syncWorkerFullState();
-    void markWorkerRowsDirty(const QVector<int> &rows);
-    void markWorkerRowsRemoved(const QVector<int> &rows);
-    void updateFrameTimerInterval();
-    bool beginDragInternal(int index, qreal pointerX, qreal pointerY, bool hasPointerPosition);
-    void moveDragInternal(int index, qreal pointerX, qreal pointerY, bool hasPointerPosition);
-    void dropDragInternal(int index, bool inNgZone);
-    void refreshActiveSpriteIds();
-    void enqueueSpriteUpload(const DanmakuSpriteUpload &upload);
-    bool rasterizePendingSpritesWithinBudget();
-
-    QVector<Item> m_items;
-    QVector<LaneState> m_laneStates;
-    QVector<int> m_freeRows;
-    DanmakuSpatialGrid m_spatialGrid;
-    QSet<int> m_pendingSpatialUpsertRows;
-    QSet<int> m_pendingSpatialRemoveRows;
-    QSet<int> m_pendingSnapshotUpsertRows;
-    QSet<int> m_pendingSnapshotRemoveRows;
-    bool m_pendingFullSpatialRebuild = true;
-    bool m_pendingFullSnapshotRebuild = true;
-    bool m_spatialIndexDirty = false;
-
-    qreal m_viewportWidth = 1280;
-    qreal m_viewportHeight = 720;
-    int m_fontPx = 36;
-    int m_laneGap = 6;
-    int m_laneCursor = 0;
-
+    template <typename Function>
+    void dispatch(Function function) {
+        DanmakuEngine *engine = m_engine;
+        QMetaObject::invokeMethod(engine, [engine, function]() { function(engine); }, Qt::AutoConnection);
+    }
+
+    template <typename Function>
+    auto call(Function function) const {
+        DanmakuEngine *engine = m_engine;
+        decltype(function(engine)) result {};
+        QMetaObject::invokeMethod(
+            engine,
+            [engine, function]() { return function(engine); },
+            m_simulationThread.isRunning() ? Qt::BlockingQueuedConnection : Qt::DirectConnection,
+            &result);
+        return result;
+    }
+
+    template <typename Value>
+    void mirrorEngineValue(
+        void (DanmakuEngine::*engineChanged)(),
+        Value (DanmakuEngine::*engineValue)() const,
+        void (DanmakuController::*changed)(),
+        Value DanmakuController::*field) {
+        DanmakuEngine *engine = m_engine;
+        this->*field = (engine->*engineValue)();
+        connect(
+            engine,
+            engineChanged,
+            engine,
+            [this, engine, engineValue, changed, field]() {
+                const Value value = (engine->*engineValue)();
+                QMetaObject::invokeMethod(
+                    this,
+                    [this, changed, field, value]() {
+                        this->*field = value;
+                        emit (this->*changed)();
+                    },
+                    Qt::AutoConnection);
+            },
+            Qt::DirectConnection);
+    }
+
+    DanmakuRenderHandoff m_renderHandoff;
+    DanmakuEngine *m_engine = nullptr;
+    QThread m_simulationThread;
+    std::unique_ptr<DanmakuSessionRecorder> m_sessionRecorder;
+    DanmakuFrameClockMode m_frameClockMode = DanmakuFrameClockMode::Timer;
     bool m_ngDropZoneVisible = false;
     bool m_playbackPaused = true;
     double m_playbackRate = 1.0;
     int m_targetFps = 60;
-    qreal m_ngZoneX = 0;
-    qreal m_ngZoneY = 0;
-    qreal m_ngZoneWidth = 0;
-    qreal m_ngZoneHeight = 0;
     bool m_perfLogEnabled = false;
-    qint64 m_perfLogWindowStartMs = 0;
-    int m_perfLogFrameCount = 0;
-    QVector<int> m_perfFrameSamplesMs;
-    int m_perfLogAppendCount = 0;
-    int m_perfLogGeometryUpdateCount = 0;
-    int m_perfLogRemovedCount = 0;
-    int m_perfLanePickCount = 0;
-    int m_perfLaneReadyCount = 0;
-    int m_perfLaneForcedCount = 0;
-    qint64 m_perfLaneWaitTotalMs = 0;
-    qint64 m_perfLaneWaitMaxMs = 0;
-    bool m_perfCompactedSinceLastLog = false;
     bool m_glyphWarmupEnabled = true;
-    QString m_glyphWarmupText;
-    QSet<char32_t> m_seenGlyphCodepoints;
-    QSet<char32_t> m_warmedGlyphCodepoints;
-    QSet<char32_t> m_queuedGlyphCodepoints;
-    QQueue<char32_t> m_glyphWarmupQueue;
-    qint64 m_lastGlyphWarmupDispatchMs = 0;
-    int m_perfGlyphNewCodepoints = 0;
-    int m_perfGlyphNewNonAsciiCodepoints = 0;
-    int m_perfGlyphWarmupSentCodepoints = 0;
-    int m_perfGlyphWarmupBatchCount = 0;
-    int m_perfGlyphWarmupDroppedCodepoints = 0;
-    int m_activeDragRow = -1;
-    qreal m_activeDragOffsetX = 0;
-    qreal m_activeDragOffsetY = 0;
-    mutable QMutex m_renderSnapshotMutex;
-    QMutex m_pendingSpriteUploadsMutex;
-    QVector<DanmakuRenderInstance> m_renderCache;
-    QVector<int> m_renderRows;
-    QVector<int> m_rowToRenderIndex;
-    QVector<DanmakuSpriteUpload> m_pendingSpriteUploads;
-    DanmakuRenderFrameConstPtr m_renderSnapshot;
-    DanmakuTextSpriteCache m_textSpriteCache;
-    qreal m_renderDevicePixelRatio = 1.0;
-    bool m_workerEnabled = true;
-    bool m_workerBusy = false;
-    qint64 m_workerSeq = 0;
-    int m_workerAccumulatedElapsedMs = 0;
-    DanmakuWorkerFramePtr m_workerReusableFrame;
-    DanmakuUpdateWorker *m_updateWorker = nullptr;
-    QThread m_updateThread;
-    QString m_simdModeName = QStringLiteral("auto");
-    QSet<int> m_workerPendingDirtyRows;
-    QSet<int> m_workerPendingRemovedRows;
-
-    QTimer m_frameTimer;
-    qint64 m_lastTickMs = 0;
-    int m_perfSpatialFullRebuildCount = 0;
-    int m_perfSpatialRowUpdateCount = 0;
-    int m_perfSnapshotFullRebuildCount = 0;
-    int m_perfSnapshotRowUpdateCount = 0;
-    qint64 m_overlayMetricWindowStartMs = 0;
-    int m_presentedCommentFrameCount = 0;
     double m_commentRenderFps = 0.0;
     int m_activeCommentCount = 0;
     qint64 m_overlayMetricsUpdatedAtMs = 0;
+    int m_densityTier = 0;
 };
@@ -0,0 +1,160 @@
+#include "danmaku/DanmakuDensityGovernor.hpp"
+
+#include <algorithm>
+
+bool DanmakuDensityGovernor::enabledFromEnvironment() {
+    const QString configured = qEnvironmentVariable("NICONEON_DANMAKU_GOVERNOR").trimmed().toLower();
+    return configured != QStringLiteral("off")
+        && configured != QStringLiteral("0")
+        && configured != QStringLiteral("false");
+}
+
+QString DanmakuDensityGovernor::tierName(DanmakuDensityTier tier) {
+    switch (tier) {
+    case DanmakuDensityTier::Normal:
+        return QStringLiteral("normal");
+    case DanmakuDensityTier::SkipLowPriority:
+        return QStringLiteral("skip_low_priority");
+    case DanmakuDensityTier::ThrottleRaster:
+        return QStringLiteral("throttle_raster");
+    case DanmakuDensityTier::TightenEmit:
+        return QStringLiteral("tighten_emit");
+    case DanmakuDensityTier::LowResolutionSprites:
+        return QStringLiteral("low_res_sprites");
+    }
+    return QStringLiteral("normal");
+}
+
+void DanmakuDensityGovernor::setEnabled(bool enabled) {
+    m_enabled = enabled;
+    if (!m_enabled) {
+        reset();
+    }
+}
+
+bool DanmakuDensityGovernor::enabled() const {
+    return m_enabled;
+}
+
+void DanmakuDensityGovernor::setTargetFps(int fps) {
+    const int normalized = std::clamp(fps, 10, 120);
+    m_frameBudgetUs = static_cast<qint64>(1000000.0 / normalized * kFrameBudgetShare);
+}
+
+qint64 DanmakuDensityGovernor::frameBudgetUs() const {
+    return m_frameBudgetUs;
+}
+
+void DanmakuDensityGovernor::reset() {
+    m_tier = DanmakuDensityTier::Normal;
+    m_windowCostUs.reset();
+    m_windowFrames = 0;
+    m_windowMaxActive = 0;
+    m_windowMaxBacklog = 0;
+    m_windowUploadBytes = 0;
+    m_pressureStreak = 0;
+    m_relaxedStreak = 0;
+    m_lastWindowP95Us = 0;
+}
+
+bool DanmakuDensityGovernor::observe(const DanmakuDensitySample &sample) {
+    if (!m_enabled) {
+        return false;
+    }
+
+    m_windowCostUs.record(sample.frameCostUs);
+    m_windowMaxActive = std::max(m_windowMaxActive, sample.activeCount);
+    m_windowMaxBacklog = std::max(m_windowMaxBacklog, sample.rasterBacklog);
+    m_windowUploadBytes += sample.uploadBytes;
+    if (++m_windowFrames < kWindowFrames) {
+        return false;
+    }
+    return closeWindow();
+}
+
+bool DanmakuDensityGovernor::closeWindow() {
+    m_lastWindowP95Us = m_windowCostUs.valueAtPercentile(95.0);
+    const qint64 uploadBytesPerFrame = m_windowUploadBytes / std::max(1, m_windowFrames);
+    const bool costHeadroom = m_lastWindowP95Us < static_cast<qint64>(m_frameBudgetUs * kRecoverBudgetShare);
+    const bool rasterThrottled = m_tier >= DanmakuDensityTier::ThrottleRaster;
+    const bool rasterPressured = !rasterThrottled
+        && (m_windowMaxBacklog > kRasterBacklogHigh || uploadBytesPerFrame > kUploadBytesHigh);
+    const bool rasterDrained = rasterThrottled
+        || (m_windowMaxBacklog < kRasterBacklogLow && uploadBytesPerFrame < kUploadBytesLow);
+    const bool pressured = m_lastWindowP95Us > m_frameBudgetUs
+        || rasterPressured
+        || (!costHeadroom && m_windowMaxActive > kActiveCountHigh);
+    const bool relaxed = costHeadroom && rasterDrained;
+
+    m_windowCostUs.reset();
+    m_windowFrames = 0;
+    m_windowMaxActive = 0;
+    m_windowMaxBacklog = 0;
+    m_windowUploadBytes = 0;
+
+    if (pressured) {
+        ++m_pressureStreak;
+        m_relaxedStreak = 0;
+    } else if (relaxed) {
+        ++m_relaxedStreak;
+        m_pressureStreak = 0;
+    } else {
+        m_pressureStreak = 0;
+        m_relaxedStreak = 0;
+    }
+
+    if (m_pressureStreak >= kDegradeWindows && m_tier != DanmakuDensityTier::LowResolutionSprites) {
+        setTier(static_cast<DanmakuDensityTier>(static_cast<int>(m_tier) + 1));
+        return true;
+    }
+    if (m_relaxedStreak >= kRecoverWindows && m_tier != DanmakuDensityTier::Normal) {
+        setTier(static_cast<DanmakuDensityTier>(static_cast<int>(m_tier) - 1));
+        return true;
+    }
+    return false;
+}
+
+void DanmakuDensityGovernor::setTier(DanmakuDensityTier tier) {
+    m_tier = tier;
+    m_pressureStreak = 0;
+    m_relaxedStreak = 0;
+    ++m_tierChangeCount;
+}
+
+DanmakuDensityTier DanmakuDensityGovernor::tier() const {
+    return m_tier;
+}
+
+int DanmakuDensityGovernor::tierChangeCount() const {
+    return m_tierChangeCount;
+}
+
+qint64 DanmakuDensityGovernor::lastWindowP95Us() const {
+    return m_lastWindowP95Us;
+}
+
+bool DanmakuDensityGovernor::skipLowPriority() const {
+    return m_tier >= DanmakuDensityTier::SkipLowPriority;
+}
+
+bool DanmakuDensityGovernor::tightenEmitBudget() const {
+    return m_tier >= DanmakuDensityTier::TightenEmit;
+}
+
+int DanmakuDensityGovernor::spriteRasterBudget(int baseBudget) const {
+    if (m_tier < DanmakuDensityTier::ThrottleRaster) {
+        return baseBudget;
+    }
+    return std::max(1, baseBudget / kThrottledRasterDivisor);
+}
+
+qint64 DanmakuDensityGovernor::spriteUploadBudgetBytes(qint64 baseBytes) const {
+    if (m_tier < DanmakuDensityTier::ThrottleRaster) {
+        return baseBytes;
+    }
+    return std::max<qint64>(1, baseBytes / kThrottledRasterDivisor);
+}
+
+qreal DanmakuDensityGovernor::spriteResolutionScale() const {
+    return m_tier >= DanmakuDensityTier::LowResolutionSprites ? kLowResolutionScale : 1.0;
+}
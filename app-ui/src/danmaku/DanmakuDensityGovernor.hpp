@@ -0,0 +1,74 @@
+#pragma once
+
+#include "perf/PerfHistogram.hpp"
+
+#include <QString>
+#include <QtGlobal>
+
+enum class DanmakuDensityTier {
+    Normal = 0,
+    SkipLowPriority = 1,
+    ThrottleRaster = 2,
+    TightenEmit = 3,
+    LowResolutionSprites = 4,
+};
+
+struct DanmakuDensitySample {
+    qint64 frameCostUs = 0;
+    int activeCount = 0;
+    int rasterBacklog = 0;
+    qint64 uploadBytes = 0;
+};
+
+class DanmakuDensityGovernor {
+public:
+    static constexpr int kWindowFrames = 30;
+    static constexpr int kDegradeWindows = 2;
+    static constexpr int kRecoverWindows = 6;
+    static constexpr double kFrameBudgetShare = 0.5;
+    static constexpr double kRecoverBudgetShare = 0.6;
+    static constexpr int kActiveCountHigh = 2000;
+    static constexpr int kRasterBacklogHigh = 128;
+    static constexpr int kRasterBacklogLow = 16;
+    static constexpr qint64 kUploadBytesHigh = 384 * 1024;
+    static constexpr qint64 kUploadBytesLow = 64 * 1024;
+    static constexpr int kThrottledRasterDivisor = 4;
+    static constexpr qreal kLowResolutionScale = 0.5;
+
+    static bool enabledFromEnvironment();
+    static QString tierName(DanmakuDensityTier tier);
+
+    void setEnabled(bool enabled);
+    bool enabled() const;
+    void setTargetFps(int fps);
+    qint64 frameBudgetUs() const;
+    void reset();
+
+    bool observe(const DanmakuDensitySample &sample);
+
+    DanmakuDensityTier tier() const;
+    int tierChangeCount() const;
+    qint64 lastWindowP95Us() const;
+    bool skipLowPriority() const;
+    bool tightenEmitBudget() const;
+    int spriteRasterBudget(int baseBudget) const;
+    qint64 spriteUploadBudgetBytes(qint64 baseBytes) const;
+    qreal spriteResolutionScale() const;
+
+private:
+    bool closeWindow();
+    void setTier(DanmakuDensityTier tier);
+
+    bool m_enabled = true;
+    qint64 m_frameBudgetUs = 1000000 / 60;
+    DanmakuDensityTier m_tier = DanmakuDensityTier::Normal;
+    PerfHistogram m_windowCostUs;
+    int m_windowFrames = 0;
+    int m_windowMaxActive = 0;
+    int m_windowMaxBacklog = 0;
+    qint64 m_windowUploadBytes = 0;
+    int m_pressureStreak = 0;
+    int m_relaxedStreak = 0;
+    int m_tierChangeCount = 0;
+    qint64 m_lastWindowP95Us = 0;
+};
@@ -0,0 +1,16 @@
+#include "danmaku/DanmakuDirtyRowSet.hpp"
+
+#include <algorithm>
+
+void DanmakuDirtyRowSet::clear() {
+    std::fill(m_words.begin(), m_words.begin() + m_highWord, quint64(0));
+    m_highWord = 0;
+    m_count = 0;
+}
+
+void DanmakuDirtyRowSet::reserve(int rowCount) {
+    const int wordCount = (std::max(0, rowCount) + 63) >> 6;
+    if (wordCount > m_words.size()) {
+        m_words.resize(wordCount);
+    }
+}
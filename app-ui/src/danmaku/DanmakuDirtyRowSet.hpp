@@ -0,0 +1,88 @@
+#pragma once
+
+#include <QVector>
+#include <QtAlgorithms>
+#include <QtGlobal>
+
+#include <algorithm>
+
+class DanmakuDirtyRowSet {
+public:
+    void insert(int row) {
+        if (row < 0) {
+            return;
+        }
+        const int wordIndex = row >> 6;
+        if (wordIndex >= m_words.size()) {
+            m_words.resize(wordIndex + 1);
+        }
+        const quint64 bit = quint64(1) << (row & 63);
+        quint64 &word = m_words[wordIndex];
+        if ((word & bit) == 0) {
+            word |= bit;
+            ++m_count;
+            m_highWord = std::max(m_highWord, wordIndex + 1);
+        }
+    }
+
+    void remove(int row) {
+        if (row < 0 || (row >> 6) >= m_words.size()) {
+            return;
+        }
+        const quint64 bit = quint64(1) << (row & 63);
+        quint64 &word = m_words[row >> 6];
+        if ((word & bit) != 0) {
+            word &= ~bit;
+            --m_count;
+        }
+    }
+
+    bool contains(int row) const {
+        if (row < 0 || (row >> 6) >= m_words.size()) {
+            return false;
+        }
+        return (m_words[row >> 6] & (quint64(1) << (row & 63))) != 0;
+    }
+
+    bool isEmpty() const {
+        return m_count == 0;
+    }
+
+    int size() const {
+        return m_count;
+    }
+
+    void clear();
+    void reserve(int rowCount);
+
+    template <typename Fn>
+    void forEachAscending(Fn &&fn) const {
+        const quint64 *words = m_words.constData();
+        for (int wordIndex = 0; wordIndex < m_highWord; ++wordIndex) {
+            quint64 word = words[wordIndex];
+            while (word != 0) {
+                const int bitIndex = static_cast<int>(qCountTrailingZeroBits(word));
+                fn((wordIndex << 6) | bitIndex);
+                word &= word - 1;
+            }
+        }
+    }
+
+    template <typename Fn>
+    void forEachDescending(Fn &&fn) const {
+        const quint64 *words = m_words.constData();
+        for (int wordIndex = m_highWord - 1; wordIndex >= 0; --wordIndex) {
+            quint64 word = words[wordIndex];
+            while (word != 0) {
+                const int bitIndex = 63 - static_cast<int>(qCountLeadingZeroBits(word));
+                fn((wordIndex << 6) | bitIndex);
+                word &= ~(quint64(1) << bitIndex);
+            }
+        }
+    }
+
+private:
+    QVector<quint64> m_words;
+    int m_highWord = 0;
+    int m_count = 0;
+};
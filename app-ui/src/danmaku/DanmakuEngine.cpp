@@ -0,0 +1,1992 @@
+#include "danmaku/DanmakuEngine.hpp"
+
+#include "danmaku/DanmakuGlyphWarmer.hpp"
+#include "danmaku/DanmakuRenderStyle.hpp"
+#include "danmaku/DanmakuSimdUpdater.hpp"
+#include "danmaku/DanmakuUpdateWorker.hpp"
+#include "perf/PerfMetricsRegistry.hpp"
+#include "perf/PerfTrace.hpp"
+
+#include <QDateTime>
+#include <QHash>
+#include <QMetaType>
+#include <QPointF>
+#include <QVariantMap>
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <utility>
+
+namespace {
+constexpr qreal kLaneTopMargin = 10.0;
+constexpr qreal kSpawnOffset = 12.0;
+constexpr qreal kItemHeight = static_cast<qreal>(DanmakuRenderStyle::kItemHeightPx);
+constexpr qreal kItemCullThreshold = -20.0;
+constexpr qint64 kMaxLagCompensationMs = 15000;
+constexpr qreal kLaneSpawnGapPx = 20.0;
+constexpr qint64 kGlyphWarmupIntervalMs = 80;
+constexpr int kGlyphWarmupBatchChars = 24;
+constexpr int kGlyphWarmupQueueMax = 2048;
+constexpr qint64 kWorkerElapsedCapMs = 200;
+constexpr qint64 kVsyncFallbackNs = 100 * 1000 * 1000;
+constexpr int kSpriteRasterBudgetPerFrame = 8;
+constexpr int kSpriteDeliveryBudgetPerFrame = 64;
+constexpr qint64 kSpriteUploadBudgetBytesPerFrame = 512 * 1024;
+constexpr const char *kGlyphWarmupSeed =
+    "0123456789"
+    "abcdefghijklmnopqrstuvwxyz"
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+    "!?#$%&*+-=/:;.,_()[]{}<>|~^'\"`\\"
+    "あいうえおかきくけこさしすせそたちつてとなにぬねの"
+    "はひふへほまみむめもやゆよらりるれろわをん"
+    "アイウエオカキクケコサシスセソタチツテトナニヌネノ"
+    "ハヒフヘホマミムメモヤユヨラリルレロワヲン"
+    "。、！？「」『』（）【】・ー";
+
+bool isTrackableGlyphCodepoint(char32_t codepoint) {
+    if (codepoint == U'\0') {
+        return false;
+    }
+    if (codepoint > 0x10FFFF) {
+        return false;
+    }
+    if (codepoint < 0x20 || (codepoint >= 0x7F && codepoint <= 0x9F)) {
+        return false;
+    }
+    if (codepoint == U' ' || codepoint == 0x3000) {
+        return false;
+    }
+    if (codepoint >= 0xD800 && codepoint <= 0xDFFF) {
+        return false;
+    }
+    return true;
+}
+}
+
+DanmakuEngine::DanmakuEngine(DanmakuRenderHandoff *handoff, bool simulationThread, QObject *parent)
+    : QObject(parent), m_handoff(handoff), m_laneIndex(&m_items, &m_slots), m_textSpriteCache(&m_strings) {
+    m_lastTickNs = DanmakuFrameClock::nowNs();
+    m_clockEpochNs = m_lastTickNs;
+    const qint64 nowMs = QDateTime::currentMSecsSinceEpoch();
+    m_perfLogWindowStartMs = nowMs;
+    m_perfFrameIntervalUs = &m_perfDanmakuMetrics.histogram(QStringLiteral("frame_interval_us"));
+    m_perfFrameJitterUs = &m_perfDanmakuMetrics.histogram(QStringLiteral("frame_jitter_us"));
+    m_overlayMetricWindowStartMs = nowMs;
+    m_overlayMetricsUpdatedAtMs = nowMs;
+    const QString workerMode = qEnvironmentVariable("NICONEON_DANMAKU_WORKER").trimmed().toLower();
+    if (simulationThread
+        || workerMode == QStringLiteral("off")
+        || workerMode == QStringLiteral("0")
+        || workerMode == QStringLiteral("false")) {
+        m_workerEnabled = false;
+    }
+    const DanmakuSimdMode requestedSimdMode = DanmakuSimdUpdater::parseMode(qEnvironmentVariable("NICONEON_SIMD_MODE"));
+    const DanmakuSimdMode resolvedSimdMode = DanmakuSimdUpdater::resolveMode(requestedSimdMode);
+    m_simdModeName = DanmakuSimdUpdater::modeName(resolvedSimdMode);
+    m_frameClockMode = DanmakuFrameClock::parseMode(qEnvironmentVariable("NICONEON_DANMAKU_CLOCK"));
+    if (m_frameClockMode == DanmakuFrameClockMode::Parametric) {
+        m_workerEnabled = false;
+    }
+    m_densityGovernor.setEnabled(DanmakuDensityGovernor::enabledFromEnvironment());
+    m_densityGovernor.setTargetFps(m_targetFps);
+
+    m_glyphWarmer = new DanmakuGlyphWarmer(this);
+    m_glyphWarmer->loadCache(DanmakuGlyphWarmer::cachePathFromEnvironment());
+    m_textSpriteCache.setFallbackFamilies(m_glyphWarmer->fallbackFamilies());
+    connect(m_glyphWarmer, &DanmakuGlyphWarmer::fallbackFamiliesChanged, this, [this](const QStringList &families) {
+        m_textSpriteCache.setFallbackFamilies(families);
+    });
+    m_textSpriteCache.setRasterThreadCount(DanmakuTextSpriteCache::rasterThreadCountFromEnvironment());
+    m_textSpriteCache.setGlyphRunMode(DanmakuTextSpriteCache::glyphRunModeFromEnvironment());
+    m_textSpriteCache.setDistanceFieldMode(DanmakuTextSpriteCache::distanceFieldModeFromEnvironment());
+
+    m_frameTimer.setTimerType(Qt::PreciseTimer);
+    updateFrameTimerInterval();
+    connect(&m_frameTimer, &QTimer::timeout, this, &DanmakuEngine::onTimerFrame);
+
+    if (m_workerEnabled) {
+        m_workerChannel = std::make_unique<DanmakuWorkerChannel>();
+        m_workerPipelineDepth = DanmakuWorkerChannel::pipelineDepthFromEnvironment();
+        m_workerScheduledThroughNs = m_lastTickNs;
+        m_updatePool = std::make_unique<DanmakuUpdatePool>(
+            DanmakuUpdatePool::threadCountFromEnvironment(),
+            DanmakuUpdatePool::parallelMinRowsFromEnvironment());
+        m_updateWorker = new DanmakuUpdateWorker(m_workerChannel.get());
+        m_updateWorker->setSimdMode(resolvedSimdMode);
+        m_updateWorker->setUpdatePool(m_updatePool.get());
+        m_updateWorker->moveToThread(&m_updateThread);
+        m_updateThread.setObjectName(QStringLiteral("danmaku-worker"));
+        connect(&m_updateThread, &QThread::finished, m_updateWorker, &QObject::deleteLater);
+        m_updateThread.start();
+        QMetaObject::invokeMethod(m_updateWorker, &DanmakuUpdateWorker::run, Qt::QueuedConnection);
+    }
+
+    ensureLaneStateSize();
+    resetLaneStates();
+    resetGlyphSession();
+    queueFullSpatialRebuild();
+    queueFullSnapshotRebuild();
+    flushPendingDiffs(false);
+    qInfo().noquote() << QString("[danmaku-simd] mode=%1").arg(m_simdModeName);
+    qInfo().noquote() << QString("[danmaku-worker] enabled=%1 simulation_thread=%2 update_threads=%3 parallel_min_rows=%4 pipeline=%5")
+                             .arg(m_workerEnabled ? 1 : 0)
+                             .arg(simulationThread ? 1 : 0)
+                             .arg(m_updatePool ? m_updatePool->threadCount() : 1)
+                             .arg(m_updatePool ? m_updatePool->parallelMinRows() : 0)
+                             .arg(m_workerEnabled ? m_workerPipelineDepth : 0);
+    qInfo().noquote() << QString("[danmaku-raster] threads=%1 glyph_runs=%2 sprite_format=%3")
+                             .arg(m_textSpriteCache.rasterThreadCount())
+                             .arg(m_textSpriteCache.glyphRunMode() ? 1 : 0)
+                             .arg(m_textSpriteCache.distanceFieldMode() ? QStringLiteral("sdf") : QStringLiteral("coverage"));
+    qInfo().noquote() << QString("[danmaku-clock] mode=%1").arg(DanmakuFrameClock::modeName(m_frameClockMode));
+    qInfo().noquote() << QString("[danmaku-density] governor=%1").arg(m_densityGovernor.enabled() ? 1 : 0);
+}
+
+DanmakuEngine::~DanmakuEngine() {
+    m_workerFramesInFlight = 0;
+    if (m_updateThread.isRunning()) {
+        DanmakuWorkerCommand quit;
+        quit.type = DanmakuWorkerCommandType::Quit;
+        m_workerChannel->push(quit);
+        m_workerChannel->wake();
+        m_updateThread.quit();
+        m_updateThread.wait();
+    }
+}
+
+void DanmakuEngine::moveToSimulationThread(QThread *thread) {
+    m_frameTimer.moveToThread(thread);
+    moveToThread(thread);
+}
+
+void DanmakuEngine::start() {
+    m_lastTickNs = DanmakuFrameClock::nowNs();
+    m_frameTimer.start();
+}
+
+void DanmakuEngine::setViewportSize(qreal width, qreal height) {
+    m_viewportWidth = width;
+    m_viewportHeight = height;
+    ensureLaneStateSize();
+    queueFullSpatialRebuild();
+    queueFullSnapshotRebuild();
+    flushPendingDiffs(false);
+}
+
+void DanmakuEngine::setLaneMetrics(int fontPx, int laneGap) {
+    m_fontPx = std::max(fontPx, 12);
+    m_laneGap = std::max(laneGap, 0);
+    ensureLaneStateSize();
+    queueFullSpatialRebuild();
+    queueFullSnapshotRebuild();
+    flushPendingDiffs(false);
+}
+
+void DanmakuEngine::setPlaybackPaused(bool paused) {
+    if (m_playbackPaused == paused) {
+        return;
+    }
+    m_playbackPaused = paused;
+    m_renderSimulatedAtNs = m_lastTickNs;
+    syncWorkerFullState();
+    republishForFrameClock();
+}
+
+void DanmakuEngine::setPlaybackRate(double rate) {
+    if (qFuzzyCompare(m_playbackRate + 1.0, rate + 1.0)) {
+        return;
+    }
+    m_playbackRate = rate;
+    syncWorkerFullState();
+    republishForFrameClock();
+}
+
+void DanmakuEngine::setTargetFps(int fps) {
+    if (m_targetFps == fps) {
+        return;
+    }
+    m_targetFps = fps;
+    updateFrameTimerInterval();
+    m_densityGovernor.setTargetFps(fps);
+}
+
+void DanmakuEngine::setPerfLogEnabled(bool enabled) {
+    if (m_perfLogEnabled == enabled) {
+        return;
+    }
+
+    m_perfLogEnabled = enabled;
+    m_perfLogWindowStartMs = QDateTime::currentMSecsSinceEpoch();
+    m_perfLogFrameCount = 0;
+    m_perfDanmakuMetrics.resetHistograms();
+    m_perfLogAppendCount = 0;
+    m_perfLogGeometryUpdateCount = 0;
+    m_perfLogRemovedCount = 0;
+    m_perfLanePickCount = 0;
+    m_perfLaneReadyCount = 0;
+    m_perfLaneForcedCount = 0;
+    m_perfLaneWaitTotalMs = 0;
+    m_perfLaneWaitMaxMs = 0;
+    m_perfSpatialFullRebuildCount = 0;
+    m_perfSpatialRowUpdateCount = 0;
+    m_perfLaneIndexResortBaseline = m_laneIndex.resortCount();
+    m_perfSnapshotFullRebuildCount = 0;
+    m_perfSnapshotRowUpdateCount = 0;
+    m_handoff->snapshots().takeCounters();
+    if (m_workerChannel) {
+        m_workerChannel->takeCounters();
+    }
+    if (m_updatePool) {
+        m_updatePool->takeCounters();
+    }
+    m_perfLastTickNs = 0;
+    m_perfLastFrameIntervalNs = 0;
+    m_perfSwapRemoveCount = 0;
+    m_perfDensityTierChangeCount = 0;
+    m_perfDensitySkippedCount = 0;
+    m_perfWorkerLateFrames = 0;
+    m_perfWorkerStaleFrames = 0;
+    m_perfWorkerInFlightMax = 0;
+    m_perfSpriteWidthRefinements = 0;
+    m_perfGlyphNewCodepoints = 0;
+    m_perfGlyphNewNonAsciiCodepoints = 0;
+    m_perfGlyphWarmupSentCodepoints = 0;
+    m_perfGlyphWarmupBatchCount = 0;
+    m_perfGlyphWarmupDroppedCodepoints = 0;
+}
+
+void DanmakuEngine::setGlyphWarmupEnabled(bool enabled) {
+    if (m_glyphWarmupEnabled == enabled) {
+        return;
+    }
+
+    m_glyphWarmupEnabled = enabled;
+    m_glyphWarmupQueue.clear();
+    m_queuedGlyphCodepoints.clear();
+    m_lastGlyphWarmupDispatchMs = 0;
+
+    if (!m_glyphWarmupEnabled) {
+        return;
+    }
+
+    queueGlyphSeedCharacters();
+    for (const char32_t codepoint : m_seenGlyphCodepoints) {
+        queueGlyphCodepoint(codepoint);
+    }
+}
+
+void DanmakuEngine::appendFromCore(const QVariantList &comments, qint64 playbackPositionMs) {
+    const PerfTraceSpan span("DanmakuEngine::appendFromCore");
+    const qint64 appendStartNs = DanmakuFrameClock::nowNs();
+    ensureLaneStateSize();
+    QVector<int> appendedRows;
+    appendedRows.reserve(comments.size());
+    bool appendedAny = false;
+    bool queuedSpriteRaster = false;
+    for (const QVariant &entry : comments) {
+        const QVariantMap map = entry.toMap();
+        const QString commentId = map.value("comment_id").toString();
+        if (commentId.isEmpty()) {
+            continue;
+        }
+        const QString text = map.value("text").toString();
+        observeGlyphText(text);
+
+        const qint64 atMs = map.value("at_ms").toLongLong();
+        const qreal speedPxPerSec = 120 + (qHash(commentId) % 70);
+
+        qreal x = m_viewportWidth + kSpawnOffset;
+        const qint64 lagMs = std::clamp(playbackPositionMs - atMs, qint64(0), kMaxLagCompensationMs);
+        const qreal lagSec = lagMs / 1000.0;
+        x -= (speedPxPerSec * m_playbackRate) * lagSec;
+        if (x + m_textSpriteCache.estimateWidth(text, DanmakuRenderStyle::kTextPixelSize) < kItemCullThreshold) {
+            continue;
+        }
+
+        const DanmakuLaneScheduler::Pick pick = pickLane(x, speedPxPerSec);
+        if (pick.forced && m_densityGovernor.skipLowPriority()) {
+            if (m_perfLogEnabled) {
+                ++m_perfDensitySkippedCount;
+            }
+            continue;
+        }
+
+        const DanmakuStringId textId = m_strings.intern(text);
+        const DanmakuTextSpriteCache::EnsureResult spriteResult =
+            m_textSpriteCache.ensureSprite(textId, DanmakuRenderStyle::kTextPixelSize, spriteDevicePixelRatio());
+        if (spriteResult.queuedRaster) {
+            queuedSpriteRaster = true;
+        }
+        const int lane = pick.lane;
+        const qreal y = lane * (m_fontPx + m_laneGap) + kLaneTopMargin;
+
+        const int row = acquireRow();
+        m_items.x[row] = x;
+        m_items.y[row] = y;
+        m_items.speed[row] = speedPxPerSec;
+        m_items.alpha[row] = 1.0;
+        m_items.flags[row] = DanmakuItemFlagActive;
+        m_items.commentId[row] = m_strings.intern(commentId);
+        m_items.userId[row] = m_strings.intern(map.value("user_id").toString());
+        m_items.text[row] = textId;
+        m_items.spriteId[row] = spriteResult.spriteId;
+        m_items.lane[row] = lane;
+        m_items.originalLane[row] = lane;
+        m_items.widthEstimate[row] = spriteResult.widthEstimate;
+        m_items.fadeRemainingMs[row] = 0;
+        trackEstimatedWidth(row, spriteResult.widthMeasured);
+        appendedRows.push_back(row);
+        m_laneScheduler.assign(lane, x + spriteResult.widthEstimate, speedPxPerSec);
+
+        if (m_perfLogEnabled) {
+            ++m_perfLogAppendCount;
+        }
+        appendedAny = true;
+    }
+
+    if (appendedAny) {
+        if (queuedSpriteRaster) {
+            rasterizePendingSpritesWithinBudget();
+        }
+        queueSpatialUpsertRows(appendedRows);
+        queueSnapshotUpsertRows(appendedRows);
+        flushPendingDiffs(true);
+        syncWorkerRows(appendedRows);
+    }
+    m_densityPendingCostNs += DanmakuFrameClock::nowNs() - appendStartNs;
+}
+
+void DanmakuEngine::setNgDropZoneRect(qreal x, qreal y, qreal width, qreal height) {
+    m_ngZoneX = x;
+    m_ngZoneY = y;
+    m_ngZoneWidth = std::max(0.0, width);
+    m_ngZoneHeight = std::max(0.0, height);
+
+    if (!hasDragging()) {
+        return;
+    }
+
+    bool changed = false;
+    QVector<int> changedRows;
+    for (int i = 0; i < m_items.size(); ++i) {
+        if (!m_items.isActive(i) || !m_items.hasFlag(i, DanmakuItemFlagDragging)) {
+            continue;
+        }
+        const bool hovered = isItemInNgZone(i);
+        if (hovered == m_items.hasFlag(i, DanmakuItemFlagNgDropHovered)) {
+            continue;
+        }
+        m_items.setFlag(i, DanmakuItemFlagNgDropHovered, hovered);
+        changedRows.push_back(i);
+        changed = true;
+    }
+
+    if (changed) {
+        queueSnapshotUpsertRows(changedRows);
+        flushPendingDiffs(true);
+    }
+}
+
+bool DanmakuEngine::beginDragAt(qreal x, qreal y) {
+    const int index = findItemIndexAt(x, y);
+    if (index < 0) {
+        return false;
+    }
+
+    return beginDragInternal(index, x, y, true);
+}
+
+void DanmakuEngine::moveActiveDrag(qreal x, qreal y) {
+    const int row = m_slots.row(m_activeDragHandle);
+    if (row < 0) {
+        return;
+    }
+
+    moveDragInternal(row, x, y, true);
+}
+
+void DanmakuEngine::dropActiveDrag(bool inNgZone) {
+    const int row = m_slots.row(m_activeDragHandle);
+    if (row < 0) {
+        return;
+    }
+
+    dropDragInternal(row, inNgZone);
+}
+
+bool DanmakuEngine::beginDragInternal(int index, qreal pointerX, qreal pointerY, bool hasPointerPosition) {
+    if (index < 0 || index >= m_items.size()) {
+        return false;
+    }
+    if (!m_items.isActive(index) || m_items.hasFlag(index, DanmakuItemFlagDragging)) {
+        return false;
+    }
+
+    m_items.setFlag(index, DanmakuItemFlagFrozen, true);
+    m_items.setFlag(index, DanmakuItemFlagDragging, true);
+    m_items.originalLane[index] = m_items.lane[index];
+    m_items.setFlag(index, DanmakuItemFlagNgDropHovered, isItemInNgZone(index));
+    m_activeDragHandle = m_slots.handleAt(index);
+    if (hasPointerPosition) {
+        m_activeDragOffsetX = pointerX - m_items.x[index];
+        m_activeDragOffsetY = pointerY - m_items.y[index];
+    } else {
+        m_activeDragOffsetX = 0.0;
+        m_activeDragOffsetY = 0.0;
+    }
+
+    updateNgZoneVisibility();
+    syncWorkerRows(QVector<int> {index});
+    queueSnapshotUpsertRow(index);
+    flushPendingDiffs(true);
+    return true;
+}
+
+void DanmakuEngine::moveDragInternal(int index, qreal pointerX, qreal pointerY, bool hasPointerPosition) {
+    if (index < 0 || index >= m_items.size()) {
+        return;
+    }
+
+    if (!m_items.isActive(index) || !m_items.hasFlag(index, DanmakuItemFlagDragging)) {
+        return;
+    }
+
+    if (hasPointerPosition) {
+        m_items.x[index] = pointerX - m_activeDragOffsetX;
+        m_items.y[index] = pointerY - m_activeDragOffsetY;
+    } else {
+        m_items.x[index] = pointerX;
+        m_items.y[index] = pointerY;
+    }
+
+    m_items.setFlag(index, DanmakuItemFlagNgDropHovered, isItemInNgZone(index));
+    syncWorkerRows(QVector<int> {index});
+    queueSpatialUpsertRow(index);
+    queueSnapshotUpsertRow(index);
+    flushPendingDiffs(true);
+}
+
+void DanmakuEngine::dropDragInternal(int index, bool inNgZone) {
+    if (index < 0 || index >= m_items.size()) {
+        return;
+    }
+
+    if (!m_items.isActive(index)) {
+        return;
+    }
+
+    const bool resolvedInNgZone = inNgZone || isItemInNgZone(index);
+    m_activeDragHandle = DanmakuSlotMap::kInvalidHandle;
+    m_activeDragOffsetX = 0.0;
+    m_activeDragOffsetY = 0.0;
+
+    QVector<int> workerRows;
+    if (resolvedInNgZone) {
+        const DanmakuStringId userId = m_items.userId[index];
+        m_items.setFlag(index, DanmakuItemFlagDragging, false);
+        m_items.setFlag(index, DanmakuItemFlagFrozen, true);
+        m_items.setFlag(index, DanmakuItemFlagNgDropHovered, false);
+        m_items.setFlag(index, DanmakuItemFlagPendingNgDraggedOrigin, true);
+        QVector<int> changedRows;
+        for (int row = 0; row < m_items.size(); ++row) {
+            if (!m_items.isActive(row) || m_items.userId[row] != userId) {
+                continue;
+            }
+            m_items.setFlag(row, DanmakuItemFlagPendingNgFade, true);
+            m_items.setFlag(row, DanmakuItemFlagFading, true);
+            m_items.fadeRemainingMs[row] = DanmakuRenderStyle::kFadeDurationMs;
+            changedRows.push_back(row);
+        }
+        workerRows = changedRows;
+        queueSnapshotUpsertRows(changedRows);
+        emit ngDropRequested(m_strings.text(userId));
+    } else {
+        m_items.setFlag(index, DanmakuItemFlagDragging, false);
+        m_items.setFlag(index, DanmakuItemFlagFrozen, false);
+        m_items.setFlag(index, DanmakuItemFlagNgDropHovered, false);
+        recoverToLane(index);
+        workerRows.push_back(index);
+    }
+
+    updateNgZoneVisibility();
+    if (!resolvedInNgZone) {
+        queueSpatialUpsertRow(index);
+        queueSnapshotUpsertRow(index);
+    }
+    flushPendingDiffs(true);
+    if (!workerRows.isEmpty()) {
+        syncWorkerRows(workerRows);
+    }
+}
+
+void DanmakuEngine::applyNgUserFade(const QString &userId) {
+    const DanmakuStringId userKey = m_strings.find(userId);
+    if (userKey == DanmakuStringPool::kInvalidId) {
+        return;
+    }
+
+    bool changed = false;
+    QVector<int> changedRows;
+    for (int row = 0; row < m_items.size(); ++row) {
+        if (m_items.isActive(row) && m_items.userId[row] == userKey) {
+            if (m_items.hasFlag(row, DanmakuItemFlagPendingNgFade)) {
+                m_items.setFlag(row, DanmakuItemFlagPendingNgFade, false);
+                m_items.setFlag(row, DanmakuItemFlagPendingNgDraggedOrigin, false);
+            } else {
+                m_items.setFlag(row, DanmakuItemFlagFading, true);
+                m_items.fadeRemainingMs[row] = DanmakuRenderStyle::kFadeDurationMs;
+            }
+            changedRows.push_back(row);
+            changed = true;
+        }
+    }
+    if (changed) {
+        queueSnapshotUpsertRows(changedRows);
+        flushPendingDiffs(true);
+        syncWorkerRows(changedRows);
+    }
+}
+
+void DanmakuEngine::rollbackPendingNgUserFade(const QString &userId) {
+    const DanmakuStringId userKey = m_strings.find(userId);
+    if (userKey == DanmakuStringPool::kInvalidId) {
+        return;
+    }
+
+    QVector<int> snapshotRows;
+    QVector<int> spatialRows;
+    for (int row = 0; row < m_items.size(); ++row) {
+        if (!m_items.isActive(row)
+            || m_items.userId[row] != userKey
+            || !m_items.hasFlag(row, DanmakuItemFlagPendingNgFade)) {
+            continue;
+        }
+
+        m_items.setFlag(row, DanmakuItemFlagPendingNgFade, false);
+        m_items.setFlag(row, DanmakuItemFlagFading, false);
+        m_items.fadeRemainingMs[row] = 0;
+        m_items.alpha[row] = 1.0;
+        m_items.setFlag(row, DanmakuItemFlagNgDropHovered, false);
+
+        if (m_items.hasFlag(row, DanmakuItemFlagPendingNgDraggedOrigin)) {
+            m_items.setFlag(row, DanmakuItemFlagPendingNgDraggedOrigin, false);
+            m_items.setFlag(row, DanmakuItemFlagFrozen, false);
+            recoverToLane(row);
+            spatialRows.push_back(row);
+        }
+
+        snapshotRows.push_back(row);
+    }
+
+    updateNgZoneVisibility();
+    if (!spatialRows.isEmpty()) {
+        queueSpatialUpsertRows(spatialRows);
+    }
+    if (!snapshotRows.isEmpty()) {
+        queueSnapshotUpsertRows(snapshotRows);
+        flushPendingDiffs(true);
+        syncWorkerRows(snapshotRows);
+    }
+}
+
+void DanmakuEngine::resetForSeek() {
+    invalidateWorkerGeneration();
+    QVector<int> activeRows;
+    activeRows.reserve(m_items.size());
+    for (int i = 0; i < m_items.size(); ++i) {
+        if (m_items.isActive(i)) {
+            activeRows.push_back(i);
+        }
+    }
+    releaseRowsDescending(activeRows);
+    resetLaneStates();
+    m_activeDragHandle = DanmakuSlotMap::kInvalidHandle;
+    m_activeDragOffsetX = 0.0;
+    m_activeDragOffsetY = 0.0;
+    updateNgZoneVisibility();
+    queueFullSpatialRebuild();
+    queueFullSnapshotRebuild();
+    flushPendingDiffs(true);
+    syncWorkerFullState();
+}
+
+void DanmakuEngine::resetGlyphSession() {
+    m_seenGlyphCodepoints.clear();
+    m_warmedGlyphCodepoints.clear();
+    m_queuedGlyphCodepoints.clear();
+    m_glyphWarmupQueue.clear();
+    m_lastGlyphWarmupDispatchMs = 0;
+    m_textSpriteCache.clear();
+    m_handoff->clearSpriteUploads();
+    if (m_glyphWarmupEnabled) {
+        queueGlyphSeedCharacters();
+    }
+}
+
+void DanmakuEngine::setRenderDevicePixelRatio(qreal devicePixelRatio) {
+    const qreal normalized = std::max<qreal>(1.0, devicePixelRatio);
+    if (qFuzzyCompare(m_renderDevicePixelRatio, normalized)) {
+        return;
+    }
+
+    m_renderDevicePixelRatio = normalized;
+    if (m_textSpriteCache.distanceFieldMode()) {
+        return;
+    }
+    m_textSpriteCache.clear();
+    m_handoff->clearSpriteUploads();
+    refreshActiveSpriteIds();
+    syncWorkerFullState();
+}
+
+bool DanmakuEngine::ngDropZoneVisible() const {
+    return m_ngDropZoneVisible;
+}
+
+double DanmakuEngine::commentRenderFps() const {
+    return m_commentRenderFps;
+}
+
+int DanmakuEngine::activeCommentCountMetric() const {
+    return m_activeCommentCount;
+}
+
+int DanmakuEngine::densityTier() const {
+    return m_densityTier;
+}
+
+qint64 DanmakuEngine::overlayMetricsUpdatedAtMs() const {
+    return m_overlayMetricsUpdatedAtMs;
+}
+
+void DanmakuEngine::recordPresentedCommentFrame(qint64 presentedAtMs) {
+    if (m_overlayMetricWindowStartMs <= 0) {
+        m_overlayMetricWindowStartMs = presentedAtMs;
+    }
+    ++m_presentedCommentFrameCount;
+}
+
+int DanmakuEngine::widthMeasurementCountForTesting() const {
+    return m_textSpriteCache.widthMeasurementCountForTesting();
+}
+
+int DanmakuEngine::pendingRasterCountForTesting() const {
+    return m_textSpriteCache.pendingRasterCountForTesting();
+}
+
+void DanmakuEngine::stepFrameForTesting(int elapsedMs) {
+    m_frameTimer.stop();
+    advanceFrameTo(m_lastTickNs + static_cast<qint64>(elapsedMs) * 1000000);
+}
+
+bool DanmakuEngine::workerBusyForTesting() {
+    collectWorkerFrames();
+    return m_workerChannel && m_workerFramesInFlight > m_workerChannel->pendingFrames();
+}
+
+DanmakuFrameClockMode DanmakuEngine::frameClockMode() const {
+    return m_frameClockMode;
+}
+
+void DanmakuEngine::advanceVsyncFrame() {
+    if (m_frameClockMode != DanmakuFrameClockMode::Vsync) {
+        return;
+    }
+    m_lastVsyncTickNs = DanmakuFrameClock::nowNs();
+    onFrame();
+}
+
+bool DanmakuEngine::wantsAnimationFrame() const {
+    if (m_frameClockMode == DanmakuFrameClockMode::Timer || activeItemCount() <= 0) {
+        return false;
+    }
+    if (!m_playbackPaused) {
+        return true;
+    }
+    return m_frameClockMode == DanmakuFrameClockMode::Parametric
+        && m_items.anyActiveWithFlag(DanmakuItemFlagFading);
+}
+
+void DanmakuEngine::onTimerFrame() {
+    if (m_frameClockMode == DanmakuFrameClockMode::Vsync
+        && DanmakuFrameClock::nowNs() - m_lastVsyncTickNs < kVsyncFallbackNs) {
+        return;
+    }
+    onFrame();
+}
+
+void DanmakuEngine::onFrame() {
+    advanceFrameTo(DanmakuFrameClock::nowNs());
+}
+
+void DanmakuEngine::advanceFrameTo(qint64 nowNs) {
+    const PerfTraceSpan span("DanmakuEngine::onFrame");
+    const int elapsedMs = static_cast<int>((nowNs - m_lastTickNs) / 1000000);
+    if (elapsedMs <= 0) {
+        return;
+    }
+    m_lastTickNs += static_cast<qint64>(elapsedMs) * 1000000;
+
+    const qint64 frameStartNs = DanmakuFrameClock::nowNs();
+    runFrame(elapsedMs, nowNs);
+    observeDensityFrame(DanmakuFrameClock::nowNs() - frameStartNs);
+}
+
+void DanmakuEngine::runFrame(int elapsedMs, qint64 nowNs) {
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    if (m_perfLogEnabled) {
+        ++m_perfLogFrameCount;
+        if (m_perfLastTickNs > 0) {
+            const qint64 intervalNs = nowNs - m_perfLastTickNs;
+            m_perfFrameIntervalUs->record(intervalNs / 1000);
+            if (m_perfLastFrameIntervalNs > 0) {
+                m_perfFrameJitterUs->record(std::abs(intervalNs - m_perfLastFrameIntervalNs) / 1000);
+            }
+            m_perfLastFrameIntervalNs = intervalNs;
+        } else {
+            m_perfFrameIntervalUs->record(static_cast<qint64>(elapsedMs) * 1000);
+        }
+        m_perfLastTickNs = nowNs;
+    }
+    if (!m_playbackPaused) {
+        m_laneScheduler.advance((elapsedMs / 1000.0) * m_playbackRate);
+    }
+    updateOverlayMetrics(now);
+    dispatchGlyphWarmupIfDue(now);
+    rasterizePendingSpritesWithinBudget();
+    m_workerDueNs = m_lastTickNs + static_cast<qint64>(elapsedMs) * 500000;
+    if (m_workerFramesInFlight > 0) {
+        collectWorkerFrames();
+        if (m_perfLogEnabled && m_workerFramesInFlight > 0 && oldestWorkerTargetNs() <= m_lastTickNs) {
+            ++m_perfWorkerLateFrames;
+        }
+    }
+
+    if (activeItemCount() == 0) {
+        m_renderSimulatedAtNs = m_lastTickNs;
+        if (m_workerFramesInFlight == 0) {
+            m_workerScheduledThroughNs = m_lastTickNs;
+        }
+        maybeWritePerfLog(now);
+        return;
+    }
+
+    if (m_workerEnabled && m_updateWorker) {
+        scheduleWorkerFrames(elapsedMs);
+        maybeWritePerfLog(now);
+        return;
+    }
+
+    m_renderSimulatedAtNs = m_lastTickNs;
+    runFrameSingleThread(elapsedMs, now);
+}
+
+void DanmakuEngine::observeDensityFrame(qint64 frameCostNs) {
+    DanmakuDensitySample sample;
+    sample.frameCostUs = (frameCostNs + m_densityPendingCostNs) / 1000;
+    sample.activeCount = activeItemCount();
+    sample.rasterBacklog = m_textSpriteCache.pendingRasterCount();
+    sample.uploadBytes = m_densityUploadBytes;
+    m_densityPendingCostNs = 0;
+    m_densityUploadBytes = 0;
+    if (!m_densityGovernor.observe(sample)) {
+        return;
+    }
+
+    const int tier = static_cast<int>(m_densityGovernor.tier());
+    qInfo().noquote() << QString("[danmaku-density] tier=%1 from=%2 name=%3 p95_us=%4 budget_us=%5 active=%6 raster_backlog=%7")
+                             .arg(tier)
+                             .arg(m_densityTier)
+                             .arg(DanmakuDensityGovernor::tierName(m_densityGovernor.tier()))
+                             .arg(m_densityGovernor.lastWindowP95Us())
+                             .arg(m_densityGovernor.frameBudgetUs())
+                             .arg(sample.activeCount)
+                             .arg(sample.rasterBacklog);
+    if (m_perfLogEnabled) {
+        ++m_perfDensityTierChangeCount;
+    }
+    m_densityTier = tier;
+    emit densityTierChanged();
+}
+
+qreal DanmakuEngine::spriteDevicePixelRatio() const {
+    return m_renderDevicePixelRatio * m_densityGovernor.spriteResolutionScale();
+}
+
+void DanmakuEngine::runFrameSingleThread(int elapsedMs, qint64 nowMs) {
+    const qreal elapsedSec = elapsedMs / 1000.0;
+    QVector<int> &changedRows = m_frameChangedRows;
+    changedRows.clear();
+    QVector<int> &spatialRows = m_frameSpatialRows;
+    spatialRows.clear();
+    QVector<int> &removeRows = m_frameRemoveRows;
+    removeRows.clear();
+    int frameGeometryUpdates = 0;
+    bool frameStateChanged = false;
+    bool spatialDirty = false;
+
+    const int rowCount = m_items.size();
+    qreal *xs = m_items.x.data();
+    const qreal *ys = m_items.y.data();
+    const qreal *speeds = m_items.speed.data();
+    qreal *alphas = m_items.alpha.data();
+    quint16 *flags = m_items.flags.data();
+    const int *widths = m_items.widthEstimate.data();
+    const qreal distanceFactor = m_playbackRate * elapsedSec;
+    const bool parametric = m_frameClockMode == DanmakuFrameClockMode::Parametric;
+    for (int i = 0; i < rowCount; ++i) {
+        const quint16 rowFlags = flags[i];
+        if ((rowFlags & DanmakuItemFlagActive) == 0) {
+            continue;
+        }
+
+        bool geometryChanged = false;
+        if (!m_playbackPaused && (rowFlags & DanmakuItemFlagFrozen) == 0) {
+            xs[i] -= speeds[i] * distanceFactor;
+            geometryChanged = true;
+        }
+
+        if ((rowFlags & DanmakuItemFlagFading) != 0) {
+            int &fadeRemainingMs = m_items.fadeRemainingMs[i];
+            fadeRemainingMs -= elapsedMs;
+            if (fadeRemainingMs <= 0) {
+                alphas[i] = 0.0;
+            } else {
+                alphas[i] = std::clamp(fadeRemainingMs / static_cast<double>(DanmakuRenderStyle::kFadeDurationMs), 0.0, 1.0);
+            }
+            geometryChanged = true;
+        }
+
+        const bool dragging = (rowFlags & DanmakuItemFlagDragging) != 0;
+        if (dragging) {
+            const bool hovered = isItemInNgZone(i);
+            if (hovered != ((rowFlags & DanmakuItemFlagNgDropHovered) != 0)) {
+                m_items.setFlag(i, DanmakuItemFlagNgDropHovered, hovered);
+                changedRows.push_back(i);
+                frameStateChanged = true;
+            }
+        }
+
+        if (geometryChanged) {
+            ++frameGeometryUpdates;
+            if (!parametric) {
+                changedRows.push_back(i);
+            }
+            if (dragging) {
+                spatialRows.push_back(i);
+            } else {
+                spatialDirty = true;
+            }
+            frameStateChanged = true;
+        }
+
+        const bool outOfHorizontalBounds = xs[i] + widths[i] < kItemCullThreshold;
+        const bool outOfVerticalBounds = ys[i] > m_viewportHeight || ys[i] + kItemHeight < 0.0;
+        const bool canCull = !dragging && (alphas[i] <= 0.0 || outOfHorizontalBounds || outOfVerticalBounds);
+        if (canCull) {
+            removeRows.push_back(i);
+        }
+    }
+
+    if (m_perfLogEnabled) {
+        m_perfLogGeometryUpdateCount += frameGeometryUpdates;
+    }
+    if (!spatialRows.isEmpty()) {
+        queueSpatialUpsertRows(spatialRows);
+    }
+    if (spatialDirty && !m_playbackPaused) {
+        markSpatialIndexMoved(distanceFactor);
+    }
+    if (!changedRows.isEmpty()) {
+        queueSnapshotUpsertRows(changedRows);
+    }
+    if (!removeRows.isEmpty()) {
+        releaseRowsDescending(removeRows);
+        if (m_perfLogEnabled) {
+            m_perfLogRemovedCount += removeRows.size();
+        }
+        frameStateChanged = true;
+    }
+
+    if (frameStateChanged) {
+        flushPendingDiffs(true);
+    }
+    maybeWritePerfLog(nowMs);
+}
+
+int DanmakuEngine::laneCount() const {
+    const int laneHeight = m_fontPx + m_laneGap;
+    if (laneHeight <= 0) {
+        return 1;
+    }
+    return std::max(1, static_cast<int>(m_viewportHeight / laneHeight));
+}
+
+void DanmakuEngine::ensureLaneStateSize() {
+    m_laneScheduler.setLaneCount(laneCount());
+    m_laneScheduler.setSpawnGeometry(m_viewportWidth + kSpawnOffset, kLaneSpawnGapPx);
+}
+
+void DanmakuEngine::resetLaneStates() {
+    ensureLaneStateSize();
+    m_laneScheduler.reset();
+}
+
+DanmakuLaneScheduler::Pick DanmakuEngine::pickLane(qreal left, qreal speedPxPerSec) {
+    ensureLaneStateSize();
+    const DanmakuLaneScheduler::Pick pick = m_laneScheduler.pick(left, speedPxPerSec);
+    if (m_perfLogEnabled) {
+        ++m_perfLanePickCount;
+        if (pick.forced) {
+            const qreal effectiveRate = std::max(0.01, m_playbackRate);
+            const qint64 waitMs = static_cast<qint64>(std::llround(pick.waitSec * 1000.0 / effectiveRate));
+            ++m_perfLaneForcedCount;
+            m_perfLaneWaitTotalMs += waitMs;
+            m_perfLaneWaitMaxMs = std::max(m_perfLaneWaitMaxMs, waitMs);
+        } else {
+            ++m_perfLaneReadyCount;
+        }
+    }
+    return pick;
+}
+
+bool DanmakuEngine::laneHasCollision(int lane, int candidateRow) {
+    const qreal left = m_items.x[candidateRow];
+    const qreal right = left + m_items.widthEstimate[candidateRow];
+    return m_laneIndex.hasOverlapInLane(lane, left, right, m_slots.handleAt(candidateRow));
+}
+
+void DanmakuEngine::recoverToLane(int row) {
+    const int originalLane = m_items.originalLane[row];
+    m_items.y[row] = originalLane * (m_fontPx + m_laneGap) + kLaneTopMargin;
+    m_items.lane[row] = originalLane;
+
+    if (!laneHasCollision(originalLane, row)) {
+        return;
+    }
+
+    const int lanes = laneCount();
+    for (int offset = 1; offset < lanes; ++offset) {
+        const int up = originalLane - offset;
+        const int down = originalLane + offset;
+
+        if (up >= 0) {
+            m_items.lane[row] = up;
+            m_items.y[row] = up * (m_fontPx + m_laneGap) + kLaneTopMargin;
+            if (!laneHasCollision(up, row)) {
+                return;
+            }
+        }
+
+        if (down < lanes) {
+            m_items.lane[row] = down;
+            m_items.y[row] = down * (m_fontPx + m_laneGap) + kLaneTopMargin;
+            if (!laneHasCollision(down, row)) {
+                return;
+            }
+        }
+    }
+}
+
+int DanmakuEngine::findItemIndexAt(qreal x, qreal y) {
+    return m_laneIndex.rowAt(QPointF(x, y));
+}
+
+int DanmakuEngine::acquireRow() {
+    const int row = m_items.appendRow();
+    m_slots.insert(row);
+    return row;
+}
+
+void DanmakuEngine::releaseRow(int row) {
+    if (row < 0 || row >= m_items.size()) {
+        return;
+    }
+
+    if (!m_items.isActive(row)) {
+        return;
+    }
+
+    m_strings.release(m_items.commentId[row]);
+    m_strings.release(m_items.userId[row]);
+    m_strings.release(m_items.text[row]);
+
+    untrackEstimatedWidth(row);
+    const DanmakuItemHandle handle = m_slots.handleAt(row);
+    if (m_activeDragHandle == handle) {
+        m_activeDragHandle = DanmakuSlotMap::kInvalidHandle;
+        m_activeDragOffsetX = 0.0;
+        m_activeDragOffsetY = 0.0;
+    }
+    m_laneIndex.remove(handle);
+    m_slots.remove(handle);
+
+    const int lastRow = m_items.size() - 1;
+    if (row != lastRow) {
+        m_items.moveRow(lastRow, row);
+        m_slots.relocate(lastRow, row);
+        queueSnapshotUpsertRow(row);
+        if (m_perfLogEnabled) {
+            ++m_perfSwapRemoveCount;
+        }
+    }
+    m_items.truncate(lastRow);
+    m_slots.truncate(lastRow);
+    queueSnapshotRemoveRow(lastRow);
+}
+
+void DanmakuEngine::refreshActiveSpriteIds() {
+    QVector<int> changedRows;
+    changedRows.reserve(activeItemCount());
+    bool queuedSpriteRaster = false;
+    m_estimatedWidthRows.clear();
+    for (int row = 0; row < m_items.size(); ++row) {
+        if (!m_items.isActive(row)) {
+            continue;
+        }
+        const DanmakuTextSpriteCache::EnsureResult spriteResult =
+            m_textSpriteCache.ensureSprite(m_items.text[row], DanmakuRenderStyle::kTextPixelSize, spriteDevicePixelRatio());
+        m_items.spriteId[row] = spriteResult.spriteId;
+        m_items.widthEstimate[row] = spriteResult.widthEstimate;
+        trackEstimatedWidth(row, spriteResult.widthMeasured);
+        if (spriteResult.queuedRaster) {
+            queuedSpriteRaster = true;
+        }
+        changedRows.push_back(row);
+    }
+    if (!changedRows.isEmpty()) {
+        if (queuedSpriteRaster) {
+            rasterizePendingSpritesWithinBudget();
+        }
+        queueSpatialUpsertRows(changedRows);
+        queueSnapshotUpsertRows(changedRows);
+        flushPendingDiffs(true);
+    }
+}
+
+void DanmakuEngine::enqueueSpriteUpload(const DanmakuSpriteUpload &upload) {
+    if (upload.spriteId == 0 || (upload.image.isNull() && upload.glyphs.isEmpty() && upload.glyphImages.isEmpty())) {
+        return;
+    }
+    m_handoff->enqueueSpriteUpload(upload);
+}
+
+void DanmakuEngine::releaseRowsDescending(const QVector<int> &rowsDescending) {
+    if (rowsDescending.isEmpty()) {
+        return;
+    }
+
+    QVector<int> &rows = m_releaseRowsScratch;
+    rows.clear();
+    std::copy(rowsDescending.cbegin(), rowsDescending.cend(), std::back_inserter(rows));
+    std::sort(rows.begin(), rows.end(), std::greater<int>());
+    rows.erase(std::unique(rows.begin(), rows.end()), rows.end());
+    QVector<DanmakuItemHandle> &handles = m_releaseHandlesScratch;
+    handles.clear();
+    for (const int row : rows) {
+        const DanmakuItemHandle handle = m_slots.handleAt(row);
+        if (handle != DanmakuSlotMap::kInvalidHandle) {
+            handles.push_back(handle);
+        }
+        releaseRow(row);
+    }
+    syncWorkerRemoveHandles(handles);
+}
+
+int DanmakuEngine::activeItemCount() const {
+    return m_items.size();
+}
+
+bool DanmakuEngine::hasDragging() const {
+    return m_items.anyActiveWithFlag(DanmakuItemFlagDragging);
+}
+
+void DanmakuEngine::updateNgZoneVisibility() {
+    const bool visible = hasDragging();
+
+    if (visible != m_ngDropZoneVisible) {
+        m_ngDropZoneVisible = visible;
+        emit ngDropZoneVisibleChanged();
+    }
+}
+
+bool DanmakuEngine::isItemInNgZone(int row) const {
+    if (!m_items.isActive(row)) {
+        return false;
+    }
+    if (m_ngZoneWidth <= 0 || m_ngZoneHeight <= 0) {
+        return false;
+    }
+
+    const int widthEstimate = m_items.widthEstimate[row];
+    const qreal itemLeft = m_items.x[row];
+    const qreal itemTop = m_items.y[row];
+    const qreal itemRight = itemLeft + widthEstimate;
+    const qreal itemBottom = itemTop + kItemHeight;
+
+    const qreal zoneLeft = m_ngZoneX;
+    const qreal zoneTop = m_ngZoneY;
+    const qreal zoneRight = zoneLeft + m_ngZoneWidth;
+    const qreal zoneBottom = zoneTop + m_ngZoneHeight;
+
+    const bool overlap = !(itemRight < zoneLeft || zoneRight < itemLeft || itemBottom < zoneTop || zoneBottom < itemTop);
+    if (overlap) {
+        return true;
+    }
+
+    const qreal centerX = itemLeft + widthEstimate / 2.0;
+    const qreal centerY = itemTop + (kItemHeight / 2.0);
+    return centerX >= zoneLeft && centerX <= zoneRight && centerY >= zoneTop && centerY <= zoneBottom;
+}
+
+void DanmakuEngine::observeGlyphText(const QString &text) {
+    if (text.isEmpty()) {
+        return;
+    }
+
+    const QVector<uint> codepoints = text.toUcs4();
+    for (const uint value : codepoints) {
+        const char32_t codepoint = static_cast<char32_t>(value);
+        if (!isTrackableGlyphCodepoint(codepoint)) {
+            continue;
+        }
+
+        if (m_seenGlyphCodepoints.contains(codepoint)) {
+            continue;
+        }
+        m_seenGlyphCodepoints.insert(codepoint);
+
+        ++m_perfGlyphNewCodepoints;
+        if (codepoint > 0x7F) {
+            ++m_perfGlyphNewNonAsciiCodepoints;
+        }
+        queueGlyphCodepoint(codepoint);
+    }
+}
+
+void DanmakuEngine::queueGlyphCodepoint(char32_t codepoint) {
+    if (!m_glyphWarmupEnabled) {
+        return;
+    }
+    if (!isTrackableGlyphCodepoint(codepoint)) {
+        return;
+    }
+    if (m_warmedGlyphCodepoints.contains(codepoint) || m_queuedGlyphCodepoints.contains(codepoint)) {
+        return;
+    }
+    if (m_glyphWarmupQueue.size() >= kGlyphWarmupQueueMax) {
+        ++m_perfGlyphWarmupDroppedCodepoints;
+        return;
+    }
+
+    m_glyphWarmupQueue.enqueue(codepoint);
+    m_queuedGlyphCodepoints.insert(codepoint);
+}
+
+void DanmakuEngine::queueGlyphSeedCharacters() {
+    const QString seed = QString::fromUtf8(kGlyphWarmupSeed);
+    const QVector<uint> codepoints = seed.toUcs4();
+    for (const uint value : codepoints) {
+        queueGlyphCodepoint(static_cast<char32_t>(value));
+    }
+}
+
+void DanmakuEngine::dispatchGlyphWarmupIfDue(qint64 nowMs) {
+    if (!m_glyphWarmupEnabled || !m_glyphWarmer) {
+        return;
+    }
+    if (m_lastGlyphWarmupDispatchMs > 0 && nowMs - m_lastGlyphWarmupDispatchMs < kGlyphWarmupIntervalMs) {
+        return;
+    }
+    if (m_glyphWarmupQueue.isEmpty()) {
+        return;
+    }
+
+    QString batch;
+    batch.reserve(kGlyphWarmupBatchChars * 2);
+
+    int sent = 0;
+    while (sent < kGlyphWarmupBatchChars && !m_glyphWarmupQueue.isEmpty()) {
+        const char32_t codepoint = m_glyphWarmupQueue.dequeue();
+        m_queuedGlyphCodepoints.remove(codepoint);
+        if (m_warmedGlyphCodepoints.contains(codepoint)) {
+            continue;
+        }
+
+        const char32_t raw[] = {codepoint};
+        batch.append(QString::fromUcs4(raw, 1));
+        m_warmedGlyphCodepoints.insert(codepoint);
+        ++sent;
+    }
+
+    if (sent <= 0) {
+        return;
+    }
+
+    m_lastGlyphWarmupDispatchMs = nowMs;
+    m_perfGlyphWarmupSentCodepoints += sent;
+    ++m_perfGlyphWarmupBatchCount;
+    m_glyphWarmer->warm(batch, DanmakuRenderStyle::kTextPixelSize, m_renderDevicePixelRatio);
+}
+
+bool DanmakuEngine::rasterizePendingSpritesWithinBudget() {
+    const PerfTraceSpan span("DanmakuEngine::rasterizePendingSprites");
+    const int spriteBudget =
+        m_textSpriteCache.rasterThreadCount() > 0 ? kSpriteDeliveryBudgetPerFrame : kSpriteRasterBudgetPerFrame;
+    const QVector<DanmakuSpriteUpload> uploads = m_textSpriteCache.rasterizePendingSprites(
+        m_densityGovernor.spriteRasterBudget(spriteBudget),
+        m_densityGovernor.spriteUploadBudgetBytes(kSpriteUploadBudgetBytesPerFrame));
+    applySpriteWidthRefinements();
+    if (uploads.isEmpty()) {
+        return false;
+    }
+
+    for (const DanmakuSpriteUpload &upload : uploads) {
+        m_densityUploadBytes += static_cast<qint64>(upload.image.sizeInBytes());
+        for (const DanmakuGlyphImage &glyph : upload.glyphImages) {
+            m_densityUploadBytes += static_cast<qint64>(glyph.image.sizeInBytes());
+        }
+        enqueueSpriteUpload(upload);
+    }
+    emit renderSnapshotChanged();
+    return true;
+}
+
+void DanmakuEngine::applySpriteWidthRefinements() {
+    const QVector<DanmakuTextSpriteCache::WidthRefinement> refinements = m_textSpriteCache.takeWidthRefinements();
+    if (refinements.isEmpty()) {
+        return;
+    }
+
+    QVector<int> changedRows;
+    QVector<int> widenedRows;
+    for (const DanmakuTextSpriteCache::WidthRefinement &refinement : refinements) {
+        const auto it = m_estimatedWidthRows.find(refinement.spriteId);
+        if (it == m_estimatedWidthRows.end()) {
+            continue;
+        }
+        const QVector<DanmakuItemHandle> handles = std::move(it.value());
+        m_estimatedWidthRows.erase(it);
+        for (const DanmakuItemHandle handle : handles) {
+            const int row = m_slots.row(handle);
+            if (row < 0
+                || !m_items.isActive(row)
+                || m_items.spriteId[row] != refinement.spriteId
+                || m_items.widthEstimate[row] == refinement.widthEstimate) {
+                continue;
+            }
+            if (refinement.widthEstimate > m_items.widthEstimate[row]) {
+                widenedRows.push_back(row);
+            }
+            m_items.widthEstimate[row] = refinement.widthEstimate;
+            changedRows.push_back(row);
+        }
+    }
+    if (changedRows.isEmpty()) {
+        return;
+    }
+
+    if (m_perfLogEnabled) {
+        m_perfSpriteWidthRefinements += changedRows.size();
+    }
+    queueSpatialUpsertRows(changedRows);
+    queueSnapshotUpsertRows(changedRows);
+    syncWorkerRows(widenedRows);
+}
+
+void DanmakuEngine::trackEstimatedWidth(int row, bool widthMeasured) {
+    if (widthMeasured) {
+        return;
+    }
+    m_estimatedWidthRows[m_items.spriteId[row]].push_back(m_slots.handleAt(row));
+}
+
+void DanmakuEngine::untrackEstimatedWidth(int row) {
+    const auto it = m_estimatedWidthRows.find(m_items.spriteId[row]);
+    if (it == m_estimatedWidthRows.end()) {
+        return;
+    }
+    QVector<DanmakuItemHandle> &handles = it.value();
+    const qsizetype index = handles.indexOf(m_slots.handleAt(row));
+    if (index < 0) {
+        return;
+    }
+    handles[index] = handles.last();
+    handles.removeLast();
+    if (handles.isEmpty()) {
+        m_estimatedWidthRows.erase(it);
+    }
+}
+
+DanmakuWorkerRowState DanmakuEngine::buildWorkerRowState(int row) const {
+    DanmakuWorkerRowState rowState;
+    if (row < 0 || row >= m_items.size()) {
+        return rowState;
+    }
+
+    if (!m_items.isActive(row)) {
+        return rowState;
+    }
+
+    quint8 flags = 0;
+    if (m_items.hasFlag(row, DanmakuItemFlagFrozen)) {
+        flags |= DanmakuSoAFlagFrozen;
+    }
+    if (m_items.hasFlag(row, DanmakuItemFlagDragging)) {
+        flags |= DanmakuSoAFlagDragging;
+    }
+    if (m_items.hasFlag(row, DanmakuItemFlagFading)) {
+        flags |= DanmakuSoAFlagFading;
+    }
+
+    rowState.handle = m_slots.handleAt(row);
+    rowState.x = m_items.x[row];
+    rowState.y = m_items.y[row];
+    rowState.speed = m_items.speed[row];
+    rowState.alpha = m_items.alpha[row];
+    rowState.widthEstimate = m_items.widthEstimate[row];
+    rowState.fadeRemainingMs = m_items.fadeRemainingMs[row];
+    rowState.flags = flags;
+    return rowState;
+}
+
+void DanmakuEngine::pushWorkerUpsert(int row) {
+    DanmakuWorkerCommand command;
+    command.type = DanmakuWorkerCommandType::Upsert;
+    command.row = buildWorkerRowState(row);
+    if (command.row.handle != DanmakuSlotMap::kInvalidHandle) {
+        m_workerChannel->push(command);
+    }
+}
+
+void DanmakuEngine::syncWorkerRows(const QVector<int> &rows) {
+    if (!m_workerEnabled || !m_updateWorker || rows.isEmpty()) {
+        return;
+    }
+
+    markWorkerRowsDirty(rows);
+    for (const int row : rows) {
+        pushWorkerUpsert(row);
+    }
+    m_workerChannel->wake();
+}
+
+void DanmakuEngine::syncWorkerRemoveHandles(const QVector<DanmakuItemHandle> &handles) {
+    if (!m_workerEnabled || !m_updateWorker || handles.isEmpty()) {
+        return;
+    }
+
+    markWorkerHandlesRemoved(handles);
+    DanmakuWorkerCommand command;
+    command.type = DanmakuWorkerCommandType::Remove;
+    for (const DanmakuItemHandle handle : handles) {
+        command.row.handle = handle;
+        m_workerChannel->push(command);
+    }
+    m_workerChannel->wake();
+}
+
+void DanmakuEngine::syncWorkerFullState() {
+    if (!m_workerEnabled || !m_updateWorker) {
+        return;
+    }
+
+    invalidateWorkerGeneration();
+    QVector<DanmakuWorkerRowState> rows;
+    rows.reserve(m_items.size());
+    for (int row = 0; row < m_items.size(); ++row) {
+        const DanmakuWorkerRowState rowState = buildWorkerRowState(row);
+        if (rowState.handle != DanmakuSlotMap::kInvalidHandle) {
+            rows.push_back(rowState);
+        }
+    }
+    m_workerChannel->pushFullState(std::move(rows));
+    m_workerChannel->wake();
+}
+
+void DanmakuEngine::markWorkerRowsDirty(const QVector<int> &rows) {
+    if (!m_workerEnabled || m_workerFramesInFlight == 0) {
+        return;
+    }
+    m_workerPendingUntilSeq = m_workerSeq;
+    for (const int row : rows) {
+        const int slot = DanmakuSlotMap::slotOf(m_slots.handleAt(row));
+        if (slot < 0) {
+            continue;
+        }
+        m_workerPendingRemovedRows.remove(slot);
+        m_workerPendingDirtyRows.insert(slot);
+    }
+}
+
+void DanmakuEngine::markWorkerHandlesRemoved(const QVector<DanmakuItemHandle> &handles) {
+    if (!m_workerEnabled || m_workerFramesInFlight == 0) {
+        return;
+    }
+    m_workerPendingUntilSeq = m_workerSeq;
+    for (const DanmakuItemHandle handle : handles) {
+        const int slot = DanmakuSlotMap::slotOf(handle);
+        if (slot < 0) {
+            continue;
+        }
+        m_workerPendingDirtyRows.remove(slot);
+        m_workerPendingRemovedRows.insert(slot);
+    }
+}
+
+void DanmakuEngine::scheduleWorkerFrames(int elapsedMs) {
+    if (!m_updateWorker || activeItemCount() <= 0 || m_workerFramesInFlight >= m_workerPipelineDepth) {
+        return;
+    }
+
+    const qint64 intervalNs = static_cast<qint64>(std::max(elapsedMs, 1)) * 1000000;
+    while (m_workerFramesInFlight < m_workerPipelineDepth) {
+        const qint64 targetNs = std::max(m_workerScheduledThroughNs, m_lastTickNs) + intervalNs;
+        const qint64 stepNs = std::min(targetNs - m_workerScheduledThroughNs, kWorkerElapsedCapMs * 1000000);
+        DanmakuWorkerCommand command;
+        command.type = DanmakuWorkerCommandType::Frame;
+        command.frame.seq = ++m_workerSeq;
+        command.frame.generation = m_workerGeneration;
+        command.frame.targetNs = targetNs;
+        command.frame.playbackPaused = m_playbackPaused;
+        command.frame.playbackRate = static_cast<qreal>(m_playbackRate);
+        command.frame.elapsedMs = static_cast<int>(stepNs / 1000000);
+        command.frame.viewportHeight = m_viewportHeight;
+        command.frame.cullThreshold = kItemCullThreshold;
+        command.frame.itemHeight = kItemHeight;
+        m_workerChannel->push(command);
+        m_workerTargetNs[static_cast<size_t>(m_workerSeq % DanmakuWorkerChannel::kFrameSlots)] = targetNs;
+        m_workerScheduledThroughNs = targetNs;
+        ++m_workerFramesInFlight;
+    }
+    m_workerChannel->wake();
+    if (m_perfLogEnabled) {
+        m_perfWorkerInFlightMax = std::max(m_perfWorkerInFlightMax, m_workerFramesInFlight);
+    }
+}
+
+void DanmakuEngine::collectWorkerFrames() {
+    while (m_workerFramesInFlight > 0) {
+        const DanmakuWorkerFrameColumns *frame = m_workerChannel->acquireFrame();
+        if (!frame) {
+            return;
+        }
+        if (frame->generation != m_workerGeneration) {
+            m_workerChannel->releaseFrame();
+            --m_workerFramesInFlight;
+            if (m_perfLogEnabled) {
+                ++m_perfWorkerStaleFrames;
+            }
+            continue;
+        }
+        if (frame->targetNs > m_workerDueNs) {
+            return;
+        }
+        applyWorkerFrame(*frame);
+    }
+}
+
+qint64 DanmakuEngine::oldestWorkerTargetNs() const {
+    const qint64 oldestSeq = m_workerSeq - m_workerFramesInFlight + 1;
+    return m_workerTargetNs[static_cast<size_t>(oldestSeq % DanmakuWorkerChannel::kFrameSlots)];
+}
+
+void DanmakuEngine::applyWorkerFrame(const DanmakuWorkerFrameColumns &frame) {
+    const qint64 applyStartNs = DanmakuFrameClock::nowNs();
+    const qint64 seq = frame.seq;
+    m_renderSimulatedAtNs = frame.targetNs;
+    const bool skipPending = seq <= m_workerPendingUntilSeq;
+
+    m_workerAcceptedChangedRows.clear();
+    bool skippedPendingRows = false;
+    const int changedCount = frame.changedCount();
+    for (int i = 0; i < changedCount; ++i) {
+        const DanmakuItemHandle handle = frame.changedHandles[i];
+        const int row = m_slots.row(handle);
+        if (row < 0 || row >= m_items.size()) {
+            continue;
+        }
+        const int slot = DanmakuSlotMap::slotOf(handle);
+        if (skipPending && (m_workerPendingDirtyRows.contains(slot) || m_workerPendingRemovedRows.contains(slot))) {
+            skippedPendingRows = true;
+            continue;
+        }
+        if (!m_items.isActive(row)) {
+            continue;
+        }
+        m_items.x[row] = frame.x[i];
+        m_items.alpha[row] = frame.alpha[i];
+        m_items.fadeRemainingMs[row] = frame.fadeRemainingMs[i];
+        m_workerAcceptedChangedRows.push_back(row);
+    }
+
+    m_workerAcceptedRemoveRows.clear();
+    for (const DanmakuItemHandle handle : frame.removedHandles) {
+        const int row = m_slots.row(handle);
+        if (row < 0) {
+            continue;
+        }
+        const int slot = DanmakuSlotMap::slotOf(handle);
+        if (skipPending && (m_workerPendingDirtyRows.contains(slot) || m_workerPendingRemovedRows.contains(slot))) {
+            continue;
+        }
+        m_workerAcceptedRemoveRows.push_back(row);
+    }
+    m_workerChannel->releaseFrame();
+    --m_workerFramesInFlight;
+
+    if (skippedPendingRows) {
+        m_laneIndex.invalidateOrder();
+    }
+    if (!m_workerAcceptedChangedRows.isEmpty()) {
+        markSpatialIndexMoved(frame.travel);
+        queueSnapshotUpsertRows(m_workerAcceptedChangedRows);
+    }
+
+    if (m_perfLogEnabled) {
+        m_perfLogGeometryUpdateCount += m_workerAcceptedChangedRows.size();
+    }
+
+    if (!m_workerAcceptedRemoveRows.isEmpty()) {
+        releaseRowsDescending(m_workerAcceptedRemoveRows);
+        if (m_perfLogEnabled) {
+            m_perfLogRemovedCount += m_workerAcceptedRemoveRows.size();
+        }
+    }
+
+    if (!m_workerAcceptedChangedRows.isEmpty() || !m_workerAcceptedRemoveRows.isEmpty()) {
+        flushPendingDiffs(true);
+    }
+
+    if (seq >= m_workerPendingUntilSeq) {
+        m_workerPendingDirtyRows.clear();
+        m_workerPendingRemovedRows.clear();
+    }
+    m_densityPendingCostNs += DanmakuFrameClock::nowNs() - applyStartNs;
+}
+
+void DanmakuEngine::invalidateWorkerGeneration() {
+    if (!m_workerEnabled) {
+        return;
+    }
+    ++m_workerGeneration;
+    m_workerScheduledThroughNs = m_renderSimulatedAtNs;
+    m_workerPendingUntilSeq = 0;
+    m_workerPendingDirtyRows.clear();
+    m_workerPendingRemovedRows.clear();
+}
+
+void DanmakuEngine::updateFrameTimerInterval() {
+    const int fps = std::clamp(m_targetFps, 10, 120);
+    const int intervalMs = std::max(1, static_cast<int>(std::lround(1000.0 / fps)));
+    m_frameTimer.setInterval(intervalMs);
+}
+
+DanmakuRenderInstance DanmakuEngine::buildRenderInstance(int row) const {
+    DanmakuRenderInstance instance;
+    instance.commentId = m_strings.text(m_items.commentId[row]);
+    instance.spriteId = m_items.spriteId[row];
+    instance.x = m_items.x[row];
+    instance.y = m_items.y[row];
+    instance.alpha = m_items.alpha[row];
+    instance.speed = (m_items.flags[row] & (DanmakuItemFlagFrozen | DanmakuItemFlagDragging)) != 0
+        ? 0.0
+        : m_items.speed[row];
+    if (m_frameClockMode == DanmakuFrameClockMode::Parametric) {
+        instance.anchorScrollSec = m_laneScheduler.now();
+        if (m_items.hasFlag(row, DanmakuItemFlagFading)) {
+            instance.fadeEndSec = (m_lastTickNs - m_clockEpochNs + m_items.fadeRemainingMs[row] * qint64(1000000))
+                / 1000000000.0;
+        }
+    }
+    instance.widthEstimate = m_items.widthEstimate[row];
+    instance.ngDropHovered = m_items.hasFlag(row, DanmakuItemFlagNgDropHovered);
+    return instance;
+}
+
+void DanmakuEngine::queueSpatialUpsertRow(int row) {
+    if (row < 0) {
+        return;
+    }
+    if (m_pendingFullSpatialRebuild) {
+        return;
+    }
+    m_pendingSpatialUpsertRows.insert(row);
+}
+
+void DanmakuEngine::queueSpatialUpsertRows(const QVector<int> &rows) {
+    for (const int row : rows) {
+        queueSpatialUpsertRow(row);
+    }
+}
+
+void DanmakuEngine::queueSnapshotUpsertRow(int row) {
+    if (row < 0) {
+        return;
+    }
+    if (m_pendingFullSnapshotRebuild) {
+        return;
+    }
+    m_pendingSnapshotRemoveRows.remove(row);
+    m_pendingSnapshotUpsertRows.insert(row);
+}
+
+void DanmakuEngine::queueSnapshotUpsertRows(const QVector<int> &rows) {
+    for (const int row : rows) {
+        queueSnapshotUpsertRow(row);
+    }
+}
+
+void DanmakuEngine::queueSnapshotRemoveRow(int row) {
+    if (row < 0) {
+        return;
+    }
+    if (m_pendingFullSnapshotRebuild) {
+        return;
+    }
+    m_pendingSnapshotUpsertRows.remove(row);
+    m_pendingSnapshotRemoveRows.insert(row);
+}
+
+void DanmakuEngine::queueSnapshotRemoveRows(const QVector<int> &rows) {
+    for (const int row : rows) {
+        queueSnapshotRemoveRow(row);
+    }
+}
+
+void DanmakuEngine::queueFullSpatialRebuild() {
+    m_pendingFullSpatialRebuild = true;
+    m_pendingSpatialUpsertRows.clear();
+}
+
+void DanmakuEngine::queueFullSnapshotRebuild() {
+    m_pendingFullSnapshotRebuild = true;
+    m_pendingSnapshotUpsertRows.clear();
+    m_pendingSnapshotRemoveRows.clear();
+}
+
+void DanmakuEngine::rebuildSpatialIndex() {
+    m_laneIndex.setGeometry(laneCount(), kLaneTopMargin, static_cast<qreal>(m_fontPx + m_laneGap), kItemHeight);
+    m_laneIndex.rebuild();
+}
+
+void DanmakuEngine::rebuildRenderSnapshot() {
+    m_renderCache.clear();
+    m_renderRows.clear();
+    m_renderCache.reserve(activeItemCount());
+    m_renderRows.reserve(activeItemCount());
+    m_rowToRenderIndex.resize(m_items.size());
+    std::fill(m_rowToRenderIndex.begin(), m_rowToRenderIndex.end(), -1);
+
+    for (int row = 0; row < m_items.size(); ++row) {
+        if (!m_items.isActive(row)) {
+            continue;
+        }
+
+        m_rowToRenderIndex[row] = m_renderCache.size();
+        m_renderRows.push_back(row);
+        m_renderCache.push_back(buildRenderInstance(row));
+    }
+    publishRenderSnapshot();
+}
+
+void DanmakuEngine::ensureRowToRenderIndexSize() {
+    if (m_rowToRenderIndex.size() >= m_items.size()) {
+        return;
+    }
+
+    const int oldSize = m_rowToRenderIndex.size();
+    m_rowToRenderIndex.resize(m_items.size());
+    std::fill(m_rowToRenderIndex.begin() + oldSize, m_rowToRenderIndex.end(), -1);
+}
+
+void DanmakuEngine::markSpatialIndexMoved(qreal travel) {
+    m_laneIndex.markMoved(travel);
+}
+
+bool DanmakuEngine::applySnapshotRowUpsert(int row) {
+    if (row < 0 || row >= m_items.size()) {
+        return applySnapshotRowRemoval(row);
+    }
+
+    ensureRowToRenderIndexSize();
+    if (!m_items.isActive(row)) {
+        return applySnapshotRowRemoval(row);
+    }
+
+    const int existingIndex = (row < m_rowToRenderIndex.size()) ? m_rowToRenderIndex[row] : -1;
+    if (existingIndex >= 0 && existingIndex < m_renderCache.size() && existingIndex < m_renderRows.size()) {
+        m_renderCache[existingIndex] = buildRenderInstance(row);
+        return true;
+    }
+
+    m_rowToRenderIndex[row] = m_renderCache.size();
+    m_renderRows.push_back(row);
+    m_renderCache.push_back(buildRenderInstance(row));
+    return true;
+}
+
+bool DanmakuEngine::applySnapshotRowRemoval(int row) {
+    if (row < 0 || row >= m_rowToRenderIndex.size()) {
+        return false;
+    }
+    const int index = m_rowToRenderIndex[row];
+    if (index < 0 || index >= m_renderCache.size() || index >= m_renderRows.size()) {
+        m_rowToRenderIndex[row] = -1;
+        return false;
+    }
+
+    const int lastIndex = m_renderCache.size() - 1;
+    if (index != lastIndex) {
+        const int movedRow = m_renderRows[lastIndex];
+        m_renderCache[index] = std::move(m_renderCache[lastIndex]);
+        m_renderRows[index] = movedRow;
+        if (movedRow >= 0 && movedRow < m_rowToRenderIndex.size()) {
+            m_rowToRenderIndex[movedRow] = index;
+        }
+    }
+    m_renderCache.removeLast();
+    m_renderRows.removeLast();
+    m_rowToRenderIndex[row] = -1;
+    return true;
+}
+
+void DanmakuEngine::publishRenderSnapshot() {
+    DanmakuRenderFrame &frame = m_handoff->snapshots().backFrame();
+    frame.simulatedAtNs = m_frameClockMode != DanmakuFrameClockMode::Timer ? m_renderSimulatedAtNs : 0;
+    frame.scrollRate = m_playbackPaused ? 0.0 : m_playbackRate;
+    frame.parametric = m_frameClockMode == DanmakuFrameClockMode::Parametric;
+    frame.scrollSec = frame.parametric ? m_laneScheduler.now() : 0.0;
+    frame.clockEpochNs = frame.parametric ? m_clockEpochNs : 0;
+    frame.instances.resize(m_renderCache.size());
+    std::copy(m_renderCache.cbegin(), m_renderCache.cend(), frame.instances.begin());
+    m_handoff->snapshots().publish();
+    m_handoff->setWantsAnimationFrame(wantsAnimationFrame());
+}
+
+void DanmakuEngine::republishForFrameClock() {
+    if (m_frameClockMode == DanmakuFrameClockMode::Timer) {
+        return;
+    }
+    publishRenderSnapshot();
+    emit renderSnapshotChanged();
+}
+
+void DanmakuEngine::flushPendingDiffs(bool emitSnapshotSignal) {
+    const PerfTraceSpan span("DanmakuEngine::flushPendingDiffs");
+    if (m_pendingFullSpatialRebuild) {
+        rebuildSpatialIndex();
+        m_pendingFullSpatialRebuild = false;
+        m_pendingSpatialUpsertRows.clear();
+        if (m_perfLogEnabled) {
+            ++m_perfSpatialFullRebuildCount;
+        }
+    } else if (!m_pendingSpatialUpsertRows.isEmpty()) {
+        m_pendingSpatialUpsertRows.forEachAscending([this](int row) {
+            if (row < m_items.size()) {
+                m_laneIndex.upsert(m_slots.handleAt(row));
+            }
+        });
+        if (m_perfLogEnabled) {
+            m_perfSpatialRowUpdateCount += m_pendingSpatialUpsertRows.size();
+        }
+        m_pendingSpatialUpsertRows.clear();
+    }
+
+    bool snapshotChanged = false;
+    if (m_pendingFullSnapshotRebuild) {
+        rebuildRenderSnapshot();
+        m_pendingFullSnapshotRebuild = false;
+        m_pendingSnapshotUpsertRows.clear();
+        m_pendingSnapshotRemoveRows.clear();
+        snapshotChanged = true;
+        if (m_perfLogEnabled) {
+            ++m_perfSnapshotFullRebuildCount;
+        }
+    } else if (!m_pendingSnapshotUpsertRows.isEmpty() || !m_pendingSnapshotRemoveRows.isEmpty()) {
+        bool rowChanged = false;
+        m_pendingSnapshotRemoveRows.forEachDescending([this, &rowChanged](int row) {
+            rowChanged = applySnapshotRowRemoval(row) || rowChanged;
+        });
+        m_pendingSnapshotUpsertRows.forEachAscending([this, &rowChanged](int row) {
+            rowChanged = applySnapshotRowUpsert(row) || rowChanged;
+        });
+        if (rowChanged) {
+            publishRenderSnapshot();
+            snapshotChanged = true;
+        }
+        if (m_perfLogEnabled) {
+            m_perfSnapshotRowUpdateCount += m_pendingSnapshotRemoveRows.size() + m_pendingSnapshotUpsertRows.size();
+        }
+        m_pendingSnapshotUpsertRows.clear();
+        m_pendingSnapshotRemoveRows.clear();
+    }
+
+    if (snapshotChanged && emitSnapshotSignal) {
+        emit renderSnapshotChanged();
+    }
+}
+
+void DanmakuEngine::updateOverlayMetrics(qint64 nowMs) {
+    if (m_overlayMetricWindowStartMs <= 0) {
+        m_overlayMetricWindowStartMs = nowMs;
+        m_presentedCommentFrameCount = 0;
+    }
+
+    const qint64 elapsedMs = nowMs - m_overlayMetricWindowStartMs;
+    if (elapsedMs >= 2000) {
+        const double fps = elapsedMs > 0 ? (m_presentedCommentFrameCount * 1000.0 / elapsedMs) : 0.0;
+        if (std::abs(m_commentRenderFps - fps) > 0.05) {
+            m_commentRenderFps = fps;
+            emit commentRenderFpsChanged();
+        }
+        m_overlayMetricWindowStartMs = nowMs;
+        m_presentedCommentFrameCount = 0;
+    }
+
+    const int count = activeItemCount();
+    if (m_activeCommentCount != count) {
+        m_activeCommentCount = count;
+        emit activeCommentCountChanged();
+    }
+
+    if (m_overlayMetricsUpdatedAtMs != nowMs) {
+        m_overlayMetricsUpdatedAtMs = nowMs;
+        emit overlayMetricsUpdatedAtMsChanged();
+    }
+}
+
+void DanmakuEngine::maybeWritePerfLog(qint64 nowMs) {
+    if (!m_perfLogEnabled) {
+        return;
+    }
+
+    if (m_perfLogWindowStartMs <= 0) {
+        m_perfLogWindowStartMs = nowMs;
+        return;
+    }
+
+    const qint64 elapsedMs = nowMs - m_perfLogWindowStartMs;
+    if (elapsedMs < 2000) {
+        return;
+    }
+
+    const double fps = elapsedMs > 0 ? (m_perfLogFrameCount * 1000.0 / elapsedMs) : 0.0;
+    const double p95Ms = m_perfFrameIntervalUs->valueAtPercentile(95.0) / 1000.0;
+    const double p99Ms = m_perfFrameIntervalUs->valueAtPercentile(99.0) / 1000.0;
+    const double laneWaitAvgMs = m_perfLanePickCount > 0
+        ? (static_cast<double>(m_perfLaneWaitTotalMs) / m_perfLanePickCount)
+        : 0.0;
+    const DanmakuRenderSnapshotChannel::Counters snapshotCounters = m_handoff->snapshots().takeCounters();
+    const DanmakuWorkerChannel::Counters workerCounters =
+        m_workerChannel ? m_workerChannel->takeCounters() : DanmakuWorkerChannel::Counters();
+    const DanmakuUpdatePool::Counters poolCounters =
+        m_updatePool ? m_updatePool->takeCounters() : DanmakuUpdatePool::Counters();
+
+    PerfMetricScope &danmaku = m_perfDanmakuMetrics;
+    danmaku.setCounter(QStringLiteral("window_ms"), elapsedMs);
+    danmaku.setCounter(QStringLiteral("frame_count"), m_perfLogFrameCount);
+    danmaku.setGauge(QStringLiteral("fps"), fps, 1);
+    danmaku.setGauge(QStringLiteral("avg_ms"), m_perfFrameIntervalUs->mean() / 1000.0);
+    danmaku.setGauge(QStringLiteral("p50_ms"), m_perfFrameIntervalUs->valueAtPercentile(50.0) / 1000.0);
+    danmaku.setGauge(QStringLiteral("p95_ms"), p95Ms);
+    danmaku.setGauge(QStringLiteral("p99_ms"), p99Ms);
+    danmaku.setGauge(QStringLiteral("max_ms"), m_perfFrameIntervalUs->max() / 1000.0);
+    danmaku.setGauge(QStringLiteral("rows_total"), m_items.size(), 0);
+    danmaku.setGauge(QStringLiteral("rows_active"), activeItemCount(), 0);
+    danmaku.setGauge(QStringLiteral("slots_free"), m_slots.freeSlotCount(), 0);
+    danmaku.setCounter(QStringLiteral("swap_removes"), m_perfSwapRemoveCount);
+    danmaku.setCounter(QStringLiteral("appended"), m_perfLogAppendCount);
+    danmaku.setCounter(QStringLiteral("updates"), m_perfLogGeometryUpdateCount);
+    danmaku.setCounter(QStringLiteral("removed"), m_perfLogRemovedCount);
+    danmaku.setCounter(QStringLiteral("lane_pick_count"), m_perfLanePickCount);
+    danmaku.setCounter(QStringLiteral("lane_ready_count"), m_perfLaneReadyCount);
+    danmaku.setCounter(QStringLiteral("lane_forced_count"), m_perfLaneForcedCount);
+    danmaku.setGauge(QStringLiteral("lane_wait_ms_avg"), laneWaitAvgMs);
+    danmaku.setGauge(QStringLiteral("lane_wait_ms_max"), m_perfLaneWaitMaxMs, 0);
+    danmaku.setGauge(QStringLiteral("dragging"), hasDragging() ? 1 : 0, 0);
+    danmaku.setGauge(QStringLiteral("paused"), m_playbackPaused ? 1 : 0, 0);
+    danmaku.setGauge(QStringLiteral("rate"), m_playbackRate);
+    danmaku.setCounter(QStringLiteral("spatial_full_rebuilds"), m_perfSpatialFullRebuildCount);
+    danmaku.setCounter(QStringLiteral("spatial_row_updates"), m_perfSpatialRowUpdateCount);
+    danmaku.setCounter(
+        QStringLiteral("lane_index_resorts"), m_laneIndex.resortCount() - m_perfLaneIndexResortBaseline);
+    danmaku.setCounter(QStringLiteral("snapshot_full_rebuilds"), m_perfSnapshotFullRebuildCount);
+    danmaku.setCounter(QStringLiteral("snapshot_row_updates"), m_perfSnapshotRowUpdateCount);
+    danmaku.setCounter(QStringLiteral("snapshot_published"), static_cast<qint64>(snapshotCounters.published));
+    danmaku.setCounter(QStringLiteral("snapshot_consumed"), static_cast<qint64>(snapshotCounters.consumed));
+    danmaku.setCounter(QStringLiteral("snapshot_skipped"), static_cast<qint64>(snapshotCounters.skipped));
+    danmaku.setCounter(QStringLiteral("snapshot_detached"), static_cast<qint64>(snapshotCounters.detached));
+    danmaku.setCounter(QStringLiteral("worker_commands"), static_cast<qint64>(workerCounters.commands));
+    danmaku.setCounter(QStringLiteral("worker_ring_stalls"), static_cast<qint64>(workerCounters.ringStalls));
+    danmaku.setCounter(QStringLiteral("worker_frames"), static_cast<qint64>(workerCounters.framesPublished));
+    danmaku.setCounter(QStringLiteral("worker_late_frames"), m_perfWorkerLateFrames);
+    danmaku.setCounter(QStringLiteral("worker_stale_frames"), m_perfWorkerStaleFrames);
+    danmaku.setGauge(QStringLiteral("worker_inflight_max"), m_perfWorkerInFlightMax, 0);
+    danmaku.setGauge(QStringLiteral("update_threads"), m_updatePool ? m_updatePool->threadCount() : 1, 0);
+    danmaku.setCounter(QStringLiteral("update_parallel_frames"), static_cast<qint64>(poolCounters.parallelFrames));
+    danmaku.setCounter(QStringLiteral("update_serial_frames"), static_cast<qint64>(poolCounters.serialFrames));
+    danmaku.setCounter(QStringLiteral("update_chunks"), static_cast<qint64>(poolCounters.chunks));
+    danmaku.setCounter(QStringLiteral("update_stolen_chunks"), static_cast<qint64>(poolCounters.stolenChunks));
+    danmaku.setGauge(
+        QStringLiteral("update_scaling"),
+        poolCounters.wallNs > 0 ? static_cast<double>(poolCounters.busyNs) / poolCounters.wallNs : 0.0,
+        2);
+    danmaku.setLabel(QStringLiteral("clock"), DanmakuFrameClock::modeName(m_frameClockMode));
+    danmaku.setGauge(QStringLiteral("jitter_ms_avg"), m_perfFrameJitterUs->mean() / 1000.0, 3);
+    danmaku.setGauge(QStringLiteral("jitter_ms_max"), m_perfFrameJitterUs->max() / 1000.0, 3);
+    danmaku.setGauge(QStringLiteral("density_tier"), static_cast<int>(m_densityGovernor.tier()), 0);
+    danmaku.setLabel(QStringLiteral("density_tier_name"), DanmakuDensityGovernor::tierName(m_densityGovernor.tier()));
+    danmaku.setCounter(QStringLiteral("density_tier_changes"), m_perfDensityTierChangeCount);
+    danmaku.setCounter(QStringLiteral("density_skipped"), m_perfDensitySkippedCount);
+    danmaku.setGauge(QStringLiteral("density_cost_p95_us"), m_densityGovernor.lastWindowP95Us(), 0);
+    danmaku.setGauge(QStringLiteral("raster_backlog"), m_textSpriteCache.pendingRasterCount(), 0);
+    danmaku.setGauge(QStringLiteral("raster_threads"), m_textSpriteCache.rasterThreadCount(), 0);
+    danmaku.setGauge(QStringLiteral("raster_jobs_inflight"), m_textSpriteCache.rasterJobsInFlight(), 0);
+    danmaku.setCounter(QStringLiteral("sprite_width_refinements"), m_perfSpriteWidthRefinements);
+    PerfMetricsRegistry::instance().publish(danmaku, nowMs);
+
+    PerfMetricScope &glyph = m_perfGlyphMetrics;
+    glyph.setCounter(QStringLiteral("window_ms"), elapsedMs);
+    glyph.setCounter(QStringLiteral("new_cp_total"), m_perfGlyphNewCodepoints);
+    glyph.setCounter(QStringLiteral("new_cp_non_ascii"), m_perfGlyphNewNonAsciiCodepoints);
+    glyph.setCounter(QStringLiteral("warmup_sent_cp"), m_perfGlyphWarmupSentCodepoints);
+    glyph.setCounter(QStringLiteral("warmup_batches"), m_perfGlyphWarmupBatchCount);
+    glyph.setGauge(QStringLiteral("warmup_pending_cp"), m_glyphWarmupQueue.size(), 0);
+    glyph.setCounter(QStringLiteral("warmup_dropped_cp"), m_perfGlyphWarmupDroppedCodepoints);
+    glyph.setGauge(QStringLiteral("warmup_enabled"), m_glyphWarmupEnabled ? 1 : 0, 0);
+    glyph.setGauge(QStringLiteral("p95_ms"), p95Ms);
+    glyph.setGauge(QStringLiteral("p99_ms"), p99Ms);
+    glyph.setGauge(QStringLiteral("warmup_inflight"), m_glyphWarmer ? m_glyphWarmer->inflightBatchCount() : 0, 0);
+    glyph.setGauge(QStringLiteral("fallback_blocks"), m_glyphWarmer ? m_glyphWarmer->resolvedBlockCount() : 0, 0);
+    PerfMetricsRegistry::instance().publish(glyph, nowMs);
+
+    m_perfLogWindowStartMs = nowMs;
+    m_perfLogFrameCount = 0;
+    m_perfDanmakuMetrics.resetHistograms();
+    m_perfLogAppendCount = 0;
+    m_perfLogGeometryUpdateCount = 0;
+    m_perfLogRemovedCount = 0;
+    m_perfLanePickCount = 0;
+    m_perfLaneReadyCount = 0;
+    m_perfLaneForcedCount = 0;
+    m_perfLaneWaitTotalMs = 0;
+    m_perfLaneWaitMaxMs = 0;
+    m_perfSpatialFullRebuildCount = 0;
+    m_perfSpatialRowUpdateCount = 0;
+    m_perfLaneIndexResortBaseline = m_laneIndex.resortCount();
+    m_perfSnapshotFullRebuildCount = 0;
+    m_perfSnapshotRowUpdateCount = 0;
+    m_perfSwapRemoveCount = 0;
+    m_perfDensityTierChangeCount = 0;
+    m_perfDensitySkippedCount = 0;
+    m_perfWorkerLateFrames = 0;
+    m_perfWorkerStaleFrames = 0;
+    m_perfWorkerInFlightMax = 0;
+    m_perfSpriteWidthRefinements = 0;
+    m_perfGlyphNewCodepoints = 0;
+    m_perfGlyphNewNonAsciiCodepoints = 0;
+    m_perfGlyphWarmupSentCodepoints = 0;
+    m_perfGlyphWarmupBatchCount = 0;
+    m_perfGlyphWarmupDroppedCodepoints = 0;
+}
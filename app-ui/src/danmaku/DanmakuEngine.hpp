@@ -0,0 +1,270 @@
+#pragma once
+
+#include "danmaku/DanmakuDensityGovernor.hpp"
+#include "danmaku/DanmakuDirtyRowSet.hpp"
+#include "danmaku/DanmakuFrameClock.hpp"
+#include "danmaku/DanmakuItemStore.hpp"
+#include "danmaku/DanmakuLaneIndex.hpp"
+#include "danmaku/DanmakuLaneScheduler.hpp"
+#include "danmaku/DanmakuRenderFrame.hpp"
+#include "danmaku/DanmakuRenderHandoff.hpp"
+#include "danmaku/DanmakuSlotMap.hpp"
+#include "danmaku/DanmakuSoAState.hpp"
+#include "danmaku/DanmakuStringPool.hpp"
+#include "danmaku/DanmakuTextSpriteCache.hpp"
+#include "danmaku/DanmakuUpdatePool.hpp"
+#include "danmaku/DanmakuWorkerChannel.hpp"
+#include "perf/PerfMetricScope.hpp"
+
+#include <QObject>
+#include <QQueue>
+#include <QSet>
+#include <QString>
+#include <QThread>
+#include <QTimer>
+#include <QVariantList>
+#include <QVector>
+
+#include <array>
+#include <memory>
+
+class DanmakuGlyphWarmer;
+class DanmakuUpdateWorker;
+
+class DanmakuEngine : public QObject {
+    Q_OBJECT
+
+public:
+    DanmakuEngine(DanmakuRenderHandoff *handoff, bool simulationThread, QObject *parent = nullptr);
+    ~DanmakuEngine() override;
+
+    void moveToSimulationThread(QThread *thread);
+    void start();
+
+    void setViewportSize(qreal width, qreal height);
+    void setLaneMetrics(int fontPx, int laneGap);
+    void setPlaybackPaused(bool paused);
+    void setPlaybackRate(double rate);
+    void setTargetFps(int fps);
+    void setPerfLogEnabled(bool enabled);
+    void setGlyphWarmupEnabled(bool enabled);
+    void appendFromCore(const QVariantList &comments, qint64 playbackPositionMs);
+    void resetForSeek();
+    void resetGlyphSession();
+    void setRenderDevicePixelRatio(qreal devicePixelRatio);
+
+    bool beginDragAt(qreal x, qreal y);
+    void moveActiveDrag(qreal x, qreal y);
+    void dropActiveDrag(bool inNgZone);
+    void setNgDropZoneRect(qreal x, qreal y, qreal width, qreal height);
+
+    void applyNgUserFade(const QString &userId);
+    void rollbackPendingNgUserFade(const QString &userId);
+
+    bool ngDropZoneVisible() const;
+    double commentRenderFps() const;
+    int activeCommentCountMetric() const;
+    qint64 overlayMetricsUpdatedAtMs() const;
+    int densityTier() const;
+    void recordPresentedCommentFrame(qint64 presentedAtMs);
+    DanmakuFrameClockMode frameClockMode() const;
+    void advanceVsyncFrame();
+    int widthMeasurementCountForTesting() const;
+    int pendingRasterCountForTesting() const;
+    void stepFrameForTesting(int elapsedMs);
+    bool workerBusyForTesting();
+
+signals:
+    void ngDropZoneVisibleChanged();
+    void commentRenderFpsChanged();
+    void activeCommentCountChanged();
+    void overlayMetricsUpdatedAtMsChanged();
+    void densityTierChanged();
+    void ngDropRequested(const QString &userId);
+    void renderSnapshotChanged();
+
+private:
+    bool wantsAnimationFrame() const;
+    void onTimerFrame();
+    void onFrame();
+    void advanceFrameTo(qint64 nowNs);
+    void runFrame(int elapsedMs, qint64 nowNs);
+    void observeDensityFrame(qint64 frameCostNs);
+    qreal spriteDevicePixelRatio() const;
+    int laneCount() const;
+    DanmakuLaneScheduler::Pick pickLane(qreal left, qreal speedPxPerSec);
+    bool laneHasCollision(int lane, int candidateRow);
+    void recoverToLane(int row);
+    void ensureLaneStateSize();
+    void resetLaneStates();
+    int findItemIndexAt(qreal x, qreal y);
+    int acquireRow();
+    void releaseRow(int row);
+    void releaseRowsDescending(const QVector<int> &rowsDescending);
+    int activeItemCount() const;
+    bool hasDragging() const;
+    void updateNgZoneVisibility();
+    bool isItemInNgZone(int row) const;
+    void observeGlyphText(const QString &text);
+    void queueGlyphCodepoint(char32_t codepoint);
+    void queueGlyphSeedCharacters();
+    void dispatchGlyphWarmupIfDue(qint64 nowMs);
+    void updateOverlayMetrics(qint64 nowMs);
+    void maybeWritePerfLog(qint64 nowMs);
+    void runFrameSingleThread(int elapsedMs, qint64 nowMs);
+    void rebuildSpatialIndex();
+    void rebuildRenderSnapshot();
+    DanmakuRenderInstance buildRenderInstance(int row) const;
+    void queueSpatialUpsertRow(int row);
+    void queueSpatialUpsertRows(const QVector<int> &rows);
+    void queueSnapshotUpsertRow(int row);
+    void queueSnapshotUpsertRows(const QVector<int> &rows);
+    void queueSnapshotRemoveRow(int row);
+    void queueSnapshotRemoveRows(const QVector<int> &rows);
+    void queueFullSpatialRebuild();
+    void queueFullSnapshotRebuild();
+    bool applySnapshotRowUpsert(int row);
+    bool applySnapshotRowRemoval(int row);
+    void ensureRowToRenderIndexSize();
+    void markSpatialIndexMoved(qreal travel);
+    void publishRenderSnapshot();
+    void republishForFrameClock();
+    void flushPendingDiffs(bool emitSnapshotSignal);
+    void scheduleWorkerFrames(int elapsedMs);
+    void collectWorkerFrames();
+    void applyWorkerFrame(const DanmakuWorkerFrameColumns &frame);
+    qint64 oldestWorkerTargetNs() const;
+    void invalidateWorkerGeneration();
+    DanmakuWorkerRowState buildWorkerRowState(int row) const;
+    void pushWorkerUpsert(int row);
+    void syncWorkerRows(const QVector<int> &rows);
+    void syncWorkerRemoveHandles(const QVector<DanmakuItemHandle> &handles);
+    void syncWorkerFullState();
+    void markWorkerRowsDirty(const QVector<int> &rows);
+    void markWorkerHandlesRemoved(const QVector<DanmakuItemHandle> &handles);
+    void updateFrameTimerInterval();
+    bool beginDragInternal(int index, qreal pointerX, qreal pointerY, bool hasPointerPosition);
+    void moveDragInternal(int index, qreal pointerX, qreal pointerY, bool hasPointerPosition);
+    void dropDragInternal(int index, bool inNgZone);
+    void refreshActiveSpriteIds();
+    void enqueueSpriteUpload(const DanmakuSpriteUpload &upload);
+    bool rasterizePendingSpritesWithinBudget();
+    void applySpriteWidthRefinements();
+    void trackEstimatedWidth(int row, bool widthMeasured);
+    void untrackEstimatedWidth(int row);
+
+    DanmakuRenderHandoff *m_handoff = nullptr;
+    DanmakuStringPool m_strings;
+    DanmakuItemStore m_items;
+    DanmakuLaneScheduler m_laneScheduler;
+    DanmakuSlotMap m_slots;
+    DanmakuLaneIndex m_laneIndex;
+    DanmakuDirtyRowSet m_pendingSpatialUpsertRows;
+    DanmakuDirtyRowSet m_pendingSnapshotUpsertRows;
+    DanmakuDirtyRowSet m_pendingSnapshotRemoveRows;
+    bool m_pendingFullSpatialRebuild = true;
+    bool m_pendingFullSnapshotRebuild = true;
+
+    qreal m_viewportWidth = 1280;
+    qreal m_viewportHeight = 720;
+    int m_fontPx = 36;
+    int m_laneGap = 6;
+
+    bool m_ngDropZoneVisible = false;
+    bool m_playbackPaused = true;
+    double m_playbackRate = 1.0;
+    int m_targetFps = 60;
+    qreal m_ngZoneX = 0;
+    qreal m_ngZoneY = 0;
+    qreal m_ngZoneWidth = 0;
+    qreal m_ngZoneHeight = 0;
+    bool m_perfLogEnabled = false;
+    qint64 m_perfLogWindowStartMs = 0;
+    int m_perfLogFrameCount = 0;
+    PerfMetricScope m_perfDanmakuMetrics {QStringLiteral("danmaku")};
+    PerfMetricScope m_perfGlyphMetrics {QStringLiteral("glyph")};
+    PerfHistogram *m_perfFrameIntervalUs = nullptr;
+    PerfHistogram *m_perfFrameJitterUs = nullptr;
+    int m_perfLogAppendCount = 0;
+    int m_perfLogGeometryUpdateCount = 0;
+    int m_perfLogRemovedCount = 0;
+    int m_perfLanePickCount = 0;
+    int m_perfLaneReadyCount = 0;
+    int m_perfLaneForcedCount = 0;
+    qint64 m_perfLaneWaitTotalMs = 0;
+    qint64 m_perfLaneWaitMaxMs = 0;
+    int m_perfSwapRemoveCount = 0;
+    bool m_glyphWarmupEnabled = true;
+    DanmakuGlyphWarmer *m_glyphWarmer = nullptr;
+    QSet<char32_t> m_seenGlyphCodepoints;
+    QSet<char32_t> m_warmedGlyphCodepoints;
+    QSet<char32_t> m_queuedGlyphCodepoints;
+    QQueue<char32_t> m_glyphWarmupQueue;
+    qint64 m_lastGlyphWarmupDispatchMs = 0;
+    int m_perfGlyphNewCodepoints = 0;
+    int m_perfGlyphNewNonAsciiCodepoints = 0;
+    int m_perfGlyphWarmupSentCodepoints = 0;
+    int m_perfGlyphWarmupBatchCount = 0;
+    int m_perfGlyphWarmupDroppedCodepoints = 0;
+    DanmakuItemHandle m_activeDragHandle = DanmakuSlotMap::kInvalidHandle;
+    qreal m_activeDragOffsetX = 0;
+    qreal m_activeDragOffsetY = 0;
+    QVector<DanmakuRenderInstance> m_renderCache;
+    QVector<int> m_renderRows;
+    QVector<int> m_rowToRenderIndex;
+    DanmakuTextSpriteCache m_textSpriteCache;
+    qreal m_renderDevicePixelRatio = 1.0;
+    bool m_workerEnabled = true;
+    int m_workerPipelineDepth = DanmakuWorkerChannel::kFrameSlots;
+    int m_workerFramesInFlight = 0;
+    qint64 m_workerSeq = 0;
+    quint32 m_workerGeneration = 0;
+    std::array<qint64, DanmakuWorkerChannel::kFrameSlots> m_workerTargetNs {};
+    qint64 m_workerScheduledThroughNs = 0;
+    qint64 m_workerDueNs = 0;
+    qint64 m_workerPendingUntilSeq = 0;
+    std::unique_ptr<DanmakuWorkerChannel> m_workerChannel;
+    std::unique_ptr<DanmakuUpdatePool> m_updatePool;
+    QVector<int> m_frameChangedRows;
+    QVector<int> m_frameSpatialRows;
+    QVector<int> m_frameRemoveRows;
+    QVector<int> m_workerAcceptedChangedRows;
+    QVector<int> m_workerAcceptedRemoveRows;
+    QVector<int> m_releaseRowsScratch;
+    QVector<DanmakuItemHandle> m_releaseHandlesScratch;
+    QHash<DanmakuSpriteId, QVector<DanmakuItemHandle>> m_estimatedWidthRows;
+    DanmakuUpdateWorker *m_updateWorker = nullptr;
+    QThread m_updateThread;
+    QString m_simdModeName = QStringLiteral("auto");
+    DanmakuDirtyRowSet m_workerPendingDirtyRows;
+    DanmakuDirtyRowSet m_workerPendingRemovedRows;
+
+    QTimer m_frameTimer;
+    DanmakuFrameClockMode m_frameClockMode = DanmakuFrameClockMode::Timer;
+    qint64 m_lastTickNs = 0;
+    qint64 m_clockEpochNs = 0;
+    qint64 m_lastVsyncTickNs = 0;
+    qint64 m_renderSimulatedAtNs = 0;
+    qint64 m_perfLastTickNs = 0;
+    qint64 m_perfLastFrameIntervalNs = 0;
+    int m_perfSpatialFullRebuildCount = 0;
+    int m_perfSpatialRowUpdateCount = 0;
+    int m_perfLaneIndexResortBaseline = 0;
+    int m_perfSnapshotFullRebuildCount = 0;
+    int m_perfSnapshotRowUpdateCount = 0;
+    qint64 m_overlayMetricWindowStartMs = 0;
+    int m_presentedCommentFrameCount = 0;
+    double m_commentRenderFps = 0.0;
+    int m_activeCommentCount = 0;
+    qint64 m_overlayMetricsUpdatedAtMs = 0;
+    DanmakuDensityGovernor m_densityGovernor;
+    int m_densityTier = 0;
+    qint64 m_densityPendingCostNs = 0;
+    qint64 m_densityUploadBytes = 0;
+    int m_perfDensityTierChangeCount = 0;
+    int m_perfDensitySkippedCount = 0;
+    int m_perfWorkerLateFrames = 0;
+    int m_perfWorkerStaleFrames = 0;
+    int m_perfWorkerInFlightMax = 0;
+    int m_perfSpriteWidthRefinements = 0;
+};
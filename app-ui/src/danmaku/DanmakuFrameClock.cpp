@@ -0,0 +1,32 @@
+#include "danmaku/DanmakuFrameClock.hpp"
+
+#include <chrono>
+
+DanmakuFrameClockMode DanmakuFrameClock::parseMode(const QString &raw) {
+    const QString normalized = raw.trimmed().toLower();
+    if (normalized == QStringLiteral("vsync")) {
+        return DanmakuFrameClockMode::Vsync;
+    }
+    if (normalized == QStringLiteral("parametric")) {
+        return DanmakuFrameClockMode::Parametric;
+    }
+    return DanmakuFrameClockMode::Timer;
+}
+
+QString DanmakuFrameClock::modeName(DanmakuFrameClockMode mode) {
+    switch (mode) {
+    case DanmakuFrameClockMode::Timer:
+        return QStringLiteral("timer");
+    case DanmakuFrameClockMode::Vsync:
+        return QStringLiteral("vsync");
+    case DanmakuFrameClockMode::Parametric:
+        return QStringLiteral("parametric");
+    }
+    return QStringLiteral("timer");
+}
+
+qint64 DanmakuFrameClock::nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
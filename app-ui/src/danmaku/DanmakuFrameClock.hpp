@@ -0,0 +1,17 @@
+#pragma once
+
+#include <QString>
+#include <QtGlobal>
+
+enum class DanmakuFrameClockMode {
+    Timer,
+    Vsync,
+    Parametric,
+};
+
+class DanmakuFrameClock {
+public:
+    static DanmakuFrameClockMode parseMode(const QString &raw);
+    static QString modeName(DanmakuFrameClockMode mode);
+    static qint64 nowNs();
+};
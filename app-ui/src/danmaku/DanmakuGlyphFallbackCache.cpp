@@ -0,0 +1,115 @@
+#include "danmaku/DanmakuGlyphFallbackCache.hpp"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+
+bool DanmakuGlyphFallbackCache::load(const QString &path, const QString &baseFamily) {
+    m_baseFamily = baseFamily;
+    m_blockFamilies.clear();
+    if (path.isEmpty()) {
+        return false;
+    }
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QJsonParseError error;
+    const QJsonDocument document = QJsonDocument::fromJson(file.readAll(), &error);
+    if (error.error != QJsonParseError::NoError || !document.isObject()) {
+        return false;
+    }
+
+    const QJsonObject root = document.object();
+    if (root.value(QStringLiteral("version")).toInt() != kFormatVersion
+        || root.value(QStringLiteral("block_shift")).toInt() != kBlockShift
+        || root.value(QStringLiteral("base_family")).toString() != baseFamily) {
+        return false;
+    }
+
+    const QJsonObject blocks = root.value(QStringLiteral("blocks")).toObject();
+    for (auto it = blocks.constBegin(); it != blocks.constEnd(); ++it) {
+        bool ok = false;
+        const int block = it.key().toInt(&ok);
+        const QString family = it.value().toString();
+        if (!ok || block < 0 || family.isEmpty()) {
+            continue;
+        }
+        m_blockFamilies.insert(block, family);
+    }
+    return true;
+}
+
+bool DanmakuGlyphFallbackCache::save(const QString &path) const {
+    if (path.isEmpty()) {
+        return false;
+    }
+    if (!QDir().mkpath(QFileInfo(path).absolutePath())) {
+        return false;
+    }
+
+    QJsonObject blocks;
+    for (auto it = m_blockFamilies.constBegin(); it != m_blockFamilies.constEnd(); ++it) {
+        blocks.insert(QString::number(it.key()), it.value());
+    }
+    QJsonObject root;
+    root.insert(QStringLiteral("version"), kFormatVersion);
+    root.insert(QStringLiteral("block_shift"), kBlockShift);
+    root.insert(QStringLiteral("base_family"), m_baseFamily);
+    root.insert(QStringLiteral("blocks"), blocks);
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    file.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+    return file.commit();
+}
+
+void DanmakuGlyphFallbackCache::clear() {
+    m_blockFamilies.clear();
+}
+
+bool DanmakuGlyphFallbackCache::contains(int block) const {
+    return m_blockFamilies.contains(block);
+}
+
+QString DanmakuGlyphFallbackCache::family(int block) const {
+    return m_blockFamilies.value(block);
+}
+
+bool DanmakuGlyphFallbackCache::insert(int block, const QString &family) {
+    if (block < 0 || family.isEmpty()) {
+        return false;
+    }
+    const auto it = m_blockFamilies.constFind(block);
+    if (it != m_blockFamilies.constEnd() && it.value() == family) {
+        return false;
+    }
+    m_blockFamilies.insert(block, family);
+    return true;
+}
+
+QStringList DanmakuGlyphFallbackCache::fallbackFamilies() const {
+    QStringList families;
+    for (auto it = m_blockFamilies.constBegin(); it != m_blockFamilies.constEnd(); ++it) {
+        if (it.value() == m_baseFamily || families.contains(it.value())) {
+            continue;
+        }
+        families.push_back(it.value());
+    }
+    return families;
+}
+
+QString DanmakuGlyphFallbackCache::baseFamily() const {
+    return m_baseFamily;
+}
+
+int DanmakuGlyphFallbackCache::size() const {
+    return m_blockFamilies.size();
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <QMap>
+#include <QString>
+#include <QStringList>
+#include <QtGlobal>
+
+class DanmakuGlyphFallbackCache {
+public:
+    static constexpr int kFormatVersion = 1;
+    static constexpr int kBlockShift = 7;
+
+    static int blockOf(char32_t codepoint) {
+        return static_cast<int>(codepoint >> kBlockShift);
+    }
+
+    bool load(const QString &path, const QString &baseFamily);
+    bool save(const QString &path) const;
+    void clear();
+    bool contains(int block) const;
+    QString family(int block) const;
+    bool insert(int block, const QString &family);
+    QStringList fallbackFamilies() const;
+    QString baseFamily() const;
+    int size() const;
+
+private:
+    QString m_baseFamily;
+    QMap<int, QString> m_blockFamilies;
+};
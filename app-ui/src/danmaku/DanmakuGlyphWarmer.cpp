@@ -0,0 +1,166 @@
+#include "danmaku/DanmakuGlyphWarmer.hpp"
+
+#include "danmaku/DanmakuTextSpriteCache.hpp"
+#include "perf/PerfTrace.hpp"
+
+#include <QDir>
+#include <QFont>
+#include <QGlyphRun>
+#include <QMetaObject>
+#include <QMutexLocker>
+#include <QRawFont>
+#include <QStandardPaths>
+#include <QTextLayout>
+#include <QVector>
+
+#include <algorithm>
+
+namespace {
+QString resolveFallbackFamily(const QFont &font, char32_t codepoint) {
+    const char32_t raw[] = {codepoint};
+    QTextLayout layout(QString::fromUcs4(raw, 1), font);
+    layout.beginLayout();
+    layout.createLine();
+    layout.endLayout();
+    const QList<QGlyphRun> runs = layout.glyphRuns();
+    if (runs.isEmpty()) {
+        return {};
+    }
+    return runs.first().rawFont().familyName();
+}
+} // namespace
+
+DanmakuGlyphWarmer::DanmakuGlyphWarmer(QObject *parent) : QObject(parent) {
+    m_pool.setMaxThreadCount(1);
+    m_pool.setExpiryTimeout(-1);
+}
+
+DanmakuGlyphWarmer::~DanmakuGlyphWarmer() {
+    m_pool.clear();
+    m_pool.waitForDone();
+    QMutexLocker locker(&m_saveMutex);
+    if (m_saveQueued) {
+        m_pendingSave.save(m_cachePath);
+        m_saveQueued = false;
+    }
+}
+
+QString DanmakuGlyphWarmer::cachePathFromEnvironment() {
+    const QString configured = qEnvironmentVariable("NICONEON_GLYPH_FALLBACK_CACHE").trimmed();
+    if (configured.compare(QStringLiteral("off"), Qt::CaseInsensitive) == 0) {
+        return {};
+    }
+    if (!configured.isEmpty()) {
+        return configured;
+    }
+    const QString cacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    if (cacheDir.isEmpty()) {
+        return {};
+    }
+    return QDir(cacheDir).filePath(QStringLiteral("glyph-fallback-cache.json"));
+}
+
+void DanmakuGlyphWarmer::loadCache(const QString &path) {
+    m_cachePath = path;
+    m_cache.load(path, QFont().family());
+}
+
+QStringList DanmakuGlyphWarmer::fallbackFamilies() const {
+    return m_cache.fallbackFamilies();
+}
+
+void DanmakuGlyphWarmer::warm(const QString &text, int fontPixelSize, qreal devicePixelRatio) {
+    if (text.isEmpty()) {
+        return;
+    }
+
+    QVector<char32_t> probes;
+    const QVector<uint> codepoints = text.toUcs4();
+    for (const uint value : codepoints) {
+        const char32_t codepoint = static_cast<char32_t>(value);
+        const int block = DanmakuGlyphFallbackCache::blockOf(codepoint);
+        if (m_cache.contains(block) || m_probingBlocks.contains(block)) {
+            continue;
+        }
+        m_probingBlocks.insert(block);
+        probes.push_back(codepoint);
+    }
+
+    const QStringList families = m_cache.fallbackFamilies();
+    ++m_inflightBatches;
+    m_pool.start([this, text, fontPixelSize, devicePixelRatio, families, probes]() {
+        PerfTrace::setThreadName(QStringLiteral("glyph-warmup"));
+        const PerfTraceSpan span("DanmakuGlyphWarmer::warmBatch");
+        const QFont font = DanmakuTextSpriteCache::spriteFont(fontPixelSize, families);
+        QHash<int, QString> resolvedBlocks;
+        for (const char32_t codepoint : probes) {
+            resolvedBlocks.insert(DanmakuGlyphFallbackCache::blockOf(codepoint), resolveFallbackFamily(font, codepoint));
+        }
+        DanmakuTextSpriteCache::rasterizeText(
+            text,
+            font,
+            DanmakuTextSpriteCache::measureWidth(text, font),
+            devicePixelRatio);
+        QMetaObject::invokeMethod(
+            this,
+            [this, resolvedBlocks]() { applyResolvedBlocks(resolvedBlocks); },
+            Qt::QueuedConnection);
+    });
+}
+
+bool DanmakuGlyphWarmer::waitForDone(int msecs) {
+    return m_pool.waitForDone(msecs);
+}
+
+int DanmakuGlyphWarmer::inflightBatchCount() const {
+    return m_inflightBatches;
+}
+
+int DanmakuGlyphWarmer::resolvedBlockCount() const {
+    return m_cache.size();
+}
+
+void DanmakuGlyphWarmer::applyResolvedBlocks(const QHash<int, QString> &resolvedBlocks) {
+    m_inflightBatches = std::max(0, m_inflightBatches - 1);
+    if (resolvedBlocks.isEmpty()) {
+        return;
+    }
+
+    const QStringList previousFamilies = m_cache.fallbackFamilies();
+    bool changed = false;
+    for (auto it = resolvedBlocks.constBegin(); it != resolvedBlocks.constEnd(); ++it) {
+        m_probingBlocks.remove(it.key());
+        changed = m_cache.insert(it.key(), it.value()) || changed;
+    }
+    if (!changed) {
+        return;
+    }
+
+    scheduleCacheSave();
+    const QStringList families = m_cache.fallbackFamilies();
+    if (families != previousFamilies) {
+        emit fallbackFamiliesChanged(families);
+    }
+}
+
+void DanmakuGlyphWarmer::scheduleCacheSave() {
+    if (m_cachePath.isEmpty()) {
+        return;
+    }
+    QMutexLocker locker(&m_saveMutex);
+    m_pendingSave = m_cache;
+    if (m_saveQueued) {
+        return;
+    }
+    m_saveQueued = true;
+    const QString path = m_cachePath;
+    m_pool.start([this, path]() {
+        DanmakuGlyphFallbackCache snapshot;
+        {
+            QMutexLocker saveLocker(&m_saveMutex);
+            snapshot = m_pendingSave;
+            m_saveQueued = false;
+        }
+        snapshot.save(path);
+    });
+}
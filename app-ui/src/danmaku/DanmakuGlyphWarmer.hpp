@@ -0,0 +1,44 @@
+#pragma once
+
+#include "danmaku/DanmakuGlyphFallbackCache.hpp"
+
+#include <QHash>
+#include <QMutex>
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+
+class DanmakuGlyphWarmer : public QObject {
+    Q_OBJECT
+
+public:
+    explicit DanmakuGlyphWarmer(QObject *parent = nullptr);
+    ~DanmakuGlyphWarmer() override;
+
+    static QString cachePathFromEnvironment();
+
+    void loadCache(const QString &path);
+    QStringList fallbackFamilies() const;
+    void warm(const QString &text, int fontPixelSize, qreal devicePixelRatio);
+    bool waitForDone(int msecs = -1);
+    int inflightBatchCount() const;
+    int resolvedBlockCount() const;
+
+signals:
+    void fallbackFamiliesChanged(const QStringList &families);
+
+private:
+    void applyResolvedBlocks(const QHash<int, QString> &resolvedBlocks);
+    void scheduleCacheSave();
+
+    QThreadPool m_pool;
+    DanmakuGlyphFallbackCache m_cache;
+    QString m_cachePath;
+    QMutex m_saveMutex;
+    DanmakuGlyphFallbackCache m_pendingSave;
+    bool m_saveQueued = false;
+    QSet<int> m_probingBlocks;
+    int m_inflightBatches = 0;
+};
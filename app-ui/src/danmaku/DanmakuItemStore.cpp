@@ -0,0 +1,86 @@
+#include "danmaku/DanmakuItemStore.hpp"
+
+bool DanmakuItemStore::anyActiveWithFlag(DanmakuItemFlag flag) const {
+    const quint16 mask = static_cast<quint16>(DanmakuItemFlagActive | flag);
+    const quint16 *data = flags.constData();
+    const int count = flags.size();
+    for (int row = 0; row < count; ++row) {
+        if ((data[row] & mask) == mask) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int DanmakuItemStore::appendRow() {
+    const int row = size();
+    x.push_back(0.0);
+    y.push_back(0.0);
+    speed.push_back(120.0);
+    alpha.push_back(1.0);
+    flags.push_back(0);
+    commentId.push_back(DanmakuStringPool::kInvalidId);
+    userId.push_back(DanmakuStringPool::kInvalidId);
+    text.push_back(DanmakuStringPool::kInvalidId);
+    spriteId.push_back(0);
+    lane.push_back(0);
+    originalLane.push_back(0);
+    widthEstimate.push_back(120);
+    fadeRemainingMs.push_back(0);
+    return row;
+}
+
+void DanmakuItemStore::moveRow(int from, int to) {
+    if (from == to) {
+        return;
+    }
+    x[to] = x[from];
+    y[to] = y[from];
+    speed[to] = speed[from];
+    alpha[to] = alpha[from];
+    flags[to] = flags[from];
+    commentId[to] = commentId[from];
+    userId[to] = userId[from];
+    text[to] = text[from];
+    spriteId[to] = spriteId[from];
+    lane[to] = lane[from];
+    originalLane[to] = originalLane[from];
+    widthEstimate[to] = widthEstimate[from];
+    fadeRemainingMs[to] = fadeRemainingMs[from];
+}
+
+void DanmakuItemStore::truncate(int count) {
+    x.resize(count);
+    y.resize(count);
+    speed.resize(count);
+    alpha.resize(count);
+    flags.resize(count);
+    commentId.resize(count);
+    userId.resize(count);
+    text.resize(count);
+    spriteId.resize(count);
+    lane.resize(count);
+    originalLane.resize(count);
+    widthEstimate.resize(count);
+    fadeRemainingMs.resize(count);
+}
+
+void DanmakuItemStore::clear() {
+    truncate(0);
+}
+
+void DanmakuItemStore::reserve(int count) {
+    x.reserve(count);
+    y.reserve(count);
+    speed.reserve(count);
+    alpha.reserve(count);
+    flags.reserve(count);
+    commentId.reserve(count);
+    userId.reserve(count);
+    text.reserve(count);
+    spriteId.reserve(count);
+    lane.reserve(count);
+    originalLane.reserve(count);
+    widthEstimate.reserve(count);
+    fadeRemainingMs.reserve(count);
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "danmaku/DanmakuRenderFrame.hpp"
+#include "danmaku/DanmakuStringPool.hpp"
+
+#include <QVector>
+#include <QtGlobal>
+
+enum DanmakuItemFlag : quint16 {
+    DanmakuItemFlagActive = 1 << 0,
+    DanmakuItemFlagFrozen = 1 << 1,
+    DanmakuItemFlagDragging = 1 << 2,
+    DanmakuItemFlagFading = 1 << 3,
+    DanmakuItemFlagNgDropHovered = 1 << 4,
+    DanmakuItemFlagPendingNgFade = 1 << 5,
+    DanmakuItemFlagPendingNgDraggedOrigin = 1 << 6,
+};
+
+class DanmakuItemStore {
+public:
+    QVector<qreal> x;
+    QVector<qreal> y;
+    QVector<qreal> speed;
+    QVector<qreal> alpha;
+    QVector<quint16> flags;
+
+    QVector<DanmakuStringId> commentId;
+    QVector<DanmakuStringId> userId;
+    QVector<DanmakuStringId> text;
+    QVector<DanmakuSpriteId> spriteId;
+    QVector<int> lane;
+    QVector<int> originalLane;
+    QVector<int> widthEstimate;
+    QVector<int> fadeRemainingMs;
+
+    int size() const {
+        return flags.size();
+    }
+
+    bool isActive(int row) const {
+        return (flags[row] & DanmakuItemFlagActive) != 0;
+    }
+
+    bool hasFlag(int row, DanmakuItemFlag flag) const {
+        return (flags[row] & flag) != 0;
+    }
+
+    void setFlag(int row, DanmakuItemFlag flag, bool enabled) {
+        if (enabled) {
+            flags[row] |= flag;
+        } else {
+            flags[row] &= static_cast<quint16>(~flag);
+        }
+    }
+
+    bool anyActiveWithFlag(DanmakuItemFlag flag) const;
+    int appendRow();
+    void moveRow(int from, int to);
+    void truncate(int count);
+    void clear();
+    void reserve(int count);
+};
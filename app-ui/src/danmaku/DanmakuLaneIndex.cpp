@@ -0,0 +1,370 @@
+#include "danmaku/DanmakuLaneIndex.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+DanmakuLaneIndex::DanmakuLaneIndex(const DanmakuItemStore *items, const DanmakuSlotMap *slotMap)
+    : m_items(items), m_slots(slotMap) {}
+
+void DanmakuLaneIndex::setGeometry(int laneCount, qreal laneTop, qreal laneHeight, qreal itemHeight) {
+    clear();
+    m_lanes.resize(std::max(0, laneCount));
+    m_laneTop = laneTop;
+    m_laneHeight = laneHeight;
+    m_itemHeight = itemHeight;
+}
+
+void DanmakuLaneIndex::clear() {
+    for (Lane &lane : m_lanes) {
+        lane = Lane {};
+    }
+    m_floating = Lane {};
+    std::fill(m_slotLanes.begin(), m_slotLanes.end(), kAbsentLane);
+}
+
+void DanmakuLaneIndex::rebuild() {
+    clear();
+    for (int row = 0; row < m_items->size(); ++row) {
+        if (!m_items->isActive(row)) {
+            continue;
+        }
+        const DanmakuItemHandle handle = m_slots->handleAt(row);
+        if (handle == DanmakuSlotMap::kInvalidHandle) {
+            continue;
+        }
+        const int laneId = laneForY(m_items->y[row]);
+        Lane &lane = *laneAt(laneId);
+        lane.handles.push_back(handle);
+        lane.maxWidth = std::max(lane.maxWidth, m_items->widthEstimate[row]);
+        setSlotLane(handle, laneId);
+    }
+
+    const auto byLeft = [this](DanmakuItemHandle lhs, DanmakuItemHandle rhs) { return leftOf(lhs) < leftOf(rhs); };
+    for (Lane &lane : m_lanes) {
+        std::sort(lane.handles.begin(), lane.handles.end(), byLeft);
+        certifySorted(lane);
+    }
+    std::sort(m_floating.handles.begin(), m_floating.handles.end(), byLeft);
+    certifySorted(m_floating);
+}
+
+void DanmakuLaneIndex::markMoved(qreal travel) {
+    m_travel += travel;
+}
+
+void DanmakuLaneIndex::invalidateOrder() {
+    for (Lane &lane : m_lanes) {
+        lane.sorted = false;
+    }
+    m_floating.sorted = false;
+}
+
+void DanmakuLaneIndex::upsert(DanmakuItemHandle handle) {
+    const int row = m_slots->row(handle);
+    if (row < 0 || row >= m_items->size() || !m_items->isActive(row)) {
+        remove(handle);
+        return;
+    }
+
+    const int target = laneForY(m_items->y[row]);
+    const int current = laneOf(handle);
+    if (current == target) {
+        Lane &lane = *laneAt(target);
+        lane.maxWidth = std::max(lane.maxWidth, m_items->widthEstimate[row]);
+        lane.sorted = false;
+        return;
+    }
+    if (current != kAbsentLane) {
+        eraseFrom(*laneAt(current), handle);
+    }
+    insertSorted(target, handle);
+}
+
+void DanmakuLaneIndex::remove(DanmakuItemHandle handle) {
+    const int current = laneOf(handle);
+    if (current == kAbsentLane) {
+        return;
+    }
+    eraseFrom(*laneAt(current), handle);
+    setSlotLane(handle, kAbsentLane);
+}
+
+int DanmakuLaneIndex::laneForY(qreal y) const {
+    if (m_laneHeight <= 0.0) {
+        return kFloatingLane;
+    }
+    const int lane = static_cast<int>(std::lround((y - m_laneTop) / m_laneHeight));
+    if (lane < 0 || lane >= m_lanes.size()) {
+        return kFloatingLane;
+    }
+    if (std::abs(y - (m_laneTop + lane * m_laneHeight)) > kLaneAlignmentTolerancePx) {
+        return kFloatingLane;
+    }
+    return lane;
+}
+
+int DanmakuLaneIndex::laneOf(DanmakuItemHandle handle) const {
+    const int slot = DanmakuSlotMap::slotOf(handle);
+    if (slot < 0 || slot >= m_slotLanes.size()) {
+        return kAbsentLane;
+    }
+    return m_slotLanes[slot];
+}
+
+int DanmakuLaneIndex::laneCount() const {
+    return m_lanes.size();
+}
+
+int DanmakuLaneIndex::laneSize(int lane) const {
+    if (lane == kFloatingLane) {
+        return floatingCount();
+    }
+    if (lane < 0 || lane >= m_lanes.size()) {
+        return 0;
+    }
+    return m_lanes[lane].handles.size() - m_lanes[lane].head;
+}
+
+int DanmakuLaneIndex::floatingCount() const {
+    return m_floating.handles.size() - m_floating.head;
+}
+
+DanmakuItemHandle DanmakuLaneIndex::laneTail(int laneId) {
+    Lane *lane = laneAt(laneId);
+    if (!lane || lane->handles.size() == lane->head) {
+        return DanmakuSlotMap::kInvalidHandle;
+    }
+    ensureSorted(*lane);
+    return lane->handles.last();
+}
+
+bool DanmakuLaneIndex::hasOverlapInLane(int laneId, qreal left, qreal right, DanmakuItemHandle exclude) {
+    if (laneId < 0 || laneId >= m_lanes.size()) {
+        return false;
+    }
+    Lane &lane = m_lanes[laneId];
+    if (lane.handles.size() == lane.head) {
+        return false;
+    }
+    ensureSorted(lane);
+    if (left > leftOf(lane.handles.last()) + lane.maxWidth) {
+        return false;
+    }
+
+    for (int i = firstLeftAfter(lane, right) - 1; i >= lane.head; --i) {
+        const DanmakuItemHandle handle = lane.handles[i];
+        const qreal otherLeft = leftOf(handle);
+        if (otherLeft + lane.maxWidth < left) {
+            break;
+        }
+        if (handle != exclude && otherLeft + widthOf(handle) >= left) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int DanmakuLaneIndex::rowAt(const QPointF &point) {
+    const int row = rowWithin(point, 0.0);
+    if (row >= 0) {
+        return row;
+    }
+    return rowWithin(point, kDragPickSlopPx);
+}
+
+int DanmakuLaneIndex::resortCount() const {
+    return m_resortCount;
+}
+
+DanmakuLaneIndex::Lane *DanmakuLaneIndex::laneAt(int lane) {
+    if (lane == kFloatingLane) {
+        return &m_floating;
+    }
+    if (lane < 0 || lane >= m_lanes.size()) {
+        return nullptr;
+    }
+    return &m_lanes[lane];
+}
+
+qreal DanmakuLaneIndex::leftOf(DanmakuItemHandle handle) const {
+    return m_items->x[m_slots->row(handle)];
+}
+
+int DanmakuLaneIndex::widthOf(DanmakuItemHandle handle) const {
+    return m_items->widthEstimate[m_slots->row(handle)];
+}
+
+qreal DanmakuLaneIndex::speedOf(DanmakuItemHandle handle) const {
+    const int row = m_slots->row(handle);
+    if ((m_items->flags[row] & (DanmakuItemFlagFrozen | DanmakuItemFlagDragging)) != 0) {
+        return 0.0;
+    }
+    return m_items->speed[row];
+}
+
+qreal DanmakuLaneIndex::pairReorderTravel(DanmakuItemHandle front, DanmakuItemHandle behind) const {
+    const qreal closingSpeed = speedOf(behind) - speedOf(front);
+    if (closingSpeed <= 0.0) {
+        return std::numeric_limits<qreal>::infinity();
+    }
+    const qreal gap = leftOf(behind) - leftOf(front) - kReorderSlopPx;
+    return std::max(0.0, gap) / closingSpeed;
+}
+
+void DanmakuLaneIndex::restrictReorder(Lane &lane, DanmakuItemHandle front, DanmakuItemHandle behind) const {
+    lane.reorderTravel =
+        std::min(lane.reorderTravel, m_travel - lane.sortedTravel + pairReorderTravel(front, behind));
+}
+
+void DanmakuLaneIndex::certifySorted(Lane &lane) const {
+    lane.sorted = true;
+    lane.sortedTravel = m_travel;
+    lane.reorderTravel = std::numeric_limits<qreal>::infinity();
+    for (int i = lane.head + 1; i < lane.handles.size(); ++i) {
+        lane.reorderTravel = std::min(lane.reorderTravel, pairReorderTravel(lane.handles[i - 1], lane.handles[i]));
+    }
+}
+
+void DanmakuLaneIndex::setSlotLane(DanmakuItemHandle handle, int lane) {
+    const int slot = DanmakuSlotMap::slotOf(handle);
+    if (slot < 0) {
+        return;
+    }
+    if (slot >= m_slotLanes.size()) {
+        m_slotLanes.resize(slot + 1, kAbsentLane);
+    }
+    m_slotLanes[slot] = lane;
+}
+
+void DanmakuLaneIndex::ensureSorted(Lane &lane) {
+    if (lane.sorted && m_travel - lane.sortedTravel < lane.reorderTravel) {
+        return;
+    }
+
+    bool moved = false;
+    int maxWidth = 0;
+    DanmakuItemHandle *handles = lane.handles.data();
+    for (int i = lane.head; i < lane.handles.size(); ++i) {
+        const DanmakuItemHandle handle = handles[i];
+        const qreal left = leftOf(handle);
+        maxWidth = std::max(maxWidth, widthOf(handle));
+        int j = i;
+        while (j > lane.head && leftOf(handles[j - 1]) > left) {
+            handles[j] = handles[j - 1];
+            --j;
+        }
+        if (j != i) {
+            handles[j] = handle;
+            moved = true;
+        }
+    }
+    lane.maxWidth = maxWidth;
+    certifySorted(lane);
+    if (moved) {
+        ++m_resortCount;
+    }
+}
+
+void DanmakuLaneIndex::insertSorted(int laneId, DanmakuItemHandle handle) {
+    Lane *lane = laneAt(laneId);
+    if (!lane) {
+        laneId = kFloatingLane;
+        lane = &m_floating;
+    }
+
+    const qreal left = leftOf(handle);
+    if (lane->handles.size() == lane->head || leftOf(lane->handles.last()) <= left) {
+        if (lane->handles.size() > lane->head) {
+            restrictReorder(*lane, lane->handles.last(), handle);
+        }
+        lane->handles.push_back(handle);
+    } else {
+        ensureSorted(*lane);
+        const int position = firstLeftAfter(*lane, left);
+        if (position > lane->head) {
+            restrictReorder(*lane, lane->handles[position - 1], handle);
+        }
+        restrictReorder(*lane, handle, lane->handles[position]);
+        lane->handles.insert(position, handle);
+    }
+    lane->maxWidth = std::max(lane->maxWidth, widthOf(handle));
+    setSlotLane(handle, laneId);
+}
+
+void DanmakuLaneIndex::eraseFrom(Lane &lane, DanmakuItemHandle handle) {
+    if (lane.handles.size() > lane.head && lane.handles[lane.head] == handle) {
+        ++lane.head;
+    } else if (lane.handles.size() > lane.head && lane.handles.last() == handle) {
+        lane.handles.removeLast();
+    } else {
+        const int index = lane.handles.indexOf(handle, lane.head);
+        if (index < 0) {
+            return;
+        }
+        lane.handles.remove(index);
+    }
+
+    if (lane.head == lane.handles.size()) {
+        lane.handles.clear();
+        lane.head = 0;
+        lane.maxWidth = 0;
+        lane.sorted = true;
+        lane.reorderTravel = std::numeric_limits<qreal>::infinity();
+    } else if (lane.head >= 64 && lane.head * 2 >= lane.handles.size()) {
+        lane.handles.remove(0, lane.head);
+        lane.head = 0;
+    }
+}
+
+int DanmakuLaneIndex::firstLeftAfter(const Lane &lane, qreal x) const {
+    int low = lane.head;
+    int high = lane.handles.size();
+    while (low < high) {
+        const int mid = low + (high - low) / 2;
+        if (leftOf(lane.handles[mid]) <= x) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+int DanmakuLaneIndex::rowWithin(const QPointF &point, qreal slop) {
+    int bestRow = -1;
+    if (m_laneHeight > 0.0 && !m_lanes.isEmpty()) {
+        const int firstLane =
+            std::max(0, static_cast<int>(std::ceil(
+                (point.y() - slop - m_itemHeight - m_laneTop - kLaneAlignmentTolerancePx) / m_laneHeight)));
+        const int lastLane = std::min(
+            static_cast<int>(m_lanes.size()) - 1,
+            static_cast<int>(std::floor((point.y() + slop - m_laneTop + kLaneAlignmentTolerancePx) / m_laneHeight)));
+        for (int lane = firstLane; lane <= lastLane; ++lane) {
+            collectHit(m_lanes[lane], point, slop, bestRow);
+        }
+    }
+    collectHit(m_floating, point, slop, bestRow);
+    return bestRow;
+}
+
+void DanmakuLaneIndex::collectHit(Lane &lane, const QPointF &point, qreal slop, int &bestRow) {
+    if (lane.handles.size() == lane.head) {
+        return;
+    }
+    ensureSorted(lane);
+    for (int i = firstLeftAfter(lane, point.x() + slop) - 1; i >= lane.head; --i) {
+        const DanmakuItemHandle handle = lane.handles[i];
+        const qreal left = leftOf(handle);
+        if (left + lane.maxWidth < point.x() - slop) {
+            break;
+        }
+        const int row = m_slots->row(handle);
+        const qreal top = m_items->y[row];
+        const bool contains = point.x() - slop <= left + m_items->widthEstimate[row]
+            && point.y() + slop >= top
+            && point.y() - slop <= top + m_itemHeight;
+        if (contains && row > bestRow) {
+            bestRow = row;
+        }
+    }
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "danmaku/DanmakuItemStore.hpp"
+#include "danmaku/DanmakuSlotMap.hpp"
+
+#include <QPointF>
+#include <QVector>
+#include <QtGlobal>
+
+#include <limits>
+
+class DanmakuLaneIndex {
+public:
+    static constexpr int kFloatingLane = -1;
+    static constexpr int kAbsentLane = -2;
+    static constexpr qreal kLaneAlignmentTolerancePx = 0.5;
+    static constexpr qreal kDragPickSlopPx = 4.0;
+    static constexpr qreal kReorderSlopPx = 1.0;
+
+    DanmakuLaneIndex(const DanmakuItemStore *items, const DanmakuSlotMap *slotMap);
+
+    void setGeometry(int laneCount, qreal laneTop, qreal laneHeight, qreal itemHeight);
+    void clear();
+    void rebuild();
+    void markMoved(qreal travel);
+    void invalidateOrder();
+    void upsert(DanmakuItemHandle handle);
+    void remove(DanmakuItemHandle handle);
+
+    int laneForY(qreal y) const;
+    int laneOf(DanmakuItemHandle handle) const;
+    int laneCount() const;
+    int laneSize(int lane) const;
+    int floatingCount() const;
+    DanmakuItemHandle laneTail(int lane);
+
+    bool hasOverlapInLane(int lane, qreal left, qreal right, DanmakuItemHandle exclude);
+    int rowAt(const QPointF &point);
+    int resortCount() const;
+
+private:
+    struct Lane {
+        QVector<DanmakuItemHandle> handles;
+        int head = 0;
+        int maxWidth = 0;
+        bool sorted = true;
+        qreal sortedTravel = 0.0;
+        qreal reorderTravel = std::numeric_limits<qreal>::infinity();
+    };
+
+    Lane *laneAt(int lane);
+    qreal leftOf(DanmakuItemHandle handle) const;
+    int widthOf(DanmakuItemHandle handle) const;
+    qreal speedOf(DanmakuItemHandle handle) const;
+    qreal pairReorderTravel(DanmakuItemHandle front, DanmakuItemHandle behind) const;
+    void restrictReorder(Lane &lane, DanmakuItemHandle front, DanmakuItemHandle behind) const;
+    void certifySorted(Lane &lane) const;
+    void setSlotLane(DanmakuItemHandle handle, int lane);
+    void ensureSorted(Lane &lane);
+    void insertSorted(int laneId, DanmakuItemHandle handle);
+    void eraseFrom(Lane &lane, DanmakuItemHandle handle);
+    int firstLeftAfter(const Lane &lane, qreal x) const;
+    int rowWithin(const QPointF &point, qreal slop);
+    void collectHit(Lane &lane, const QPointF &point, qreal slop, int &bestRow);
+
+    const DanmakuItemStore *m_items = nullptr;
+    const DanmakuSlotMap *m_slots = nullptr;
+    QVector<Lane> m_lanes;
+    Lane m_floating;
+    QVector<int> m_slotLanes;
+    qreal m_laneTop = 0.0;
+    qreal m_laneHeight = 0.0;
+    qreal m_itemHeight = 0.0;
+    qreal m_travel = 0.0;
+    int m_resortCount = 0;
+};
@@ -0,0 +1,278 @@
+#include "danmaku/DanmakuLaneScheduler.hpp"
+
+#include <QVarLengthArray>
+#include <QtAlgorithms>
+
+#include <algorithm>
+#include <limits>
+
+namespace {
+constexpr qreal kMinSpeedPxPerSec = 1.0;
+}
+
+bool DanmakuLaneScheduler::pendingLaneAfter(const PendingLane &lhs, const PendingLane &rhs) {
+    if (lhs.readyAt != rhs.readyAt) {
+        return lhs.readyAt > rhs.readyAt;
+    }
+    return lhs.lane > rhs.lane;
+}
+
+void DanmakuLaneScheduler::setLaneCount(int lanes) {
+    lanes = std::max(0, lanes);
+    if (m_lanes.size() == lanes) {
+        return;
+    }
+
+    m_lanes.resize(lanes);
+    if (lanes <= 0) {
+        m_cursor = 0;
+    } else {
+        m_cursor %= lanes;
+    }
+    rebuildQueues();
+}
+
+int DanmakuLaneScheduler::laneCount() const {
+    return m_lanes.size();
+}
+
+void DanmakuLaneScheduler::setSpawnGeometry(qreal spawnX, qreal gapPx) {
+    if (m_spawnX == spawnX && m_gapPx == gapPx) {
+        return;
+    }
+    m_spawnX = spawnX;
+    m_gapPx = std::max<qreal>(0.0, gapPx);
+    for (Lane &lane : m_lanes) {
+        if (lane.hasTail) {
+            lane.entryReadyAt = lane.tailAt + (lane.tailRight + m_gapPx - m_spawnX) / lane.tailSpeed;
+        }
+    }
+    rebuildQueues();
+}
+
+void DanmakuLaneScheduler::reset() {
+    for (Lane &lane : m_lanes) {
+        lane = Lane {};
+    }
+    m_now = 0.0;
+    m_cursor = 0;
+    rebuildQueues();
+}
+
+void DanmakuLaneScheduler::advance(qreal scrollSec) {
+    if (scrollSec <= 0.0) {
+        return;
+    }
+    m_now += scrollSec;
+    promoteReadyLanes();
+}
+
+qreal DanmakuLaneScheduler::now() const {
+    return m_now;
+}
+
+qreal DanmakuLaneScheduler::earliestSpawnSec(int lane, qreal left, qreal speedPxPerSec) const {
+    if (lane < 0 || lane >= m_lanes.size()) {
+        return std::numeric_limits<qreal>::infinity();
+    }
+    const Lane &state = m_lanes[lane];
+    if (!state.hasTail) {
+        return -std::numeric_limits<qreal>::infinity();
+    }
+
+    const qreal tailSpeed = state.tailSpeed;
+    const qreal entryAt = state.tailAt + (state.tailRight + m_gapPx - left) / tailSpeed;
+    const qreal speed = std::max(kMinSpeedPxPerSec, speedPxPerSec);
+    if (speed <= tailSpeed) {
+        return entryAt;
+    }
+
+    const qreal tailExitAt = state.tailAt + state.tailRight / tailSpeed;
+    const qreal catchUpAt = tailExitAt - (left - m_gapPx) / speed;
+    return std::max(entryAt, catchUpAt);
+}
+
+DanmakuLaneScheduler::Pick DanmakuLaneScheduler::pick(qreal left, qreal speedPxPerSec) {
+    Pick result;
+    const int lanes = m_lanes.size();
+    if (lanes <= 0) {
+        return result;
+    }
+
+    promoteReadyLanes();
+
+    int lane = nextLaneBit(m_readyWords, m_cursor);
+    if (lane < 0 || earliestSpawnSec(lane, left, speedPxPerSec) > m_now) {
+        lane = nextLaneBit(m_emptyWords, m_cursor);
+    }
+    if (lane < 0) {
+        result = earliestLane(left, speedPxPerSec);
+        lane = result.lane;
+    }
+    result.lane = lane;
+    m_cursor = (lane + 1) % lanes;
+    return result;
+}
+
+DanmakuLaneScheduler::Pick DanmakuLaneScheduler::earliestLane(qreal left, qreal speedPxPerSec) const {
+    const qreal slackSec = std::max<qreal>(0.0, left - m_spawnX) / kMinSpeedPxPerSec;
+    int bestLane = m_cursor;
+    qreal bestAt = std::numeric_limits<qreal>::infinity();
+    const auto entryAfter = [this](int lhs, int rhs) {
+        return pendingLaneAfter(m_entryOrder[lhs], m_entryOrder[rhs]);
+    };
+
+    QVarLengthArray<int, 64> frontier;
+    if (!m_entryOrder.isEmpty()) {
+        frontier.push_back(0);
+    }
+    while (!frontier.isEmpty()) {
+        std::pop_heap(frontier.begin(), frontier.end(), entryAfter);
+        const int index = frontier.back();
+        frontier.pop_back();
+        const PendingLane &entry = m_entryOrder[index];
+        if (entry.readyAt - slackSec >= bestAt) {
+            break;
+        }
+        if (entry.version == m_lanes[entry.lane].version) {
+            const qreal readyAt = earliestSpawnSec(entry.lane, left, speedPxPerSec);
+            if (readyAt < bestAt) {
+                bestAt = readyAt;
+                bestLane = entry.lane;
+            }
+        }
+        for (const int child : {index * 2 + 1, index * 2 + 2}) {
+            if (child < m_entryOrder.size()) {
+                frontier.push_back(child);
+                std::push_heap(frontier.begin(), frontier.end(), entryAfter);
+            }
+        }
+    }
+
+    Pick result;
+    result.lane = bestLane;
+    if (bestAt > m_now) {
+        result.waitSec = bestAt - m_now;
+        result.forced = true;
+    }
+    return result;
+}
+
+void DanmakuLaneScheduler::assign(int lane, qreal right, qreal speedPxPerSec) {
+    if (lane < 0 || lane >= m_lanes.size()) {
+        return;
+    }
+
+    Lane &state = m_lanes[lane];
+    const qreal speed = std::max(kMinSpeedPxPerSec, speedPxPerSec);
+    if (state.hasTail) {
+        const qreal currentTailRight = state.tailRight - state.tailSpeed * (m_now - state.tailAt);
+        if (currentTailRight > right) {
+            return;
+        }
+    }
+
+    state.tailRight = right;
+    state.tailSpeed = speed;
+    state.tailAt = m_now;
+    state.entryReadyAt = m_now + (right + m_gapPx - m_spawnX) / speed;
+    state.hasTail = true;
+    ++state.version;
+    setReady(lane, false);
+    setLaneBit(m_emptyWords, lane, false);
+    pushPending(lane);
+    pushEntryOrder(lane);
+    promoteReadyLanes();
+}
+
+void DanmakuLaneScheduler::rebuildQueues() {
+    m_pending.clear();
+    m_readyWords.clear();
+    m_readyWords.resize((m_lanes.size() + 63) / 64);
+    m_emptyWords.clear();
+    m_emptyWords.resize(m_readyWords.size());
+    for (int lane = 0; lane < m_lanes.size(); ++lane) {
+        ++m_lanes[lane].version;
+        if (!m_lanes[lane].hasTail) {
+            setReady(lane, true);
+            setLaneBit(m_emptyWords, lane, true);
+            continue;
+        }
+        pushPending(lane);
+    }
+    rebuildEntryOrder();
+    promoteReadyLanes();
+}
+
+void DanmakuLaneScheduler::rebuildEntryOrder() {
+    m_entryOrder.clear();
+    for (int lane = 0; lane < m_lanes.size(); ++lane) {
+        if (m_lanes[lane].hasTail) {
+            m_entryOrder.push_back({m_lanes[lane].entryReadyAt, lane, m_lanes[lane].version});
+        }
+    }
+    std::make_heap(m_entryOrder.begin(), m_entryOrder.end(), pendingLaneAfter);
+}
+
+void DanmakuLaneScheduler::pushPending(int lane) {
+    PendingLane pending;
+    pending.readyAt = m_lanes[lane].entryReadyAt;
+    pending.lane = lane;
+    pending.version = m_lanes[lane].version;
+    m_pending.push_back(pending);
+    std::push_heap(m_pending.begin(), m_pending.end(), pendingLaneAfter);
+}
+
+void DanmakuLaneScheduler::pushEntryOrder(int lane) {
+    if (m_entryOrder.size() >= m_lanes.size() * 2 + 16) {
+        rebuildEntryOrder();
+        return;
+    }
+    m_entryOrder.push_back({m_lanes[lane].entryReadyAt, lane, m_lanes[lane].version});
+    std::push_heap(m_entryOrder.begin(), m_entryOrder.end(), pendingLaneAfter);
+}
+
+void DanmakuLaneScheduler::promoteReadyLanes() {
+    while (!m_pending.isEmpty() && m_pending.front().readyAt <= m_now) {
+        std::pop_heap(m_pending.begin(), m_pending.end(), pendingLaneAfter);
+        const PendingLane pending = m_pending.takeLast();
+        if (pending.version == m_lanes[pending.lane].version) {
+            setReady(pending.lane, true);
+        }
+    }
+}
+
+void DanmakuLaneScheduler::setReady(int lane, bool ready) {
+    setLaneBit(m_readyWords, lane, ready);
+}
+
+void DanmakuLaneScheduler::setLaneBit(QVector<quint64> &words, int lane, bool set) {
+    const quint64 bit = quint64(1) << (lane & 63);
+    if (set) {
+        words[lane >> 6] |= bit;
+    } else {
+        words[lane >> 6] &= ~bit;
+    }
+}
+
+int DanmakuLaneScheduler::nextLaneBit(const QVector<quint64> &words, int from) {
+    const int wordCount = words.size();
+    if (wordCount <= 0) {
+        return -1;
+    }
+
+    const int startWord = from >> 6;
+    const quint64 *data = words.constData();
+    quint64 word = data[startWord] & (~quint64(0) << (from & 63));
+    for (int step = 0; step <= wordCount; ++step) {
+        if (word != 0) {
+            return (((startWord + step) % wordCount) << 6) | static_cast<int>(qCountTrailingZeroBits(word));
+        }
+        const int wordIndex = (startWord + step + 1) % wordCount;
+        word = data[wordIndex];
+        if (step + 1 == wordCount) {
+            word &= ~(~quint64(0) << (from & 63));
+        }
+    }
+    return -1;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <QVector>
+#include <QtGlobal>
+
+class DanmakuLaneScheduler {
+public:
+    struct Pick {
+        int lane = 0;
+        qreal waitSec = 0.0;
+        bool forced = false;
+    };
+
+    void setLaneCount(int lanes);
+    int laneCount() const;
+    void setSpawnGeometry(qreal spawnX, qreal gapPx);
+    void reset();
+
+    void advance(qreal scrollSec);
+    qreal now() const;
+
+    qreal earliestSpawnSec(int lane, qreal left, qreal speedPxPerSec) const;
+    Pick pick(qreal left, qreal speedPxPerSec);
+    void assign(int lane, qreal right, qreal speedPxPerSec);
+
+private:
+    struct Lane {
+        qreal tailRight = 0.0;
+        qreal tailSpeed = 0.0;
+        qreal tailAt = 0.0;
+        qreal entryReadyAt = 0.0;
+        quint32 version = 0;
+        bool hasTail = false;
+    };
+
+    struct PendingLane {
+        qreal readyAt = 0.0;
+        int lane = 0;
+        quint32 version = 0;
+    };
+
+    static bool pendingLaneAfter(const PendingLane &lhs, const PendingLane &rhs);
+
+    void rebuildQueues();
+    void rebuildEntryOrder();
+    void pushPending(int lane);
+    void pushEntryOrder(int lane);
+    void promoteReadyLanes();
+    void setReady(int lane, bool ready);
+    static void setLaneBit(QVector<quint64> &words, int lane, bool set);
+    static int nextLaneBit(const QVector<quint64> &words, int from);
+    Pick earliestLane(qreal left, qreal speedPxPerSec) const;
+
+    QVector<Lane> m_lanes;
+    QVector<PendingLane> m_pending;
+    QVector<PendingLane> m_entryOrder;
+    QVector<quint64> m_readyWords;
+    QVector<quint64> m_emptyWords;
+    qreal m_now = 0.0;
+    qreal m_spawnX = 0.0;
+    qreal m_gapPx = 0.0;
+    int m_cursor = 0;
+};
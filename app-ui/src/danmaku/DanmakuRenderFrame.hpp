@@ -1,17 +1,56 @@
 #pragma once
 
+#include <QHash>
 #include <QImage>
+#include <QPointF>
 #include <QSharedPointer>
+#include <QSizeF>
 #include <QString>
 #include <QVector>
 #include <QtGlobal>
 
 using DanmakuSpriteId = quint32;
 
+struct DanmakuGlyphKey {
+    quint32 fontId = 0;
+    quint32 glyphIndex = 0;
+    int fontPixelSize = 0;
+    int devicePixelRatioMilli = 1000;
+
+    friend bool operator==(const DanmakuGlyphKey &lhs, const DanmakuGlyphKey &rhs) {
+        return lhs.fontId == rhs.fontId
+            && lhs.glyphIndex == rhs.glyphIndex
+            && lhs.fontPixelSize == rhs.fontPixelSize
+            && lhs.devicePixelRatioMilli == rhs.devicePixelRatioMilli;
+    }
+};
+
+inline size_t qHash(const DanmakuGlyphKey &key, size_t seed = 0) noexcept {
+    seed = qHash(key.fontId, seed);
+    seed = qHash(key.glyphIndex, seed);
+    seed = qHash(key.fontPixelSize, seed);
+    return qHash(key.devicePixelRatioMilli, seed);
+}
+
+struct DanmakuGlyphPlacement {
+    DanmakuGlyphKey key;
+    QPointF offset;
+};
+
+struct DanmakuGlyphImage {
+    DanmakuGlyphKey key;
+    QSizeF logicalSize;
+    QImage image;
+    bool distanceField = false;
+};
+
 struct DanmakuSpriteUpload {
     DanmakuSpriteId spriteId = 0;
     QSize logicalSize;
     QImage image;
+    bool distanceField = false;
+    QVector<DanmakuGlyphPlacement> glyphs;
+    QVector<DanmakuGlyphImage> glyphImages;
 };
 
 struct DanmakuRenderInstance {
@@ -20,11 +59,20 @@ struct DanmakuRenderInstance {
     qreal x = 0.0;
     qreal y = 0.0;
     qreal alpha = 1.0;
+    qreal speed = 0.0;
+    qreal anchorScrollSec = 0.0;
+    qreal fadeEndSec = 0.0;
     int widthEstimate = 0;
     bool ngDropHovered = false;
 };
 
 struct DanmakuRenderFrame {
+    quint64 sequence = 0;
+    qint64 simulatedAtNs = 0;
+    qreal scrollRate = 0.0;
+    bool parametric = false;
+    qreal scrollSec = 0.0;
+    qint64 clockEpochNs = 0;
     QVector<DanmakuRenderInstance> instances;
 };
 
@@ -0,0 +1,36 @@
+#include "danmaku/DanmakuRenderHandoff.hpp"
+
+#include <QMutexLocker>
+
+DanmakuRenderSnapshotChannel &DanmakuRenderHandoff::snapshots() {
+    return m_snapshots;
+}
+
+DanmakuRenderFrameConstPtr DanmakuRenderHandoff::consumeSnapshot() {
+    return m_snapshots.consume();
+}
+
+void DanmakuRenderHandoff::enqueueSpriteUpload(const DanmakuSpriteUpload &upload) {
+    QMutexLocker locker(&m_spriteUploadsMutex);
+    m_spriteUploads.push_back(upload);
+}
+
+QVector<DanmakuSpriteUpload> DanmakuRenderHandoff::takeSpriteUploads() {
+    QMutexLocker locker(&m_spriteUploadsMutex);
+    QVector<DanmakuSpriteUpload> uploads;
+    uploads.swap(m_spriteUploads);
+    return uploads;
+}
+
+void DanmakuRenderHandoff::clearSpriteUploads() {
+    QMutexLocker locker(&m_spriteUploadsMutex);
+    m_spriteUploads.clear();
+}
+
+void DanmakuRenderHandoff::setWantsAnimationFrame(bool wants) {
+    m_wantsAnimationFrame.store(wants, std::memory_order_release);
+}
+
+bool DanmakuRenderHandoff::wantsAnimationFrame() const {
+    return m_wantsAnimationFrame.load(std::memory_order_acquire);
+}
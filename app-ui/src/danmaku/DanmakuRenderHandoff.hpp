@@ -0,0 +1,28 @@
+#pragma once
+
+#include "danmaku/DanmakuRenderFrame.hpp"
+#include "danmaku/DanmakuRenderSnapshotChannel.hpp"
+
+#include <QMutex>
+#include <QVector>
+
+#include <atomic>
+
+class DanmakuRenderHandoff {
+public:
+    DanmakuRenderSnapshotChannel &snapshots();
+    DanmakuRenderFrameConstPtr consumeSnapshot();
+
+    void enqueueSpriteUpload(const DanmakuSpriteUpload &upload);
+    QVector<DanmakuSpriteUpload> takeSpriteUploads();
+    void clearSpriteUploads();
+
+    void setWantsAnimationFrame(bool wants);
+    bool wantsAnimationFrame() const;
+
+private:
+    DanmakuRenderSnapshotChannel m_snapshots;
+    QMutex m_spriteUploadsMutex;
+    QVector<DanmakuSpriteUpload> m_spriteUploads;
+    std::atomic<bool> m_wantsAnimationFrame {false};
+};
@@ -2,10 +2,15 @@
 
 #include "danmaku/DanmakuAtlasPacker.hpp"
 #include "danmaku/DanmakuController.hpp"
+#include "danmaku/DanmakuFrameClock.hpp"
 #include "danmaku/DanmakuRenderFrame.hpp"
 #include "danmaku/DanmakuRenderStyle.hpp"
+#include "perf/PerfMetricScope.hpp"
+#include "perf/PerfMetricsRegistry.hpp"
+#include "perf/PerfTrace.hpp"
 
 #include <QColor>
+#include <QCoreApplication>
 #include <QDateTime>
 #include <QDebug>
 #include <QHash>
@@ -19,14 +24,17 @@
 #include <QOpenGLShaderProgram>
 #include <QOpenGLTexture>
 #include <QPainter>
+#include <QPointF>
 #include <QQuickWindow>
 #include <QRectF>
 #include <QSGNode>
+#include <QScreen>
 #include <QSGRenderNode>
 #include <QSet>
 #include <QSharedPointer>
 #include <QSize>
 #include <QSurfaceFormat>
+#include <QThread>
 #include <QVector>
 #include <QtGlobal>
 
@@ -38,9 +46,14 @@ namespace {
 constexpr int kAtlasPagePixelSize = 2048;
 constexpr int kMaxAtlasPages = 8;
 constexpr qint64 kPerfLogWindowMs = 2000;
+constexpr qreal kMaxExtrapolationSec = 0.1;
+constexpr qreal kFallbackRefreshRateHz = 60.0;
+constexpr qreal kFadeDurationSec = DanmakuRenderStyle::kFadeDurationMs / 1000.0;
+constexpr DanmakuSpriteId kFirstGlyphSpriteId = 0x80000000u;
 
 enum class DanmakuRendererBackend {
     Atlas,
+    GlyphAtlas,
     FrameImage,
 };
 
@@ -49,6 +62,9 @@ DanmakuRendererBackend rendererBackendFromEnv() {
     if (raw == QStringLiteral("frame_image")) {
         return DanmakuRendererBackend::FrameImage;
     }
+    if (raw == QStringLiteral("glyph_atlas")) {
+        return DanmakuRendererBackend::GlyphAtlas;
+    }
     return DanmakuRendererBackend::Atlas;
 }
 
@@ -56,6 +72,8 @@ const char *rendererBackendName(DanmakuRendererBackend backend) {
     switch (backend) {
     case DanmakuRendererBackend::Atlas:
         return "atlas";
+    case DanmakuRendererBackend::GlyphAtlas:
+        return "glyph_atlas";
     case DanmakuRendererBackend::FrameImage:
         return "frame_image";
     }
@@ -72,6 +90,27 @@ QImage normalizedImageForAtlas(const QImage &image) {
     return normalized;
 }
 
+QImage decodeDistanceField(const QImage &field) {
+    if (field.isNull()) {
+        return {};
+    }
+
+    QImage decoded = field.convertToFormat(QImage::Format_RGBA8888_Premultiplied);
+    const qreal width = 0.25 / DanmakuRenderStyle::kDistanceFieldSpreadPx;
+    for (int y = 0; y < decoded.height(); ++y) {
+        uchar *line = decoded.scanLine(y);
+        for (int x = 0; x < decoded.width(); ++x) {
+            const qreal t = std::clamp((line[x * 4 + 3] / 255.0 - 0.5 + width) / (2.0 * width), 0.0, 1.0);
+            const uchar value = static_cast<uchar>(std::lround(t * t * (3.0 - 2.0 * t) * 255.0));
+            line[x * 4 + 0] = value;
+            line[x * 4 + 1] = value;
+            line[x * 4 + 2] = value;
+            line[x * 4 + 3] = value;
+        }
+    }
+    return decoded;
+}
+
 QImage colorizeSpriteImage(const QImage &source, const QColor &color) {
     if (source.isNull()) {
         return {};
@@ -93,7 +132,11 @@ public:
     DanmakuRenderNode()
         : m_quadVbo(QOpenGLBuffer::VertexBuffer),
           m_instanceVbo(QOpenGLBuffer::VertexBuffer),
-          m_frameVbo(QOpenGLBuffer::VertexBuffer) {}
+          m_frameVbo(QOpenGLBuffer::VertexBuffer) {
+        if (QCoreApplication::instance() && QThread::currentThread() != QCoreApplication::instance()->thread()) {
+            PerfTrace::setThreadName(QStringLiteral("render"));
+        }
+    }
 
     ~DanmakuRenderNode() override {
         releaseResources();
@@ -104,22 +147,61 @@ public:
         const QVector<DanmakuSpriteUpload> &uploads,
         const QSize &itemSize,
         qreal devicePixelRatio,
+        qreal scrollSec,
+        qreal clockSec,
         DanmakuRendererBackend backend) {
+        const PerfTraceSpan span("DanmakuRenderNode::setFrame");
         if (m_requestedBackend != backend) {
             m_requestedBackend = backend;
             m_runtimeBackend = backend;
             m_atlasInstancingUnsupported = false;
+            m_atlasInstancesDirty = true;
         }
         m_itemSize = itemSize;
         m_devicePixelRatio = std::max(devicePixelRatio, 1.0);
+        m_scrollSec = scrollSec;
+        m_clockSec = clockSec;
+        const quint64 snapshotSequence = frame ? frame->sequence : 0;
+        const bool snapshotChanged = frame.data() != m_frameSnapshot.data()
+            || snapshotSequence != m_frameSnapshotSequence
+            || !uploads.isEmpty();
         m_frameSnapshot = frame;
+        m_frameSnapshotSequence = snapshotSequence;
         const QVector<DanmakuRenderInstance> &instances = currentInstances();
-        ++m_frameSequence;
         ++m_perfFrameCount;
         m_perfInstanceTotal += instances.size();
 
+        if (snapshotChanged || m_spriteResidencyPending) {
+            applySnapshotChange(uploads);
+        }
+
+        if (m_runtimeBackend != DanmakuRendererBackend::FrameImage) {
+            if (m_atlasInstancingUnsupported) {
+                buildAtlasVertices();
+                clearPageInstanceBuffers();
+                m_atlasInstancesDirty = true;
+            } else if (m_atlasInstancesDirty || m_pageInstances.size() != m_atlasPages.size()) {
+                buildAtlasInstances();
+                clearPageVertexBuffers();
+            }
+        } else {
+            composeFrameImage();
+        }
+    }
+
+    void applySnapshotChange(const QVector<DanmakuSpriteUpload> &uploads) {
+        const PerfTraceSpan span("DanmakuRenderNode::applySnapshotChange");
+        const QVector<DanmakuRenderInstance> &instances = currentInstances();
+        ++m_frameSequence;
+        m_atlasInstancesDirty = true;
+
+        for (const DanmakuSpriteUpload &upload : uploads) {
+            for (const DanmakuGlyphImage &glyph : upload.glyphImages) {
+                applyGlyphImage(glyph);
+            }
+        }
         for (const DanmakuSpriteUpload &upload : uploads) {
-            if (upload.spriteId == 0 || upload.image.isNull()) {
+            if (upload.spriteId == 0 || (upload.image.isNull() && upload.glyphs.isEmpty())) {
                 continue;
             }
 
@@ -127,7 +209,11 @@ public:
             record.spriteId = upload.spriteId;
             record.logicalSize = upload.logicalSize;
             record.image = normalizedImageForAtlas(upload.image);
+            record.distanceField = upload.distanceField;
+            record.decodedImage = {};
+            record.glyphs = upload.glyphs;
             record.hoverImage = {};
+            m_distanceFieldSprites = m_distanceFieldSprites || upload.distanceField;
             record.lastUsedFrame = m_frameSequence;
             if (record.pageIndex >= 0) {
                 removeSpriteFromPage(upload.spriteId, record.pageIndex);
@@ -140,33 +226,60 @@ public:
 
         bool hasPendingResidency = false;
         for (const DanmakuRenderInstance &instance : instances) {
-            auto spriteIt = m_sprites.find(instance.spriteId);
-            if (spriteIt != m_sprites.end()) {
-                spriteIt->lastUsedFrame = m_frameSequence;
-                if (spriteIt->pageIndex < 0 && !spriteIt->image.isNull()) {
+            forEachSpriteQuad(instance, [this, &hasPendingResidency](SpriteRecord &record, const QPointF &) {
+                record.lastUsedFrame = m_frameSequence;
+                if (record.pageIndex < 0 && !record.image.isNull()) {
                     hasPendingResidency = true;
                 }
-            }
+            });
         }
 
-        if (m_runtimeBackend == DanmakuRendererBackend::Atlas) {
-            if (hasPendingResidency) {
-                QSet<DanmakuSpriteId> activeSpriteIds;
-                activeSpriteIds.reserve(instances.size());
-                for (const DanmakuRenderInstance &instance : instances) {
-                    activeSpriteIds.insert(instance.spriteId);
-                }
-                ensureActiveSpritesResident(activeSpriteIds);
+        m_spriteResidencyPending = hasPendingResidency && m_runtimeBackend != DanmakuRendererBackend::FrameImage;
+        if (m_spriteResidencyPending) {
+            QSet<DanmakuSpriteId> activeSpriteIds;
+            activeSpriteIds.reserve(instances.size());
+            for (const DanmakuRenderInstance &instance : instances) {
+                forEachSpriteQuad(instance, [&activeSpriteIds](SpriteRecord &record, const QPointF &) {
+                    activeSpriteIds.insert(record.spriteId);
+                });
             }
-            if (m_atlasInstancingUnsupported) {
-                buildAtlasVertices();
-                clearPageInstanceBuffers();
-            } else {
-                buildAtlasInstances();
-                clearPageVertexBuffers();
+            ensureActiveSpritesResident(activeSpriteIds);
+        }
+    }
+
+    void applyGlyphImage(const DanmakuGlyphImage &glyph) {
+        if (glyph.image.isNull() || m_glyphSpriteIds.contains(glyph.key)) {
+            return;
+        }
+
+        const DanmakuSpriteId glyphSpriteId = m_nextGlyphSpriteId++;
+        m_glyphSpriteIds.insert(glyph.key, glyphSpriteId);
+        SpriteRecord &record = m_sprites[glyphSpriteId];
+        record.spriteId = glyphSpriteId;
+        record.logicalSize = glyph.logicalSize;
+        record.image = normalizedImageForAtlas(glyph.image);
+        record.distanceField = glyph.distanceField;
+        record.lastUsedFrame = m_frameSequence;
+        m_distanceFieldSprites = m_distanceFieldSprites || glyph.distanceField;
+        ++m_perfGlyphUploadCount;
+        m_perfSpriteUploadBytes += static_cast<qulonglong>(record.image.sizeInBytes());
+    }
+
+    template <typename Fn>
+    void forEachSpriteQuad(const DanmakuRenderInstance &instance, Fn &&fn) {
+        const auto spriteIt = m_sprites.find(instance.spriteId);
+        if (spriteIt == m_sprites.end()) {
+            return;
+        }
+        if (spriteIt->glyphs.isEmpty()) {
+            fn(spriteIt.value(), QPointF());
+            return;
+        }
+        for (const DanmakuGlyphPlacement &glyph : std::as_const(spriteIt->glyphs)) {
+            const auto glyphIt = m_sprites.find(m_glyphSpriteIds.value(glyph.key));
+            if (glyphIt != m_sprites.end()) {
+                fn(glyphIt.value(), glyph.offset);
             }
-        } else {
-            composeFrameImage();
         }
     }
 
@@ -183,6 +296,7 @@ public:
     }
 
     void render(const RenderState *state) override {
+        const PerfTraceSpan span("DanmakuRenderNode::render");
         if (m_itemSize.width() <= 0 || m_itemSize.height() <= 0) {
             return;
         }
@@ -196,6 +310,7 @@ public:
         if (!projection) {
             return;
         }
+        const qint64 renderStartNs = DanmakuFrameClock::nowNs();
 
         glDisable(GL_DEPTH_TEST);
         glDisable(GL_CULL_FACE);
@@ -218,7 +333,7 @@ public:
 
         int drawCallsThisFrame = 0;
         DanmakuRendererBackend backendForRender = m_runtimeBackend;
-        if (backendForRender == DanmakuRendererBackend::Atlas) {
+        if (backendForRender != DanmakuRendererBackend::FrameImage) {
             const bool useInstancing = !m_atlasInstancingUnsupported && supportsAtlasInstancing(ctx);
             if (useInstancing) {
                 if (!ensureAtlasGlResources() || !updateAtlasTextures() || !m_atlasProgram) {
@@ -228,6 +343,10 @@ public:
                     m_atlasProgram->bind();
                     m_atlasProgram->setUniformValue(m_atlasMatrixLoc, mvp);
                     m_atlasProgram->setUniformValue(m_atlasTextureLoc, 0);
+                    m_atlasProgram->setUniformValue(m_atlasScrollSecLoc, static_cast<GLfloat>(m_scrollSec));
+                    m_atlasProgram->setUniformValue(m_atlasClockSecLoc, static_cast<GLfloat>(m_clockSec));
+                    m_atlasProgram->setUniformValue(m_atlasFadeDurationLoc, static_cast<GLfloat>(kFadeDurationSec));
+                    m_atlasProgram->setUniformValue(m_atlasDistanceFieldWidthLoc, distanceFieldWidth());
 
                     m_quadVbo.bind();
                     m_atlasProgram->enableAttributeArray(m_atlasLocalPositionLoc);
@@ -246,42 +365,51 @@ public:
                         sizeof(QuadVertex));
 
                     m_instanceVbo.bind();
+                    uploadInstanceBufferIfDirty();
                     m_atlasProgram->enableAttributeArray(m_atlasRectLoc);
                     m_atlasProgram->enableAttributeArray(m_atlasUvRectLoc);
                     m_atlasProgram->enableAttributeArray(m_atlasColorLoc);
-                    m_atlasProgram->setAttributeBuffer(
-                        m_atlasRectLoc,
-                        GL_FLOAT,
-                        offsetof(InstanceData, x),
-                        4,
-                        sizeof(InstanceData));
-                    m_atlasProgram->setAttributeBuffer(
-                        m_atlasUvRectLoc,
-                        GL_FLOAT,
-                        offsetof(InstanceData, u0),
-                        4,
-                        sizeof(InstanceData));
-                    m_atlasProgram->setAttributeBuffer(
-                        m_atlasColorLoc,
-                        GL_FLOAT,
-                        offsetof(InstanceData, r),
-                        4,
-                        sizeof(InstanceData));
+                    m_atlasProgram->enableAttributeArray(m_atlasMotionLoc);
                     glVertexAttribDivisor(static_cast<GLuint>(m_atlasRectLoc), 1);
                     glVertexAttribDivisor(static_cast<GLuint>(m_atlasUvRectLoc), 1);
                     glVertexAttribDivisor(static_cast<GLuint>(m_atlasColorLoc), 1);
+                    glVertexAttribDivisor(static_cast<GLuint>(m_atlasMotionLoc), 1);
 
                     for (int pageIndex = 0; pageIndex < m_pageInstances.size(); ++pageIndex) {
                         const QVector<InstanceData> &instances = m_pageInstances[pageIndex];
-                        if (instances.isEmpty()) {
+                        if (instances.isEmpty() || pageIndex >= m_pageInstanceOffsets.size()) {
                             continue;
                         }
                         AtlasPage &page = m_atlasPages[pageIndex];
                         if (!page.texture) {
                             continue;
                         }
+                        const int baseOffset = m_pageInstanceOffsets[pageIndex] * static_cast<int>(sizeof(InstanceData));
+                        m_atlasProgram->setAttributeBuffer(
+                            m_atlasRectLoc,
+                            GL_FLOAT,
+                            baseOffset + static_cast<int>(offsetof(InstanceData, x)),
+                            4,
+                            sizeof(InstanceData));
+                        m_atlasProgram->setAttributeBuffer(
+                            m_atlasUvRectLoc,
+                            GL_FLOAT,
+                            baseOffset + static_cast<int>(offsetof(InstanceData, u0)),
+                            4,
+                            sizeof(InstanceData));
+                        m_atlasProgram->setAttributeBuffer(
+                            m_atlasColorLoc,
+                            GL_FLOAT,
+                            baseOffset + static_cast<int>(offsetof(InstanceData, r)),
+                            4,
+                            sizeof(InstanceData));
+                        m_atlasProgram->setAttributeBuffer(
+                            m_atlasMotionLoc,
+                            GL_FLOAT,
+                            baseOffset + static_cast<int>(offsetof(InstanceData, speed)),
+                            3,
+                            sizeof(InstanceData));
                         page.texture->bind(0);
-                        m_instanceVbo.allocate(instances.constData(), instances.size() * static_cast<int>(sizeof(InstanceData)));
                         glDrawArraysInstanced(GL_TRIANGLES, 0, 6, instances.size());
                         page.texture->release();
                         ++drawCallsThisFrame;
@@ -290,11 +418,13 @@ public:
                     glVertexAttribDivisor(static_cast<GLuint>(m_atlasRectLoc), 0);
                     glVertexAttribDivisor(static_cast<GLuint>(m_atlasUvRectLoc), 0);
                     glVertexAttribDivisor(static_cast<GLuint>(m_atlasColorLoc), 0);
+                    glVertexAttribDivisor(static_cast<GLuint>(m_atlasMotionLoc), 0);
                     m_atlasProgram->disableAttributeArray(m_atlasLocalPositionLoc);
                     m_atlasProgram->disableAttributeArray(m_atlasLocalUvLoc);
                     m_atlasProgram->disableAttributeArray(m_atlasRectLoc);
                     m_atlasProgram->disableAttributeArray(m_atlasUvRectLoc);
                     m_atlasProgram->disableAttributeArray(m_atlasColorLoc);
+                    m_atlasProgram->disableAttributeArray(m_atlasMotionLoc);
                     m_instanceVbo.release();
                     m_quadVbo.release();
                     m_atlasProgram->release();
@@ -311,6 +441,7 @@ public:
                     m_frameProgram->bind();
                     m_frameProgram->setUniformValue(m_frameMatrixLoc, mvp);
                     m_frameProgram->setUniformValue(m_frameTextureLoc, 0);
+                    m_frameProgram->setUniformValue(m_frameDistanceFieldWidthLoc, distanceFieldWidth());
                     m_frameVbo.bind();
                     m_frameProgram->enableAttributeArray(m_framePositionLoc);
                     m_frameProgram->enableAttributeArray(m_frameUvLoc);
@@ -352,6 +483,7 @@ public:
             m_frameProgram->bind();
             m_frameProgram->setUniformValue(m_frameMatrixLoc, mvp);
             m_frameProgram->setUniformValue(m_frameTextureLoc, 0);
+            m_frameProgram->setUniformValue(m_frameDistanceFieldWidthLoc, 0.0f);
             m_frameVbo.bind();
             m_frameProgram->enableAttributeArray(m_framePositionLoc);
             m_frameProgram->enableAttributeArray(m_frameUvLoc);
@@ -375,6 +507,7 @@ public:
         }
 
         m_perfDrawCalls += drawCallsThisFrame;
+        m_perfMetrics.histogram(QStringLiteral("render_cpu_us")).record((DanmakuFrameClock::nowNs() - renderStartNs) / 1000);
         maybeWritePerfLog();
     }
 
@@ -446,12 +579,18 @@ private:
         float g = 1.0f;
         float b = 1.0f;
         float a = 1.0f;
+        float speed = 0.0f;
+        float anchorScrollSec = 0.0f;
+        float fadeEndSec = 0.0f;
     };
 
     struct SpriteRecord {
         DanmakuSpriteId spriteId = 0;
-        QSize logicalSize;
+        QSizeF logicalSize;
         QImage image;
+        bool distanceField = false;
+        QImage decodedImage;
+        QVector<DanmakuGlyphPlacement> glyphs;
         QImage hoverImage;
         quint64 lastUsedFrame = 0;
         int pageIndex = -1;
@@ -483,20 +622,30 @@ private:
             const bool isGles = ctx->isOpenGLES();
             const char *vertexSource = isGles
                 ? R"(
-                    precision mediump float;
+                    precision highp float;
                     attribute vec2 a_localPos;
                     attribute vec2 a_localUv;
                     attribute vec4 a_instanceRect;
                     attribute vec4 a_instanceUvRect;
                     attribute vec4 a_instanceColor;
+                    attribute vec3 a_instanceMotion;
                     uniform mat4 u_matrix;
+                    uniform float u_scrollSec;
+                    uniform float u_clockSec;
+                    uniform float u_fadeDurationSec;
                     varying vec2 v_uv;
                     varying vec4 v_color;
                     void main() {
-                        vec2 position = a_instanceRect.xy + (a_localPos * a_instanceRect.zw);
+                        vec2 origin = vec2(
+                            a_instanceRect.x - a_instanceMotion.x * (u_scrollSec - a_instanceMotion.y),
+                            a_instanceRect.y);
+                        float alpha = a_instanceMotion.z > 0.0
+                            ? clamp((a_instanceMotion.z - u_clockSec) / u_fadeDurationSec, 0.0, 1.0)
+                            : a_instanceColor.a;
+                        vec2 position = origin + (a_localPos * a_instanceRect.zw);
                         vec2 uv = mix(a_instanceUvRect.xy, a_instanceUvRect.zw, a_localUv);
                         v_uv = uv;
-                        v_color = a_instanceColor;
+                        v_color = vec4(a_instanceColor.rgb, alpha);
                         gl_Position = u_matrix * vec4(position, 0.0, 1.0);
                     }
                 )"
@@ -507,14 +656,24 @@ private:
                     in vec4 a_instanceRect;
                     in vec4 a_instanceUvRect;
                     in vec4 a_instanceColor;
+                    in vec3 a_instanceMotion;
                     uniform mat4 u_matrix;
+                    uniform float u_scrollSec;
+                    uniform float u_clockSec;
+                    uniform float u_fadeDurationSec;
                     out vec2 v_uv;
                     out vec4 v_color;
                     void main() {
-                        vec2 position = a_instanceRect.xy + (a_localPos * a_instanceRect.zw);
+                        vec2 origin = vec2(
+                            a_instanceRect.x - a_instanceMotion.x * (u_scrollSec - a_instanceMotion.y),
+                            a_instanceRect.y);
+                        float alpha = a_instanceMotion.z > 0.0
+                            ? clamp((a_instanceMotion.z - u_clockSec) / u_fadeDurationSec, 0.0, 1.0)
+                            : a_instanceColor.a;
+                        vec2 position = origin + (a_localPos * a_instanceRect.zw);
                         vec2 uv = mix(a_instanceUvRect.xy, a_instanceUvRect.zw, a_localUv);
                         v_uv = uv;
-                        v_color = a_instanceColor;
+                        v_color = vec4(a_instanceColor.rgb, alpha);
                         gl_Position = u_matrix * vec4(position, 0.0, 1.0);
                     }
                 )";
@@ -525,9 +684,13 @@ private:
                     varying vec2 v_uv;
                     varying vec4 v_color;
                     uniform sampler2D u_texture;
+                    uniform float u_distanceFieldWidth;
                     void main() {
                         vec4 tex = texture2D(u_texture, v_uv);
-                        gl_FragColor = vec4(v_color.rgb * tex.a, tex.a * v_color.a);
+                        float coverage = u_distanceFieldWidth > 0.0
+                            ? smoothstep(0.5 - u_distanceFieldWidth, 0.5 + u_distanceFieldWidth, tex.a)
+                            : tex.a;
+                        gl_FragColor = vec4(v_color.rgb * coverage, coverage * v_color.a);
                     }
                 )"
                 : R"(
@@ -535,10 +698,14 @@ private:
                     in vec2 v_uv;
                     in vec4 v_color;
                     uniform sampler2D u_texture;
+                    uniform float u_distanceFieldWidth;
                     out vec4 fragColor;
                     void main() {
                         vec4 tex = texture(u_texture, v_uv);
-                        fragColor = vec4(v_color.rgb * tex.a, tex.a * v_color.a);
+                        float coverage = u_distanceFieldWidth > 0.0
+                            ? smoothstep(0.5 - u_distanceFieldWidth, 0.5 + u_distanceFieldWidth, tex.a)
+                            : tex.a;
+                        fragColor = vec4(v_color.rgb * coverage, coverage * v_color.a);
                     }
                 )";
 
@@ -555,6 +722,7 @@ private:
             m_atlasProgram->bindAttributeLocation("a_instanceRect", 2);
             m_atlasProgram->bindAttributeLocation("a_instanceUvRect", 3);
             m_atlasProgram->bindAttributeLocation("a_instanceColor", 4);
+            m_atlasProgram->bindAttributeLocation("a_instanceMotion", 5);
             if (!m_atlasProgram->link()) {
                 delete m_atlasProgram;
                 m_atlasProgram = nullptr;
@@ -566,8 +734,13 @@ private:
             m_atlasRectLoc = 2;
             m_atlasUvRectLoc = 3;
             m_atlasColorLoc = 4;
+            m_atlasMotionLoc = 5;
             m_atlasMatrixLoc = m_atlasProgram->uniformLocation("u_matrix");
             m_atlasTextureLoc = m_atlasProgram->uniformLocation("u_texture");
+            m_atlasScrollSecLoc = m_atlasProgram->uniformLocation("u_scrollSec");
+            m_atlasClockSecLoc = m_atlasProgram->uniformLocation("u_clockSec");
+            m_atlasFadeDurationLoc = m_atlasProgram->uniformLocation("u_fadeDurationSec");
+            m_atlasDistanceFieldWidthLoc = m_atlasProgram->uniformLocation("u_distanceFieldWidth");
         }
 
         if (!m_quadVbo.isCreated()) {
@@ -588,6 +761,7 @@ private:
         if (!m_instanceVbo.isCreated()) {
             m_instanceVbo.create();
             m_instanceVbo.setUsagePattern(QOpenGLBuffer::DynamicDraw);
+            m_instanceBufferDirty = true;
         }
         return true;
     }
@@ -657,9 +831,13 @@ private:
                     varying vec2 v_uv;
                     varying vec4 v_color;
                     uniform sampler2D u_texture;
+                    uniform float u_distanceFieldWidth;
                     void main() {
                         vec4 tex = texture2D(u_texture, v_uv);
-                        gl_FragColor = vec4(v_color.rgb * tex.a, tex.a * v_color.a);
+                        float coverage = u_distanceFieldWidth > 0.0
+                            ? smoothstep(0.5 - u_distanceFieldWidth, 0.5 + u_distanceFieldWidth, tex.a)
+                            : tex.a;
+                        gl_FragColor = vec4(v_color.rgb * coverage, coverage * v_color.a);
                     }
                 )"
                 : R"(
@@ -667,10 +845,14 @@ private:
                     in vec2 v_uv;
                     in vec4 v_color;
                     uniform sampler2D u_texture;
+                    uniform float u_distanceFieldWidth;
                     out vec4 fragColor;
                     void main() {
                         vec4 tex = texture(u_texture, v_uv);
-                        fragColor = vec4(v_color.rgb * tex.a, tex.a * v_color.a);
+                        float coverage = u_distanceFieldWidth > 0.0
+                            ? smoothstep(0.5 - u_distanceFieldWidth, 0.5 + u_distanceFieldWidth, tex.a)
+                            : tex.a;
+                        fragColor = vec4(v_color.rgb * coverage, coverage * v_color.a);
                     }
                 )";
 
@@ -696,6 +878,7 @@ private:
             m_frameColorLoc = 2;
             m_frameMatrixLoc = m_frameProgram->uniformLocation("u_matrix");
             m_frameTextureLoc = m_frameProgram->uniformLocation("u_texture");
+            m_frameDistanceFieldWidthLoc = m_frameProgram->uniformLocation("u_distanceFieldWidth");
         }
 
         if (!m_frameVbo.isCreated()) {
@@ -739,6 +922,7 @@ private:
     }
 
     bool updateAtlasTextures() {
+        const PerfTraceSpan span("DanmakuRenderNode::uploadAtlasTextures");
         for (AtlasPage &page : m_atlasPages) {
             if (!page.textureDirty) {
                 continue;
@@ -762,6 +946,43 @@ private:
         return true;
     }
 
+    qreal instanceX(const DanmakuRenderInstance &instance) const {
+        return instance.x - instance.speed * (m_scrollSec - instance.anchorScrollSec);
+    }
+
+    qreal instanceAlpha(const DanmakuRenderInstance &instance) const {
+        if (instance.fadeEndSec > 0.0) {
+            return std::clamp((instance.fadeEndSec - m_clockSec) / kFadeDurationSec, 0.0, 1.0);
+        }
+        return std::clamp(instance.alpha, 0.0, 1.0);
+    }
+
+    void uploadInstanceBufferIfDirty() {
+        if (!m_instanceBufferDirty) {
+            return;
+        }
+        m_pageInstanceOffsets.resize(m_pageInstances.size());
+        int totalInstances = 0;
+        for (int pageIndex = 0; pageIndex < m_pageInstances.size(); ++pageIndex) {
+            m_pageInstanceOffsets[pageIndex] = totalInstances;
+            totalInstances += m_pageInstances[pageIndex].size();
+        }
+        const int instanceBytes = static_cast<int>(sizeof(InstanceData));
+        m_instanceVbo.allocate(std::max(1, totalInstances) * instanceBytes);
+        for (int pageIndex = 0; pageIndex < m_pageInstances.size(); ++pageIndex) {
+            const QVector<InstanceData> &instances = m_pageInstances[pageIndex];
+            if (instances.isEmpty()) {
+                continue;
+            }
+            m_instanceVbo.write(
+                m_pageInstanceOffsets[pageIndex] * instanceBytes,
+                instances.constData(),
+                instances.size() * instanceBytes);
+        }
+        m_instanceBufferDirty = false;
+        ++m_perfInstanceUploadCount;
+    }
+
     const QVector<DanmakuRenderInstance> &currentInstances() const {
         static const QVector<DanmakuRenderInstance> emptyInstances;
         return m_frameSnapshot ? m_frameSnapshot->instances : emptyInstances;
@@ -781,7 +1002,9 @@ private:
 
     void ensureActiveSpritesResident(const QSet<DanmakuSpriteId> &activeSpriteIds) {
         for (const DanmakuRenderInstance &instance : currentInstances()) {
-            ensureSpriteResident(instance.spriteId, activeSpriteIds);
+            forEachSpriteQuad(instance, [this, &activeSpriteIds](SpriteRecord &record, const QPointF &) {
+                ensureSpriteResident(record.spriteId, activeSpriteIds);
+            });
         }
     }
 
@@ -964,47 +1187,53 @@ private:
             m_pageInstances.resize(m_atlasPages.size());
         }
         clearPageInstanceBuffers();
+        m_atlasInstancesDirty = false;
+        m_instanceBufferDirty = true;
 
         for (const DanmakuRenderInstance &instance : currentInstances()) {
-            const auto spriteIt = m_sprites.constFind(instance.spriteId);
-            if (spriteIt == m_sprites.constEnd()) {
-                continue;
-            }
-            const SpriteRecord &record = spriteIt.value();
-            if (record.pageIndex < 0 || record.pageIndex >= m_pageInstances.size()) {
-                continue;
-            }
-
-            const QSize pageSize = m_atlasPages[record.pageIndex].image.size();
-            if (!pageSize.isValid()) {
-                continue;
-            }
-            const float u0 = static_cast<float>(record.pixelRect.left()) / pageSize.width();
-            const float v0 = static_cast<float>(record.pixelRect.top()) / pageSize.height();
-            const float u1 = static_cast<float>(record.pixelRect.right() + 1) / pageSize.width();
-            const float v1 = static_cast<float>(record.pixelRect.bottom() + 1) / pageSize.height();
-            const float alpha = static_cast<float>(std::clamp(instance.alpha, 0.0, 1.0));
-            const float red = 1.0f;
-            const float green = instance.ngDropHovered ? 0.4f : 1.0f;
-            const float blue = instance.ngDropHovered ? (119.0f / 255.0f) : 1.0f;
-            QVector<InstanceData> &instances = m_pageInstances[record.pageIndex];
-            instances.push_back(InstanceData {
-                static_cast<float>(instance.x),
-                static_cast<float>(instance.y),
-                static_cast<float>(record.logicalSize.width()),
-                static_cast<float>(record.logicalSize.height()),
-                u0,
-                v0,
-                u1,
-                v1,
-                red,
-                green,
-                blue,
-                alpha,
+            forEachSpriteQuad(instance, [this, &instance](SpriteRecord &record, const QPointF &offset) {
+                appendAtlasInstance(instance, record, offset);
             });
         }
     }
 
+    void appendAtlasInstance(const DanmakuRenderInstance &instance, const SpriteRecord &record, const QPointF &offset) {
+        if (record.pageIndex < 0 || record.pageIndex >= m_pageInstances.size()) {
+            return;
+        }
+
+        const QSize pageSize = m_atlasPages[record.pageIndex].image.size();
+        if (!pageSize.isValid()) {
+            return;
+        }
+        const float u0 = static_cast<float>(record.pixelRect.left()) / pageSize.width();
+        const float v0 = static_cast<float>(record.pixelRect.top()) / pageSize.height();
+        const float u1 = static_cast<float>(record.pixelRect.right() + 1) / pageSize.width();
+        const float v1 = static_cast<float>(record.pixelRect.bottom() + 1) / pageSize.height();
+        const float alpha = static_cast<float>(std::clamp(instance.alpha, 0.0, 1.0));
+        const float red = 1.0f;
+        const float green = instance.ngDropHovered ? 0.4f : 1.0f;
+        const float blue = instance.ngDropHovered ? (119.0f / 255.0f) : 1.0f;
+        QVector<InstanceData> &instances = m_pageInstances[record.pageIndex];
+        instances.push_back(InstanceData {
+            static_cast<float>(instance.x + offset.x()),
+            static_cast<float>(instance.y + offset.y()),
+            static_cast<float>(record.logicalSize.width()),
+            static_cast<float>(record.logicalSize.height()),
+            u0,
+            v0,
+            u1,
+            v1,
+            red,
+            green,
+            blue,
+            alpha,
+            static_cast<float>(instance.speed),
+            static_cast<float>(instance.anchorScrollSec),
+            static_cast<float>(instance.fadeEndSec),
+        });
+    }
+
     void buildAtlasVertices() {
         if (m_pageVertices.size() != m_atlasPages.size()) {
             m_pageVertices.resize(m_atlasPages.size());
@@ -1012,39 +1241,51 @@ private:
         clearPageVertexBuffers();
 
         for (const DanmakuRenderInstance &instance : currentInstances()) {
-            const auto spriteIt = m_sprites.constFind(instance.spriteId);
-            if (spriteIt == m_sprites.constEnd()) {
-                continue;
-            }
-            const SpriteRecord &record = spriteIt.value();
-            if (record.pageIndex < 0 || record.pageIndex >= m_pageVertices.size()) {
-                continue;
-            }
+            forEachSpriteQuad(instance, [this, &instance](SpriteRecord &record, const QPointF &offset) {
+                appendAtlasVertices(instance, record, offset);
+            });
+        }
+    }
 
-            const QSize pageSize = m_atlasPages[record.pageIndex].image.size();
-            if (!pageSize.isValid()) {
-                continue;
-            }
-            const float left = static_cast<float>(instance.x);
-            const float top = static_cast<float>(instance.y);
-            const float right = static_cast<float>(instance.x + record.logicalSize.width());
-            const float bottom = static_cast<float>(instance.y + record.logicalSize.height());
-            const float u0 = static_cast<float>(record.pixelRect.left()) / pageSize.width();
-            const float v0 = static_cast<float>(record.pixelRect.top()) / pageSize.height();
-            const float u1 = static_cast<float>(record.pixelRect.right() + 1) / pageSize.width();
-            const float v1 = static_cast<float>(record.pixelRect.bottom() + 1) / pageSize.height();
-            const float alpha = static_cast<float>(std::clamp(instance.alpha, 0.0, 1.0));
-            const float red = 1.0f;
-            const float green = instance.ngDropHovered ? 0.4f : 1.0f;
-            const float blue = instance.ngDropHovered ? (119.0f / 255.0f) : 1.0f;
-            QVector<Vertex> &vertices = m_pageVertices[record.pageIndex];
-            vertices.push_back(Vertex {left, top, u0, v0, red, green, blue, alpha});
-            vertices.push_back(Vertex {right, top, u1, v0, red, green, blue, alpha});
-            vertices.push_back(Vertex {left, bottom, u0, v1, red, green, blue, alpha});
-            vertices.push_back(Vertex {left, bottom, u0, v1, red, green, blue, alpha});
-            vertices.push_back(Vertex {right, top, u1, v0, red, green, blue, alpha});
-            vertices.push_back(Vertex {right, bottom, u1, v1, red, green, blue, alpha});
+    void appendAtlasVertices(const DanmakuRenderInstance &instance, const SpriteRecord &record, const QPointF &offset) {
+        if (record.pageIndex < 0 || record.pageIndex >= m_pageVertices.size()) {
+            return;
+        }
+
+        const QSize pageSize = m_atlasPages[record.pageIndex].image.size();
+        if (!pageSize.isValid()) {
+            return;
         }
+        const qreal x = instanceX(instance) + offset.x();
+        const qreal y = instance.y + offset.y();
+        const float left = static_cast<float>(x);
+        const float top = static_cast<float>(y);
+        const float right = static_cast<float>(x + record.logicalSize.width());
+        const float bottom = static_cast<float>(y + record.logicalSize.height());
+        const float u0 = static_cast<float>(record.pixelRect.left()) / pageSize.width();
+        const float v0 = static_cast<float>(record.pixelRect.top()) / pageSize.height();
+        const float u1 = static_cast<float>(record.pixelRect.right() + 1) / pageSize.width();
+        const float v1 = static_cast<float>(record.pixelRect.bottom() + 1) / pageSize.height();
+        const float alpha = static_cast<float>(instanceAlpha(instance));
+        const float red = 1.0f;
+        const float green = instance.ngDropHovered ? 0.4f : 1.0f;
+        const float blue = instance.ngDropHovered ? (119.0f / 255.0f) : 1.0f;
+        QVector<Vertex> &vertices = m_pageVertices[record.pageIndex];
+        vertices.push_back(Vertex {left, top, u0, v0, red, green, blue, alpha});
+        vertices.push_back(Vertex {right, top, u1, v0, red, green, blue, alpha});
+        vertices.push_back(Vertex {left, bottom, u0, v1, red, green, blue, alpha});
+        vertices.push_back(Vertex {left, bottom, u0, v1, red, green, blue, alpha});
+        vertices.push_back(Vertex {right, top, u1, v0, red, green, blue, alpha});
+        vertices.push_back(Vertex {right, bottom, u1, v1, red, green, blue, alpha});
+    }
+
+    GLfloat distanceFieldWidth() const {
+        if (!m_distanceFieldSprites) {
+            return 0.0f;
+        }
+        return static_cast<GLfloat>(
+            0.25 * DanmakuRenderStyle::kDistanceFieldRasterScale
+            / (m_devicePixelRatio * DanmakuRenderStyle::kDistanceFieldSpreadPx));
     }
 
     void composeFrameImage() {
@@ -1057,24 +1298,29 @@ private:
 
         QPainter painter(&m_frameImage);
         for (const DanmakuRenderInstance &instance : currentInstances()) {
-            const auto spriteIt = m_sprites.find(instance.spriteId);
-            if (spriteIt == m_sprites.end() || spriteIt->image.isNull()) {
-                continue;
-            }
-            const QRectF targetRect(
-                instance.x,
-                instance.y,
-                spriteIt->logicalSize.width(),
-                spriteIt->logicalSize.height());
-            painter.setOpacity(std::clamp(instance.alpha, 0.0, 1.0));
-            if (instance.ngDropHovered) {
-                if (spriteIt->hoverImage.isNull()) {
-                    spriteIt->hoverImage = colorizeSpriteImage(spriteIt->image, QColor(QStringLiteral("#FFFF6677")));
+            painter.setOpacity(instanceAlpha(instance));
+            forEachSpriteQuad(instance, [this, &instance, &painter](SpriteRecord &record, const QPointF &offset) {
+                if (record.image.isNull()) {
+                    return;
                 }
-                painter.drawImage(targetRect, spriteIt->hoverImage);
-            } else {
-                painter.drawImage(targetRect, spriteIt->image);
-            }
+                if (record.distanceField && record.decodedImage.isNull()) {
+                    record.decodedImage = decodeDistanceField(record.image);
+                }
+                const QImage &image = record.distanceField ? record.decodedImage : record.image;
+                const QRectF targetRect(
+                    instanceX(instance) + offset.x(),
+                    instance.y + offset.y(),
+                    record.logicalSize.width(),
+                    record.logicalSize.height());
+                if (instance.ngDropHovered) {
+                    if (record.hoverImage.isNull()) {
+                        record.hoverImage = colorizeSpriteImage(image, QColor(QStringLiteral("#FFFF6677")));
+                    }
+                    painter.drawImage(targetRect, record.hoverImage);
+                } else {
+                    painter.drawImage(targetRect, image);
+                }
+            });
         }
 
         const float width = static_cast<float>(m_itemSize.width());
@@ -1102,23 +1348,28 @@ private:
             return;
         }
 
-        qInfo().noquote()
-            << QString("[perf-render] backend=%1 window_ms=%2 frame_count=%3 instances=%4 sprite_upload_count=%5 sprite_upload_bytes=%6 atlas_pages=%7 draw_calls=%8")
-                   .arg(QString::fromLatin1(rendererBackendName(m_runtimeBackend)))
-                   .arg(elapsedMs)
-                   .arg(m_perfFrameCount)
-                   .arg(m_perfInstanceTotal)
-                   .arg(m_perfSpriteUploadCount)
-                   .arg(m_perfSpriteUploadBytes)
-                   .arg(m_atlasPages.size())
-                   .arg(m_perfDrawCalls);
+        m_perfMetrics.setLabel(QStringLiteral("backend"), QString::fromLatin1(rendererBackendName(m_runtimeBackend)));
+        m_perfMetrics.setCounter(QStringLiteral("window_ms"), elapsedMs);
+        m_perfMetrics.setCounter(QStringLiteral("frame_count"), m_perfFrameCount);
+        m_perfMetrics.setCounter(QStringLiteral("instances"), static_cast<qint64>(m_perfInstanceTotal));
+        m_perfMetrics.setCounter(QStringLiteral("sprite_upload_count"), static_cast<qint64>(m_perfSpriteUploadCount));
+        m_perfMetrics.setCounter(QStringLiteral("sprite_upload_bytes"), static_cast<qint64>(m_perfSpriteUploadBytes));
+        m_perfMetrics.setCounter(QStringLiteral("glyph_upload_count"), static_cast<qint64>(m_perfGlyphUploadCount));
+        m_perfMetrics.setGauge(QStringLiteral("glyph_atlas_glyphs"), m_glyphSpriteIds.size(), 0);
+        m_perfMetrics.setGauge(QStringLiteral("atlas_pages"), m_atlasPages.size(), 0);
+        m_perfMetrics.setCounter(QStringLiteral("draw_calls"), static_cast<qint64>(m_perfDrawCalls));
+        m_perfMetrics.setCounter(QStringLiteral("instance_uploads"), static_cast<qint64>(m_perfInstanceUploadCount));
+        PerfMetricsRegistry::instance().publish(m_perfMetrics, nowMs);
 
         m_perfWindowStartMs = nowMs;
         m_perfFrameCount = 0;
         m_perfInstanceTotal = 0;
         m_perfSpriteUploadCount = 0;
         m_perfSpriteUploadBytes = 0;
+        m_perfGlyphUploadCount = 0;
         m_perfDrawCalls = 0;
+        m_perfInstanceUploadCount = 0;
+        m_perfMetrics.resetHistograms();
     }
 
     void releaseResources() {
@@ -1155,9 +1406,16 @@ private:
     DanmakuRendererBackend m_requestedBackend = DanmakuRendererBackend::Atlas;
     DanmakuRendererBackend m_runtimeBackend = DanmakuRendererBackend::Atlas;
     DanmakuRenderFrameConstPtr m_frameSnapshot;
+    quint64 m_frameSnapshotSequence = 0;
+    qreal m_scrollSec = 0.0;
+    qreal m_clockSec = 0.0;
     QHash<DanmakuSpriteId, SpriteRecord> m_sprites;
+    QHash<DanmakuGlyphKey, DanmakuSpriteId> m_glyphSpriteIds;
+    DanmakuSpriteId m_nextGlyphSpriteId = kFirstGlyphSpriteId;
+    bool m_distanceFieldSprites = false;
     QVector<AtlasPage> m_atlasPages;
     QVector<QVector<InstanceData>> m_pageInstances;
+    QVector<int> m_pageInstanceOffsets;
     QVector<QVector<Vertex>> m_pageVertices;
     QVector<Vertex> m_frameQuadVertices;
     QImage m_frameImage;
@@ -1165,6 +1423,9 @@ private:
     QOpenGLContext *m_glContext = nullptr;
     bool m_atlasInstancingUnsupported = false;
     bool m_frameTextureDirty = true;
+    bool m_atlasInstancesDirty = true;
+    bool m_instanceBufferDirty = true;
+    bool m_spriteResidencyPending = false;
     quint64 m_frameSequence = 0;
 
     QOpenGLShaderProgram *m_atlasProgram = nullptr;
@@ -1178,20 +1439,29 @@ private:
     int m_atlasRectLoc = -1;
     int m_atlasUvRectLoc = -1;
     int m_atlasColorLoc = -1;
+    int m_atlasMotionLoc = -1;
     int m_atlasMatrixLoc = -1;
     int m_atlasTextureLoc = -1;
+    int m_atlasScrollSecLoc = -1;
+    int m_atlasClockSecLoc = -1;
+    int m_atlasFadeDurationLoc = -1;
+    int m_atlasDistanceFieldWidthLoc = -1;
     int m_framePositionLoc = -1;
     int m_frameUvLoc = -1;
     int m_frameColorLoc = -1;
     int m_frameMatrixLoc = -1;
     int m_frameTextureLoc = -1;
+    int m_frameDistanceFieldWidthLoc = -1;
 
+    PerfMetricScope m_perfMetrics {QStringLiteral("render")};
     qint64 m_perfWindowStartMs = 0;
     int m_perfFrameCount = 0;
     qulonglong m_perfInstanceTotal = 0;
     qulonglong m_perfSpriteUploadCount = 0;
     qulonglong m_perfSpriteUploadBytes = 0;
+    qulonglong m_perfGlyphUploadCount = 0;
     qulonglong m_perfDrawCalls = 0;
+    qulonglong m_perfInstanceUploadCount = 0;
 };
 } // namespace
 
@@ -1258,7 +1528,7 @@ QSGNode *DanmakuRenderNodeItem::updatePaintNode(QSGNode *oldNode, UpdatePaintNod
     }
     if (itemWidth <= 0 || itemHeight <= 0 || !window()) {
         m_pendingPresentedFrame.store(false, std::memory_order_release);
-        node->setFrame({}, {}, QSize(1, 1), 1.0, rendererBackendFromEnv());
+        node->setFrame({}, {}, QSize(1, 1), 1.0, 0.0, 0.0, rendererBackendFromEnv());
         return node;
     }
 
@@ -1268,8 +1538,29 @@ QSGNode *DanmakuRenderNodeItem::updatePaintNode(QSGNode *oldNode, UpdatePaintNod
         snapshot = m_controller->renderSnapshot();
         uploads = m_controller->takePendingSpriteUploads();
     }
+    qreal scrollSec = 0.0;
+    qreal clockSec = 0.0;
+    if (snapshot && snapshot->simulatedAtNs > 0) {
+        const QScreen *screen = window()->screen();
+        const qreal refreshRate = screen && screen->refreshRate() > 1.0 ? screen->refreshRate() : kFallbackRefreshRateHz;
+        const qint64 predictedPresentNs = DanmakuFrameClock::nowNs() + static_cast<qint64>(1000000000.0 / refreshRate);
+        const qreal sinceSimulatedSec = (predictedPresentNs - snapshot->simulatedAtNs) / 1000000000.0;
+        if (snapshot->parametric) {
+            scrollSec = snapshot->scrollSec + snapshot->scrollRate * std::max<qreal>(0.0, sinceSimulatedSec);
+            clockSec = (predictedPresentNs - snapshot->clockEpochNs) / 1000000000.0;
+        } else {
+            scrollSec = snapshot->scrollRate * std::clamp(sinceSimulatedSec, 0.0, kMaxExtrapolationSec);
+        }
+    }
     m_pendingPresentedFrame.store(snapshot && !snapshot->instances.isEmpty(), std::memory_order_release);
-    node->setFrame(snapshot, uploads, QSize(itemWidth, itemHeight), devicePixelRatio, rendererBackendFromEnv());
+    node->setFrame(
+        snapshot,
+        uploads,
+        QSize(itemWidth, itemHeight),
+        devicePixelRatio,
+        scrollSec,
+        clockSec,
+        rendererBackendFromEnv());
     return node;
 }
 
@@ -1282,6 +1573,10 @@ void DanmakuRenderNodeItem::handleWindowChanged(QQuickWindow *window) {
         disconnect(m_frameSwappedConnection);
         m_frameSwappedConnection = {};
     }
+    if (m_afterAnimatingConnection) {
+        disconnect(m_afterAnimatingConnection);
+        m_afterAnimatingConnection = {};
+    }
     m_pendingPresentedFrame.store(false, std::memory_order_release);
     if (!window) {
         return;
@@ -1297,6 +1592,22 @@ void DanmakuRenderNodeItem::handleWindowChanged(QQuickWindow *window) {
         this,
         &DanmakuRenderNodeItem::handleWindowFrameSwapped,
         Qt::DirectConnection);
+    m_afterAnimatingConnection = connect(
+        window,
+        &QQuickWindow::afterAnimating,
+        this,
+        &DanmakuRenderNodeItem::handleWindowAfterAnimating);
+}
+
+void DanmakuRenderNodeItem::handleWindowAfterAnimating() {
+    if (!m_controller || m_controller->frameClockMode() == DanmakuFrameClockMode::Timer) {
+        return;
+    }
+    m_controller->advanceVsyncFrame();
+    update();
+    if (m_controller->wantsAnimationFrame() && window()) {
+        QMetaObject::invokeMethod(window(), &QQuickWindow::update, Qt::QueuedConnection);
+    }
 }
 
 void DanmakuRenderNodeItem::handleWindowFrameSwapped() {
@@ -29,9 +29,11 @@ private:
     void handleControllerRenderSnapshotChanged();
     void handleWindowChanged(QQuickWindow *window);
     void handleWindowFrameSwapped();
+    void handleWindowAfterAnimating();
 
     QPointer<DanmakuController> m_controller;
     QMetaObject::Connection m_frameSwappedConnection;
+    QMetaObject::Connection m_afterAnimatingConnection;
     std::atomic_bool m_pendingPresentedFrame = false;
     qreal m_lastRenderDevicePixelRatio = 0.0;
 };
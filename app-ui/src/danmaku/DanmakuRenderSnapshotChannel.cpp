@@ -0,0 +1,59 @@
+#include "danmaku/DanmakuRenderSnapshotChannel.hpp"
+
+DanmakuRenderSnapshotChannel::DanmakuRenderSnapshotChannel() {
+    for (std::shared_ptr<Slot> &slot : m_slots) {
+        slot = std::make_shared<Slot>();
+    }
+}
+
+DanmakuRenderFrame &DanmakuRenderSnapshotChannel::backFrame() {
+    std::shared_ptr<Slot> &slot = m_slots[m_backIndex];
+    if (slot->leased.load(std::memory_order_acquire)) {
+        slot = std::make_shared<Slot>();
+        m_detachedCount.fetch_add(1, std::memory_order_relaxed);
+    }
+    return slot->frame;
+}
+
+void DanmakuRenderSnapshotChannel::publish() {
+    backFrame().sequence = m_nextSequence++;
+    const quint8 previous = m_readyState.exchange(
+        static_cast<quint8>(m_backIndex) | kFreshBit,
+        std::memory_order_acq_rel);
+    m_backIndex = previous & kIndexMask;
+    m_publishedCount.fetch_add(1, std::memory_order_relaxed);
+    if ((previous & kFreshBit) != 0) {
+        m_skippedCount.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+DanmakuRenderFrameConstPtr DanmakuRenderSnapshotChannel::consume() {
+    if ((m_readyState.load(std::memory_order_acquire) & kFreshBit) != 0) {
+        m_frontLease.reset();
+        const quint8 previous = m_readyState.exchange(
+            static_cast<quint8>(m_frontIndex),
+            std::memory_order_acq_rel);
+        m_frontIndex = previous & kIndexMask;
+        m_consumedCount.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (!m_frontLease) {
+        m_frontLease = lease(m_slots[m_frontIndex]);
+    }
+    return m_frontLease;
+}
+
+DanmakuRenderSnapshotChannel::Counters DanmakuRenderSnapshotChannel::takeCounters() {
+    Counters counters;
+    counters.published = m_publishedCount.exchange(0, std::memory_order_relaxed);
+    counters.consumed = m_consumedCount.exchange(0, std::memory_order_relaxed);
+    counters.skipped = m_skippedCount.exchange(0, std::memory_order_relaxed);
+    counters.detached = m_detachedCount.exchange(0, std::memory_order_relaxed);
+    return counters;
+}
+
+DanmakuRenderFrameConstPtr DanmakuRenderSnapshotChannel::lease(const std::shared_ptr<Slot> &slot) {
+    slot->leased.store(true, std::memory_order_relaxed);
+    return DanmakuRenderFrameConstPtr(&slot->frame, [slot](const DanmakuRenderFrame *) {
+        slot->leased.store(false, std::memory_order_release);
+    });
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "danmaku/DanmakuRenderFrame.hpp"
+
+#include <array>
+#include <atomic>
+#include <memory>
+
+class DanmakuRenderSnapshotChannel {
+public:
+    struct Counters {
+        quint64 published = 0;
+        quint64 consumed = 0;
+        quint64 skipped = 0;
+        quint64 detached = 0;
+    };
+
+    DanmakuRenderSnapshotChannel();
+
+    DanmakuRenderFrame &backFrame();
+    void publish();
+    DanmakuRenderFrameConstPtr consume();
+    Counters takeCounters();
+
+private:
+    struct Slot {
+        DanmakuRenderFrame frame;
+        std::atomic<bool> leased {false};
+    };
+
+    static constexpr quint8 kIndexMask = 0x3;
+    static constexpr quint8 kFreshBit = 0x4;
+
+    static DanmakuRenderFrameConstPtr lease(const std::shared_ptr<Slot> &slot);
+
+    std::array<std::shared_ptr<Slot>, 3> m_slots;
+    std::atomic<quint8> m_readyState {1};
+    int m_backIndex = 0;
+    int m_frontIndex = 2;
+    DanmakuRenderFrameConstPtr m_frontLease;
+    quint64 m_nextSequence = 1;
+    std::atomic<quint64> m_publishedCount {0};
+    std::atomic<quint64> m_consumedCount {0};
+    std::atomic<quint64> m_skippedCount {0};
+    std::atomic<quint64> m_detachedCount {0};
+};
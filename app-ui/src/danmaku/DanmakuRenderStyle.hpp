@@ -5,4 +5,7 @@ constexpr int kItemHeightPx = 42;
 constexpr int kTextPixelSize = 24;
 constexpr int kHorizontalPaddingPx = 8;
 constexpr int kMinWidthPx = 80;
+constexpr int kFadeDurationMs = 300;
+constexpr int kDistanceFieldRasterScale = 2;
+constexpr int kDistanceFieldSpreadPx = 6;
 } // namespace DanmakuRenderStyle
@@ -0,0 +1,124 @@
+#include "danmaku/DanmakuSessionEvent.hpp"
+
+#include <QByteArray>
+#include <algorithm>
+#include <limits>
+
+namespace {
+void writeString(QDataStream &stream, const QString &value) {
+    stream << value.toUtf8();
+}
+
+QString readString(QDataStream &stream) {
+    QByteArray bytes;
+    stream >> bytes;
+    return QString::fromUtf8(bytes);
+}
+}
+
+int DanmakuSessionEvent::argumentCount(DanmakuSessionEventType type) {
+    switch (type) {
+    case DanmakuSessionEventType::PlaybackPaused:
+    case DanmakuSessionEventType::PlaybackRate:
+    case DanmakuSessionEventType::DevicePixelRatio:
+    case DanmakuSessionEventType::DropDrag:
+        return 1;
+    case DanmakuSessionEventType::ViewportSize:
+    case DanmakuSessionEventType::LaneMetrics:
+    case DanmakuSessionEventType::BeginDrag:
+    case DanmakuSessionEventType::MoveDrag:
+        return 2;
+    case DanmakuSessionEventType::NgDropZoneRect:
+        return 4;
+    case DanmakuSessionEventType::AppendComments:
+    case DanmakuSessionEventType::ResetForSeek:
+    case DanmakuSessionEventType::NgUserFade:
+    case DanmakuSessionEventType::NgUserFadeRollback:
+    case DanmakuSessionEventType::ResetGlyphSession:
+        return 0;
+    }
+    return 0;
+}
+
+bool DanmakuSessionEvent::isKnownType(quint8 rawType) {
+    return rawType >= static_cast<quint8>(DanmakuSessionEventType::AppendComments)
+        && rawType <= static_cast<quint8>(DanmakuSessionEventType::ResetGlyphSession);
+}
+
+void DanmakuSessionEvent::write(QDataStream &stream, qint64 previousAtUs) const {
+    const qint64 deltaUs = std::clamp<qint64>(atUs - previousAtUs, 0, std::numeric_limits<quint32>::max());
+    stream << static_cast<quint8>(type) << static_cast<quint32>(deltaUs);
+
+    const int count = argumentCount(type);
+    for (int i = 0; i < count; ++i) {
+        stream << static_cast<double>(args[i]);
+    }
+
+    switch (type) {
+    case DanmakuSessionEventType::AppendComments:
+        stream << playbackPositionMs << static_cast<quint32>(comments.size());
+        for (const DanmakuSessionComment &comment : comments) {
+            writeString(stream, comment.commentId);
+            writeString(stream, comment.userId);
+            writeString(stream, comment.text);
+            stream << comment.atMs;
+        }
+        break;
+    case DanmakuSessionEventType::NgUserFade:
+    case DanmakuSessionEventType::NgUserFadeRollback:
+        writeString(stream, userId);
+        break;
+    default:
+        break;
+    }
+}
+
+bool DanmakuSessionEvent::read(QDataStream &stream, qint64 previousAtUs) {
+    quint8 rawType = 0;
+    quint32 deltaUs = 0;
+    stream >> rawType >> deltaUs;
+    if (stream.status() != QDataStream::Ok || !isKnownType(rawType)) {
+        return false;
+    }
+
+    type = static_cast<DanmakuSessionEventType>(rawType);
+    atUs = previousAtUs + deltaUs;
+    std::fill(std::begin(args), std::end(args), 0.0);
+    userId.clear();
+    comments.clear();
+    playbackPositionMs = 0;
+
+    const int count = argumentCount(type);
+    for (int i = 0; i < count; ++i) {
+        double value = 0.0;
+        stream >> value;
+        args[i] = value;
+    }
+
+    switch (type) {
+    case DanmakuSessionEventType::AppendComments: {
+        quint32 commentCount = 0;
+        stream >> playbackPositionMs >> commentCount;
+        if (stream.status() != QDataStream::Ok) {
+            return false;
+        }
+        comments.reserve(static_cast<int>(std::min<quint32>(commentCount, 4096)));
+        for (quint32 i = 0; i < commentCount && stream.status() == QDataStream::Ok; ++i) {
+            DanmakuSessionComment comment;
+            comment.commentId = readString(stream);
+            comment.userId = readString(stream);
+            comment.text = readString(stream);
+            stream >> comment.atMs;
+            comments.push_back(comment);
+        }
+        break;
+    }
+    case DanmakuSessionEventType::NgUserFade:
+    case DanmakuSessionEventType::NgUserFadeRollback:
+        userId = readString(stream);
+        break;
+    default:
+        break;
+    }
+    return stream.status() == QDataStream::Ok;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <QDataStream>
+#include <QString>
+#include <QVector>
+#include <QtGlobal>
+
+enum class DanmakuSessionEventType : quint8 {
+    AppendComments = 1,
+    ResetForSeek = 2,
+    PlaybackPaused = 3,
+    PlaybackRate = 4,
+    ViewportSize = 5,
+    LaneMetrics = 6,
+    DevicePixelRatio = 7,
+    BeginDrag = 8,
+    MoveDrag = 9,
+    DropDrag = 10,
+    NgDropZoneRect = 11,
+    NgUserFade = 12,
+    NgUserFadeRollback = 13,
+    ResetGlyphSession = 14,
+};
+
+struct DanmakuSessionComment {
+    QString commentId;
+    QString userId;
+    QString text;
+    qint64 atMs = 0;
+};
+
+struct DanmakuSessionEvent {
+    static constexpr int kMaxArguments = 4;
+
+    static int argumentCount(DanmakuSessionEventType type);
+    static bool isKnownType(quint8 rawType);
+
+    void write(QDataStream &stream, qint64 previousAtUs) const;
+    bool read(QDataStream &stream, qint64 previousAtUs);
+
+    DanmakuSessionEventType type = DanmakuSessionEventType::ResetForSeek;
+    qint64 atUs = 0;
+    qint64 playbackPositionMs = 0;
+    qreal args[kMaxArguments] = {};
+    QString userId;
+    QVector<DanmakuSessionComment> comments;
+};
@@ -0,0 +1,124 @@
+#include "danmaku/DanmakuSessionRecorder.hpp"
+
+#include "danmaku/DanmakuFrameClock.hpp"
+
+#include <QDir>
+#include <QFileInfo>
+#include <QVariantMap>
+#include <algorithm>
+
+namespace {
+constexpr int kFlushIntervalEvents = 256;
+}
+
+DanmakuSessionRecorder::~DanmakuSessionRecorder() {
+    close();
+}
+
+QString DanmakuSessionRecorder::outputPathFromEnvironment() {
+    const QString configured = qEnvironmentVariable("NICONEON_DANMAKU_RECORD").trimmed();
+    if (configured.compare(QStringLiteral("off"), Qt::CaseInsensitive) == 0) {
+        return {};
+    }
+    return configured;
+}
+
+void DanmakuSessionRecorder::prepareStream(QDataStream &stream) {
+    stream.setVersion(QDataStream::Qt_6_0);
+    stream.setByteOrder(QDataStream::LittleEndian);
+    stream.setFloatingPointPrecision(QDataStream::DoublePrecision);
+}
+
+bool DanmakuSessionRecorder::open(const QString &path) {
+    close();
+    if (path.isEmpty()) {
+        return false;
+    }
+    if (!QDir().mkpath(QFileInfo(path).absolutePath())) {
+        return false;
+    }
+
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return false;
+    }
+    m_stream.setDevice(&m_file);
+    prepareStream(m_stream);
+    m_stream << kMagic << kFormatVersion;
+    m_startNs = DanmakuFrameClock::nowNs();
+    m_lastAtUs = 0;
+    m_eventCount = 0;
+    return m_stream.status() == QDataStream::Ok;
+}
+
+void DanmakuSessionRecorder::close() {
+    if (!m_file.isOpen()) {
+        return;
+    }
+    m_stream.setDevice(nullptr);
+    m_file.close();
+}
+
+bool DanmakuSessionRecorder::isOpen() const {
+    return m_file.isOpen();
+}
+
+int DanmakuSessionRecorder::eventCount() const {
+    return m_eventCount;
+}
+
+void DanmakuSessionRecorder::record(DanmakuSessionEvent event) {
+    if (!m_file.isOpen()) {
+        return;
+    }
+    event.atUs = std::max(m_lastAtUs, (DanmakuFrameClock::nowNs() - m_startNs) / 1000);
+    event.write(m_stream, m_lastAtUs);
+    m_lastAtUs = event.atUs;
+    ++m_eventCount;
+    if (m_eventCount % kFlushIntervalEvents == 0) {
+        m_file.flush();
+    }
+}
+
+void DanmakuSessionRecorder::recordComments(const QVariantList &comments, qint64 playbackPositionMs) {
+    if (!m_file.isOpen()) {
+        return;
+    }
+    DanmakuSessionEvent event;
+    event.type = DanmakuSessionEventType::AppendComments;
+    event.playbackPositionMs = playbackPositionMs;
+    event.comments.reserve(comments.size());
+    for (const QVariant &entry : comments) {
+        const QVariantMap map = entry.toMap();
+        DanmakuSessionComment comment;
+        comment.commentId = map.value("comment_id").toString();
+        comment.userId = map.value("user_id").toString();
+        comment.text = map.value("text").toString();
+        comment.atMs = map.value("at_ms").toLongLong();
+        event.comments.push_back(comment);
+    }
+    record(std::move(event));
+}
+
+void DanmakuSessionRecorder::recordArguments(DanmakuSessionEventType type, qreal arg0, qreal arg1, qreal arg2, qreal arg3) {
+    if (!m_file.isOpen()) {
+        return;
+    }
+    DanmakuSessionEvent event;
+    event.type = type;
+    event.args[0] = arg0;
+    event.args[1] = arg1;
+    event.args[2] = arg2;
+    event.args[3] = arg3;
+    record(std::move(event));
+}
+
+void DanmakuSessionRecorder::recordUser(DanmakuSessionEventType type, const QString &userId) {
+    if (!m_file.isOpen()) {
+        return;
+    }
+    DanmakuSessionEvent event;
+    event.type = type;
+    event.userId = userId;
+    record(std::move(event));
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "danmaku/DanmakuSessionEvent.hpp"
+
+#include <QDataStream>
+#include <QFile>
+#include <QString>
+#include <QVariantList>
+#include <QtGlobal>
+
+class DanmakuSessionRecorder {
+public:
+    static constexpr quint32 kMagic = 0x4e445352;
+    static constexpr quint16 kFormatVersion = 1;
+
+    DanmakuSessionRecorder() = default;
+    ~DanmakuSessionRecorder();
+
+    DanmakuSessionRecorder(const DanmakuSessionRecorder &) = delete;
+    DanmakuSessionRecorder &operator=(const DanmakuSessionRecorder &) = delete;
+
+    static QString outputPathFromEnvironment();
+    static void prepareStream(QDataStream &stream);
+
+    bool open(const QString &path);
+    void close();
+    bool isOpen() const;
+    int eventCount() const;
+
+    void record(DanmakuSessionEvent event);
+    void recordComments(const QVariantList &comments, qint64 playbackPositionMs);
+    void recordArguments(DanmakuSessionEventType type, qreal arg0 = 0.0, qreal arg1 = 0.0, qreal arg2 = 0.0, qreal arg3 = 0.0);
+    void recordUser(DanmakuSessionEventType type, const QString &userId);
+
+private:
+    QFile m_file;
+    QDataStream m_stream;
+    qint64 m_startNs = 0;
+    qint64 m_lastAtUs = 0;
+    int m_eventCount = 0;
+};
@@ -0,0 +1,280 @@
+#include "danmaku/DanmakuSessionReplayer.hpp"
+
+#include "danmaku/DanmakuController.hpp"
+#include "danmaku/DanmakuFrameClock.hpp"
+#include "danmaku/DanmakuSessionRecorder.hpp"
+#include "perf/PerfHistogram.hpp"
+
+#include <QCoreApplication>
+#include <QDataStream>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTextStream>
+#include <QVariantList>
+#include <QVariantMap>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+constexpr quint64 kFnvOffsetBasis = 1469598103934665603ull;
+constexpr quint64 kFnvPrime = 1099511628211ull;
+constexpr int kWorkerWaitTimeoutMs = 5000;
+
+void hashBytes(quint64 &hash, const void *data, size_t size) {
+    const auto *bytes = static_cast<const unsigned char *>(data);
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= kFnvPrime;
+    }
+}
+
+template <typename Value>
+void hashValue(quint64 &hash, Value value) {
+    hashBytes(hash, &value, sizeof(value));
+}
+
+void hashReal(quint64 &hash, qreal value) {
+    const double normalized = value == 0.0 ? 0.0 : static_cast<double>(value);
+    quint64 bits = 0;
+    std::memcpy(&bits, &normalized, sizeof(bits));
+    hashValue(hash, bits);
+}
+
+QVariantList toCommentList(const QVector<DanmakuSessionComment> &comments) {
+    QVariantList list;
+    list.reserve(comments.size());
+    for (const DanmakuSessionComment &comment : comments) {
+        QVariantMap map;
+        map.insert(QStringLiteral("comment_id"), comment.commentId);
+        map.insert(QStringLiteral("user_id"), comment.userId);
+        map.insert(QStringLiteral("text"), comment.text);
+        map.insert(QStringLiteral("at_ms"), comment.atMs);
+        list.push_back(map);
+    }
+    return list;
+}
+}
+
+QString DanmakuSessionReplayer::inputPathFromEnvironment() {
+    const QString configured = qEnvironmentVariable("NICONEON_DANMAKU_REPLAY").trimmed();
+    if (configured.compare(QStringLiteral("off"), Qt::CaseInsensitive) == 0) {
+        return {};
+    }
+    return configured;
+}
+
+QString DanmakuSessionReplayer::outputPathFromEnvironment() {
+    const QString configured = qEnvironmentVariable("NICONEON_DANMAKU_REPLAY_OUT").trimmed();
+    return configured.isEmpty() ? QStringLiteral("-") : configured;
+}
+
+int DanmakuSessionReplayer::stepMsFromEnvironment() {
+    bool ok = false;
+    const int stepMs = qEnvironmentVariableIntValue("NICONEON_DANMAKU_REPLAY_STEP_MS", &ok);
+    return ok && stepMs > 0 ? stepMs : kDefaultStepMs;
+}
+
+quint64 DanmakuSessionReplayer::frameDigest(const DanmakuRenderFrame &frame) {
+    quint64 hash = kFnvOffsetBasis;
+    hashValue(hash, static_cast<qint32>(frame.instances.size()));
+    for (const DanmakuRenderInstance &instance : frame.instances) {
+        hashBytes(hash, instance.commentId.constData(), static_cast<size_t>(instance.commentId.size()) * sizeof(QChar));
+        hashValue(hash, instance.spriteId);
+        hashReal(hash, instance.x);
+        hashReal(hash, instance.y);
+        hashReal(hash, instance.alpha);
+        hashValue(hash, static_cast<qint32>(instance.widthEstimate));
+        hashValue(hash, static_cast<quint8>(instance.ngDropHovered ? 1 : 0));
+    }
+    return hash;
+}
+
+quint64 DanmakuSessionReplayer::sessionDigest(const QVector<FrameResult> &frames) {
+    quint64 hash = kFnvOffsetBasis;
+    for (const FrameResult &frame : frames) {
+        hashValue(hash, frame.digest);
+    }
+    return hash;
+}
+
+void DanmakuSessionReplayer::apply(DanmakuController &controller, const DanmakuSessionEvent &event) {
+    switch (event.type) {
+    case DanmakuSessionEventType::AppendComments:
+        controller.appendFromCore(toCommentList(event.comments), event.playbackPositionMs);
+        break;
+    case DanmakuSessionEventType::ResetForSeek:
+        controller.resetForSeek();
+        break;
+    case DanmakuSessionEventType::PlaybackPaused:
+        controller.setPlaybackPaused(event.args[0] != 0.0);
+        break;
+    case DanmakuSessionEventType::PlaybackRate:
+        controller.setPlaybackRate(event.args[0]);
+        break;
+    case DanmakuSessionEventType::ViewportSize:
+        controller.setViewportSize(event.args[0], event.args[1]);
+        break;
+    case DanmakuSessionEventType::LaneMetrics:
+        controller.setLaneMetrics(static_cast<int>(event.args[0]), static_cast<int>(event.args[1]));
+        break;
+    case DanmakuSessionEventType::DevicePixelRatio:
+        controller.setRenderDevicePixelRatio(event.args[0]);
+        break;
+    case DanmakuSessionEventType::BeginDrag:
+        controller.beginDragAt(event.args[0], event.args[1]);
+        break;
+    case DanmakuSessionEventType::MoveDrag:
+        controller.moveActiveDrag(event.args[0], event.args[1]);
+        break;
+    case DanmakuSessionEventType::DropDrag:
+        controller.dropActiveDrag(event.args[0] != 0.0);
+        break;
+    case DanmakuSessionEventType::NgDropZoneRect:
+        controller.setNgDropZoneRect(event.args[0], event.args[1], event.args[2], event.args[3]);
+        break;
+    case DanmakuSessionEventType::NgUserFade:
+        controller.applyNgUserFade(event.userId);
+        break;
+    case DanmakuSessionEventType::NgUserFadeRollback:
+        controller.rollbackPendingNgUserFade(event.userId);
+        break;
+    case DanmakuSessionEventType::ResetGlyphSession:
+        controller.resetGlyphSession();
+        break;
+    }
+}
+
+bool DanmakuSessionReplayer::load(const QString &path, QString *error) {
+    m_events.clear();
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (error) {
+            *error = file.errorString();
+        }
+        return false;
+    }
+
+    QDataStream stream(&file);
+    DanmakuSessionRecorder::prepareStream(stream);
+    quint32 magic = 0;
+    quint16 version = 0;
+    stream >> magic >> version;
+    if (magic != DanmakuSessionRecorder::kMagic || version != DanmakuSessionRecorder::kFormatVersion) {
+        if (error) {
+            *error = QStringLiteral("not a danmaku session recording (version %1)").arg(version);
+        }
+        return false;
+    }
+
+    qint64 previousAtUs = 0;
+    while (!stream.atEnd()) {
+        DanmakuSessionEvent event;
+        if (!event.read(stream, previousAtUs)) {
+            break;
+        }
+        previousAtUs = event.atUs;
+        m_events.push_back(event);
+    }
+    return true;
+}
+
+const QVector<DanmakuSessionEvent> &DanmakuSessionReplayer::events() const {
+    return m_events;
+}
+
+QVector<DanmakuSessionReplayer::FrameResult> DanmakuSessionReplayer::replay(
+    DanmakuController &controller,
+    int stepMs,
+    int tailFrames) const {
+    QVector<FrameResult> frames;
+    const qint64 stepUs = static_cast<qint64>(std::max(stepMs, 1)) * 1000;
+    const qint64 lastEventUs = m_events.isEmpty() ? 0 : m_events.last().atUs;
+    const int frameCount = static_cast<int>(lastEventUs / stepUs) + 1 + std::max(tailFrames, 0);
+    frames.reserve(frameCount);
+
+    int nextEvent = 0;
+    for (int frame = 0; frame < frameCount; ++frame) {
+        const qint64 frameEndUs = (frame + 1) * stepUs;
+        const qint64 startNs = DanmakuFrameClock::nowNs();
+        while (nextEvent < m_events.size() && m_events.at(nextEvent).atUs < frameEndUs) {
+            apply(controller, m_events.at(nextEvent));
+            ++nextEvent;
+        }
+        controller.stepFrameForTesting(stepMs);
+        QElapsedTimer workerWait;
+        workerWait.start();
+        while (controller.workerBusyForTesting() && workerWait.elapsed() < kWorkerWaitTimeoutMs) {
+            QCoreApplication::processEvents(QEventLoop::AllEvents | QEventLoop::WaitForMoreEvents, 5);
+        }
+
+        FrameResult result;
+        result.frame = frame;
+        result.atMs = frameEndUs / 1000;
+        result.costNs = DanmakuFrameClock::nowNs() - startNs;
+        const DanmakuRenderFrameConstPtr snapshot = controller.renderSnapshot();
+        if (snapshot) {
+            result.instanceCount = snapshot->instances.size();
+            result.digest = frameDigest(*snapshot);
+        }
+        controller.takePendingSpriteUploads();
+        frames.push_back(result);
+    }
+    return frames;
+}
+
+int DanmakuSessionReplayer::runHeadless(const QString &inputPath, const QString &outputPath) {
+    DanmakuSessionReplayer replayer;
+    QString error;
+    if (!replayer.load(inputPath, &error)) {
+        qWarning() << "failed to load danmaku session:" << inputPath << error;
+        return 1;
+    }
+
+    if (qEnvironmentVariable("NICONEON_DANMAKU_WORKER").trimmed().compare(QStringLiteral("sim"), Qt::CaseInsensitive) == 0) {
+        qputenv("NICONEON_DANMAKU_WORKER", "on");
+    }
+    qputenv("NICONEON_GLYPH_FALLBACK_CACHE", "off");
+    qputenv("NICONEON_DANMAKU_GOVERNOR", "off");
+    qputenv("NICONEON_DANMAKU_RASTER_THREADS", "0");
+    qunsetenv("NICONEON_DANMAKU_RECORD");
+
+    DanmakuController controller;
+    controller.setGlyphWarmupEnabled(false);
+    const int stepMs = stepMsFromEnvironment();
+    const QVector<FrameResult> frames = replayer.replay(controller, stepMs, kDefaultTailFrames);
+
+    QFile output;
+    bool opened = false;
+    if (outputPath == QStringLiteral("-")) {
+        opened = output.open(stdout, QIODevice::WriteOnly | QIODevice::Text);
+    } else {
+        output.setFileName(outputPath);
+        opened = output.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text);
+    }
+    if (!opened) {
+        qWarning() << "failed to open danmaku replay output:" << outputPath;
+        return 1;
+    }
+
+    PerfHistogram frameCostUs;
+    QTextStream stream(&output);
+    stream << "# frame at_ms instances digest\n";
+    for (const FrameResult &frame : frames) {
+        frameCostUs.record(frame.costNs / 1000);
+        stream << frame.frame << ' ' << frame.atMs << ' ' << frame.instanceCount << ' '
+               << QString::number(frame.digest, 16).rightJustified(16, QLatin1Char('0')) << '\n';
+    }
+    stream.flush();
+
+    qInfo().noquote() << QString("[perf-replay] events=%1 frames=%2 step_ms=%3 digest=%4 frame_us_p50=%5 frame_us_p99=%6 frame_us_max=%7")
+                             .arg(replayer.events().size())
+                             .arg(frames.size())
+                             .arg(stepMs)
+                             .arg(QString::number(sessionDigest(frames), 16).rightJustified(16, QLatin1Char('0')))
+                             .arg(frameCostUs.valueAtPercentile(50.0))
+                             .arg(frameCostUs.valueAtPercentile(99.0))
+                             .arg(frameCostUs.max());
+    return 0;
+}
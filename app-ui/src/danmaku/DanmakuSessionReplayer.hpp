@@ -0,0 +1,39 @@
+#pragma once
+
+#include "danmaku/DanmakuRenderFrame.hpp"
+#include "danmaku/DanmakuSessionEvent.hpp"
+
+#include <QString>
+#include <QVector>
+#include <QtGlobal>
+
+class DanmakuController;
+
+class DanmakuSessionReplayer {
+public:
+    static constexpr int kDefaultStepMs = 16;
+    static constexpr int kDefaultTailFrames = 600;
+
+    struct FrameResult {
+        int frame = 0;
+        qint64 atMs = 0;
+        int instanceCount = 0;
+        quint64 digest = 0;
+        qint64 costNs = 0;
+    };
+
+    static QString inputPathFromEnvironment();
+    static QString outputPathFromEnvironment();
+    static int stepMsFromEnvironment();
+    static quint64 frameDigest(const DanmakuRenderFrame &frame);
+    static quint64 sessionDigest(const QVector<FrameResult> &frames);
+    static void apply(DanmakuController &controller, const DanmakuSessionEvent &event);
+    static int runHeadless(const QString &inputPath, const QString &outputPath);
+
+    bool load(const QString &path, QString *error = nullptr);
+    const QVector<DanmakuSessionEvent> &events() const;
+    QVector<FrameResult> replay(DanmakuController &controller, int stepMs, int tailFrames) const;
+
+private:
+    QVector<DanmakuSessionEvent> m_events;
+};
@@ -1,74 +1,383 @@
 #include "danmaku/DanmakuSimdUpdater.hpp"
 
+#include "danmaku/DanmakuRenderStyle.hpp"
+
 #include <algorithm>
-#include <cmath>
+#include <array>
+#include <cstring>
 
 #if defined(__GNUC__) || defined(__clang__)
 #if defined(__x86_64__) || defined(__i386__)
 #include <immintrin.h>
-#define NICONEON_HAS_AVX2_IMPL 1
+#define NICONEON_HAS_X86_SIMD_IMPL 1
 #endif
 #endif
 
 namespace {
-DanmakuSimdMode normalizeMode(DanmakuSimdMode mode) {
-    return DanmakuSimdUpdater::resolveMode(mode);
+constexpr float kFadeDurationMs = static_cast<float>(DanmakuRenderStyle::kFadeDurationMs);
+
+struct FusedColumns {
+    float *x = nullptr;
+    const float *y = nullptr;
+    const float *speed = nullptr;
+    float *alpha = nullptr;
+    const int *widthEstimate = nullptr;
+    int *fadeRemainingMs = nullptr;
+    const quint8 *flags = nullptr;
+};
+
+struct FusedOutput {
+    int *changed = nullptr;
+    int changedCount = 0;
+    int *removed = nullptr;
+    int removedCount = 0;
+};
+
+struct CpuFeatures {
+    bool sse41 = false;
+    bool avx2 = false;
+    bool avx512 = false;
+};
+
+CpuFeatures probeCpuFeatures() {
+    CpuFeatures features;
+#if defined(NICONEON_HAS_X86_SIMD_IMPL)
+    __builtin_cpu_init();
+    features.sse41 = __builtin_cpu_supports("sse4.1");
+    features.avx2 = __builtin_cpu_supports("avx2");
+    features.avx512 = __builtin_cpu_supports("avx512f");
+#endif
+    return features;
 }
 
-void updateScalar(
-    QVector<qreal> &x,
-    const QVector<qreal> &speed,
-    const QVector<quint8> &movableMask,
-    qreal movementFactor,
-    QVector<quint8> &changedMask) {
-    const int count = std::min({x.size(), speed.size(), movableMask.size(), changedMask.size()});
-    for (int i = 0; i < count; ++i) {
-        if (!movableMask[i]) {
-            continue;
+const CpuFeatures &cpuFeatures() {
+    static const CpuFeatures features = probeCpuFeatures();
+    return features;
+}
+
+template <bool Paused, bool AnyFading, bool AnyDragging>
+void updateFusedScalar(
+    const FusedColumns &columns,
+    const DanmakuFusedUpdateParams &params,
+    int begin,
+    int end,
+    FusedOutput &out) {
+    for (int i = begin; i < end; ++i) {
+        const quint8 flags = columns.flags[i];
+        bool changed = false;
+        if constexpr (!Paused) {
+            if ((flags & DanmakuSoAFlagFrozen) == 0) {
+                columns.x[i] -= columns.speed[i] * params.movementFactor;
+                changed = true;
+            }
+        }
+        if constexpr (AnyFading) {
+            if ((flags & DanmakuSoAFlagFading) != 0) {
+                const int remaining = columns.fadeRemainingMs[i] - params.elapsedMs;
+                columns.fadeRemainingMs[i] = remaining;
+                columns.alpha[i] = remaining <= 0 ? 0.0f : std::min(static_cast<float>(remaining) / kFadeDurationMs, 1.0f);
+                changed = true;
+            }
+        }
+
+        bool cull = columns.alpha[i] <= 0.0f
+            || columns.x[i] + static_cast<float>(columns.widthEstimate[i]) < params.cullThreshold
+            || columns.y[i] > params.viewportHeight
+            || columns.y[i] + params.itemHeight < 0.0f;
+        if constexpr (AnyDragging) {
+            cull = cull && (flags & DanmakuSoAFlagDragging) == 0;
+        }
+
+        if (cull) {
+            out.removed[out.removedCount++] = i;
+        } else if (changed) {
+            out.changed[out.changedCount++] = i;
         }
-        x[i] -= speed[i] * movementFactor;
-        changedMask[i] = 1;
     }
 }
 
-#if defined(NICONEON_HAS_AVX2_IMPL)
-__attribute__((target("avx2")))
-void updateAvx2Doubles(
-    QVector<qreal> &x,
-    const QVector<qreal> &speed,
-    const QVector<quint8> &movableMask,
-    qreal movementFactor,
-    QVector<quint8> &changedMask) {
-    const int count = std::min({x.size(), speed.size(), movableMask.size(), changedMask.size()});
-    if (count <= 0) {
-        return;
+#if defined(NICONEON_HAS_X86_SIMD_IMPL)
+void appendLaneIndices(int *out, int &outCount, int base, unsigned bits) {
+    while (bits != 0) {
+        out[outCount++] = base + __builtin_ctz(bits);
+        bits &= bits - 1;
     }
+}
 
-    QVector<qreal> effectiveSpeed(count);
-    for (int i = 0; i < count; ++i) {
-        effectiveSpeed[i] = movableMask[i] ? speed[i] : 0.0;
-    }
+template <bool Paused, bool AnyFading, bool AnyDragging>
+__attribute__((target("sse4.1")))
+void updateFusedSse41(const FusedColumns &columns, const DanmakuFusedUpdateParams &params, int count, FusedOutput &out) {
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 factor = _mm_set1_ps(params.movementFactor);
+    const __m128 fadeDuration = _mm_set1_ps(kFadeDurationMs);
+    const __m128 cullThreshold = _mm_set1_ps(params.cullThreshold);
+    const __m128 viewportHeight = _mm_set1_ps(params.viewportHeight);
+    const __m128 itemHeight = _mm_set1_ps(params.itemHeight);
+    const __m128i zeroInt = _mm_setzero_si128();
+    const __m128i oneInt = _mm_set1_epi32(1);
+    const __m128i elapsed = _mm_set1_epi32(params.elapsedMs);
+    const __m128i frozenBit = _mm_set1_epi32(DanmakuSoAFlagFrozen);
+    const __m128i fadingBit = _mm_set1_epi32(DanmakuSoAFlagFading);
+    const __m128i draggingBit = _mm_set1_epi32(DanmakuSoAFlagDragging);
 
-    const __m256d factor = _mm256_set1_pd(static_cast<double>(movementFactor));
     int i = 0;
     for (; i + 4 <= count; i += 4) {
-        const __m256d xVec = _mm256_loadu_pd(reinterpret_cast<const double *>(&x[i]));
-        const __m256d sVec = _mm256_loadu_pd(reinterpret_cast<const double *>(&effectiveSpeed[i]));
-        const __m256d next = _mm256_sub_pd(xVec, _mm256_mul_pd(sVec, factor));
-        _mm256_storeu_pd(reinterpret_cast<double *>(&x[i]), next);
+        int packedFlags = 0;
+        std::memcpy(&packedFlags, columns.flags + i, sizeof(packedFlags));
+        const __m128i flags = _mm_cvtepu8_epi32(_mm_cvtsi32_si128(packedFlags));
+        __m128 x = _mm_loadu_ps(columns.x + i);
+        __m128 alpha = _mm_loadu_ps(columns.alpha + i);
+        __m128 changed = zero;
+
+        if constexpr (!Paused) {
+            const __m128 movable = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(flags, frozenBit), zeroInt));
+            const __m128 moved = _mm_sub_ps(x, _mm_mul_ps(_mm_loadu_ps(columns.speed + i), factor));
+            x = _mm_blendv_ps(x, moved, movable);
+            _mm_storeu_ps(columns.x + i, x);
+            changed = movable;
+        }
+
+        if constexpr (AnyFading) {
+            const __m128i fadingMask = _mm_cmpeq_epi32(_mm_and_si128(flags, fadingBit), fadingBit);
+            __m128i *remainingPtr = reinterpret_cast<__m128i *>(columns.fadeRemainingMs + i);
+            const __m128i previous = _mm_loadu_si128(remainingPtr);
+            const __m128i remaining = _mm_blendv_epi8(previous, _mm_sub_epi32(previous, elapsed), fadingMask);
+            _mm_storeu_si128(remainingPtr, remaining);
+
+            const __m128 expired = _mm_castsi128_ps(_mm_cmplt_epi32(remaining, oneInt));
+            const __m128 faded =
+                _mm_andnot_ps(expired, _mm_min_ps(_mm_div_ps(_mm_cvtepi32_ps(remaining), fadeDuration), one));
+            const __m128 fading = _mm_castsi128_ps(fadingMask);
+            alpha = _mm_blendv_ps(alpha, faded, fading);
+            _mm_storeu_ps(columns.alpha + i, alpha);
+            changed = _mm_or_ps(changed, fading);
+        }
+
+        const __m128 y = _mm_loadu_ps(columns.y + i);
+        const __m128 width =
+            _mm_cvtepi32_ps(_mm_loadu_si128(reinterpret_cast<const __m128i *>(columns.widthEstimate + i)));
+        __m128 cull = _mm_or_ps(
+            _mm_or_ps(_mm_cmple_ps(alpha, zero), _mm_cmplt_ps(_mm_add_ps(x, width), cullThreshold)),
+            _mm_or_ps(_mm_cmpgt_ps(y, viewportHeight), _mm_cmplt_ps(_mm_add_ps(y, itemHeight), zero)));
+        if constexpr (AnyDragging) {
+            const __m128 dragging =
+                _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(flags, draggingBit), draggingBit));
+            cull = _mm_andnot_ps(dragging, cull);
+        }
+
+        appendLaneIndices(out.removed, out.removedCount, i, static_cast<unsigned>(_mm_movemask_ps(cull)));
+        appendLaneIndices(
+            out.changed,
+            out.changedCount,
+            i,
+            static_cast<unsigned>(_mm_movemask_ps(_mm_andnot_ps(cull, changed))));
     }
 
-    for (; i < count; ++i) {
-        x[i] -= effectiveSpeed[i] * movementFactor;
+    updateFusedScalar<Paused, AnyFading, AnyDragging>(columns, params, i, count, out);
+}
+
+template <bool Paused, bool AnyFading, bool AnyDragging>
+__attribute__((target("avx2")))
+void updateFusedAvx2(const FusedColumns &columns, const DanmakuFusedUpdateParams &params, int count, FusedOutput &out) {
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 factor = _mm256_set1_ps(params.movementFactor);
+    const __m256 fadeDuration = _mm256_set1_ps(kFadeDurationMs);
+    const __m256 cullThreshold = _mm256_set1_ps(params.cullThreshold);
+    const __m256 viewportHeight = _mm256_set1_ps(params.viewportHeight);
+    const __m256 itemHeight = _mm256_set1_ps(params.itemHeight);
+    const __m256i zeroInt = _mm256_setzero_si256();
+    const __m256i oneInt = _mm256_set1_epi32(1);
+    const __m256i elapsed = _mm256_set1_epi32(params.elapsedMs);
+    const __m256i frozenBit = _mm256_set1_epi32(DanmakuSoAFlagFrozen);
+    const __m256i fadingBit = _mm256_set1_epi32(DanmakuSoAFlagFading);
+    const __m256i draggingBit = _mm256_set1_epi32(DanmakuSoAFlagDragging);
+
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256i flags =
+            _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(columns.flags + i)));
+        __m256 x = _mm256_loadu_ps(columns.x + i);
+        __m256 alpha = _mm256_loadu_ps(columns.alpha + i);
+        __m256 changed = zero;
+
+        if constexpr (!Paused) {
+            const __m256 movable =
+                _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(flags, frozenBit), zeroInt));
+            const __m256 moved = _mm256_sub_ps(x, _mm256_mul_ps(_mm256_loadu_ps(columns.speed + i), factor));
+            x = _mm256_blendv_ps(x, moved, movable);
+            _mm256_storeu_ps(columns.x + i, x);
+            changed = movable;
+        }
+
+        if constexpr (AnyFading) {
+            const __m256i fadingMask = _mm256_cmpeq_epi32(_mm256_and_si256(flags, fadingBit), fadingBit);
+            __m256i *remainingPtr = reinterpret_cast<__m256i *>(columns.fadeRemainingMs + i);
+            const __m256i previous = _mm256_loadu_si256(remainingPtr);
+            const __m256i remaining = _mm256_blendv_epi8(previous, _mm256_sub_epi32(previous, elapsed), fadingMask);
+            _mm256_storeu_si256(remainingPtr, remaining);
+
+            const __m256 expired = _mm256_castsi256_ps(_mm256_cmpgt_epi32(oneInt, remaining));
+            const __m256 faded =
+                _mm256_andnot_ps(expired, _mm256_min_ps(_mm256_div_ps(_mm256_cvtepi32_ps(remaining), fadeDuration), one));
+            const __m256 fading = _mm256_castsi256_ps(fadingMask);
+            alpha = _mm256_blendv_ps(alpha, faded, fading);
+            _mm256_storeu_ps(columns.alpha + i, alpha);
+            changed = _mm256_or_ps(changed, fading);
+        }
+
+        const __m256 y = _mm256_loadu_ps(columns.y + i);
+        const __m256 width =
+            _mm256_cvtepi32_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(columns.widthEstimate + i)));
+        __m256 cull = _mm256_or_ps(
+            _mm256_or_ps(
+                _mm256_cmp_ps(alpha, zero, _CMP_LE_OQ),
+                _mm256_cmp_ps(_mm256_add_ps(x, width), cullThreshold, _CMP_LT_OQ)),
+            _mm256_or_ps(
+                _mm256_cmp_ps(y, viewportHeight, _CMP_GT_OQ),
+                _mm256_cmp_ps(_mm256_add_ps(y, itemHeight), zero, _CMP_LT_OQ)));
+        if constexpr (AnyDragging) {
+            const __m256 dragging =
+                _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(flags, draggingBit), draggingBit));
+            cull = _mm256_andnot_ps(dragging, cull);
+        }
+
+        appendLaneIndices(out.removed, out.removedCount, i, static_cast<unsigned>(_mm256_movemask_ps(cull)));
+        appendLaneIndices(
+            out.changed,
+            out.changedCount,
+            i,
+            static_cast<unsigned>(_mm256_movemask_ps(_mm256_andnot_ps(cull, changed))));
     }
 
-    for (int idx = 0; idx < count; ++idx) {
-        if (movableMask[idx]) {
-            changedMask[idx] = 1;
+    updateFusedScalar<Paused, AnyFading, AnyDragging>(columns, params, i, count, out);
+}
+
+template <bool Paused, bool AnyFading, bool AnyDragging>
+__attribute__((target("avx512f")))
+void updateFusedAvx512(const FusedColumns &columns, const DanmakuFusedUpdateParams &params, int count, FusedOutput &out) {
+    const __m512 zero = _mm512_setzero_ps();
+    const __m512 one = _mm512_set1_ps(1.0f);
+    const __m512 factor = _mm512_set1_ps(params.movementFactor);
+    const __m512 fadeDuration = _mm512_set1_ps(kFadeDurationMs);
+    const __m512 cullThreshold = _mm512_set1_ps(params.cullThreshold);
+    const __m512 viewportHeight = _mm512_set1_ps(params.viewportHeight);
+    const __m512 itemHeight = _mm512_set1_ps(params.itemHeight);
+    const __m512i zeroInt = _mm512_setzero_si512();
+    const __m512i elapsed = _mm512_set1_epi32(params.elapsedMs);
+    const __m512i frozenBit = _mm512_set1_epi32(DanmakuSoAFlagFrozen);
+    const __m512i fadingBit = _mm512_set1_epi32(DanmakuSoAFlagFading);
+    const __m512i draggingBit = _mm512_set1_epi32(DanmakuSoAFlagDragging);
+    const __m512i laneOffsets = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+
+    int i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const __m512i flags =
+            _mm512_cvtepu8_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(columns.flags + i)));
+        __m512 x = _mm512_loadu_ps(columns.x + i);
+        __m512 alpha = _mm512_loadu_ps(columns.alpha + i);
+        __mmask16 changed = 0;
+
+        if constexpr (!Paused) {
+            const __mmask16 movable = _mm512_testn_epi32_mask(flags, frozenBit);
+            x = _mm512_mask_sub_ps(x, movable, x, _mm512_mul_ps(_mm512_loadu_ps(columns.speed + i), factor));
+            _mm512_storeu_ps(columns.x + i, x);
+            changed = movable;
         }
+
+        if constexpr (AnyFading) {
+            const __mmask16 fading = _mm512_test_epi32_mask(flags, fadingBit);
+            const __m512i previous = _mm512_loadu_si512(columns.fadeRemainingMs + i);
+            const __m512i remaining = _mm512_mask_sub_epi32(previous, fading, previous, elapsed);
+            _mm512_storeu_si512(columns.fadeRemainingMs + i, remaining);
+
+            const __mmask16 alive = _mm512_cmpgt_epi32_mask(remaining, zeroInt);
+            const __m512 faded =
+                _mm512_maskz_min_ps(alive, _mm512_div_ps(_mm512_cvtepi32_ps(remaining), fadeDuration), one);
+            alpha = _mm512_mask_mov_ps(alpha, fading, faded);
+            _mm512_storeu_ps(columns.alpha + i, alpha);
+            changed = static_cast<__mmask16>(changed | fading);
+        }
+
+        const __m512 y = _mm512_loadu_ps(columns.y + i);
+        const __m512 width = _mm512_cvtepi32_ps(_mm512_loadu_si512(columns.widthEstimate + i));
+        __mmask16 cull = static_cast<__mmask16>(
+            _mm512_cmp_ps_mask(alpha, zero, _CMP_LE_OQ)
+            | _mm512_cmp_ps_mask(_mm512_add_ps(x, width), cullThreshold, _CMP_LT_OQ)
+            | _mm512_cmp_ps_mask(y, viewportHeight, _CMP_GT_OQ)
+            | _mm512_cmp_ps_mask(_mm512_add_ps(y, itemHeight), zero, _CMP_LT_OQ));
+        if constexpr (AnyDragging) {
+            cull = static_cast<__mmask16>(cull & ~_mm512_test_epi32_mask(flags, draggingBit));
+        }
+        const __mmask16 changedKept = static_cast<__mmask16>(changed & ~cull);
+
+        const __m512i indices = _mm512_add_epi32(_mm512_set1_epi32(i), laneOffsets);
+        _mm512_mask_compressstoreu_epi32(out.removed + out.removedCount, cull, indices);
+        out.removedCount += __builtin_popcount(cull);
+        _mm512_mask_compressstoreu_epi32(out.changed + out.changedCount, changedKept, indices);
+        out.changedCount += __builtin_popcount(changedKept);
     }
+
+    updateFusedScalar<Paused, AnyFading, AnyDragging>(columns, params, i, count, out);
 }
 #endif
+
+template <DanmakuSimdMode Mode, bool Paused, bool AnyFading, bool AnyDragging>
+void runFused(const FusedColumns &columns, const DanmakuFusedUpdateParams &params, int count, FusedOutput &out) {
+#if defined(NICONEON_HAS_X86_SIMD_IMPL)
+    if constexpr (Mode == DanmakuSimdMode::Avx512) {
+        updateFusedAvx512<Paused, AnyFading, AnyDragging>(columns, params, count, out);
+        return;
+    }
+    if constexpr (Mode == DanmakuSimdMode::Avx2) {
+        updateFusedAvx2<Paused, AnyFading, AnyDragging>(columns, params, count, out);
+        return;
+    }
+    if constexpr (Mode == DanmakuSimdMode::Sse41) {
+        updateFusedSse41<Paused, AnyFading, AnyDragging>(columns, params, count, out);
+        return;
+    }
+#endif
+    updateFusedScalar<Paused, AnyFading, AnyDragging>(columns, params, 0, count, out);
+}
+
+using FusedKernel = void (*)(const FusedColumns &, const DanmakuFusedUpdateParams &, int, FusedOutput &);
+using FusedKernelTable = std::array<FusedKernel, 8>;
+
+template <DanmakuSimdMode Mode>
+constexpr FusedKernelTable fusedKernelTable() {
+    return {
+        runFused<Mode, false, false, false>,
+        runFused<Mode, false, false, true>,
+        runFused<Mode, false, true, false>,
+        runFused<Mode, false, true, true>,
+        runFused<Mode, true, false, false>,
+        runFused<Mode, true, false, true>,
+        runFused<Mode, true, true, false>,
+        runFused<Mode, true, true, true>,
+    };
+}
+
+constexpr FusedKernelTable kScalarKernels = fusedKernelTable<DanmakuSimdMode::Scalar>();
+constexpr FusedKernelTable kSse41Kernels = fusedKernelTable<DanmakuSimdMode::Sse41>();
+constexpr FusedKernelTable kAvx2Kernels = fusedKernelTable<DanmakuSimdMode::Avx2>();
+constexpr FusedKernelTable kAvx512Kernels = fusedKernelTable<DanmakuSimdMode::Avx512>();
+
+const FusedKernelTable &fusedKernels(DanmakuSimdMode resolved) {
+    switch (resolved) {
+    case DanmakuSimdMode::Avx512:
+        return kAvx512Kernels;
+    case DanmakuSimdMode::Avx2:
+        return kAvx2Kernels;
+    case DanmakuSimdMode::Sse41:
+        return kSse41Kernels;
+    case DanmakuSimdMode::Auto:
+    case DanmakuSimdMode::Scalar:
+        break;
+    }
+    return kScalarKernels;
+}
 }
 
 DanmakuSimdMode DanmakuSimdUpdater::parseMode(const QString &raw) {
@@ -76,9 +385,15 @@ DanmakuSimdMode DanmakuSimdUpdater::parseMode(const QString &raw) {
     if (normalized == QStringLiteral("scalar")) {
         return DanmakuSimdMode::Scalar;
     }
+    if (normalized == QStringLiteral("sse41") || normalized == QStringLiteral("sse4.1")) {
+        return DanmakuSimdMode::Sse41;
+    }
     if (normalized == QStringLiteral("avx2")) {
         return DanmakuSimdMode::Avx2;
     }
+    if (normalized == QStringLiteral("avx512")) {
+        return DanmakuSimdMode::Avx512;
+    }
     return DanmakuSimdMode::Auto;
 }
 
@@ -88,54 +403,107 @@ QString DanmakuSimdUpdater::modeName(DanmakuSimdMode mode) {
         return QStringLiteral("auto");
     case DanmakuSimdMode::Scalar:
         return QStringLiteral("scalar");
+    case DanmakuSimdMode::Sse41:
+        return QStringLiteral("sse41");
     case DanmakuSimdMode::Avx2:
         return QStringLiteral("avx2");
+    case DanmakuSimdMode::Avx512:
+        return QStringLiteral("avx512");
     }
     return QStringLiteral("auto");
 }
 
 DanmakuSimdMode DanmakuSimdUpdater::resolveMode(DanmakuSimdMode requested) {
-    if (requested == DanmakuSimdMode::Auto) {
-        return hasAvx2Runtime() ? DanmakuSimdMode::Avx2 : DanmakuSimdMode::Scalar;
+    const DanmakuSimdMode tiers[] = {DanmakuSimdMode::Avx512, DanmakuSimdMode::Avx2, DanmakuSimdMode::Sse41};
+    for (const DanmakuSimdMode tier : tiers) {
+        const bool allowed = requested == DanmakuSimdMode::Auto || static_cast<int>(tier) <= static_cast<int>(requested);
+        if (allowed && isSupported(tier)) {
+            return tier;
+        }
     }
-    if (requested == DanmakuSimdMode::Avx2 && !hasAvx2Runtime()) {
-        return DanmakuSimdMode::Scalar;
+    return DanmakuSimdMode::Scalar;
+}
+
+bool DanmakuSimdUpdater::isSupported(DanmakuSimdMode mode) {
+    switch (mode) {
+    case DanmakuSimdMode::Auto:
+    case DanmakuSimdMode::Scalar:
+        return true;
+    case DanmakuSimdMode::Sse41:
+        return cpuFeatures().sse41;
+    case DanmakuSimdMode::Avx2:
+        return cpuFeatures().avx2;
+    case DanmakuSimdMode::Avx512:
+        return cpuFeatures().avx512;
     }
-    return requested;
+    return false;
 }
 
-void DanmakuSimdUpdater::updatePositions(
-    QVector<qreal> &x,
-    const QVector<qreal> &speed,
-    const QVector<quint8> &movableMask,
-    qreal movementFactor,
-    QVector<quint8> &changedMask,
+void DanmakuSimdUpdater::updateFused(
+    DanmakuSoAState &state,
+    const DanmakuFusedUpdateParams &params,
+    DanmakuFusedUpdateResult &result,
     DanmakuSimdMode mode) {
-    if (x.isEmpty()) {
-        return;
-    }
+    updateFusedRange(state, 0, fusedRowCount(state), params, result, mode);
+}
+
+int DanmakuSimdUpdater::fusedRowCount(const DanmakuSoAState &state) {
+    return std::min({
+        state.x.size(),
+        state.y.size(),
+        state.speed.size(),
+        state.alpha.size(),
+        state.widthEstimate.size(),
+        state.fadeRemainingMs.size(),
+        state.flags.size(),
+    });
+}
 
-    const DanmakuSimdMode resolved = normalizeMode(mode);
-    if (resolved == DanmakuSimdMode::Scalar || movementFactor == 0.0) {
-        updateScalar(x, speed, movableMask, movementFactor, changedMask);
+void DanmakuSimdUpdater::updateFusedRange(
+    DanmakuSoAState &state,
+    int begin,
+    int end,
+    const DanmakuFusedUpdateParams &params,
+    DanmakuFusedUpdateResult &result,
+    DanmakuSimdMode mode) {
+    begin = std::max(begin, 0);
+    const int count = std::min(end, fusedRowCount(state)) - begin;
+    result.changedCount = 0;
+    result.removedCount = 0;
+    if (count <= 0) {
         return;
     }
 
-#if defined(NICONEON_HAS_AVX2_IMPL)
-    if constexpr (sizeof(qreal) == sizeof(double)) {
-        updateAvx2Doubles(x, speed, movableMask, movementFactor, changedMask);
-        return;
+    const FusedColumns columns {
+        state.x.data() + begin,
+        state.y.constData() + begin,
+        state.speed.constData() + begin,
+        state.alpha.data() + begin,
+        state.widthEstimate.constData() + begin,
+        state.fadeRemainingMs.data() + begin,
+        state.flags.constData() + begin,
+    };
+    if (result.changedIndices.size() < count) {
+        result.changedIndices.resize(count);
     }
-#endif
+    if (result.removedIndices.size() < count) {
+        result.removedIndices.resize(count);
+    }
+    FusedOutput out;
+    out.changed = result.changedIndices.data();
+    out.removed = result.removedIndices.data();
 
-    updateScalar(x, speed, movableMask, movementFactor, changedMask);
-}
+    const int kernel = (params.paused ? 4 : 0) | (params.anyFading ? 2 : 0) | (params.anyDragging ? 1 : 0);
+    fusedKernels(resolveMode(mode))[kernel](columns, params, count, out);
 
-bool DanmakuSimdUpdater::hasAvx2Runtime() {
-#if defined(__GNUC__) || defined(__clang__)
-#if defined(__x86_64__) || defined(__i386__)
-    return __builtin_cpu_supports("avx2");
-#endif
-#endif
-    return false;
+    if (begin > 0) {
+        for (int i = 0; i < out.changedCount; ++i) {
+            out.changed[i] += begin;
+        }
+        for (int i = 0; i < out.removedCount; ++i) {
+            out.removed[i] += begin;
+        }
+    }
+    result.changedCount = out.changedCount;
+    result.removedCount = out.removedCount;
 }
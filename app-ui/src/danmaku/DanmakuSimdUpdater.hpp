@@ -1,5 +1,7 @@
 #pragma once
 
+#include "danmaku/DanmakuSoAState.hpp"
+
 #include <QVector>
 #include <QString>
 #include <QtGlobal>
@@ -7,7 +9,27 @@
 enum class DanmakuSimdMode {
     Auto,
     Scalar,
+    Sse41,
     Avx2,
+    Avx512,
+};
+
+struct DanmakuFusedUpdateParams {
+    bool paused = false;
+    bool anyFading = true;
+    bool anyDragging = true;
+    float movementFactor = 0.0f;
+    int elapsedMs = 0;
+    float cullThreshold = 0.0f;
+    float viewportHeight = 0.0f;
+    float itemHeight = 0.0f;
+};
+
+struct DanmakuFusedUpdateResult {
+    QVector<int> changedIndices;
+    QVector<int> removedIndices;
+    int changedCount = 0;
+    int removedCount = 0;
 };
 
 class DanmakuSimdUpdater {
@@ -15,15 +37,19 @@ public:
     static DanmakuSimdMode parseMode(const QString &raw);
     static QString modeName(DanmakuSimdMode mode);
     static DanmakuSimdMode resolveMode(DanmakuSimdMode requested);
+    static bool isSupported(DanmakuSimdMode mode);
 
-    static void updatePositions(
-        QVector<qreal> &x,
-        const QVector<qreal> &speed,
-        const QVector<quint8> &movableMask,
-        qreal movementFactor,
-        QVector<quint8> &changedMask,
+    static void updateFused(
+        DanmakuSoAState &state,
+        const DanmakuFusedUpdateParams &params,
+        DanmakuFusedUpdateResult &result,
         DanmakuSimdMode mode);
-
-private:
-    static bool hasAvx2Runtime();
+    static void updateFusedRange(
+        DanmakuSoAState &state,
+        int begin,
+        int end,
+        const DanmakuFusedUpdateParams &params,
+        DanmakuFusedUpdateResult &result,
+        DanmakuSimdMode mode);
+    static int fusedRowCount(const DanmakuSoAState &state);
 };
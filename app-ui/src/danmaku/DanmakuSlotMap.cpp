@@ -0,0 +1,119 @@
+#include "danmaku/DanmakuSlotMap.hpp"
+
+DanmakuItemHandle DanmakuSlotMap::insert(int row) {
+    if (row < 0) {
+        return kInvalidHandle;
+    }
+    if (row >= m_rowHandles.size()) {
+        m_rowHandles.resize(row + 1);
+    }
+    if (m_rowHandles[row] != kInvalidHandle) {
+        remove(m_rowHandles[row]);
+    }
+
+    int slot = -1;
+    if (!m_freeSlots.isEmpty()) {
+        slot = m_freeSlots.takeLast();
+    } else {
+        slot = m_slots.size();
+        m_slots.push_back(Slot {});
+    }
+
+    Slot &entry = m_slots[slot];
+    entry.row = row;
+    const DanmakuItemHandle handle = makeHandle(slot, entry.generation);
+    m_rowHandles[row] = handle;
+    return handle;
+}
+
+void DanmakuSlotMap::remove(DanmakuItemHandle handle) {
+    const int currentRow = row(handle);
+    if (currentRow < 0) {
+        return;
+    }
+
+    const int slot = slotOf(handle);
+    Slot &entry = m_slots[slot];
+    entry.row = -1;
+    ++entry.generation;
+    if (entry.generation == 0) {
+        entry.generation = 1;
+    }
+    m_freeSlots.push_back(slot);
+    m_rowHandles[currentRow] = kInvalidHandle;
+}
+
+void DanmakuSlotMap::relocate(int fromRow, int toRow) {
+    if (fromRow == toRow || fromRow < 0 || toRow < 0 || fromRow >= m_rowHandles.size()) {
+        return;
+    }
+    if (toRow >= m_rowHandles.size()) {
+        m_rowHandles.resize(toRow + 1);
+    }
+    if (m_rowHandles[toRow] != kInvalidHandle) {
+        remove(m_rowHandles[toRow]);
+    }
+
+    const DanmakuItemHandle handle = m_rowHandles[fromRow];
+    m_rowHandles[fromRow] = kInvalidHandle;
+    m_rowHandles[toRow] = handle;
+    const int slot = slotOf(handle);
+    if (slot >= 0 && slot < m_slots.size()) {
+        m_slots[slot].row = toRow;
+    }
+}
+
+void DanmakuSlotMap::truncate(int rowCount) {
+    const int count = qMax(0, rowCount);
+    while (m_rowHandles.size() > count) {
+        remove(m_rowHandles.last());
+        m_rowHandles.removeLast();
+    }
+}
+
+int DanmakuSlotMap::row(DanmakuItemHandle handle) const {
+    const int slot = slotOf(handle);
+    if (slot < 0 || slot >= m_slots.size()) {
+        return -1;
+    }
+    const Slot &entry = m_slots[slot];
+    if (entry.generation != static_cast<quint32>(handle >> 32)) {
+        return -1;
+    }
+    return entry.row;
+}
+
+bool DanmakuSlotMap::contains(DanmakuItemHandle handle) const {
+    return row(handle) >= 0;
+}
+
+DanmakuItemHandle DanmakuSlotMap::handleAt(int row) const {
+    if (row < 0 || row >= m_rowHandles.size()) {
+        return kInvalidHandle;
+    }
+    return m_rowHandles[row];
+}
+
+void DanmakuSlotMap::clear() {
+    for (int slot = 0; slot < m_slots.size(); ++slot) {
+        Slot &entry = m_slots[slot];
+        if (entry.row < 0) {
+            continue;
+        }
+        entry.row = -1;
+        ++entry.generation;
+        if (entry.generation == 0) {
+            entry.generation = 1;
+        }
+        m_freeSlots.push_back(slot);
+    }
+    m_rowHandles.clear();
+}
+
+int DanmakuSlotMap::size() const {
+    return m_slots.size() - m_freeSlots.size();
+}
+
+int DanmakuSlotMap::freeSlotCount() const {
+    return m_freeSlots.size();
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <QVector>
+#include <QtGlobal>
+
+using DanmakuItemHandle = quint64;
+
+class DanmakuSlotMap {
+public:
+    static constexpr DanmakuItemHandle kInvalidHandle = 0;
+
+    DanmakuSlotMap() = default;
+
+    DanmakuItemHandle insert(int row);
+    void remove(DanmakuItemHandle handle);
+    void relocate(int fromRow, int toRow);
+    void truncate(int rowCount);
+    int row(DanmakuItemHandle handle) const;
+    bool contains(DanmakuItemHandle handle) const;
+    DanmakuItemHandle handleAt(int row) const;
+    void clear();
+    int size() const;
+    int freeSlotCount() const;
+
+    static int slotOf(DanmakuItemHandle handle) {
+        return handle == kInvalidHandle ? -1 : static_cast<int>(handle & 0xffffffffu);
+    }
+
+private:
+    struct Slot {
+        int row = -1;
+        quint32 generation = 1;
+    };
+
+    static DanmakuItemHandle makeHandle(int slot, quint32 generation) {
+        return (static_cast<DanmakuItemHandle>(generation) << 32) | static_cast<quint32>(slot);
+    }
+
+    QVector<Slot> m_slots;
+    QVector<int> m_freeSlots;
+    QVector<DanmakuItemHandle> m_rowHandles;
+};
@@ -1,7 +1,7 @@
 #pragma once
 
-#include <QMetaType>
-#include <QSharedPointer>
+#include "danmaku/DanmakuSlotMap.hpp"
+
 #include <QVector>
 #include <QtGlobal>
 
@@ -12,7 +12,7 @@ enum DanmakuSoAFlag : quint8 {
 };
 
 struct DanmakuWorkerRowState {
-    int row = -1;
+    DanmakuItemHandle handle = DanmakuSlotMap::kInvalidHandle;
     qreal x = 0.0;
     qreal y = 0.0;
     qreal speed = 0.0;
@@ -23,17 +23,17 @@ struct DanmakuWorkerRowState {
 };
 
 struct DanmakuSoAState {
-    QVector<int> rows;
-    QVector<qreal> x;
-    QVector<qreal> y;
-    QVector<qreal> speed;
-    QVector<qreal> alpha;
+    QVector<DanmakuItemHandle> handles;
+    QVector<float> x;
+    QVector<float> y;
+    QVector<float> speed;
+    QVector<float> alpha;
     QVector<int> widthEstimate;
     QVector<int> fadeRemainingMs;
     QVector<quint8> flags;
 
     void clear() {
-        rows.clear();
+        handles.clear();
         x.clear();
         y.clear();
         speed.clear();
@@ -44,7 +44,7 @@ struct DanmakuSoAState {
     }
 
     void reserve(int count) {
-        rows.reserve(count);
+        handles.reserve(count);
         x.reserve(count);
         y.reserve(count);
         speed.reserve(count);
@@ -55,7 +55,7 @@ struct DanmakuSoAState {
     }
 
     void resize(int count) {
-        rows.resize(count);
+        handles.resize(count);
         x.resize(count);
         y.resize(count);
         speed.resize(count);
@@ -66,30 +66,56 @@ struct DanmakuSoAState {
     }
 
     int size() const {
-        return rows.size();
+        return handles.size();
     }
 };
 
-struct DanmakuWorkerSyncBatch {
-    bool fullReset = false;
-    QVector<DanmakuWorkerRowState> upsertRows;
-    QVector<int> removeRows;
+enum class DanmakuWorkerCommandType : quint8 {
+    Upsert,
+    Remove,
+    FullReset,
+    Frame,
+    Quit,
 };
 
-struct DanmakuWorkerFrame {
+struct DanmakuWorkerFrameRequest {
     qint64 seq = 0;
+    quint32 generation = 0;
+    qint64 targetNs = 0;
     bool playbackPaused = false;
     qreal playbackRate = 1.0;
     int elapsedMs = 0;
     qreal viewportHeight = 0;
     qreal cullThreshold = 0;
     qreal itemHeight = 0;
-    QVector<DanmakuWorkerRowState> changedRows;
-    QVector<int> removeRows;
 };
 
-using DanmakuWorkerFramePtr = QSharedPointer<DanmakuWorkerFrame>;
-using DanmakuWorkerSyncBatchPtr = QSharedPointer<DanmakuWorkerSyncBatch>;
+struct DanmakuWorkerCommand {
+    DanmakuWorkerCommandType type = DanmakuWorkerCommandType::Upsert;
+    DanmakuWorkerRowState row;
+    DanmakuWorkerFrameRequest frame;
+};
 
-Q_DECLARE_METATYPE(DanmakuWorkerSyncBatchPtr)
-Q_DECLARE_METATYPE(DanmakuWorkerFramePtr)
+struct DanmakuWorkerFrameColumns {
+    qint64 seq = 0;
+    quint32 generation = 0;
+    qint64 targetNs = 0;
+    qreal travel = 0.0;
+    QVector<DanmakuItemHandle> changedHandles;
+    QVector<float> x;
+    QVector<float> alpha;
+    QVector<int> fadeRemainingMs;
+    QVector<DanmakuItemHandle> removedHandles;
+
+    void clear() {
+        changedHandles.clear();
+        x.clear();
+        alpha.clear();
+        fadeRemainingMs.clear();
+        removedHandles.clear();
+    }
+
+    int changedCount() const {
+        return changedHandles.size();
+    }
+};
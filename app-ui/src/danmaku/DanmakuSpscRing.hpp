@@ -0,0 +1,67 @@
+#pragma once
+
+#include <QVector>
+#include <QtGlobal>
+
+#include <algorithm>
+#include <atomic>
+
+template <typename T>
+class DanmakuSpscRing {
+public:
+    explicit DanmakuSpscRing(int capacity) {
+        quint32 size = 2;
+        while (size < static_cast<quint32>(std::max(capacity, 2))) {
+            size <<= 1;
+        }
+        m_buffer.resize(static_cast<int>(size));
+        m_mask = size - 1;
+    }
+
+    DanmakuSpscRing(const DanmakuSpscRing &) = delete;
+    DanmakuSpscRing &operator=(const DanmakuSpscRing &) = delete;
+
+    bool tryPush(const T &value) {
+        const quint32 head = m_head.load(std::memory_order_relaxed);
+        if (head - m_cachedTail > m_mask) {
+            m_cachedTail = m_tail.load(std::memory_order_acquire);
+            if (head - m_cachedTail > m_mask) {
+                return false;
+            }
+        }
+        m_buffer[static_cast<int>(head & m_mask)] = value;
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool tryPop(T &value) {
+        const quint32 tail = m_tail.load(std::memory_order_relaxed);
+        if (tail == m_cachedHead) {
+            m_cachedHead = m_head.load(std::memory_order_acquire);
+            if (tail == m_cachedHead) {
+                return false;
+            }
+        }
+        value = m_buffer[static_cast<int>(tail & m_mask)];
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    int capacity() const {
+        return static_cast<int>(m_mask + 1);
+    }
+
+    int sizeApprox() const {
+        const quint32 tail = m_tail.load(std::memory_order_acquire);
+        const quint32 head = m_head.load(std::memory_order_acquire);
+        return static_cast<int>(head - tail);
+    }
+
+private:
+    QVector<T> m_buffer;
+    quint32 m_mask = 0;
+    alignas(64) std::atomic<quint32> m_head {0};
+    quint32 m_cachedTail = 0;
+    alignas(64) std::atomic<quint32> m_tail {0};
+    quint32 m_cachedHead = 0;
+};
@@ -0,0 +1,76 @@
+#include "danmaku/DanmakuStringPool.hpp"
+
+DanmakuStringId DanmakuStringPool::intern(const QString &text) {
+    if (text.isEmpty()) {
+        return kInvalidId;
+    }
+
+    const auto it = m_ids.constFind(text);
+    if (it != m_ids.constEnd()) {
+        ++m_entries[it.value()].refCount;
+        return it.value();
+    }
+
+    DanmakuStringId id = kInvalidId;
+    if (!m_freeIds.isEmpty()) {
+        id = m_freeIds.takeLast();
+    } else {
+        id = static_cast<DanmakuStringId>(m_entries.size());
+        m_entries.push_back(Entry {});
+    }
+
+    Entry &entry = m_entries[id];
+    entry.text = text;
+    entry.refCount = 1;
+    m_ids.insert(text, id);
+    return id;
+}
+
+DanmakuStringId DanmakuStringPool::find(const QString &text) const {
+    return m_ids.value(text, kInvalidId);
+}
+
+void DanmakuStringPool::retain(DanmakuStringId id) {
+    if (id == kInvalidId || id >= static_cast<DanmakuStringId>(m_entries.size())) {
+        return;
+    }
+    Entry &entry = m_entries[id];
+    if (entry.refCount > 0) {
+        ++entry.refCount;
+    }
+}
+
+void DanmakuStringPool::release(DanmakuStringId id) {
+    if (id == kInvalidId || id >= static_cast<DanmakuStringId>(m_entries.size())) {
+        return;
+    }
+    Entry &entry = m_entries[id];
+    if (entry.refCount == 0) {
+        return;
+    }
+    if (--entry.refCount > 0) {
+        return;
+    }
+
+    m_ids.remove(entry.text);
+    entry.text.clear();
+    m_freeIds.push_back(id);
+}
+
+const QString &DanmakuStringPool::text(DanmakuStringId id) const {
+    if (id >= static_cast<DanmakuStringId>(m_entries.size())) {
+        return m_entries[kInvalidId].text;
+    }
+    return m_entries[id].text;
+}
+
+void DanmakuStringPool::clear() {
+    m_entries.clear();
+    m_entries.push_back(Entry {});
+    m_ids.clear();
+    m_freeIds.clear();
+}
+
+int DanmakuStringPool::size() const {
+    return m_ids.size();
+}
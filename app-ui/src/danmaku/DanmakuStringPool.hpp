@@ -0,0 +1,33 @@
+#pragma once
+
+#include <QHash>
+#include <QString>
+#include <QVector>
+#include <QtGlobal>
+
+using DanmakuStringId = quint32;
+
+class DanmakuStringPool {
+public:
+    static constexpr DanmakuStringId kInvalidId = 0;
+
+    DanmakuStringPool() = default;
+
+    DanmakuStringId intern(const QString &text);
+    DanmakuStringId find(const QString &text) const;
+    void retain(DanmakuStringId id);
+    void release(DanmakuStringId id);
+    const QString &text(DanmakuStringId id) const;
+    void clear();
+    int size() const;
+
+private:
+    struct Entry {
+        QString text;
+        quint32 refCount = 0;
+    };
+
+    QVector<Entry> m_entries {Entry {}};
+    QHash<QString, DanmakuStringId> m_ids;
+    QVector<DanmakuStringId> m_freeIds;
+};
@@ -1,36 +1,309 @@
 #include "danmaku/DanmakuTextSpriteCache.hpp"
 
 #include "danmaku/DanmakuRenderStyle.hpp"
+#include "perf/PerfTrace.hpp"
 
 #include <QColor>
-#include <QFont>
+#include <QFontDatabase>
 #include <QFontMetrics>
-#include <QImage>
+#include <QFontMetricsF>
+#include <QGlyphRun>
+#include <QMutexLocker>
 #include <QPainter>
+#include <QTextLayout>
+#include <QTextOption>
+#include <QThread>
 
 #include <algorithm>
 #include <cmath>
+#include <limits>
+
+namespace {
+constexpr qreal kGlyphPaddingPx = 1.0;
+constexpr float kDistanceInfinity = 1.0e20f;
+
+void squaredDistanceTransform1d(const float *source, int count, float *target, int *parabolas, float *bounds) {
+    int k = 0;
+    parabolas[0] = 0;
+    bounds[0] = -std::numeric_limits<float>::infinity();
+    bounds[1] = std::numeric_limits<float>::infinity();
+    for (int q = 1; q < count; ++q) {
+        float s = 0.0f;
+        while (true) {
+            const int v = parabolas[k];
+            s = ((source[q] + static_cast<float>(q * q)) - (source[v] + static_cast<float>(v * v)))
+                / static_cast<float>(2 * q - 2 * v);
+            if (s > bounds[k] || k == 0) {
+                break;
+            }
+            --k;
+        }
+        if (s <= bounds[k]) {
+            parabolas[k] = q;
+            bounds[k + 1] = std::numeric_limits<float>::infinity();
+            continue;
+        }
+        ++k;
+        parabolas[k] = q;
+        bounds[k] = s;
+        bounds[k + 1] = std::numeric_limits<float>::infinity();
+    }
+
+    k = 0;
+    for (int q = 0; q < count; ++q) {
+        while (bounds[k + 1] < static_cast<float>(q)) {
+            ++k;
+        }
+        const int v = parabolas[k];
+        target[q] = static_cast<float>((q - v) * (q - v)) + source[v];
+    }
+}
+
+QVector<float> squaredDistanceToSeeds(const QVector<quint8> &seeds, int width, int height) {
+    QVector<float> distances(width * height);
+    for (int i = 0; i < distances.size(); ++i) {
+        distances[i] = seeds[i] ? 0.0f : kDistanceInfinity;
+    }
+
+    const int length = std::max(width, height);
+    QVector<float> source(length);
+    QVector<float> target(length);
+    QVector<int> parabolas(length);
+    QVector<float> bounds(length + 1);
+    for (int x = 0; x < width; ++x) {
+        for (int y = 0; y < height; ++y) {
+            source[y] = distances[y * width + x];
+        }
+        squaredDistanceTransform1d(source.constData(), height, target.data(), parabolas.data(), bounds.data());
+        for (int y = 0; y < height; ++y) {
+            distances[y * width + x] = target[y];
+        }
+    }
+    for (int y = 0; y < height; ++y) {
+        float *row = distances.data() + y * width;
+        std::copy(row, row + width, source.begin());
+        squaredDistanceTransform1d(source.constData(), width, row, parabolas.data(), bounds.data());
+    }
+    return distances;
+}
+}
+
+int DanmakuTextSpriteCache::rasterThreadCountFromEnvironment() {
+    bool ok = false;
+    const int configured = qEnvironmentVariableIntValue("NICONEON_DANMAKU_RASTER_THREADS", &ok);
+    if (ok && configured >= 0) {
+        return std::min(configured, kMaxRasterThreads);
+    }
+    return std::clamp(QThread::idealThreadCount() / 2, 1, 2);
+}
+
+bool DanmakuTextSpriteCache::distanceFieldModeFromEnvironment() {
+    return qEnvironmentVariable("NICONEON_DANMAKU_SPRITE_FORMAT").trimmed().toLower() == QStringLiteral("sdf");
+}
+
+bool DanmakuTextSpriteCache::glyphRunModeFromEnvironment() {
+    return qEnvironmentVariable("NICONEON_DANMAKU_RENDERER").trimmed().toLower() == QStringLiteral("glyph_atlas");
+}
+
+DanmakuTextSpriteCache::DanmakuTextSpriteCache(DanmakuStringPool *stringPool)
+    : m_stringPool(stringPool ? stringPool : &m_ownedStringPool) {
+    m_pool.setExpiryTimeout(-1);
+}
+
+DanmakuTextSpriteCache::~DanmakuTextSpriteCache() {
+    m_generation.fetch_add(1, std::memory_order_acq_rel);
+    m_pool.clear();
+    m_pool.waitForDone();
+    clear();
+}
+
+QFont DanmakuTextSpriteCache::spriteFont(int fontPixelSize, const QStringList &fallbackFamilies) {
+    QFont font;
+    font.setPixelSize(fontPixelSize);
+    if (!fallbackFamilies.isEmpty()) {
+        QStringList families {font.family()};
+        families.append(fallbackFamilies);
+        font.setFamilies(families);
+    }
+    return font;
+}
+
+int DanmakuTextSpriteCache::measureWidth(const QString &text, const QFont &font) {
+    const QFontMetrics metrics(font);
+    const int paddedWidth = metrics.horizontalAdvance(text) + DanmakuRenderStyle::kHorizontalPaddingPx * 2;
+    return std::max(DanmakuRenderStyle::kMinWidthPx, paddedWidth);
+}
+
+QImage DanmakuTextSpriteCache::rasterizeText(
+    const QString &text,
+    const QFont &font,
+    int widthEstimate,
+    qreal devicePixelRatio) {
+    const qreal dpr = std::max(devicePixelRatio, kMinDevicePixelRatio);
+    const QSize pixelSize(
+        std::max(1, static_cast<int>(std::ceil(widthEstimate * dpr))),
+        std::max(1, static_cast<int>(std::ceil(DanmakuRenderStyle::kItemHeightPx * dpr))));
+
+    QImage image(pixelSize, QImage::Format_RGBA8888_Premultiplied);
+    image.setDevicePixelRatio(dpr);
+    image.fill(Qt::transparent);
+
+    QPainter painter(&image);
+    painter.setRenderHint(QPainter::TextAntialiasing, true);
+    painter.setFont(font);
+    painter.setPen(QColor(Qt::white));
+    painter.drawText(
+        QRectF(
+            0.0,
+            0.0,
+            static_cast<qreal>(widthEstimate),
+            static_cast<qreal>(DanmakuRenderStyle::kItemHeightPx)),
+        Qt::AlignVCenter | Qt::AlignHCenter,
+        text);
+    return image;
+}
+
+QImage DanmakuTextSpriteCache::distanceFieldFromCoverage(const QImage &coverage, int spreadPx) {
+    if (coverage.isNull()) {
+        return {};
+    }
+
+    const QImage source = coverage.convertToFormat(QImage::Format_RGBA8888_Premultiplied);
+    const int width = source.width();
+    const int height = source.height();
+    QVector<quint8> alpha(width * height);
+    QVector<quint8> inside(width * height);
+    QVector<quint8> outside(width * height);
+    for (int y = 0; y < height; ++y) {
+        const uchar *line = source.constScanLine(y);
+        for (int x = 0; x < width; ++x) {
+            const int index = y * width + x;
+            alpha[index] = line[x * 4 + 3];
+            inside[index] = alpha[index] >= 128 ? 1 : 0;
+            outside[index] = inside[index] ? 0 : 1;
+        }
+    }
+    const QVector<float> toInside = squaredDistanceToSeeds(inside, width, height);
+    const QVector<float> toOutside = squaredDistanceToSeeds(outside, width, height);
+
+    QImage field(source.size(), QImage::Format_RGBA8888_Premultiplied);
+    field.setDevicePixelRatio(coverage.devicePixelRatio());
+    const float spread = static_cast<float>(std::max(spreadPx, 1));
+    for (int y = 0; y < height; ++y) {
+        uchar *line = field.scanLine(y);
+        for (int x = 0; x < width; ++x) {
+            const int index = y * width + x;
+            float distance = 0.0f;
+            if (alpha[index] > 0 && alpha[index] < 255) {
+                distance = 0.5f - alpha[index] / 255.0f;
+            } else if (inside[index]) {
+                distance = 0.5f - std::sqrt(toOutside[index]);
+            } else {
+                distance = std::sqrt(toInside[index]) - 0.5f;
+            }
+            const float encoded = std::clamp(0.5f - distance / (2.0f * spread), 0.0f, 1.0f);
+            const uchar value = static_cast<uchar>(std::lround(encoded * 255.0f));
+            line[x * 4 + 0] = value;
+            line[x * 4 + 1] = value;
+            line[x * 4 + 2] = value;
+            line[x * 4 + 3] = value;
+        }
+    }
+    return field;
+}
 
 void DanmakuTextSpriteCache::clear() {
+    m_generation.fetch_add(1, std::memory_order_acq_rel);
+    {
+        QMutexLocker locker(&m_finishedMutex);
+        m_finishedRasters.clear();
+        m_sentGlyphs.clear();
+    }
+    m_readyRasters.clear();
+    m_readyGlyphImages.clear();
+    m_widthRefinements.clear();
+    for (auto it = m_widthCache.constBegin(); it != m_widthCache.constEnd(); ++it) {
+        m_stringPool->release(it.key().textId);
+    }
+    for (auto it = m_estimatedWidths.constBegin(); it != m_estimatedWidths.constEnd(); ++it) {
+        m_stringPool->release(it.key().textId);
+    }
+    for (auto it = m_spriteIds.constBegin(); it != m_spriteIds.constEnd(); ++it) {
+        m_stringPool->release(it.key().textId);
+    }
     m_widthCache.clear();
+    m_estimatedWidths.clear();
     m_spriteIds.clear();
     m_pendingRasters.clear();
     m_pendingRasterQueue.clear();
     m_widthMeasurementCount = 0;
 }
 
+void DanmakuTextSpriteCache::setFallbackFamilies(const QStringList &families) {
+    m_fallbackFamilies = families;
+}
+
+void DanmakuTextSpriteCache::setRasterThreadCount(int threadCount) {
+    m_rasterThreadCount = QFontDatabase::supportsThreadedFontRendering()
+        ? std::clamp(threadCount, 0, kMaxRasterThreads)
+        : 0;
+    if (m_rasterThreadCount > 0) {
+        m_pool.setMaxThreadCount(m_rasterThreadCount);
+    }
+}
+
+int DanmakuTextSpriteCache::rasterThreadCount() const {
+    return m_rasterThreadCount;
+}
+
+void DanmakuTextSpriteCache::setGlyphRunMode(bool enabled) {
+    if (m_glyphRunMode == enabled) {
+        return;
+    }
+    m_glyphRunMode = enabled;
+    clear();
+}
+
+bool DanmakuTextSpriteCache::glyphRunMode() const {
+    return m_glyphRunMode;
+}
+
+void DanmakuTextSpriteCache::setDistanceFieldMode(bool enabled) {
+    if (m_distanceFieldMode == enabled) {
+        return;
+    }
+    m_distanceFieldMode = enabled;
+    clear();
+}
+
+bool DanmakuTextSpriteCache::distanceFieldMode() const {
+    return m_distanceFieldMode;
+}
+
+int DanmakuTextSpriteCache::estimateWidth(const QString &text, int fontPixelSize) const {
+    qreal advance = 0.0;
+    const QVector<uint> codepoints = text.toUcs4();
+    for (const uint value : codepoints) {
+        const auto it = m_glyphAdvances.constFind(AdvanceKey {static_cast<char32_t>(value), fontPixelSize});
+        advance += it != m_glyphAdvances.constEnd() ? it.value() : static_cast<qreal>(fontPixelSize);
+    }
+    const int paddedWidth = static_cast<int>(std::ceil(advance)) + DanmakuRenderStyle::kHorizontalPaddingPx * 2;
+    return std::max(DanmakuRenderStyle::kMinWidthPx, paddedWidth);
+}
+
 DanmakuTextSpriteCache::EnsureResult DanmakuTextSpriteCache::ensureSprite(
-    const QString &text,
+    DanmakuStringId textId,
     int fontPixelSize,
     qreal devicePixelRatio) {
     EnsureResult result;
-    result.widthEstimate = ensureWidthEstimate(text, fontPixelSize);
+    bool widthMeasured = true;
+    result.widthEstimate = ensureWidthEstimate(textId, fontPixelSize, &widthMeasured);
+    result.widthMeasured = widthMeasured;
 
-    const int dprMilli = std::max(1, static_cast<int>(std::lround(std::max(devicePixelRatio, 1.0) * 1000.0)));
     const SpriteKey key {
-        text,
+        textId,
         fontPixelSize,
-        dprMilli,
+        spriteDevicePixelRatioMilli(devicePixelRatio),
     };
     const auto spriteIt = m_spriteIds.constFind(key);
     if (spriteIt != m_spriteIds.constEnd()) {
@@ -39,11 +312,13 @@ DanmakuTextSpriteCache::EnsureResult DanmakuTextSpriteCache::ensureSprite(
     }
 
     result.spriteId = m_nextSpriteId++;
+    m_stringPool->retain(textId);
     m_spriteIds.insert(key, result.spriteId);
     const PendingRaster pending {
         key,
         result.spriteId,
         result.widthEstimate,
+        widthMeasured,
     };
     m_pendingRasters.insert(key, pending);
     m_pendingRasterQueue.enqueue(pending);
@@ -51,26 +326,37 @@ DanmakuTextSpriteCache::EnsureResult DanmakuTextSpriteCache::ensureSprite(
     return result;
 }
 
+DanmakuTextSpriteCache::EnsureResult DanmakuTextSpriteCache::ensureSprite(
+    const QString &text,
+    int fontPixelSize,
+    qreal devicePixelRatio) {
+    const DanmakuStringId textId = m_stringPool->intern(text);
+    const EnsureResult result = ensureSprite(textId, fontPixelSize, devicePixelRatio);
+    m_stringPool->release(textId);
+    return result;
+}
+
 DanmakuSpriteUpload DanmakuTextSpriteCache::takePendingUpload(
     const QString &text,
     int fontPixelSize,
     qreal devicePixelRatio) {
-    const int dprMilli = std::max(1, static_cast<int>(std::lround(std::max(devicePixelRatio, 1.0) * 1000.0)));
     const SpriteKey key {
-        text,
+        m_stringPool->find(text),
         fontPixelSize,
-        dprMilli,
+        spriteDevicePixelRatioMilli(devicePixelRatio),
     };
     const auto pendingIt = m_pendingRasters.constFind(key);
     if (pendingIt == m_pendingRasters.constEnd()) {
         return {};
     }
 
-    const PendingRaster pending = pendingIt.value();
-    DanmakuSpriteUpload upload;
-    upload.spriteId = pending.spriteId;
-    upload.logicalSize = QSize(pending.widthEstimate, DanmakuRenderStyle::kItemHeightPx);
-    upload.image = rasterizeSprite(text, fontPixelSize, pending.widthEstimate, devicePixelRatio);
+    PendingRaster pending = pendingIt.value();
+    if (!pending.widthMeasured) {
+        pending.widthEstimate = measureWidth(text, spriteFont(fontPixelSize, m_fallbackFamilies));
+        applyMeasuredWidth(key, pending.spriteId, pending.widthEstimate);
+    }
+    DanmakuSpriteUpload upload = rasterizeUpload(text, pending);
+    attachReadyGlyphImages(upload);
     m_pendingRasters.remove(key);
     for (qsizetype i = 0; i < m_pendingRasterQueue.size(); ++i) {
         const PendingRaster &queued = m_pendingRasterQueue.at(i);
@@ -84,29 +370,32 @@ DanmakuSpriteUpload DanmakuTextSpriteCache::takePendingUpload(
 
 QVector<DanmakuSpriteUpload> DanmakuTextSpriteCache::rasterizePendingSprites(int maxSprites, qint64 maxUploadBytes) {
     QVector<DanmakuSpriteUpload> uploads;
+    collectFinishedRasters();
+    if (m_rasterThreadCount > 0) {
+        dispatchPendingRasters();
+    }
     if (maxSprites <= 0) {
         return uploads;
     }
 
     qint64 totalUploadBytes = 0;
+    takeReadyUploads(uploads, maxSprites, maxUploadBytes, totalUploadBytes);
     while (uploads.size() < maxSprites && !m_pendingRasterQueue.isEmpty()) {
-        const PendingRaster pending = m_pendingRasterQueue.dequeue();
+        PendingRaster pending = m_pendingRasterQueue.dequeue();
         const auto pendingIt = m_pendingRasters.constFind(pending.key);
         if (pendingIt == m_pendingRasters.constEnd() || pendingIt->spriteId != pending.spriteId) {
             continue;
         }
 
-        const qreal devicePixelRatio = std::max(1.0, pending.key.devicePixelRatioMilli / 1000.0);
-        DanmakuSpriteUpload upload;
-        upload.spriteId = pending.spriteId;
-        upload.logicalSize = QSize(pending.widthEstimate, DanmakuRenderStyle::kItemHeightPx);
-        upload.image = rasterizeSprite(
-            pending.key.text,
-            pending.key.fontPixelSize,
-            pending.widthEstimate,
-            devicePixelRatio);
-
-        const qint64 uploadBytes = static_cast<qint64>(upload.image.sizeInBytes());
+        const QString text = m_stringPool->text(pending.key.textId);
+        if (!pending.widthMeasured) {
+            pending.widthEstimate = measureWidth(text, spriteFont(pending.key.fontPixelSize, m_fallbackFamilies));
+            applyMeasuredWidth(pending.key, pending.spriteId, pending.widthEstimate);
+            pending.widthMeasured = true;
+        }
+        DanmakuSpriteUpload upload = rasterizeUpload(text, pending);
+
+        const qint64 uploadBytes = static_cast<qint64>(upload.image.sizeInBytes()) + readyGlyphBytes(upload.glyphs);
         const bool exceedsBudget = maxUploadBytes > 0
             && !uploads.isEmpty()
             && totalUploadBytes + uploadBytes > maxUploadBytes;
@@ -115,14 +404,32 @@ QVector<DanmakuSpriteUpload> DanmakuTextSpriteCache::rasterizePendingSprites(int
             break;
         }
 
+        attachReadyGlyphImages(upload);
         uploads.push_back(std::move(upload));
         totalUploadBytes += uploadBytes;
         m_pendingRasters.remove(pending.key);
     }
-
     return uploads;
 }
 
+QVector<DanmakuTextSpriteCache::WidthRefinement> DanmakuTextSpriteCache::takeWidthRefinements() {
+    QVector<WidthRefinement> refinements;
+    refinements.swap(m_widthRefinements);
+    return refinements;
+}
+
+int DanmakuTextSpriteCache::pendingRasterCount() const {
+    return m_pendingRasters.size();
+}
+
+int DanmakuTextSpriteCache::rasterJobsInFlight() const {
+    return m_rasterJobsInFlight.load(std::memory_order_acquire);
+}
+
+bool DanmakuTextSpriteCache::waitForRasterJobs(int timeoutMs) {
+    return m_pool.waitForDone(timeoutMs);
+}
+
 int DanmakuTextSpriteCache::widthMeasurementCountForTesting() const {
     return m_widthMeasurementCount;
 }
@@ -131,65 +438,406 @@ int DanmakuTextSpriteCache::pendingRasterCountForTesting() const {
     return m_pendingRasters.size();
 }
 
-int DanmakuTextSpriteCache::ensureWidthEstimate(const QString &text, int fontPixelSize) {
+int DanmakuTextSpriteCache::devicePixelRatioMilli(qreal devicePixelRatio) {
+    return std::max(1, static_cast<int>(std::lround(std::max(devicePixelRatio, kMinDevicePixelRatio) * 1000.0)));
+}
+
+qreal DanmakuTextSpriteCache::glyphPaddingPx(const RasterOptions &options) {
+    if (!options.distanceField) {
+        return kGlyphPaddingPx;
+    }
+    return static_cast<qreal>(DanmakuRenderStyle::kDistanceFieldSpreadPx) / DanmakuRenderStyle::kDistanceFieldRasterScale;
+}
+
+QImage DanmakuTextSpriteCache::rasterizeGlyph(const ShapedGlyph &glyph, qreal devicePixelRatio, qreal paddingPx) {
+    const qreal dpr = std::max(devicePixelRatio, kMinDevicePixelRatio);
+    const QSize pixelSize(
+        std::max(1, static_cast<int>(std::ceil((glyph.bounds.width() + paddingPx * 2.0) * dpr))),
+        std::max(1, static_cast<int>(std::ceil((glyph.bounds.height() + paddingPx * 2.0) * dpr))));
+
+    QImage image(pixelSize, QImage::Format_RGBA8888_Premultiplied);
+    image.setDevicePixelRatio(dpr);
+    image.fill(Qt::transparent);
+
+    QGlyphRun glyphRun;
+    glyphRun.setRawFont(glyph.font);
+    glyphRun.setGlyphIndexes({glyph.key.glyphIndex});
+    glyphRun.setPositions({QPointF(paddingPx - glyph.bounds.left(), paddingPx - glyph.bounds.top())});
+
+    QPainter painter(&image);
+    painter.setRenderHint(QPainter::TextAntialiasing, true);
+    painter.setPen(QColor(Qt::white));
+    painter.drawGlyphRun(QPointF(0.0, 0.0), glyphRun);
+    return image;
+}
+
+int DanmakuTextSpriteCache::spriteDevicePixelRatioMilli(qreal devicePixelRatio) const {
+    if (m_distanceFieldMode) {
+        return DanmakuRenderStyle::kDistanceFieldRasterScale * 1000;
+    }
+    return devicePixelRatioMilli(devicePixelRatio);
+}
+
+DanmakuTextSpriteCache::RasterOptions DanmakuTextSpriteCache::rasterOptions() const {
+    return RasterOptions {m_glyphRunMode, m_distanceFieldMode};
+}
+
+DanmakuTextSpriteCache::FinishedRaster DanmakuTextSpriteCache::rasterizeOffThread(
+    const QString &text,
+    const QStringList &fallbackFamilies,
+    const PendingRaster &pending,
+    quint64 generation,
+    const RasterOptions &options) {
+    const PerfTraceSpan span("DanmakuTextSpriteCache::rasterizeOffThread");
+    const QFont font = spriteFont(pending.key.fontPixelSize, fallbackFamilies);
+    FinishedRaster finished;
+    finished.key = pending.key;
+    finished.spriteId = pending.spriteId;
+    finished.generation = generation;
+    finished.widthEstimate = pending.widthEstimate;
+    finished.widthMeasured = !pending.widthMeasured;
+    if (finished.widthMeasured) {
+        finished.widthEstimate = measureWidth(text, font);
+        const QFontMetricsF metrics(font);
+        const QVector<uint> codepoints = text.toUcs4();
+        finished.advances.reserve(codepoints.size());
+        for (const uint value : codepoints) {
+            const char32_t codepoint = static_cast<char32_t>(value);
+            finished.advances.push_back({codepoint, metrics.horizontalAdvance(QString::fromUcs4(&codepoint, 1))});
+        }
+    }
+    const qreal devicePixelRatio = std::max(kMinDevicePixelRatio, pending.key.devicePixelRatioMilli / 1000.0);
+    if (options.glyphRuns) {
+        const GlyphRun run = shapeGlyphRun(
+            text,
+            font,
+            finished.widthEstimate,
+            pending.key.devicePixelRatioMilli,
+            glyphPaddingPx(options));
+        finished.glyphs = run.placements;
+        finished.glyphImages = rasterizeUnsentGlyphs(run, devicePixelRatio, options);
+    } else {
+        finished.image = rasterizeText(text, font, finished.widthEstimate, devicePixelRatio);
+        if (options.distanceField) {
+            finished.image = distanceFieldFromCoverage(finished.image, DanmakuRenderStyle::kDistanceFieldSpreadPx);
+        }
+    }
+    return finished;
+}
+
+DanmakuTextSpriteCache::GlyphRun DanmakuTextSpriteCache::shapeGlyphRun(
+    const QString &text,
+    const QFont &font,
+    int widthEstimate,
+    int devicePixelRatioMilli,
+    qreal paddingPx) {
+    QTextLayout layout(text, font);
+    QTextOption option;
+    option.setWrapMode(QTextOption::NoWrap);
+    layout.setTextOption(option);
+    layout.beginLayout();
+    QTextLine line = layout.createLine();
+    layout.endLayout();
+
+    GlyphRun run;
+    if (!line.isValid()) {
+        return run;
+    }
+    const QPointF origin(
+        (widthEstimate - line.naturalTextWidth()) / 2.0 - paddingPx,
+        (DanmakuRenderStyle::kItemHeightPx - line.height()) / 2.0 - paddingPx);
+    for (const QGlyphRun &glyphRun : line.glyphRuns()) {
+        const QRawFont rawFont = glyphRun.rawFont();
+        const quint32 fontId = glyphFontId(rawFont);
+        const int fontPixelSize = static_cast<int>(std::lround(rawFont.pixelSize()));
+        const QList<quint32> glyphIndexes = glyphRun.glyphIndexes();
+        const QList<QPointF> positions = glyphRun.positions();
+        const qsizetype glyphCount = std::min(glyphIndexes.size(), positions.size());
+        for (qsizetype i = 0; i < glyphCount; ++i) {
+            const QRectF bounds = rawFont.boundingRect(glyphIndexes[i]);
+            if (bounds.isEmpty()) {
+                continue;
+            }
+            const DanmakuGlyphKey key {fontId, glyphIndexes[i], fontPixelSize, devicePixelRatioMilli};
+            run.placements.push_back({key, origin + positions[i] + bounds.topLeft()});
+            const bool shaped = std::any_of(run.glyphs.cbegin(), run.glyphs.cend(), [&key](const ShapedGlyph &glyph) {
+                return glyph.key == key;
+            });
+            if (!shaped) {
+                run.glyphs.push_back({key, rawFont, bounds});
+            }
+        }
+    }
+    return run;
+}
+
+QVector<DanmakuGlyphImage> DanmakuTextSpriteCache::rasterizeUnsentGlyphs(
+    const GlyphRun &run,
+    qreal devicePixelRatio,
+    const RasterOptions &options) {
+    QVector<const ShapedGlyph *> unsent;
+    {
+        QMutexLocker locker(&m_finishedMutex);
+        for (const ShapedGlyph &glyph : run.glyphs) {
+            if (!m_sentGlyphs.contains(glyph.key)) {
+                unsent.push_back(&glyph);
+            }
+        }
+    }
+
+    QVector<DanmakuGlyphImage> images;
+    images.reserve(unsent.size());
+    for (const ShapedGlyph *glyph : std::as_const(unsent)) {
+        QImage image = rasterizeGlyph(*glyph, devicePixelRatio, glyphPaddingPx(options));
+        if (options.distanceField) {
+            image = distanceFieldFromCoverage(image, DanmakuRenderStyle::kDistanceFieldSpreadPx);
+        }
+        const QSizeF logicalSize = QSizeF(image.size()) / image.devicePixelRatio();
+        images.push_back({glyph->key, logicalSize, std::move(image), options.distanceField});
+    }
+    return images;
+}
+
+quint32 DanmakuTextSpriteCache::glyphFontId(const QRawFont &font) {
+    const QString name = font.familyName() + QLatin1Char('/') + font.styleName();
+    QMutexLocker locker(&m_finishedMutex);
+    const auto it = m_glyphFontIds.constFind(name);
+    if (it != m_glyphFontIds.constEnd()) {
+        return it.value();
+    }
+    const quint32 fontId = static_cast<quint32>(m_glyphFontIds.size()) + 1;
+    m_glyphFontIds.insert(name, fontId);
+    return fontId;
+}
+
+int DanmakuTextSpriteCache::ensureWidthEstimate(DanmakuStringId textId, int fontPixelSize, bool *measured) {
     const WidthKey key {
-        text,
+        textId,
         fontPixelSize,
     };
     const auto it = m_widthCache.constFind(key);
     if (it != m_widthCache.constEnd()) {
+        *measured = true;
         return it.value();
     }
 
-    QFont font;
-    font.setPixelSize(fontPixelSize);
-    QFontMetrics metrics(font);
-    const int textWidth = metrics.horizontalAdvance(text);
-    const int paddedWidth = textWidth + DanmakuRenderStyle::kHorizontalPaddingPx * 2;
-    const int widthEstimate = std::max(DanmakuRenderStyle::kMinWidthPx, paddedWidth);
+    if (m_rasterThreadCount > 0) {
+        *measured = false;
+        const auto estimatedIt = m_estimatedWidths.constFind(key);
+        if (estimatedIt != m_estimatedWidths.constEnd()) {
+            return estimatedIt.value();
+        }
+        const int widthEstimate = estimateWidth(m_stringPool->text(textId), fontPixelSize);
+        m_stringPool->retain(textId);
+        m_estimatedWidths.insert(key, widthEstimate);
+        ++m_widthMeasurementCount;
+        return widthEstimate;
+    }
+
+    *measured = true;
+    const int widthEstimate = measureWidth(m_stringPool->text(textId), spriteFont(fontPixelSize, m_fallbackFamilies));
+    m_stringPool->retain(textId);
     m_widthCache.insert(key, widthEstimate);
     ++m_widthMeasurementCount;
     return widthEstimate;
 }
 
-QImage DanmakuTextSpriteCache::rasterizeSprite(
-    const QString &text,
-    int fontPixelSize,
-    int widthEstimate,
-    qreal devicePixelRatio) const {
-    const qreal dpr = std::max(devicePixelRatio, 1.0);
-    const QSize pixelSize(
-        std::max(1, static_cast<int>(std::ceil(widthEstimate * dpr))),
-        std::max(1, static_cast<int>(std::ceil(DanmakuRenderStyle::kItemHeightPx * dpr))));
+void DanmakuTextSpriteCache::applyMeasuredWidth(const SpriteKey &key, DanmakuSpriteId spriteId, int widthEstimate) {
+    const WidthKey widthKey {
+        key.textId,
+        key.fontPixelSize,
+    };
+    const auto estimatedIt = m_estimatedWidths.find(widthKey);
+    if (estimatedIt != m_estimatedWidths.end()) {
+        m_estimatedWidths.erase(estimatedIt);
+        m_widthCache.insert(widthKey, widthEstimate);
+    }
 
-    QImage image(pixelSize, QImage::Format_RGBA8888_Premultiplied);
-    image.setDevicePixelRatio(dpr);
-    image.fill(Qt::transparent);
+    const auto pendingIt = m_pendingRasters.find(key);
+    if (pendingIt == m_pendingRasters.end() || pendingIt->spriteId != spriteId || pendingIt->widthMeasured) {
+        return;
+    }
+    if (pendingIt->widthEstimate != widthEstimate) {
+        m_widthRefinements.push_back({spriteId, widthEstimate});
+    }
+    pendingIt->widthEstimate = widthEstimate;
+    pendingIt->widthMeasured = true;
+}
 
-    QPainter painter(&image);
-    painter.setRenderHint(QPainter::TextAntialiasing, true);
-    QFont font;
-    font.setPixelSize(fontPixelSize);
-    painter.setFont(font);
-    painter.setPen(QColor(Qt::white));
-    painter.drawText(
-        QRectF(
-            0.0,
-            0.0,
-            static_cast<qreal>(widthEstimate),
-            static_cast<qreal>(DanmakuRenderStyle::kItemHeightPx)),
-        Qt::AlignVCenter | Qt::AlignHCenter,
-        text);
-    return image;
+DanmakuSpriteUpload DanmakuTextSpriteCache::rasterizeUpload(const QString &text, const PendingRaster &pending) {
+    const qreal devicePixelRatio = std::max(kMinDevicePixelRatio, pending.key.devicePixelRatioMilli / 1000.0);
+    const QFont font = spriteFont(pending.key.fontPixelSize, m_fallbackFamilies);
+    const RasterOptions options = rasterOptions();
+    DanmakuSpriteUpload upload;
+    upload.spriteId = pending.spriteId;
+    upload.logicalSize = QSize(pending.widthEstimate, DanmakuRenderStyle::kItemHeightPx);
+    if (!options.glyphRuns) {
+        upload.image = rasterizeText(text, font, pending.widthEstimate, devicePixelRatio);
+        if (options.distanceField) {
+            upload.image = distanceFieldFromCoverage(upload.image, DanmakuRenderStyle::kDistanceFieldSpreadPx);
+            upload.distanceField = true;
+        }
+        return upload;
+    }
+
+    const GlyphRun run = shapeGlyphRun(
+        text,
+        font,
+        pending.widthEstimate,
+        pending.key.devicePixelRatioMilli,
+        glyphPaddingPx(options));
+    upload.glyphs = run.placements;
+    QVector<DanmakuGlyphImage> glyphImages = rasterizeUnsentGlyphs(run, devicePixelRatio, options);
+    {
+        QMutexLocker locker(&m_finishedMutex);
+        for (const DanmakuGlyphImage &glyph : std::as_const(glyphImages)) {
+            m_sentGlyphs.insert(glyph.key);
+        }
+    }
+    queueReadyGlyphImages(glyphImages);
+    return upload;
+}
+
+void DanmakuTextSpriteCache::queueReadyGlyphImages(QVector<DanmakuGlyphImage> &glyphImages) {
+    for (DanmakuGlyphImage &glyph : glyphImages) {
+        const DanmakuGlyphKey key = glyph.key;
+        m_readyGlyphImages.insert(key, std::move(glyph));
+    }
+    glyphImages.clear();
+}
+
+qint64 DanmakuTextSpriteCache::readyGlyphBytes(const QVector<DanmakuGlyphPlacement> &glyphs) const {
+    if (m_readyGlyphImages.isEmpty()) {
+        return 0;
+    }
+    qint64 bytes = 0;
+    QSet<DanmakuGlyphKey> counted;
+    for (const DanmakuGlyphPlacement &placement : glyphs) {
+        const auto readyIt = m_readyGlyphImages.constFind(placement.key);
+        if (readyIt == m_readyGlyphImages.constEnd() || counted.contains(placement.key)) {
+            continue;
+        }
+        counted.insert(placement.key);
+        bytes += static_cast<qint64>(readyIt->image.sizeInBytes());
+    }
+    return bytes;
+}
+
+void DanmakuTextSpriteCache::attachReadyGlyphImages(DanmakuSpriteUpload &upload) {
+    for (const DanmakuGlyphPlacement &placement : std::as_const(upload.glyphs)) {
+        const auto readyIt = m_readyGlyphImages.find(placement.key);
+        if (readyIt == m_readyGlyphImages.end()) {
+            continue;
+        }
+        upload.glyphImages.push_back(std::move(readyIt.value()));
+        m_readyGlyphImages.erase(readyIt);
+    }
+}
+
+void DanmakuTextSpriteCache::dispatchPendingRasters() {
+    while (!m_pendingRasterQueue.isEmpty()) {
+        const PendingRaster pending = m_pendingRasterQueue.dequeue();
+        const auto pendingIt = m_pendingRasters.constFind(pending.key);
+        if (pendingIt == m_pendingRasters.constEnd() || pendingIt->spriteId != pending.spriteId) {
+            continue;
+        }
+
+        const QString text = m_stringPool->text(pending.key.textId);
+        const QStringList families = m_fallbackFamilies;
+        const quint64 generation = m_generation.load(std::memory_order_acquire);
+        m_rasterJobsInFlight.fetch_add(1, std::memory_order_acq_rel);
+        const RasterOptions options = rasterOptions();
+        m_pool.start([this, text, families, pending, generation, options]() {
+            PerfTrace::setThreadName(QStringLiteral("danmaku-sprite-raster"));
+            if (m_generation.load(std::memory_order_acquire) == generation) {
+                FinishedRaster finished = rasterizeOffThread(text, families, pending, generation, options);
+                QMutexLocker locker(&m_finishedMutex);
+                if (m_generation.load(std::memory_order_acquire) == generation) {
+                    for (const DanmakuGlyphImage &glyph : std::as_const(finished.glyphImages)) {
+                        m_sentGlyphs.insert(glyph.key);
+                    }
+                    m_finishedRasters.push_back(std::move(finished));
+                }
+            }
+            m_rasterJobsInFlight.fetch_sub(1, std::memory_order_acq_rel);
+        });
+    }
+}
+
+void DanmakuTextSpriteCache::collectFinishedRasters() {
+    QVector<FinishedRaster> finishedRasters;
+    {
+        QMutexLocker locker(&m_finishedMutex);
+        if (m_finishedRasters.isEmpty()) {
+            return;
+        }
+        finishedRasters.swap(m_finishedRasters);
+    }
+
+    const quint64 generation = m_generation.load(std::memory_order_acquire);
+    for (FinishedRaster &finished : finishedRasters) {
+        if (finished.generation != generation) {
+            continue;
+        }
+        queueReadyGlyphImages(finished.glyphImages);
+        if (finished.widthMeasured) {
+            for (const GlyphAdvance &glyph : finished.advances) {
+                m_glyphAdvances.insert(AdvanceKey {glyph.codepoint, finished.key.fontPixelSize}, glyph.advance);
+            }
+            finished.advances.clear();
+            applyMeasuredWidth(finished.key, finished.spriteId, finished.widthEstimate);
+        }
+        m_readyRasters.enqueue(std::move(finished));
+    }
+}
+
+void DanmakuTextSpriteCache::takeReadyUploads(
+    QVector<DanmakuSpriteUpload> &uploads,
+    int maxSprites,
+    qint64 maxUploadBytes,
+    qint64 &totalUploadBytes) {
+    while (uploads.size() < maxSprites && !m_readyRasters.isEmpty()) {
+        FinishedRaster &ready = m_readyRasters.head();
+        const auto pendingIt = m_pendingRasters.constFind(ready.key);
+        if (pendingIt == m_pendingRasters.constEnd() || pendingIt->spriteId != ready.spriteId) {
+            m_readyRasters.dequeue();
+            continue;
+        }
+
+        const qint64 uploadBytes = static_cast<qint64>(ready.image.sizeInBytes()) + readyGlyphBytes(ready.glyphs);
+        const bool exceedsBudget = maxUploadBytes > 0
+            && !uploads.isEmpty()
+            && totalUploadBytes + uploadBytes > maxUploadBytes;
+        if (exceedsBudget) {
+            break;
+        }
+
+        DanmakuSpriteUpload upload;
+        upload.spriteId = ready.spriteId;
+        upload.logicalSize = QSize(ready.widthEstimate, DanmakuRenderStyle::kItemHeightPx);
+        upload.image = std::move(ready.image);
+        upload.distanceField = m_distanceFieldMode && !upload.image.isNull();
+        upload.glyphs = std::move(ready.glyphs);
+        attachReadyGlyphImages(upload);
+        uploads.push_back(std::move(upload));
+        totalUploadBytes += uploadBytes;
+        m_pendingRasters.erase(pendingIt);
+        m_readyRasters.dequeue();
+    }
 }
 
 size_t qHash(const DanmakuTextSpriteCache::WidthKey &key, size_t seed) noexcept {
-    seed = qHash(key.text, seed);
+    seed = qHash(key.textId, seed);
     return qHash(key.fontPixelSize, seed);
 }
 
 size_t qHash(const DanmakuTextSpriteCache::SpriteKey &key, size_t seed) noexcept {
-    seed = qHash(key.text, seed);
+    seed = qHash(key.textId, seed);
     seed = qHash(key.fontPixelSize, seed);
     return qHash(key.devicePixelRatioMilli, seed);
 }
+
+size_t qHash(const DanmakuTextSpriteCache::AdvanceKey &key, size_t seed) noexcept {
+    seed = qHash(static_cast<uint>(key.codepoint), seed);
+    return qHash(key.fontPixelSize, seed);
+}
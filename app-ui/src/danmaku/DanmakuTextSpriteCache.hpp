@@ -1,46 +1,101 @@
 #pragma once
 
 #include "danmaku/DanmakuRenderFrame.hpp"
+#include "danmaku/DanmakuStringPool.hpp"
 
+#include <QFont>
 #include <QHash>
+#include <QImage>
+#include <QMutex>
 #include <QQueue>
+#include <QRawFont>
+#include <QRectF>
+#include <QSet>
 #include <QString>
+#include <QStringList>
+#include <QThreadPool>
+
+#include <atomic>
 
 class DanmakuTextSpriteCache {
 public:
     struct WidthKey {
-        QString text;
+        DanmakuStringId textId = DanmakuStringPool::kInvalidId;
         int fontPixelSize = 0;
 
         friend bool operator==(const WidthKey &lhs, const WidthKey &rhs) {
-            return lhs.fontPixelSize == rhs.fontPixelSize && lhs.text == rhs.text;
+            return lhs.textId == rhs.textId && lhs.fontPixelSize == rhs.fontPixelSize;
         }
     };
 
     struct SpriteKey {
-        QString text;
+        DanmakuStringId textId = DanmakuStringPool::kInvalidId;
         int fontPixelSize = 0;
         int devicePixelRatioMilli = 1000;
 
         friend bool operator==(const SpriteKey &lhs, const SpriteKey &rhs) {
-            return lhs.fontPixelSize == rhs.fontPixelSize
-                && lhs.devicePixelRatioMilli == rhs.devicePixelRatioMilli
-                && lhs.text == rhs.text;
+            return lhs.textId == rhs.textId
+                && lhs.fontPixelSize == rhs.fontPixelSize
+                && lhs.devicePixelRatioMilli == rhs.devicePixelRatioMilli;
+        }
+    };
+
+    struct AdvanceKey {
+        char32_t codepoint = 0;
+        int fontPixelSize = 0;
+
+        friend bool operator==(const AdvanceKey &lhs, const AdvanceKey &rhs) {
+            return lhs.codepoint == rhs.codepoint && lhs.fontPixelSize == rhs.fontPixelSize;
         }
     };
 
+    struct WidthRefinement {
+        DanmakuSpriteId spriteId = 0;
+        int widthEstimate = 0;
+    };
+
     struct EnsureResult {
         DanmakuSpriteId spriteId = 0;
         int widthEstimate = 0;
+        bool widthMeasured = true;
         bool queuedRaster = false;
     };
 
-    DanmakuTextSpriteCache() = default;
+    static constexpr qreal kMinDevicePixelRatio = 0.5;
+    static constexpr int kMaxRasterThreads = 8;
+
+    static int rasterThreadCountFromEnvironment();
+    static bool glyphRunModeFromEnvironment();
+    static bool distanceFieldModeFromEnvironment();
+
+    explicit DanmakuTextSpriteCache(DanmakuStringPool *stringPool = nullptr);
+    ~DanmakuTextSpriteCache();
+
+    DanmakuTextSpriteCache(const DanmakuTextSpriteCache &) = delete;
+    DanmakuTextSpriteCache &operator=(const DanmakuTextSpriteCache &) = delete;
+
+    static QFont spriteFont(int fontPixelSize, const QStringList &fallbackFamilies);
+    static int measureWidth(const QString &text, const QFont &font);
+    static QImage rasterizeText(const QString &text, const QFont &font, int widthEstimate, qreal devicePixelRatio);
+    static QImage distanceFieldFromCoverage(const QImage &coverage, int spreadPx);
 
     void clear();
+    void setFallbackFamilies(const QStringList &families);
+    void setRasterThreadCount(int threadCount);
+    int rasterThreadCount() const;
+    void setGlyphRunMode(bool enabled);
+    bool glyphRunMode() const;
+    void setDistanceFieldMode(bool enabled);
+    bool distanceFieldMode() const;
+    int estimateWidth(const QString &text, int fontPixelSize) const;
+    EnsureResult ensureSprite(DanmakuStringId textId, int fontPixelSize, qreal devicePixelRatio);
     EnsureResult ensureSprite(const QString &text, int fontPixelSize, qreal devicePixelRatio);
     DanmakuSpriteUpload takePendingUpload(const QString &text, int fontPixelSize, qreal devicePixelRatio);
     QVector<DanmakuSpriteUpload> rasterizePendingSprites(int maxSprites, qint64 maxUploadBytes);
+    QVector<WidthRefinement> takeWidthRefinements();
+    int pendingRasterCount() const;
+    int rasterJobsInFlight() const;
+    bool waitForRasterJobs(int timeoutMs = -1);
     int widthMeasurementCountForTesting() const;
     int pendingRasterCountForTesting() const;
 
@@ -49,18 +104,106 @@ private:
         SpriteKey key;
         DanmakuSpriteId spriteId = 0;
         int widthEstimate = 0;
+        bool widthMeasured = true;
     };
 
-    int ensureWidthEstimate(const QString &text, int fontPixelSize);
-    QImage rasterizeSprite(const QString &text, int fontPixelSize, int widthEstimate, qreal devicePixelRatio) const;
+    struct GlyphAdvance {
+        char32_t codepoint = 0;
+        qreal advance = 0.0;
+    };
 
+    struct RasterOptions {
+        bool glyphRuns = false;
+        bool distanceField = false;
+    };
+
+    struct ShapedGlyph {
+        DanmakuGlyphKey key;
+        QRawFont font;
+        QRectF bounds;
+    };
+
+    struct GlyphRun {
+        QVector<DanmakuGlyphPlacement> placements;
+        QVector<ShapedGlyph> glyphs;
+    };
+
+    struct FinishedRaster {
+        SpriteKey key;
+        DanmakuSpriteId spriteId = 0;
+        quint64 generation = 0;
+        int widthEstimate = 0;
+        bool widthMeasured = false;
+        QImage image;
+        QVector<GlyphAdvance> advances;
+        QVector<DanmakuGlyphPlacement> glyphs;
+        QVector<DanmakuGlyphImage> glyphImages;
+    };
+
+    static int devicePixelRatioMilli(qreal devicePixelRatio);
+    static qreal glyphPaddingPx(const RasterOptions &options);
+    static QImage rasterizeGlyph(const ShapedGlyph &glyph, qreal devicePixelRatio, qreal paddingPx);
+    int spriteDevicePixelRatioMilli(qreal devicePixelRatio) const;
+    RasterOptions rasterOptions() const;
+    FinishedRaster rasterizeOffThread(
+        const QString &text,
+        const QStringList &fallbackFamilies,
+        const PendingRaster &pending,
+        quint64 generation,
+        const RasterOptions &options);
+    GlyphRun shapeGlyphRun(
+        const QString &text,
+        const QFont &font,
+        int widthEstimate,
+        int devicePixelRatioMilli,
+        qreal paddingPx);
+    QVector<DanmakuGlyphImage> rasterizeUnsentGlyphs(
+        const GlyphRun &run,
+        qreal devicePixelRatio,
+        const RasterOptions &options);
+    quint32 glyphFontId(const QRawFont &font);
+    int ensureWidthEstimate(DanmakuStringId textId, int fontPixelSize, bool *measured);
+    void applyMeasuredWidth(const SpriteKey &key, DanmakuSpriteId spriteId, int widthEstimate);
+    DanmakuSpriteUpload rasterizeUpload(const QString &text, const PendingRaster &pending);
+    void queueReadyGlyphImages(QVector<DanmakuGlyphImage> &glyphImages);
+    qint64 readyGlyphBytes(const QVector<DanmakuGlyphPlacement> &glyphs) const;
+    void attachReadyGlyphImages(DanmakuSpriteUpload &upload);
+    void dispatchPendingRasters();
+    void collectFinishedRasters();
+    void takeReadyUploads(
+        QVector<DanmakuSpriteUpload> &uploads,
+        int maxSprites,
+        qint64 maxUploadBytes,
+        qint64 &totalUploadBytes);
+
+    QStringList m_fallbackFamilies;
+
+    DanmakuStringPool m_ownedStringPool;
+    DanmakuStringPool *m_stringPool = nullptr;
     QHash<WidthKey, int> m_widthCache;
     QHash<SpriteKey, DanmakuSpriteId> m_spriteIds;
     QHash<SpriteKey, PendingRaster> m_pendingRasters;
     QQueue<PendingRaster> m_pendingRasterQueue;
+    QHash<WidthKey, int> m_estimatedWidths;
+    QHash<AdvanceKey, qreal> m_glyphAdvances;
+    QVector<WidthRefinement> m_widthRefinements;
+    QQueue<FinishedRaster> m_readyRasters;
+    QHash<DanmakuGlyphKey, DanmakuGlyphImage> m_readyGlyphImages;
     quint32 m_nextSpriteId = 1;
     int m_widthMeasurementCount = 0;
+    int m_rasterThreadCount = 0;
+    bool m_glyphRunMode = false;
+    bool m_distanceFieldMode = false;
+
+    QThreadPool m_pool;
+    QMutex m_finishedMutex;
+    QVector<FinishedRaster> m_finishedRasters;
+    QSet<DanmakuGlyphKey> m_sentGlyphs;
+    QHash<QString, quint32> m_glyphFontIds;
+    std::atomic<quint64> m_generation {0};
+    std::atomic<int> m_rasterJobsInFlight {0};
 };
 
 size_t qHash(const DanmakuTextSpriteCache::WidthKey &key, size_t seed = 0) noexcept;
 size_t qHash(const DanmakuTextSpriteCache::SpriteKey &key, size_t seed = 0) noexcept;
+size_t qHash(const DanmakuTextSpriteCache::AdvanceKey &key, size_t seed = 0) noexcept;
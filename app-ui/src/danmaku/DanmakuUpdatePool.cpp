@@ -0,0 +1,187 @@
+#include "danmaku/DanmakuUpdatePool.hpp"
+
+#include "perf/PerfTrace.hpp"
+
+#include <QThread>
+
+#include <algorithm>
+
+int DanmakuUpdatePool::threadCountFromEnvironment() {
+    bool ok = false;
+    const int configured = qEnvironmentVariableIntValue("NICONEON_DANMAKU_UPDATE_THREADS", &ok);
+    if (ok && configured > 0) {
+        return std::min(configured, kMaxThreads);
+    }
+    return std::clamp(QThread::idealThreadCount() / 2, 1, 4);
+}
+
+int DanmakuUpdatePool::parallelMinRowsFromEnvironment() {
+    bool ok = false;
+    const int configured = qEnvironmentVariableIntValue("NICONEON_DANMAKU_PARALLEL_MIN_ROWS", &ok);
+    return ok && configured > 0 ? configured : kDefaultParallelMinRows;
+}
+
+DanmakuUpdatePool::DanmakuUpdatePool(int threadCount, int parallelMinRows, int chunkRows)
+    : m_threadCount(std::clamp(threadCount, 1, kMaxThreads)),
+      m_parallelMinRows(std::max(parallelMinRows, 1)),
+      m_chunkRows(std::max(chunkRows, 1)),
+      m_participants(new Participant[static_cast<size_t>(m_threadCount)]),
+      m_startSignals(new QSemaphore[static_cast<size_t>(m_threadCount)]) {
+}
+
+DanmakuUpdatePool::~DanmakuUpdatePool() {
+    m_stopping.store(true, std::memory_order_release);
+    for (int participant = 1; participant <= static_cast<int>(m_helpers.size()); ++participant) {
+        m_startSignals[participant].release();
+    }
+    for (const std::unique_ptr<QThread> &helper : m_helpers) {
+        helper->wait();
+    }
+}
+
+int DanmakuUpdatePool::threadCount() const {
+    return m_threadCount;
+}
+
+int DanmakuUpdatePool::parallelMinRows() const {
+    return m_parallelMinRows;
+}
+
+int DanmakuUpdatePool::chunkRows() const {
+    return m_chunkRows;
+}
+
+int DanmakuUpdatePool::startedHelperCount() const {
+    return static_cast<int>(m_helpers.size());
+}
+
+void DanmakuUpdatePool::updateFused(
+    DanmakuSoAState &state,
+    const DanmakuFusedUpdateParams &params,
+    DanmakuFusedUpdateResult &result,
+    DanmakuSimdMode mode) {
+    const int rowCount = DanmakuSimdUpdater::fusedRowCount(state);
+    if (m_threadCount <= 1 || rowCount < m_parallelMinRows) {
+        DanmakuSimdUpdater::updateFused(state, params, result, mode);
+        m_serialFrameCount.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    const PerfTraceSpan span("DanmakuUpdatePool::updateFused");
+    if (m_helpers.empty()) {
+        startHelpers();
+    }
+    const qint64 startNs = PerfTrace::nowNs();
+    const int chunkCount = (rowCount + m_chunkRows - 1) / m_chunkRows;
+    if (m_chunkResults.size() < chunkCount) {
+        m_chunkResults.resize(chunkCount);
+    }
+    for (int participant = 0; participant < m_threadCount; ++participant) {
+        Participant &slice = m_participants[participant];
+        slice.nextChunk.store(chunkCount * participant / m_threadCount, std::memory_order_relaxed);
+        slice.endChunk = chunkCount * (participant + 1) / m_threadCount;
+        slice.busyNs = 0;
+        slice.stolen = 0;
+    }
+    m_state = &state;
+    m_params = &params;
+    m_mode = DanmakuSimdUpdater::resolveMode(mode);
+    m_rowCount = rowCount;
+    m_chunkResultData = m_chunkResults.data();
+
+    for (int participant = 1; participant < m_threadCount; ++participant) {
+        m_startSignals[participant].release();
+    }
+    runChunks(0);
+    m_doneSignal.acquire(m_threadCount - 1);
+
+    mergeChunkResults(chunkCount, result);
+
+    qint64 busyNs = 0;
+    int stolen = 0;
+    for (int participant = 0; participant < m_threadCount; ++participant) {
+        busyNs += m_participants[participant].busyNs;
+        stolen += m_participants[participant].stolen;
+    }
+    m_parallelFrameCount.fetch_add(1, std::memory_order_relaxed);
+    m_chunkCount.fetch_add(static_cast<quint64>(chunkCount), std::memory_order_relaxed);
+    m_stolenChunkCount.fetch_add(static_cast<quint64>(stolen), std::memory_order_relaxed);
+    m_busyNs.fetch_add(busyNs, std::memory_order_relaxed);
+    m_wallNs.fetch_add(PerfTrace::nowNs() - startNs, std::memory_order_relaxed);
+}
+
+DanmakuUpdatePool::Counters DanmakuUpdatePool::takeCounters() {
+    Counters counters;
+    counters.parallelFrames = m_parallelFrameCount.exchange(0, std::memory_order_relaxed);
+    counters.serialFrames = m_serialFrameCount.exchange(0, std::memory_order_relaxed);
+    counters.chunks = m_chunkCount.exchange(0, std::memory_order_relaxed);
+    counters.stolenChunks = m_stolenChunkCount.exchange(0, std::memory_order_relaxed);
+    counters.busyNs = m_busyNs.exchange(0, std::memory_order_relaxed);
+    counters.wallNs = m_wallNs.exchange(0, std::memory_order_relaxed);
+    return counters;
+}
+
+void DanmakuUpdatePool::startHelpers() {
+    m_helpers.reserve(static_cast<size_t>(m_threadCount - 1));
+    for (int participant = 1; participant < m_threadCount; ++participant) {
+        std::unique_ptr<QThread> helper(QThread::create([this, participant]() { helperLoop(participant); }));
+        helper->setObjectName(QStringLiteral("danmaku-update-%1").arg(participant));
+        helper->start();
+        m_helpers.push_back(std::move(helper));
+    }
+}
+
+void DanmakuUpdatePool::helperLoop(int participant) {
+    while (true) {
+        m_startSignals[participant].acquire();
+        if (m_stopping.load(std::memory_order_acquire)) {
+            return;
+        }
+        runChunks(participant);
+        m_doneSignal.release();
+    }
+}
+
+void DanmakuUpdatePool::runChunks(int participant) {
+    Participant &self = m_participants[participant];
+    const qint64 startNs = PerfTrace::nowNs();
+    for (int offset = 0; offset < m_threadCount; ++offset) {
+        const int owner = (participant + offset) % m_threadCount;
+        Participant &slice = m_participants[owner];
+        for (int chunk = slice.nextChunk.fetch_add(1, std::memory_order_relaxed); chunk < slice.endChunk;
+             chunk = slice.nextChunk.fetch_add(1, std::memory_order_relaxed)) {
+            const int begin = chunk * m_chunkRows;
+            const int end = std::min(begin + m_chunkRows, m_rowCount);
+            DanmakuSimdUpdater::updateFusedRange(*m_state, begin, end, *m_params, m_chunkResultData[chunk], m_mode);
+            if (owner != participant) {
+                ++self.stolen;
+            }
+        }
+    }
+    self.busyNs += PerfTrace::nowNs() - startNs;
+}
+
+void DanmakuUpdatePool::mergeChunkResults(int chunkCount, DanmakuFusedUpdateResult &result) {
+    int changedCount = 0;
+    int removedCount = 0;
+    for (int chunk = 0; chunk < chunkCount; ++chunk) {
+        changedCount += m_chunkResults[chunk].changedCount;
+        removedCount += m_chunkResults[chunk].removedCount;
+    }
+    if (result.changedIndices.size() < changedCount) {
+        result.changedIndices.resize(changedCount);
+    }
+    if (result.removedIndices.size() < removedCount) {
+        result.removedIndices.resize(removedCount);
+    }
+    result.changedCount = changedCount;
+    result.removedCount = removedCount;
+
+    int *changed = result.changedIndices.data();
+    int *removed = result.removedIndices.data();
+    for (int chunk = 0; chunk < chunkCount; ++chunk) {
+        const DanmakuFusedUpdateResult &chunkResult = m_chunkResults[chunk];
+        changed = std::copy_n(chunkResult.changedIndices.cbegin(), chunkResult.changedCount, changed);
+        removed = std::copy_n(chunkResult.removedIndices.cbegin(), chunkResult.removedCount, removed);
+    }
+}
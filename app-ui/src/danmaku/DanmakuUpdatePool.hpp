@@ -0,0 +1,90 @@
+#pragma once
+
+#include "danmaku/DanmakuSimdUpdater.hpp"
+#include "danmaku/DanmakuSoAState.hpp"
+
+#include <QSemaphore>
+#include <QVector>
+#include <QtGlobal>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+class QThread;
+
+class DanmakuUpdatePool {
+public:
+    struct Counters {
+        quint64 parallelFrames = 0;
+        quint64 serialFrames = 0;
+        quint64 chunks = 0;
+        quint64 stolenChunks = 0;
+        qint64 busyNs = 0;
+        qint64 wallNs = 0;
+    };
+
+    static constexpr int kDefaultChunkRows = 4096;
+    static constexpr int kDefaultParallelMinRows = 32768;
+    static constexpr int kMaxThreads = 16;
+
+    static int threadCountFromEnvironment();
+    static int parallelMinRowsFromEnvironment();
+
+    explicit DanmakuUpdatePool(
+        int threadCount,
+        int parallelMinRows = kDefaultParallelMinRows,
+        int chunkRows = kDefaultChunkRows);
+    ~DanmakuUpdatePool();
+
+    DanmakuUpdatePool(const DanmakuUpdatePool &) = delete;
+    DanmakuUpdatePool &operator=(const DanmakuUpdatePool &) = delete;
+
+    int threadCount() const;
+    int parallelMinRows() const;
+    int chunkRows() const;
+    int startedHelperCount() const;
+
+    void updateFused(
+        DanmakuSoAState &state,
+        const DanmakuFusedUpdateParams &params,
+        DanmakuFusedUpdateResult &result,
+        DanmakuSimdMode mode);
+    Counters takeCounters();
+
+private:
+    struct Participant {
+        alignas(64) std::atomic<int> nextChunk {0};
+        int endChunk = 0;
+        qint64 busyNs = 0;
+        int stolen = 0;
+    };
+
+    void startHelpers();
+    void helperLoop(int participant);
+    void runChunks(int participant);
+    void mergeChunkResults(int chunkCount, DanmakuFusedUpdateResult &result);
+
+    int m_threadCount = 1;
+    int m_parallelMinRows = kDefaultParallelMinRows;
+    int m_chunkRows = kDefaultChunkRows;
+    std::vector<std::unique_ptr<QThread>> m_helpers;
+    std::unique_ptr<Participant[]> m_participants;
+    std::unique_ptr<QSemaphore[]> m_startSignals;
+    QVector<DanmakuFusedUpdateResult> m_chunkResults;
+    QSemaphore m_doneSignal;
+    std::atomic<bool> m_stopping {false};
+
+    DanmakuSoAState *m_state = nullptr;
+    const DanmakuFusedUpdateParams *m_params = nullptr;
+    DanmakuSimdMode m_mode = DanmakuSimdMode::Scalar;
+    int m_rowCount = 0;
+    DanmakuFusedUpdateResult *m_chunkResultData = nullptr;
+
+    std::atomic<quint64> m_parallelFrameCount {0};
+    std::atomic<quint64> m_serialFrameCount {0};
+    std::atomic<quint64> m_chunkCount {0};
+    std::atomic<quint64> m_stolenChunkCount {0};
+    std::atomic<qint64> m_busyNs {0};
+    std::atomic<qint64> m_wallNs {0};
+};
@@ -1,164 +1,170 @@
 #include "danmaku/DanmakuUpdateWorker.hpp"
 
-#include <algorithm>
+#include "perf/PerfTrace.hpp"
 
-DanmakuUpdateWorker::DanmakuUpdateWorker(QObject *parent) : QObject(parent) {}
+#include <QThread>
+
+DanmakuUpdateWorker::DanmakuUpdateWorker(DanmakuWorkerChannel *channel, QObject *parent)
+    : QObject(parent), m_channel(channel) {}
 
 void DanmakuUpdateWorker::setSimdMode(DanmakuSimdMode mode) {
     m_simdMode = mode;
 }
 
-void DanmakuUpdateWorker::syncState(DanmakuWorkerSyncBatchPtr batch) {
-    if (batch.isNull()) {
+void DanmakuUpdateWorker::setUpdatePool(DanmakuUpdatePool *pool) {
+    m_pool = pool;
+}
+
+void DanmakuUpdateWorker::run() {
+    if (!m_channel) {
         return;
     }
+    do {
+        m_channel->waitForCommands();
+    } while (drainCommands());
+    thread()->quit();
+}
 
-    if (batch->fullReset) {
-        clearState();
-    }
-    if (!batch->removeRows.isEmpty()) {
-        removeRows(batch->removeRows);
-    }
-    if (!batch->upsertRows.isEmpty()) {
-        upsertRows(batch->upsertRows);
+bool DanmakuUpdateWorker::drainCommands() {
+    if (!m_channel) {
+        return false;
+    }
+
+    DanmakuWorkerCommand command;
+    while (m_channel->tryPop(command)) {
+        switch (command.type) {
+        case DanmakuWorkerCommandType::Upsert:
+            upsertRow(command.row);
+            break;
+        case DanmakuWorkerCommandType::Remove:
+            removeHandle(command.row.handle);
+            break;
+        case DanmakuWorkerCommandType::FullReset:
+            loadFullState(m_channel->takeFullState());
+            break;
+        case DanmakuWorkerCommandType::Frame:
+            processFrame(command.frame);
+            break;
+        case DanmakuWorkerCommandType::Quit:
+            return false;
+        }
     }
+    return true;
 }
 
-void DanmakuUpdateWorker::processFrame(DanmakuWorkerFramePtr frame) {
-    if (frame.isNull()) {
-        emit frameProcessed({});
-        return;
-    }
+void DanmakuUpdateWorker::processFrame(const DanmakuWorkerFrameRequest &request) {
+    const PerfTraceSpan span("DanmakuUpdateWorker::processFrame");
+    DanmakuWorkerFrameColumns &columns = m_channel->beginFrame();
+    columns.seq = request.seq;
+    columns.generation = request.generation;
+    columns.targetNs = request.targetNs;
+    columns.travel = 0.0;
 
-    QVector<int> &rows = m_state.rows;
-    QVector<qreal> &x = m_state.x;
-    QVector<qreal> &y = m_state.y;
-    QVector<qreal> &speed = m_state.speed;
-    QVector<qreal> &alpha = m_state.alpha;
-    QVector<int> &widthEstimate = m_state.widthEstimate;
-    QVector<int> &fadeRemainingMs = m_state.fadeRemainingMs;
-    QVector<quint8> &flags = m_state.flags;
-    QVector<DanmakuWorkerRowState> &changedRows = frame->changedRows;
-    QVector<int> &removeRowsOut = frame->removeRows;
-    changedRows.clear();
-    removeRowsOut.clear();
-
-    const int count = rows.size();
+    const int count = m_state.size();
     if (count <= 0
-        || x.size() != count
-        || y.size() != count
-        || speed.size() != count
-        || alpha.size() != count
-        || widthEstimate.size() != count
-        || fadeRemainingMs.size() != count
-        || flags.size() != count) {
-        emit frameProcessed(frame);
+        || m_state.x.size() != count
+        || m_state.y.size() != count
+        || m_state.speed.size() != count
+        || m_state.alpha.size() != count
+        || m_state.widthEstimate.size() != count
+        || m_state.fadeRemainingMs.size() != count
+        || m_state.flags.size() != count) {
+        m_channel->publishFrame();
         return;
     }
 
-    if (m_movableMask.size() != count) {
-        m_movableMask.resize(count);
+    DanmakuFusedUpdateParams params;
+    params.paused = request.playbackPaused;
+    params.anyFading = m_fadingCount > 0;
+    params.anyDragging = m_draggingCount > 0;
+    params.movementFactor = static_cast<float>((request.elapsedMs / 1000.0) * request.playbackRate);
+    params.elapsedMs = request.elapsedMs;
+    columns.travel = params.paused ? 0.0 : params.movementFactor;
+    params.cullThreshold = static_cast<float>(request.cullThreshold);
+    params.viewportHeight = static_cast<float>(request.viewportHeight);
+    params.itemHeight = static_cast<float>(request.itemHeight);
+    if (m_pool) {
+        m_pool->updateFused(m_state, params, m_fusedResult, m_simdMode);
+    } else {
+        DanmakuSimdUpdater::updateFused(m_state, params, m_fusedResult, m_simdMode);
     }
-    if (m_changedMask.size() != count) {
-        m_changedMask.resize(count);
-    }
-    std::fill(m_changedMask.begin(), m_changedMask.end(), 0);
-    for (int i = 0; i < count; ++i) {
-        const bool frozen = (flags[i] & DanmakuSoAFlagFrozen) != 0;
-        m_movableMask[i] = (!frame->playbackPaused && !frozen) ? 1 : 0;
-    }
-
-    const qreal movementFactor = (frame->elapsedMs / 1000.0) * frame->playbackRate;
-    DanmakuSimdUpdater::updatePositions(x, speed, m_movableMask, movementFactor, m_changedMask, m_simdMode);
-    changedRows.reserve(count);
-    removeRowsOut.reserve(count / 4);
-
-    for (int i = 0; i < count; ++i) {
-        const bool fading = (flags[i] & DanmakuSoAFlagFading) != 0;
-        const bool dragging = (flags[i] & DanmakuSoAFlagDragging) != 0;
-
-        if (fading) {
-            fadeRemainingMs[i] -= frame->elapsedMs;
-            if (fadeRemainingMs[i] <= 0) {
-                alpha[i] = 0.0;
-            } else {
-                alpha[i] = std::clamp(fadeRemainingMs[i] / 300.0, 0.0, 1.0);
-            }
-            m_changedMask[i] = 1;
-        }
-
-        const bool outOfHorizontalBounds = x[i] + widthEstimate[i] < frame->cullThreshold;
-        const bool outOfVerticalBounds = y[i] > frame->viewportHeight || y[i] + frame->itemHeight < 0.0;
-        const bool canCull = !dragging && (alpha[i] <= 0.0 || outOfHorizontalBounds || outOfVerticalBounds);
-        if (canCull) {
-            removeRowsOut.push_back(rows[i]);
-            continue;
-        }
 
-        if (m_changedMask[i]) {
-            changedRows.push_back(buildRowStateAt(i));
-        }
+    for (int i = 0; i < m_fusedResult.changedCount; ++i) {
+        const int index = m_fusedResult.changedIndices[i];
+        columns.changedHandles.push_back(m_state.handles[index]);
+        columns.x.push_back(m_state.x[index]);
+        columns.alpha.push_back(m_state.alpha[index]);
+        columns.fadeRemainingMs.push_back(m_state.fadeRemainingMs[index]);
     }
-
-    if (!removeRowsOut.isEmpty()) {
-        removeRows(removeRowsOut);
+    for (int i = 0; i < m_fusedResult.removedCount; ++i) {
+        columns.removedHandles.push_back(m_state.handles[m_fusedResult.removedIndices[i]]);
+    }
+    for (const DanmakuItemHandle handle : columns.removedHandles) {
+        removeHandle(handle);
     }
 
-    emit frameProcessed(frame);
+    m_channel->publishFrame();
 }
 
 void DanmakuUpdateWorker::clearState() {
     m_state.clear();
-    m_rowToIndex.clear();
+    m_handleToIndex.clear();
+    m_fadingCount = 0;
+    m_draggingCount = 0;
 }
 
-void DanmakuUpdateWorker::upsertRows(const QVector<DanmakuWorkerRowState> &rows) {
-    for (const DanmakuWorkerRowState &rowState : rows) {
-        if (rowState.row < 0) {
-            continue;
-        }
+void DanmakuUpdateWorker::loadFullState(const QVector<DanmakuWorkerRowState> &rows) {
+    clearState();
+    m_state.reserve(rows.size());
+    m_handleToIndex.reserve(rows.size());
+    for (const DanmakuWorkerRowState &row : rows) {
+        upsertRow(row);
+    }
+}
 
-        const auto it = m_rowToIndex.constFind(rowState.row);
-        if (it != m_rowToIndex.constEnd()) {
-            const int index = it.value();
-            if (index < 0 || index >= m_state.size()) {
-                continue;
-            }
-            m_state.rows[index] = rowState.row;
-            m_state.x[index] = rowState.x;
-            m_state.y[index] = rowState.y;
-            m_state.speed[index] = rowState.speed;
-            m_state.alpha[index] = rowState.alpha;
-            m_state.widthEstimate[index] = rowState.widthEstimate;
-            m_state.fadeRemainingMs[index] = rowState.fadeRemainingMs;
-            m_state.flags[index] = rowState.flags;
-            continue;
-        }
+void DanmakuUpdateWorker::upsertRow(const DanmakuWorkerRowState &rowState) {
+    if (rowState.handle == DanmakuSlotMap::kInvalidHandle) {
+        return;
+    }
 
-        const int index = m_state.size();
-        m_state.rows.push_back(rowState.row);
-        m_state.x.push_back(rowState.x);
-        m_state.y.push_back(rowState.y);
-        m_state.speed.push_back(rowState.speed);
-        m_state.alpha.push_back(rowState.alpha);
-        m_state.widthEstimate.push_back(rowState.widthEstimate);
-        m_state.fadeRemainingMs.push_back(rowState.fadeRemainingMs);
-        m_state.flags.push_back(rowState.flags);
-        m_rowToIndex.insert(rowState.row, index);
+    const auto it = m_handleToIndex.constFind(rowState.handle);
+    if (it != m_handleToIndex.constEnd()) {
+        const int index = it.value();
+        if (index < 0 || index >= m_state.size()) {
+            return;
+        }
+        countFlags(m_state.flags[index], -1);
+        m_state.handles[index] = rowState.handle;
+        m_state.x[index] = static_cast<float>(rowState.x);
+        m_state.y[index] = static_cast<float>(rowState.y);
+        m_state.speed[index] = static_cast<float>(rowState.speed);
+        m_state.alpha[index] = static_cast<float>(rowState.alpha);
+        m_state.widthEstimate[index] = rowState.widthEstimate;
+        m_state.fadeRemainingMs[index] = rowState.fadeRemainingMs;
+        m_state.flags[index] = rowState.flags;
+        countFlags(rowState.flags, 1);
+        return;
     }
+
+    const int index = m_state.size();
+    m_state.handles.push_back(rowState.handle);
+    m_state.x.push_back(static_cast<float>(rowState.x));
+    m_state.y.push_back(static_cast<float>(rowState.y));
+    m_state.speed.push_back(static_cast<float>(rowState.speed));
+    m_state.alpha.push_back(static_cast<float>(rowState.alpha));
+    m_state.widthEstimate.push_back(rowState.widthEstimate);
+    m_state.fadeRemainingMs.push_back(rowState.fadeRemainingMs);
+    m_state.flags.push_back(rowState.flags);
+    m_handleToIndex.insert(rowState.handle, index);
+    countFlags(rowState.flags, 1);
 }
 
-void DanmakuUpdateWorker::removeRows(const QVector<int> &rows) {
-    QVector<int> uniqueRows = rows;
-    std::sort(uniqueRows.begin(), uniqueRows.end());
-    uniqueRows.erase(std::unique(uniqueRows.begin(), uniqueRows.end()), uniqueRows.end());
-    for (auto it = uniqueRows.crbegin(); it != uniqueRows.crend(); ++it) {
-        const auto rowIt = m_rowToIndex.constFind(*it);
-        if (rowIt == m_rowToIndex.constEnd()) {
-            continue;
-        }
-        removeIndex(rowIt.value());
+void DanmakuUpdateWorker::removeHandle(DanmakuItemHandle handle) {
+    const auto it = m_handleToIndex.constFind(handle);
+    if (it == m_handleToIndex.constEnd()) {
+        return;
     }
+    removeIndex(it.value());
 }
 
 void DanmakuUpdateWorker::removeIndex(int index) {
@@ -167,10 +173,11 @@ void DanmakuUpdateWorker::removeIndex(int index) {
     }
 
     const int lastIndex = m_state.size() - 1;
-    const int removedRow = m_state.rows[index];
+    const DanmakuItemHandle removedHandle = m_state.handles[index];
+    countFlags(m_state.flags[index], -1);
     if (index != lastIndex) {
-        const int movedRow = m_state.rows[lastIndex];
-        m_state.rows[index] = m_state.rows[lastIndex];
+        const DanmakuItemHandle movedHandle = m_state.handles[lastIndex];
+        m_state.handles[index] = movedHandle;
         m_state.x[index] = m_state.x[lastIndex];
         m_state.y[index] = m_state.y[lastIndex];
         m_state.speed[index] = m_state.speed[lastIndex];
@@ -178,10 +185,10 @@ void DanmakuUpdateWorker::removeIndex(int index) {
         m_state.widthEstimate[index] = m_state.widthEstimate[lastIndex];
         m_state.fadeRemainingMs[index] = m_state.fadeRemainingMs[lastIndex];
         m_state.flags[index] = m_state.flags[lastIndex];
-        m_rowToIndex.insert(movedRow, index);
+        m_handleToIndex.insert(movedHandle, index);
     }
 
-    m_state.rows.removeLast();
+    m_state.handles.removeLast();
     m_state.x.removeLast();
     m_state.y.removeLast();
     m_state.speed.removeLast();
@@ -189,22 +196,14 @@ void DanmakuUpdateWorker::removeIndex(int index) {
     m_state.widthEstimate.removeLast();
     m_state.fadeRemainingMs.removeLast();
     m_state.flags.removeLast();
-    m_rowToIndex.remove(removedRow);
+    m_handleToIndex.remove(removedHandle);
 }
 
-DanmakuWorkerRowState DanmakuUpdateWorker::buildRowStateAt(int index) const {
-    DanmakuWorkerRowState rowState;
-    if (index < 0 || index >= m_state.size()) {
-        return rowState;
-    }
-
-    rowState.row = m_state.rows[index];
-    rowState.x = m_state.x[index];
-    rowState.y = m_state.y[index];
-    rowState.speed = m_state.speed[index];
-    rowState.alpha = m_state.alpha[index];
-    rowState.widthEstimate = m_state.widthEstimate[index];
-    rowState.fadeRemainingMs = m_state.fadeRemainingMs[index];
-    rowState.flags = m_state.flags[index];
-    return rowState;
+void DanmakuUpdateWorker::countFlags(quint8 flags, int delta) {
+    if ((flags & DanmakuSoAFlagFading) != 0) {
+        m_fadingCount += delta;
+    }
+    if ((flags & DanmakuSoAFlagDragging) != 0) {
+        m_draggingCount += delta;
+    }
 }
@@ -2,37 +2,41 @@
 
 #include "danmaku/DanmakuSimdUpdater.hpp"
 #include "danmaku/DanmakuSoAState.hpp"
+#include "danmaku/DanmakuUpdatePool.hpp"
+#include "danmaku/DanmakuWorkerChannel.hpp"
 
 #include <QHash>
 #include <QObject>
-#include <QVector>
 #include <QtGlobal>
 
 class DanmakuUpdateWorker : public QObject {
     Q_OBJECT
 
 public:
-    explicit DanmakuUpdateWorker(QObject *parent = nullptr);
+    explicit DanmakuUpdateWorker(DanmakuWorkerChannel *channel, QObject *parent = nullptr);
 
     void setSimdMode(DanmakuSimdMode mode);
+    void setUpdatePool(DanmakuUpdatePool *pool);
+    bool drainCommands();
 
 public slots:
-    void syncState(DanmakuWorkerSyncBatchPtr batch);
-    void processFrame(DanmakuWorkerFramePtr frame);
-
-signals:
-    void frameProcessed(DanmakuWorkerFramePtr frame);
+    void run();
 
 private:
     void clearState();
-    void upsertRows(const QVector<DanmakuWorkerRowState> &rows);
-    void removeRows(const QVector<int> &rows);
+    void loadFullState(const QVector<DanmakuWorkerRowState> &rows);
+    void upsertRow(const DanmakuWorkerRowState &rowState);
+    void removeHandle(DanmakuItemHandle handle);
     void removeIndex(int index);
-    DanmakuWorkerRowState buildRowStateAt(int index) const;
+    void countFlags(quint8 flags, int delta);
+    void processFrame(const DanmakuWorkerFrameRequest &request);
 
+    DanmakuWorkerChannel *m_channel = nullptr;
+    DanmakuUpdatePool *m_pool = nullptr;
     DanmakuSoAState m_state;
-    QHash<int, int> m_rowToIndex;
-    QVector<quint8> m_movableMask;
-    QVector<quint8> m_changedMask;
+    QHash<DanmakuItemHandle, int> m_handleToIndex;
+    DanmakuFusedUpdateResult m_fusedResult;
+    int m_fadingCount = 0;
+    int m_draggingCount = 0;
     DanmakuSimdMode m_simdMode = DanmakuSimdMode::Scalar;
 };
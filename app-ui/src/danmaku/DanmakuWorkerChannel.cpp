@@ -0,0 +1,102 @@
+#include "danmaku/DanmakuWorkerChannel.hpp"
+
+#include <QThread>
+
+#include <algorithm>
+#include <utility>
+
+int DanmakuWorkerChannel::pipelineDepthFromEnvironment() {
+    bool ok = false;
+    const int configured = qEnvironmentVariableIntValue("NICONEON_DANMAKU_WORKER_PIPELINE", &ok);
+    return ok && configured > 0 ? std::min(configured, kFrameSlots) : kFrameSlots;
+}
+
+DanmakuWorkerChannel::DanmakuWorkerChannel(int commandCapacity) : m_commands(commandCapacity) {}
+
+void DanmakuWorkerChannel::push(const DanmakuWorkerCommand &command) {
+    if (!m_commands.tryPush(command)) {
+        m_ringStallCount.fetch_add(1, std::memory_order_relaxed);
+        do {
+            wake();
+            QThread::yieldCurrentThread();
+        } while (!m_commands.tryPush(command));
+    }
+    m_commandCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+void DanmakuWorkerChannel::pushFullState(QVector<DanmakuWorkerRowState> rows) {
+    {
+        const QMutexLocker locker(&m_fullStateMutex);
+        m_fullStates.enqueue(std::move(rows));
+    }
+    DanmakuWorkerCommand reset;
+    reset.type = DanmakuWorkerCommandType::FullReset;
+    push(reset);
+}
+
+void DanmakuWorkerChannel::wake() {
+    m_wakeups.release();
+}
+
+const DanmakuWorkerFrameColumns *DanmakuWorkerChannel::acquireFrame() const {
+    if (m_publishedFrames.load(std::memory_order_acquire) <= m_acquiredFrames) {
+        return nullptr;
+    }
+    return &m_frames[static_cast<int>(m_acquiredFrames % kFrameSlots)];
+}
+
+void DanmakuWorkerChannel::releaseFrame() {
+    if (m_publishedFrames.load(std::memory_order_acquire) <= m_acquiredFrames) {
+        return;
+    }
+    ++m_acquiredFrames;
+    m_releasedFrames.store(m_acquiredFrames, std::memory_order_release);
+}
+
+int DanmakuWorkerChannel::pendingFrames() const {
+    return static_cast<int>(m_publishedFrames.load(std::memory_order_acquire) - m_acquiredFrames);
+}
+
+bool DanmakuWorkerChannel::tryPop(DanmakuWorkerCommand &command) {
+    return m_commands.tryPop(command);
+}
+
+QVector<DanmakuWorkerRowState> DanmakuWorkerChannel::takeFullState() {
+    const QMutexLocker locker(&m_fullStateMutex);
+    return m_fullStates.isEmpty() ? QVector<DanmakuWorkerRowState>() : m_fullStates.dequeue();
+}
+
+void DanmakuWorkerChannel::waitForCommands() {
+    m_wakeups.acquire();
+    const int pending = m_wakeups.available();
+    if (pending > 0) {
+        m_wakeups.tryAcquire(pending);
+    }
+}
+
+DanmakuWorkerFrameColumns &DanmakuWorkerChannel::beginFrame() {
+    while (m_writtenFrames - m_releasedFrames.load(std::memory_order_acquire) >= m_frames.size()) {
+        QThread::yieldCurrentThread();
+    }
+    DanmakuWorkerFrameColumns &frame = m_frames[static_cast<int>(m_writtenFrames % kFrameSlots)];
+    frame.clear();
+    return frame;
+}
+
+void DanmakuWorkerChannel::publishFrame() {
+    ++m_writtenFrames;
+    m_publishedFrames.store(m_writtenFrames, std::memory_order_release);
+    m_publishedCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+int DanmakuWorkerChannel::commandCapacity() const {
+    return m_commands.capacity();
+}
+
+DanmakuWorkerChannel::Counters DanmakuWorkerChannel::takeCounters() {
+    Counters counters;
+    counters.commands = m_commandCount.exchange(0, std::memory_order_relaxed);
+    counters.ringStalls = m_ringStallCount.exchange(0, std::memory_order_relaxed);
+    counters.framesPublished = m_publishedCount.exchange(0, std::memory_order_relaxed);
+    return counters;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "danmaku/DanmakuSoAState.hpp"
+#include "danmaku/DanmakuSpscRing.hpp"
+
+#include <QMutex>
+#include <QQueue>
+#include <QSemaphore>
+#include <QVector>
+
+#include <array>
+#include <atomic>
+
+class DanmakuWorkerChannel {
+public:
+    struct Counters {
+        quint64 commands = 0;
+        quint64 ringStalls = 0;
+        quint64 framesPublished = 0;
+    };
+
+    static constexpr int kDefaultCommandCapacity = 8192;
+    static constexpr int kFrameSlots = 2;
+
+    static int pipelineDepthFromEnvironment();
+
+    explicit DanmakuWorkerChannel(int commandCapacity = kDefaultCommandCapacity);
+
+    void push(const DanmakuWorkerCommand &command);
+    void pushFullState(QVector<DanmakuWorkerRowState> rows);
+    void wake();
+    const DanmakuWorkerFrameColumns *acquireFrame() const;
+    void releaseFrame();
+    int pendingFrames() const;
+
+    bool tryPop(DanmakuWorkerCommand &command);
+    QVector<DanmakuWorkerRowState> takeFullState();
+    void waitForCommands();
+    DanmakuWorkerFrameColumns &beginFrame();
+    void publishFrame();
+
+    int commandCapacity() const;
+    Counters takeCounters();
+
+private:
+    DanmakuSpscRing<DanmakuWorkerCommand> m_commands;
+    QSemaphore m_wakeups;
+    QMutex m_fullStateMutex;
+    QQueue<QVector<DanmakuWorkerRowState>> m_fullStates;
+    std::array<DanmakuWorkerFrameColumns, kFrameSlots> m_frames;
+    std::atomic<quint64> m_publishedFrames {0};
+    std::atomic<quint64> m_releasedFrames {0};
+    quint64 m_acquiredFrames = 0;
+    quint64 m_writtenFrames = 0;
+    std::atomic<quint64> m_commandCount {0};
+    std::atomic<quint64> m_ringStallCount {0};
+    std::atomic<quint64> m_publishedCount {0};
+};
@@ -1,5 +1,7 @@
 #include "ipc/CoreClient.hpp"
 
+#include "perf/PerfTrace.hpp"
+
 #include <QCoreApplication>
 #include <QDebug>
 #include <QDir>
@@ -240,6 +242,7 @@ bool CoreClient::running() const {
 }
 
 void CoreClient::onReadyReadStandardOutput() {
+    const PerfTraceSpan span("CoreClient::readResponses");
     m_stdoutBuffer.append(m_process.readAllStandardOutput());
 
     while (true) {
@@ -270,6 +273,13 @@ void CoreClient::onReadyReadStandardOutput() {
         const PendingRequest pending = pendingIt.value();
         m_pendingRequests.erase(pendingIt);
         const QString method = pending.method;
+        if (pending.sentAtNs > 0) {
+            PerfTrace::recordAsync(
+                method == QStringLiteral("playback_tick_batch") ? "CoreClient::playback_tick_batch" : "CoreClient::request",
+                static_cast<quint64>(id),
+                pending.sentAtNs,
+                PerfTrace::nowNs());
+        }
 
         QVariant result;
         QVariant error;
@@ -362,6 +372,7 @@ qint64 CoreClient::sendRequest(const QString &method, const QVariantMap &params)
     m_pendingRequests.insert(id, PendingRequest {
                                      method,
                                      m_requestGeneration,
+                                     PerfTrace::isEnabled() ? PerfTrace::nowNs() : 0,
                                  });
 
     QJsonObject payload;
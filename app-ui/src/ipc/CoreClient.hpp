@@ -57,6 +57,7 @@ private:
     struct PendingRequest {
         QString method;
         quint64 generation = 0;
+        qint64 sentAtNs = 0;
     };
 
     static QString executableName(const QString &baseName);
@@ -1,5 +1,6 @@
 #include <clocale>
 
+#include <QDebug>
 #include <QGuiApplication>
 #include <QQmlApplicationEngine>
 #include <QQuickWindow>
@@ -10,8 +11,11 @@
 #include "LicenseProvider.hpp"
 #include "danmaku/DanmakuController.hpp"
 #include "danmaku/DanmakuRenderNodeItem.hpp"
+#include "danmaku/DanmakuSessionReplayer.hpp"
 #include "ipc/CoreClient.hpp"
 #include "mpv/MpvItem.hpp"
+#include "perf/PerfMetricsBridge.hpp"
+#include "perf/PerfTrace.hpp"
 
 int main(int argc, char *argv[]) {
     // libmpv requires C numeric locale.
@@ -25,6 +29,31 @@ int main(int argc, char *argv[]) {
     QCoreApplication::setOrganizationDomain(QStringLiteral("github.com"));
     QCoreApplication::setApplicationName(QStringLiteral("Niconeon"));
 
+    const QString tracePath = PerfTrace::outputPathFromEnvironment();
+    if (!tracePath.isEmpty()) {
+        PerfTrace::setEnabled(true);
+        PerfTrace::setThreadName(QStringLiteral("gui"));
+    }
+    const auto writeTrace = [&tracePath]() {
+        if (tracePath.isEmpty()) {
+            return;
+        }
+        PerfTrace::setEnabled(false);
+        if (PerfTrace::writeChromeTrace(tracePath)) {
+            qInfo().noquote() << QString("[perf-trace] written=%1").arg(tracePath);
+        } else {
+            qWarning() << "failed to write trace:" << tracePath;
+        }
+    };
+
+    const QString replayPath = DanmakuSessionReplayer::inputPathFromEnvironment();
+    if (!replayPath.isEmpty()) {
+        const int replayExitCode =
+            DanmakuSessionReplayer::runHeadless(replayPath, DanmakuSessionReplayer::outputPathFromEnvironment());
+        writeTrace();
+        return replayExitCode;
+    }
+
 #if defined(Q_OS_WIN)
     // QQuickFramebufferObject + libmpv rendering is stable on OpenGL backend.
     QQuickWindow::setGraphicsApi(QSGRendererInterface::OpenGL);
@@ -35,6 +64,7 @@ int main(int argc, char *argv[]) {
     qmlRegisterType<DanmakuController>("Niconeon", 1, 0, "DanmakuController");
     qmlRegisterType<DanmakuRenderNodeItem>("Niconeon", 1, 0, "DanmakuRenderNodeItem");
     qmlRegisterType<LicenseProvider>("Niconeon", 1, 0, "LicenseProvider");
+    qmlRegisterType<PerfMetricsBridge>("Niconeon", 1, 0, "PerfMetrics");
 
     QQmlApplicationEngine engine;
     QVariantMap initialProps;
@@ -67,5 +97,7 @@ int main(int argc, char *argv[]) {
     engine.load(QUrl(QStringLiteral("qrc:/qt/qml/Niconeon/Main.qml")));
 #endif
 
-    return app.exec();
+    const int exitCode = app.exec();
+    writeTrace();
+    return exitCode;
 }
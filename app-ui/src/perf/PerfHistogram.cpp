@@ -0,0 +1,95 @@
+#include "perf/PerfHistogram.hpp"
+
+#include <QtAlgorithms>
+
+#include <algorithm>
+#include <cmath>
+
+PerfHistogram::PerfHistogram()
+    : m_counts(kBucketCount, 0) {}
+
+void PerfHistogram::record(qint64 valueUs) {
+    const qint64 value = std::clamp<qint64>(valueUs, 0, kMaxTrackableUs);
+    ++m_counts[bucketIndex(value)];
+    m_min = m_count == 0 ? value : std::min(m_min, value);
+    m_max = m_count == 0 ? value : std::max(m_max, value);
+    ++m_count;
+    m_sum += value;
+}
+
+void PerfHistogram::reset() {
+    std::fill(m_counts.begin(), m_counts.end(), 0u);
+    m_count = 0;
+    m_sum = 0;
+    m_min = 0;
+    m_max = 0;
+}
+
+qint64 PerfHistogram::count() const {
+    return m_count;
+}
+
+qint64 PerfHistogram::sum() const {
+    return m_sum;
+}
+
+qint64 PerfHistogram::min() const {
+    return m_min;
+}
+
+qint64 PerfHistogram::max() const {
+    return m_max;
+}
+
+double PerfHistogram::mean() const {
+    return m_count > 0 ? static_cast<double>(m_sum) / m_count : 0.0;
+}
+
+qint64 PerfHistogram::valueAtPercentile(double percentile) const {
+    if (m_count == 0) {
+        return 0;
+    }
+
+    const double clamped = std::clamp(percentile, 0.0, 100.0);
+    const qint64 rank = std::clamp<qint64>(
+        static_cast<qint64>(std::ceil((clamped / 100.0) * m_count)), 1, m_count);
+    qint64 seen = 0;
+    for (int index = 0; index < kBucketCount; ++index) {
+        seen += m_counts[index];
+        if (seen >= rank) {
+            return std::clamp(highestEquivalentValue(index), m_min, m_max);
+        }
+    }
+    return m_max;
+}
+
+int PerfHistogram::bucketIndex(qint64 valueUs) {
+    const quint64 value = static_cast<quint64>(std::clamp<qint64>(valueUs, 0, kMaxTrackableUs));
+    if (value < static_cast<quint64>(kSubBucketCount)) {
+        return static_cast<int>(value);
+    }
+
+    const int exponent = 63 - qCountLeadingZeroBits(value);
+    const int shift = exponent - kSubBucketBits;
+    const int subBucket = static_cast<int>(value >> shift) - kSubBucketCount;
+    return (shift + 1) * kSubBucketCount + subBucket;
+}
+
+qint64 PerfHistogram::lowestEquivalentValue(int index) {
+    if (index < 2 * kSubBucketCount) {
+        return index;
+    }
+
+    const int shift = index / kSubBucketCount - 1;
+    const int subBucket = index % kSubBucketCount;
+    return static_cast<qint64>(kSubBucketCount + subBucket) << shift;
+}
+
+qint64 PerfHistogram::highestEquivalentValue(int index) {
+    if (index < 2 * kSubBucketCount) {
+        return index;
+    }
+
+    const int shift = index / kSubBucketCount - 1;
+    return lowestEquivalentValue(index) + (qint64(1) << shift) - 1;
+}
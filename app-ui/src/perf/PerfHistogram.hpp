@@ -0,0 +1,36 @@
+#pragma once
+
+#include <QVector>
+#include <QtGlobal>
+
+class PerfHistogram {
+public:
+    static constexpr int kSubBucketBits = 7;
+    static constexpr int kSubBucketCount = 1 << kSubBucketBits;
+    static constexpr int kMaxExponent = 40;
+    static constexpr int kBucketCount = (kMaxExponent - kSubBucketBits + 2) * kSubBucketCount;
+    static constexpr qint64 kMaxTrackableUs = (qint64(1) << (kMaxExponent + 1)) - 1;
+
+    PerfHistogram();
+
+    void record(qint64 valueUs);
+    void reset();
+
+    qint64 count() const;
+    qint64 sum() const;
+    qint64 min() const;
+    qint64 max() const;
+    double mean() const;
+    qint64 valueAtPercentile(double percentile) const;
+
+    static int bucketIndex(qint64 valueUs);
+    static qint64 lowestEquivalentValue(int index);
+    static qint64 highestEquivalentValue(int index);
+
+private:
+    QVector<quint32> m_counts;
+    qint64 m_count = 0;
+    qint64 m_sum = 0;
+    qint64 m_min = 0;
+    qint64 m_max = 0;
+};
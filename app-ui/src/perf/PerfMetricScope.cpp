@@ -0,0 +1,128 @@
+#include "perf/PerfMetricScope.hpp"
+
+#include "perf/PerfMetricsRegistry.hpp"
+
+PerfMetricScope::PerfMetricScope(const QString &name)
+    : m_name(name),
+      m_instanceId(PerfMetricsRegistry::instance().registerScope(name)) {}
+
+QString PerfMetricScope::name() const {
+    return m_name;
+}
+
+int PerfMetricScope::instanceId() const {
+    return m_instanceId;
+}
+
+void PerfMetricScope::setCounter(const QString &key, qint64 value) {
+    entry(key, Kind::Counter).counter = value;
+}
+
+void PerfMetricScope::setGauge(const QString &key, double value, int precision) {
+    Entry &target = entry(key, Kind::Gauge);
+    target.gauge = value;
+    target.precision = precision;
+}
+
+void PerfMetricScope::setLabel(const QString &key, const QString &value) {
+    entry(key, Kind::Label).label = value;
+}
+
+PerfHistogram &PerfMetricScope::histogram(const QString &key) {
+    const int index = m_histogramKeys.indexOf(key);
+    if (index >= 0) {
+        return m_histograms[static_cast<size_t>(index)];
+    }
+
+    m_histogramKeys.push_back(key);
+    m_histograms.emplace_back();
+    return m_histograms.back();
+}
+
+void PerfMetricScope::resetHistograms() {
+    for (PerfHistogram &histogram : m_histograms) {
+        histogram.reset();
+    }
+}
+
+QString PerfMetricScope::textLine() const {
+    QString line = QStringLiteral("[perf-%1]").arg(m_name);
+    for (const Entry &item : m_entries) {
+        line += QLatin1Char(' ');
+        line += item.key;
+        line += QLatin1Char('=');
+        switch (item.kind) {
+        case Kind::Counter:
+            line += QString::number(item.counter);
+            break;
+        case Kind::Gauge:
+            line += QString::number(item.gauge, 'f', item.precision);
+            break;
+        case Kind::Label:
+            line += item.label;
+            break;
+        }
+    }
+    return line;
+}
+
+QJsonObject PerfMetricScope::toJson(qint64 timestampMs) const {
+    QJsonObject counters;
+    QJsonObject gauges;
+    QJsonObject labels;
+    for (const Entry &item : m_entries) {
+        switch (item.kind) {
+        case Kind::Counter:
+            counters.insert(item.key, item.counter);
+            break;
+        case Kind::Gauge:
+            gauges.insert(item.key, item.gauge);
+            break;
+        case Kind::Label:
+            labels.insert(item.key, item.label);
+            break;
+        }
+    }
+
+    QJsonObject histograms;
+    for (int i = 0; i < m_histogramKeys.size(); ++i) {
+        const PerfHistogram &histogram = m_histograms[static_cast<size_t>(i)];
+        QJsonObject summary;
+        summary.insert(QStringLiteral("count"), histogram.count());
+        summary.insert(QStringLiteral("min_us"), histogram.min());
+        summary.insert(QStringLiteral("mean_us"), histogram.mean());
+        summary.insert(QStringLiteral("p50_us"), histogram.valueAtPercentile(50.0));
+        summary.insert(QStringLiteral("p90_us"), histogram.valueAtPercentile(90.0));
+        summary.insert(QStringLiteral("p95_us"), histogram.valueAtPercentile(95.0));
+        summary.insert(QStringLiteral("p99_us"), histogram.valueAtPercentile(99.0));
+        summary.insert(QStringLiteral("p999_us"), histogram.valueAtPercentile(99.9));
+        summary.insert(QStringLiteral("max_us"), histogram.max());
+        histograms.insert(m_histogramKeys[i], summary);
+    }
+
+    QJsonObject root;
+    root.insert(QStringLiteral("ts_ms"), timestampMs);
+    root.insert(QStringLiteral("scope"), m_name);
+    root.insert(QStringLiteral("instance"), m_instanceId);
+    root.insert(QStringLiteral("counters"), counters);
+    root.insert(QStringLiteral("gauges"), gauges);
+    root.insert(QStringLiteral("labels"), labels);
+    root.insert(QStringLiteral("histograms"), histograms);
+    return root;
+}
+
+PerfMetricScope::Entry &PerfMetricScope::entry(const QString &key, Kind kind) {
+    const auto it = m_entryIndex.constFind(key);
+    if (it != m_entryIndex.constEnd()) {
+        Entry &existing = m_entries[it.value()];
+        existing.kind = kind;
+        return existing;
+    }
+
+    m_entryIndex.insert(key, m_entries.size());
+    Entry created;
+    created.key = key;
+    created.kind = kind;
+    m_entries.push_back(created);
+    return m_entries.last();
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <QHash>
+#include <QJsonObject>
+#include <QString>
+#include <QVector>
+#include <QtGlobal>
+
+#include <deque>
+
+#include "perf/PerfHistogram.hpp"
+
+class PerfMetricScope {
+public:
+    explicit PerfMetricScope(const QString &name);
+
+    PerfMetricScope(const PerfMetricScope &) = delete;
+    PerfMetricScope &operator=(const PerfMetricScope &) = delete;
+
+    QString name() const;
+    int instanceId() const;
+
+    void setCounter(const QString &key, qint64 value);
+    void setGauge(const QString &key, double value, int precision = 2);
+    void setLabel(const QString &key, const QString &value);
+    PerfHistogram &histogram(const QString &key);
+    void resetHistograms();
+
+    QString textLine() const;
+    QJsonObject toJson(qint64 timestampMs) const;
+
+private:
+    enum class Kind {
+        Counter,
+        Gauge,
+        Label,
+    };
+
+    struct Entry {
+        QString key;
+        Kind kind = Kind::Counter;
+        qint64 counter = 0;
+        double gauge = 0.0;
+        int precision = 0;
+        QString label;
+    };
+
+    Entry &entry(const QString &key, Kind kind);
+
+    QString m_name;
+    int m_instanceId = 0;
+    QVector<Entry> m_entries;
+    QHash<QString, int> m_entryIndex;
+    QVector<QString> m_histogramKeys;
+    std::deque<PerfHistogram> m_histograms;
+};
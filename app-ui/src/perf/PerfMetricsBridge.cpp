@@ -0,0 +1,51 @@
+#include "perf/PerfMetricsBridge.hpp"
+
+#include <QDateTime>
+
+#include "perf/PerfMetricsRegistry.hpp"
+
+PerfMetricsBridge::PerfMetricsBridge(QObject *parent) : QObject(parent) {}
+
+PerfMetricsBridge::~PerfMetricsBridge() = default;
+
+QString PerfMetricsBridge::scope() const {
+    return m_scope;
+}
+
+void PerfMetricsBridge::setScope(const QString &scope) {
+    if (m_scope == scope || scope.isEmpty()) {
+        return;
+    }
+
+    m_scope = scope;
+    m_metrics.reset();
+    emit scopeChanged();
+}
+
+void PerfMetricsBridge::setCounter(const QString &key, qint64 value) {
+    metrics().setCounter(key, value);
+}
+
+void PerfMetricsBridge::setGauge(const QString &key, double value, int precision) {
+    metrics().setGauge(key, value, precision);
+}
+
+void PerfMetricsBridge::setLabel(const QString &key, const QString &value) {
+    metrics().setLabel(key, value);
+}
+
+void PerfMetricsBridge::record(const QString &key, qint64 valueUs) {
+    metrics().histogram(key).record(valueUs);
+}
+
+void PerfMetricsBridge::publish() {
+    PerfMetricsRegistry::instance().publish(metrics(), QDateTime::currentMSecsSinceEpoch());
+    metrics().resetHistograms();
+}
+
+PerfMetricScope &PerfMetricsBridge::metrics() {
+    if (!m_metrics) {
+        m_metrics = std::make_unique<PerfMetricScope>(m_scope);
+    }
+    return *m_metrics;
+}
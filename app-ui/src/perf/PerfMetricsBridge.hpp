@@ -0,0 +1,35 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+
+#include <memory>
+
+#include "perf/PerfMetricScope.hpp"
+
+class PerfMetricsBridge : public QObject {
+    Q_OBJECT
+    Q_PROPERTY(QString scope READ scope WRITE setScope NOTIFY scopeChanged)
+
+public:
+    explicit PerfMetricsBridge(QObject *parent = nullptr);
+    ~PerfMetricsBridge() override;
+
+    QString scope() const;
+    void setScope(const QString &scope);
+
+    Q_INVOKABLE void setCounter(const QString &key, qint64 value);
+    Q_INVOKABLE void setGauge(const QString &key, double value, int precision = 2);
+    Q_INVOKABLE void setLabel(const QString &key, const QString &value);
+    Q_INVOKABLE void record(const QString &key, qint64 valueUs);
+    Q_INVOKABLE void publish();
+
+signals:
+    void scopeChanged();
+
+private:
+    PerfMetricScope &metrics();
+
+    QString m_scope = QStringLiteral("ui");
+    std::unique_ptr<PerfMetricScope> m_metrics;
+};
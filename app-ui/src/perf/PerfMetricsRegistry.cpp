@@ -0,0 +1,98 @@
+#include "perf/PerfMetricsRegistry.hpp"
+
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QMutexLocker>
+
+#include <cstdio>
+
+#include "perf/PerfMetricScope.hpp"
+
+PerfMetricsRegistry &PerfMetricsRegistry::instance() {
+    static PerfMetricsRegistry registry;
+    return registry;
+}
+
+PerfMetricsRegistry::PerfMetricsRegistry()
+    : m_jsonLinesPath(jsonLinesPathFromEnvironment()) {}
+
+QString PerfMetricsRegistry::jsonLinesPathFromEnvironment() {
+    const QString configured = qEnvironmentVariable("NICONEON_PERF_JSONL").trimmed();
+    if (configured.compare(QStringLiteral("off"), Qt::CaseInsensitive) == 0) {
+        return {};
+    }
+    return configured;
+}
+
+int PerfMetricsRegistry::registerScope(const QString &name) {
+    QMutexLocker locker(&m_mutex);
+    int &count = m_scopeInstanceCounts[name];
+    return ++count;
+}
+
+void PerfMetricsRegistry::publish(const PerfMetricScope &scope, qint64 timestampMs) {
+    const QString textLine = scope.textLine();
+    const QJsonObject snapshot = scope.toJson(timestampMs);
+    qInfo().noquote() << textLine;
+
+    QMutexLocker locker(&m_mutex);
+    m_latestSnapshots.insert(scope.name(), snapshot);
+    ++m_publishedCount;
+    if (!ensureSinkOpenLocked()) {
+        return;
+    }
+
+    QByteArray line = QJsonDocument(snapshot).toJson(QJsonDocument::Compact);
+    line.append('\n');
+    m_jsonLinesFile.write(line);
+    m_jsonLinesFile.flush();
+}
+
+void PerfMetricsRegistry::setJsonLinesPath(const QString &path) {
+    QMutexLocker locker(&m_mutex);
+    if (m_jsonLinesFile.isOpen()) {
+        m_jsonLinesFile.close();
+    }
+    m_jsonLinesPath = path;
+    m_sinkFailed = false;
+}
+
+QString PerfMetricsRegistry::jsonLinesPath() const {
+    QMutexLocker locker(&m_mutex);
+    return m_jsonLinesPath;
+}
+
+QJsonObject PerfMetricsRegistry::latestSnapshot(const QString &scopeName) const {
+    QMutexLocker locker(&m_mutex);
+    return m_latestSnapshots.value(scopeName);
+}
+
+qint64 PerfMetricsRegistry::publishedCount() const {
+    QMutexLocker locker(&m_mutex);
+    return m_publishedCount;
+}
+
+bool PerfMetricsRegistry::ensureSinkOpenLocked() {
+    if (m_jsonLinesPath.isEmpty() || m_sinkFailed) {
+        return false;
+    }
+    if (m_jsonLinesFile.isOpen()) {
+        return true;
+    }
+
+    bool opened = false;
+    if (m_jsonLinesPath == QStringLiteral("-")) {
+        opened = m_jsonLinesFile.open(stdout, QIODevice::WriteOnly);
+    } else {
+        QDir().mkpath(QFileInfo(m_jsonLinesPath).absolutePath());
+        m_jsonLinesFile.setFileName(m_jsonLinesPath);
+        opened = m_jsonLinesFile.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text);
+    }
+    if (!opened) {
+        qWarning().noquote() << "failed to open perf JSON-lines sink:" << m_jsonLinesPath;
+        m_sinkFailed = true;
+    }
+    return opened;
+}
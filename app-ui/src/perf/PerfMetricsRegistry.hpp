@@ -0,0 +1,36 @@
+#pragma once
+
+#include <QFile>
+#include <QHash>
+#include <QJsonObject>
+#include <QMutex>
+#include <QString>
+
+class PerfMetricScope;
+
+class PerfMetricsRegistry {
+public:
+    static PerfMetricsRegistry &instance();
+    static QString jsonLinesPathFromEnvironment();
+
+    int registerScope(const QString &name);
+    void publish(const PerfMetricScope &scope, qint64 timestampMs);
+
+    void setJsonLinesPath(const QString &path);
+    QString jsonLinesPath() const;
+    QJsonObject latestSnapshot(const QString &scopeName) const;
+    qint64 publishedCount() const;
+
+private:
+    PerfMetricsRegistry();
+
+    bool ensureSinkOpenLocked();
+
+    mutable QMutex m_mutex;
+    QHash<QString, int> m_scopeInstanceCounts;
+    QHash<QString, QJsonObject> m_latestSnapshots;
+    QString m_jsonLinesPath;
+    QFile m_jsonLinesFile;
+    bool m_sinkFailed = false;
+    qint64 m_publishedCount = 0;
+};
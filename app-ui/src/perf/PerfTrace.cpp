@@ -0,0 +1,215 @@
+#include "perf/PerfTrace.hpp"
+
+#include <QByteArray>
+#include <QCoreApplication>
+#include <QDir>
+#include <QFileInfo>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QThread>
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+namespace {
+
+struct TraceEvent {
+    const char *name = nullptr;
+    qint64 startNs = 0;
+    qint64 endNs = 0;
+    quint64 asyncId = 0;
+    bool async = false;
+};
+
+struct ThreadRing {
+    int tid = 0;
+    QString threadName;
+    std::vector<TraceEvent> events;
+    std::atomic<quint64> written {0};
+};
+
+struct TraceRegistry {
+    QMutex mutex;
+    std::vector<std::shared_ptr<ThreadRing>> rings;
+    qint64 originNs = 0;
+};
+
+TraceRegistry &registry() {
+    static TraceRegistry instance;
+    return instance;
+}
+
+thread_local std::shared_ptr<ThreadRing> t_ring;
+
+ThreadRing &currentRing() {
+    if (!t_ring) {
+        auto ring = std::make_shared<ThreadRing>();
+        ring->events.resize(PerfTrace::kRingCapacity);
+        const QThread *thread = QThread::currentThread();
+        ring->threadName = thread ? thread->objectName() : QString();
+        TraceRegistry &traces = registry();
+        QMutexLocker locker(&traces.mutex);
+        ring->tid = static_cast<int>(traces.rings.size()) + 1;
+        if (ring->threadName.isEmpty()) {
+            ring->threadName = QStringLiteral("thread-%1").arg(ring->tid);
+        }
+        traces.rings.push_back(ring);
+        t_ring = ring;
+    }
+    return *t_ring;
+}
+
+void append(const TraceEvent &event) {
+    ThreadRing &ring = currentRing();
+    const quint64 index = ring.written.load(std::memory_order_relaxed);
+    ring.events[static_cast<size_t>(index % PerfTrace::kRingCapacity)] = event;
+    ring.written.store(index + 1, std::memory_order_release);
+}
+
+QByteArray jsonString(const QString &value) {
+    QByteArray escaped = value.toUtf8();
+    escaped.replace('\\', "\\\\");
+    escaped.replace('"', "\\\"");
+    return '"' + escaped + '"';
+}
+
+QByteArray microseconds(qint64 ns) {
+    return QByteArray::number(static_cast<double>(ns) / 1000.0, 'f', 3);
+}
+
+} // namespace
+
+void PerfTrace::setEnabled(bool enabled) {
+    if (enabled) {
+        TraceRegistry &traces = registry();
+        QMutexLocker locker(&traces.mutex);
+        if (traces.originNs == 0) {
+            traces.originNs = nowNs();
+        }
+    }
+    s_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+QString PerfTrace::outputPathFromEnvironment() {
+    const QString configured = qEnvironmentVariable("NICONEON_TRACE").trimmed();
+    if (configured.compare(QStringLiteral("off"), Qt::CaseInsensitive) == 0) {
+        return {};
+    }
+    return configured;
+}
+
+qint64 PerfTrace::nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+void PerfTrace::setThreadName(const QString &name) {
+    if (!isEnabled() || name.isEmpty()) {
+        return;
+    }
+
+    ThreadRing &ring = currentRing();
+    QMutexLocker locker(&registry().mutex);
+    ring.threadName = name;
+}
+
+void PerfTrace::recordComplete(const char *name, qint64 startNs, qint64 endNs) {
+    if (!isEnabled()) {
+        return;
+    }
+
+    append(TraceEvent {name, startNs, std::max(startNs, endNs), 0, false});
+}
+
+void PerfTrace::recordAsync(const char *name, quint64 id, qint64 startNs, qint64 endNs) {
+    if (!isEnabled()) {
+        return;
+    }
+
+    append(TraceEvent {name, startNs, std::max(startNs, endNs), id, true});
+}
+
+bool PerfTrace::writeChromeTrace(const QString &path) {
+    if (path.isEmpty()) {
+        return false;
+    }
+
+    TraceRegistry &traces = registry();
+    std::vector<std::shared_ptr<ThreadRing>> rings;
+    qint64 originNs = 0;
+    {
+        QMutexLocker locker(&traces.mutex);
+        rings = traces.rings;
+        originNs = traces.originNs;
+    }
+
+    const qint64 pid = QCoreApplication::applicationPid();
+    const QByteArray pidText = QByteArray::number(pid);
+    QByteArray out;
+    out.append("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    bool first = true;
+    const auto beginEvent = [&out, &first]() {
+        if (!first) {
+            out.append(",\n");
+        }
+        first = false;
+    };
+
+    for (const std::shared_ptr<ThreadRing> &ring : rings) {
+        const QByteArray tidText = QByteArray::number(ring->tid);
+        QString threadName;
+        {
+            QMutexLocker locker(&traces.mutex);
+            threadName = ring->threadName;
+        }
+        beginEvent();
+        out.append("{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":" + pidText + ",\"tid\":" + tidText
+                   + ",\"args\":{\"name\":" + jsonString(threadName) + "}}");
+
+        const quint64 written = ring->written.load(std::memory_order_acquire);
+        const quint64 capacity = static_cast<quint64>(kRingCapacity);
+        const quint64 begin = written > capacity ? written - capacity : 0;
+        for (quint64 index = begin; index < written; ++index) {
+            const TraceEvent &event = ring->events[static_cast<size_t>(index % capacity)];
+            const QByteArray name = jsonString(QString::fromLatin1(event.name));
+            if (event.async) {
+                const QByteArray idText = QByteArray::number(event.asyncId);
+                beginEvent();
+                out.append("{\"ph\":\"b\",\"cat\":\"async\",\"name\":" + name + ",\"id\":" + idText + ",\"pid\":"
+                           + pidText + ",\"tid\":" + tidText + ",\"ts\":" + microseconds(event.startNs - originNs) + "}");
+                beginEvent();
+                out.append("{\"ph\":\"e\",\"cat\":\"async\",\"name\":" + name + ",\"id\":" + idText + ",\"pid\":"
+                           + pidText + ",\"tid\":" + tidText + ",\"ts\":" + microseconds(event.endNs - originNs) + "}");
+                continue;
+            }
+            beginEvent();
+            out.append("{\"ph\":\"X\",\"cat\":\"span\",\"name\":" + name + ",\"pid\":" + pidText + ",\"tid\":" + tidText
+                       + ",\"ts\":" + microseconds(event.startNs - originNs)
+                       + ",\"dur\":" + microseconds(event.endNs - event.startNs) + "}");
+        }
+    }
+    out.append("]}\n");
+
+    if (!QDir().mkpath(QFileInfo(path).absolutePath())) {
+        return false;
+    }
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return false;
+    }
+    file.write(out);
+    return file.commit();
+}
+
+void PerfTrace::clear() {
+    TraceRegistry &traces = registry();
+    QMutexLocker locker(&traces.mutex);
+    for (const std::shared_ptr<ThreadRing> &ring : traces.rings) {
+        ring->written.store(0, std::memory_order_release);
+    }
+    traces.originNs = nowNs();
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <QString>
+#include <QtGlobal>
+
+#include <atomic>
+
+class PerfTrace {
+public:
+    static constexpr int kRingCapacity = 1 << 16;
+
+    static bool isEnabled() {
+        return s_enabled.load(std::memory_order_relaxed);
+    }
+
+    static void setEnabled(bool enabled);
+    static QString outputPathFromEnvironment();
+    static qint64 nowNs();
+
+    static void setThreadName(const QString &name);
+    static void recordComplete(const char *name, qint64 startNs, qint64 endNs);
+    static void recordAsync(const char *name, quint64 id, qint64 startNs, qint64 endNs);
+
+    static bool writeChromeTrace(const QString &path);
+    static void clear();
+
+private:
+    inline static std::atomic<bool> s_enabled {false};
+};
+
+class PerfTraceSpan {
+public:
+    explicit PerfTraceSpan(const char *name) : m_enabled(PerfTrace::isEnabled()) {
+        if (Q_UNLIKELY(m_enabled)) {
+            m_name = name;
+            m_startNs = PerfTrace::nowNs();
+        }
+    }
+
+    ~PerfTraceSpan() {
+        if (Q_UNLIKELY(m_enabled)) {
+            PerfTrace::recordComplete(m_name, m_startNs, PerfTrace::nowNs());
+        }
+    }
+
+    PerfTraceSpan(const PerfTraceSpan &) = delete;
+    PerfTraceSpan &operator=(const PerfTraceSpan &) = delete;
+
+private:
+    const bool m_enabled;
+    const char *m_name = nullptr;
+    qint64 m_startNs = 0;
+};
@@ -0,0 +1,384 @@
+#include "danmaku/DanmakuController.hpp"
+#include "danmaku/DanmakuFrameClock.hpp"
+#include "danmaku/DanmakuSimdUpdater.hpp"
+#include "perf/PerfHistogram.hpp"
+#include "perf/PerfMetricScope.hpp"
+#include "perf/PerfMetricsRegistry.hpp"
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+#include <QTest>
+#include <QVariantList>
+#include <QVariantMap>
+
+#include <atomic>
+#include <cstdlib>
+
+#if defined(__GLIBC__)
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *pointer, size_t size);
+void __libc_free(void *pointer);
+}
+#endif
+
+namespace {
+
+std::atomic<quint64> g_allocationCount {0};
+std::atomic<quint64> g_allocationBytes {0};
+
+void countAllocation(size_t size) {
+    g_allocationCount.fetch_add(1, std::memory_order_relaxed);
+    g_allocationBytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+bool allocationCountingAvailable() {
+#if defined(__GLIBC__)
+    return true;
+#else
+    return false;
+#endif
+}
+
+enum class Workload {
+    Steady,
+    Burst,
+    CjkHeavy,
+    LongComments,
+    HeavyDrag,
+};
+
+QString workloadName(Workload workload) {
+    switch (workload) {
+    case Workload::Steady:
+        return QStringLiteral("steady");
+    case Workload::Burst:
+        return QStringLiteral("burst");
+    case Workload::CjkHeavy:
+        return QStringLiteral("cjk");
+    case Workload::LongComments:
+        return QStringLiteral("long");
+    case Workload::HeavyDrag:
+        return QStringLiteral("drag");
+    }
+    return QStringLiteral("unknown");
+}
+
+const QString kAsciiAlphabet = QStringLiteral("abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789wwww!?");
+const QString kCjkAlphabet = QStringLiteral(
+    "あいうえおかきくけこさしすせそたちつてとなにぬねのはひふへほまみむめもやゆよらりるれろわをん"
+    "アイウエオカキクケコサシスセソタチツテトナニヌネノ弾幕動画再生速度職人神回草生える初見歓迎"
+    "가나다라마바사아자차카타파하");
+
+class WorkloadGenerator {
+public:
+    WorkloadGenerator(Workload workload, quint32 seed) : m_workload(workload), m_random(seed) {}
+
+    QVariantList commentsForFrame(qint64 positionMs, int elapsedMs) {
+        QVariantList comments;
+        int count = 0;
+        switch (m_workload) {
+        case Workload::Steady:
+        case Workload::HeavyDrag:
+            count = takeRate(40.0, elapsedMs);
+            break;
+        case Workload::Burst:
+            count = takeRate(5.0, elapsedMs);
+            if (positionMs / 3000 != (positionMs - elapsedMs) / 3000) {
+                count += 300;
+            }
+            break;
+        case Workload::CjkHeavy:
+            count = takeRate(40.0, elapsedMs);
+            break;
+        case Workload::LongComments:
+            count = takeRate(20.0, elapsedMs);
+            break;
+        }
+
+        comments.reserve(count);
+        for (int i = 0; i < count; ++i) {
+            QVariantMap comment;
+            const int serial = m_nextSerial++;
+            comment.insert(QStringLiteral("comment_id"), QStringLiteral("bench-%1").arg(serial));
+            comment.insert(QStringLiteral("user_id"), QStringLiteral("user-%1").arg(serial % 97));
+            comment.insert(QStringLiteral("text"), nextText());
+            comment.insert(QStringLiteral("at_ms"), positionMs);
+            comments.push_back(comment);
+        }
+        return comments;
+    }
+
+private:
+    int takeRate(double perSecond, int elapsedMs) {
+        m_rateCarry += perSecond * elapsedMs / 1000.0;
+        const int count = static_cast<int>(m_rateCarry);
+        m_rateCarry -= count;
+        return count;
+    }
+
+    QString randomText(const QString &alphabet, int minLength, int maxLength) {
+        const int length = m_random.bounded(minLength, maxLength + 1);
+        QString text;
+        text.reserve(length);
+        for (int i = 0; i < length; ++i) {
+            text.append(alphabet.at(m_random.bounded(alphabet.size())));
+        }
+        return text;
+    }
+
+    QString nextText() {
+        switch (m_workload) {
+        case Workload::Steady:
+        case Workload::Burst:
+        case Workload::HeavyDrag:
+            return randomText(kAsciiAlphabet, 4, 20);
+        case Workload::CjkHeavy:
+            return randomText(kCjkAlphabet, 6, 24);
+        case Workload::LongComments:
+            return randomText(m_random.bounded(2) == 0 ? kAsciiAlphabet : kCjkAlphabet, 60, 120);
+        }
+        return QString();
+    }
+
+    Workload m_workload;
+    QRandomGenerator m_random;
+    double m_rateCarry = 0.0;
+    int m_nextSerial = 0;
+};
+
+class DragDriver {
+public:
+    void step(DanmakuController &controller, int frame) {
+        if (m_activeFrames > 0) {
+            --m_activeFrames;
+            m_dragY += 6.0;
+            controller.moveActiveDrag(m_dragX, m_dragY);
+            if (m_activeFrames == 0) {
+                controller.dropActiveDrag(false);
+            }
+            return;
+        }
+        if (frame % 30 != 0) {
+            return;
+        }
+
+        const DanmakuRenderFrameConstPtr snapshot = controller.renderSnapshot();
+        if (!snapshot || snapshot->instances.isEmpty()) {
+            return;
+        }
+        const DanmakuRenderInstance &target = snapshot->instances.at(frame % snapshot->instances.size());
+        m_dragX = target.x + 8.0;
+        m_dragY = target.y + 8.0;
+        if (controller.beginDragAt(m_dragX, m_dragY)) {
+            m_activeFrames = 20;
+        }
+    }
+
+private:
+    int m_activeFrames = 0;
+    qreal m_dragX = 0.0;
+    qreal m_dragY = 0.0;
+};
+
+qint64 envInteger(const char *name, qint64 fallback) {
+    bool ok = false;
+    const qint64 value = qEnvironmentVariable(name).toLongLong(&ok);
+    return ok ? value : fallback;
+}
+
+} // namespace
+
+#if defined(__GLIBC__)
+extern "C" void *malloc(size_t size) {
+    countAllocation(size);
+    return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t count, size_t size) {
+    countAllocation(count * size);
+    return __libc_calloc(count, size);
+}
+
+extern "C" void *realloc(void *pointer, size_t size) {
+    countAllocation(size);
+    return __libc_realloc(pointer, size);
+}
+
+extern "C" void free(void *pointer) {
+    __libc_free(pointer);
+}
+#endif
+
+class DanmakuControllerBench : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void runWorkload_data();
+    void runWorkload();
+};
+
+void DanmakuControllerBench::initTestCase() {
+    qputenv("NICONEON_GLYPH_FALLBACK_CACHE", "off");
+    qputenv("NICONEON_DANMAKU_GOVERNOR", "off");
+    qunsetenv("NICONEON_DANMAKU_CLOCK");
+}
+
+void DanmakuControllerBench::runWorkload_data() {
+    QTest::addColumn<int>("workload");
+    QTest::addColumn<bool>("workerEnabled");
+    QTest::addColumn<int>("simdMode");
+
+    const Workload workloads[] = {
+        Workload::Steady,
+        Workload::Burst,
+        Workload::CjkHeavy,
+        Workload::LongComments,
+        Workload::HeavyDrag,
+    };
+    const DanmakuSimdMode simdModes[] = {
+        DanmakuSimdMode::Scalar,
+        DanmakuSimdMode::Sse41,
+        DanmakuSimdMode::Avx2,
+        DanmakuSimdMode::Avx512,
+        DanmakuSimdMode::Auto,
+    };
+    for (const Workload workload : workloads) {
+        const QString name = workloadName(workload);
+        QTest::newRow(qPrintable(name + QStringLiteral("/worker-off")))
+            << static_cast<int>(workload) << false << static_cast<int>(DanmakuSimdMode::Scalar);
+        for (const DanmakuSimdMode mode : simdModes) {
+            QTest::newRow(qPrintable(name + QStringLiteral("/worker-on/") + DanmakuSimdUpdater::modeName(mode)))
+                << static_cast<int>(workload) << true << static_cast<int>(mode);
+        }
+    }
+}
+
+void DanmakuControllerBench::runWorkload() {
+    QFETCH(int, workload);
+    QFETCH(bool, workerEnabled);
+    QFETCH(int, simdMode);
+
+    const Workload selectedWorkload = static_cast<Workload>(workload);
+    const DanmakuSimdMode requestedMode = static_cast<DanmakuSimdMode>(simdMode);
+    if (!DanmakuSimdUpdater::isSupported(requestedMode)) {
+        QSKIP("SIMD tier is not available on this CPU");
+    }
+
+    qputenv("NICONEON_DANMAKU_WORKER", workerEnabled ? "on" : "off");
+    qputenv("NICONEON_SIMD_MODE", DanmakuSimdUpdater::modeName(requestedMode).toLatin1());
+
+    DanmakuController controller;
+    controller.setGlyphWarmupEnabled(false);
+    controller.setViewportSize(1920.0, 1080.0);
+    controller.setLaneMetrics(36, 6);
+    controller.setRenderDevicePixelRatio(1.0);
+    controller.setPlaybackPaused(false);
+
+    const int frameCount = static_cast<int>(envInteger("NICONEON_BENCH_FRAMES", 1200));
+    WorkloadGenerator generator(selectedWorkload, 0x5eed1234u);
+    DragDriver dragDriver;
+    PerfMetricScope metrics(QStringLiteral("bench"));
+    PerfHistogram &frameCostUs = metrics.histogram(QStringLiteral("frame_cost_us"));
+    qint64 positionMs = 0;
+    qint64 commentCount = 0;
+    qint64 rowsProcessed = 0;
+    qint64 peakRows = 0;
+    qint64 measuredNs = 0;
+    quint64 allocationCount = 0;
+    quint64 allocationBytes = 0;
+    QElapsedTimer wallClock;
+    wallClock.start();
+
+    for (int frame = 0; frame < frameCount; ++frame) {
+        const int elapsedMs = frame % 3 == 0 ? 17 : 16;
+        positionMs += elapsedMs;
+        const QVariantList comments = generator.commentsForFrame(positionMs, elapsedMs);
+        commentCount += comments.size();
+
+        const quint64 allocationsBefore = g_allocationCount.load(std::memory_order_relaxed);
+        const quint64 bytesBefore = g_allocationBytes.load(std::memory_order_relaxed);
+        const qint64 startNs = DanmakuFrameClock::nowNs();
+        if (!comments.isEmpty()) {
+            controller.appendFromCore(comments, positionMs);
+        }
+        if (selectedWorkload == Workload::HeavyDrag) {
+            dragDriver.step(controller, frame);
+        }
+        controller.stepFrameForTesting(elapsedMs);
+        QElapsedTimer workerWait;
+        workerWait.start();
+        while (controller.workerBusyForTesting()) {
+            QCoreApplication::processEvents(QEventLoop::AllEvents | QEventLoop::WaitForMoreEvents, 5);
+            QVERIFY2(workerWait.elapsed() < 5000, "worker frame did not return");
+        }
+        const qint64 costNs = DanmakuFrameClock::nowNs() - startNs;
+        allocationCount += g_allocationCount.load(std::memory_order_relaxed) - allocationsBefore;
+        allocationBytes += g_allocationBytes.load(std::memory_order_relaxed) - bytesBefore;
+
+        frameCostUs.record(costNs / 1000);
+        measuredNs += costNs;
+        const int activeRows = controller.activeCommentCountMetric();
+        rowsProcessed += activeRows;
+        peakRows = std::max<qint64>(peakRows, activeRows);
+
+        controller.renderSnapshot();
+        controller.takePendingSpriteUploads();
+    }
+
+    const double measuredSec = measuredNs / 1e9;
+    const double allocsPerFrame = frameCount > 0 ? static_cast<double>(allocationCount) / frameCount : 0.0;
+    const double allocBytesPerFrame = frameCount > 0 ? static_cast<double>(allocationBytes) / frameCount : 0.0;
+    const double rowsPerSec = measuredSec > 0.0 ? rowsProcessed / measuredSec : 0.0;
+    const double speedup = wallClock.elapsed() > 0 ? static_cast<double>(positionMs) / wallClock.elapsed() : 0.0;
+
+    metrics.setLabel(QStringLiteral("workload"), workloadName(selectedWorkload));
+    metrics.setLabel(QStringLiteral("worker"), workerEnabled ? QStringLiteral("on") : QStringLiteral("off"));
+    metrics.setLabel(
+        QStringLiteral("simd"),
+        workerEnabled ? DanmakuSimdUpdater::modeName(DanmakuSimdUpdater::resolveMode(requestedMode)) : QStringLiteral("n/a"));
+    metrics.setCounter(QStringLiteral("frames"), frameCount);
+    metrics.setCounter(QStringLiteral("simulated_ms"), positionMs);
+    metrics.setCounter(QStringLiteral("comments"), commentCount);
+    metrics.setGauge(QStringLiteral("peak_rows"), peakRows, 0);
+    metrics.setGauge(QStringLiteral("frame_us_avg"), frameCostUs.mean(), 1);
+    metrics.setGauge(QStringLiteral("frame_us_p50"), frameCostUs.valueAtPercentile(50.0), 0);
+    metrics.setGauge(QStringLiteral("frame_us_p95"), frameCostUs.valueAtPercentile(95.0), 0);
+    metrics.setGauge(QStringLiteral("frame_us_p99"), frameCostUs.valueAtPercentile(99.0), 0);
+    metrics.setGauge(QStringLiteral("frame_us_max"), frameCostUs.max(), 0);
+    metrics.setGauge(QStringLiteral("allocs_per_frame"), allocationCountingAvailable() ? allocsPerFrame : -1.0, 1);
+    metrics.setGauge(QStringLiteral("alloc_bytes_per_frame"), allocationCountingAvailable() ? allocBytesPerFrame : -1.0, 0);
+    metrics.setGauge(QStringLiteral("rows_per_sec"), rowsPerSec, 0);
+    metrics.setGauge(QStringLiteral("speedup"), speedup, 1);
+    PerfMetricsRegistry::instance().publish(metrics, QDateTime::currentMSecsSinceEpoch());
+
+    QVERIFY(commentCount > 0);
+    QVERIFY(peakRows > 0);
+
+    const qint64 maxP99Us = envInteger("NICONEON_BENCH_MAX_P99_US", 0);
+    if (maxP99Us > 0) {
+        QVERIFY2(
+            frameCostUs.valueAtPercentile(99.0) <= maxP99Us,
+            qPrintable(QStringLiteral("frame_us_p99=%1 exceeds %2").arg(frameCostUs.valueAtPercentile(99.0)).arg(maxP99Us)));
+    }
+    const qint64 maxAllocsPerFrame = envInteger("NICONEON_BENCH_MAX_ALLOCS_PER_FRAME", 0);
+    if (maxAllocsPerFrame > 0 && allocationCountingAvailable()) {
+        QVERIFY2(
+            allocsPerFrame <= maxAllocsPerFrame,
+            qPrintable(QStringLiteral("allocs_per_frame=%1 exceeds %2").arg(allocsPerFrame, 0, 'f', 1).arg(maxAllocsPerFrame)));
+    }
+    const qint64 minRowsPerSec = envInteger("NICONEON_BENCH_MIN_ROWS_PER_SEC", 0);
+    if (minRowsPerSec > 0) {
+        QVERIFY2(
+            rowsPerSec >= minRowsPerSec,
+            qPrintable(QStringLiteral("rows_per_sec=%1 is below %2").arg(rowsPerSec, 0, 'f', 0).arg(minRowsPerSec)));
+    }
+}
+
+QTEST_MAIN(DanmakuControllerBench)
+
+#include "danmaku_controller_bench.moc"
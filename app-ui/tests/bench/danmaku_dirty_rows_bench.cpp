@@ -0,0 +1,91 @@
+#include "danmaku/DanmakuDirtyRowSet.hpp"
+
+#include <QSet>
+#include <QTest>
+#include <QVector>
+
+#include <algorithm>
+
+namespace {
+QVector<int> dirtyRows(int rowCount) {
+    QVector<int> rows;
+    rows.reserve(rowCount);
+    for (int row = 0; row < rowCount; ++row) {
+        if (row % 16 != 0) {
+            rows.push_back(row);
+        }
+    }
+    return rows;
+}
+} // namespace
+
+class DanmakuDirtyRowsBench : public QObject {
+    Q_OBJECT
+
+private slots:
+    void flushSortedQSet_data();
+    void flushSortedQSet();
+    void flushDirtyRowSet_data();
+    void flushDirtyRowSet();
+
+private:
+    void addRowCounts();
+};
+
+void DanmakuDirtyRowsBench::addRowCounts() {
+    QTest::addColumn<int>("rowCount");
+    QTest::newRow("1k") << 1000;
+    QTest::newRow("10k") << 10000;
+    QTest::newRow("50k") << 50000;
+}
+
+void DanmakuDirtyRowsBench::flushSortedQSet_data() {
+    addRowCounts();
+}
+
+void DanmakuDirtyRowsBench::flushSortedQSet() {
+    QFETCH(int, rowCount);
+    const QVector<int> rows = dirtyRows(rowCount);
+
+    QSet<int> pending;
+    qint64 checksum = 0;
+    QBENCHMARK {
+        for (const int row : rows) {
+            pending.insert(row);
+        }
+        QVector<int> sorted = pending.values();
+        std::sort(sorted.begin(), sorted.end());
+        for (const int row : sorted) {
+            checksum += row;
+        }
+        pending.clear();
+    }
+    QVERIFY(checksum > 0);
+}
+
+void DanmakuDirtyRowsBench::flushDirtyRowSet_data() {
+    addRowCounts();
+}
+
+void DanmakuDirtyRowsBench::flushDirtyRowSet() {
+    QFETCH(int, rowCount);
+    const QVector<int> rows = dirtyRows(rowCount);
+
+    DanmakuDirtyRowSet pending;
+    pending.reserve(rowCount);
+    qint64 checksum = 0;
+    QBENCHMARK {
+        for (const int row : rows) {
+            pending.insert(row);
+        }
+        pending.forEachAscending([&checksum](int row) {
+            checksum += row;
+        });
+        pending.clear();
+    }
+    QVERIFY(checksum > 0);
+}
+
+QTEST_APPLESS_MAIN(DanmakuDirtyRowsBench)
+
+#include "danmaku_dirty_rows_bench.moc"
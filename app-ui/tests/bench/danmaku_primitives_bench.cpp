@@ -0,0 +1,337 @@
+#include "danmaku/DanmakuAtlasPacker.hpp"
+#include "danmaku/DanmakuSimdUpdater.hpp"
+#include "danmaku/DanmakuSoAState.hpp"
+#include "danmaku/DanmakuTextSpriteCache.hpp"
+#include "danmaku/DanmakuUpdatePool.hpp"
+#include "danmaku/DanmakuUpdateWorker.hpp"
+
+#include <QStringList>
+#include <QTest>
+#include <QVector>
+
+namespace {
+
+constexpr qreal kViewportWidth = 1920.0;
+constexpr qreal kViewportHeight = 1080.0;
+constexpr qreal kLaneHeight = 42.0;
+constexpr int kLaneCount = 24;
+constexpr int kFontPixelSize = 36;
+constexpr int kRasterBatchSprites = 256;
+
+void addElementCounts() {
+    QTest::addColumn<int>("count");
+    QTest::newRow("100") << 100;
+    QTest::newRow("1k") << 1000;
+    QTest::newRow("10k") << 10000;
+    QTest::newRow("100k") << 100000;
+}
+
+QRectF commentRect(int index) {
+    const int lane = index % kLaneCount;
+    const qreal width = 80.0 + (index * 37) % 520;
+    const qreal x = -width + ((index / kLaneCount) * 211) % static_cast<int>(kViewportWidth + width * 2.0);
+    return QRectF(x, lane * kLaneHeight, width, kLaneHeight - 6.0);
+}
+
+QVector<DanmakuWorkerRowState> workerRows(int count) {
+    QVector<DanmakuWorkerRowState> rows;
+    rows.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        const QRectF rect = commentRect(i);
+        DanmakuWorkerRowState row;
+        row.handle = (static_cast<DanmakuItemHandle>(1) << 32) | static_cast<quint32>(i);
+        row.x = rect.x();
+        row.y = rect.y();
+        row.speed = 120.0 + (i % 7) * 15.0;
+        row.widthEstimate = static_cast<int>(rect.width());
+        row.flags = i % 50 == 0 ? DanmakuSoAFlagFrozen : 0;
+        rows.push_back(row);
+    }
+    return rows;
+}
+
+void pushWorkerUpserts(DanmakuWorkerChannel &channel, const QVector<DanmakuWorkerRowState> &rows) {
+    DanmakuWorkerCommand command;
+    command.type = DanmakuWorkerCommandType::Upsert;
+    for (const DanmakuWorkerRowState &row : rows) {
+        command.row = row;
+        channel.push(command);
+    }
+}
+
+DanmakuSoAState fusedUpdateState(int count, bool fading) {
+    DanmakuSoAState state;
+    state.resize(count);
+    const QVector<DanmakuWorkerRowState> rows = workerRows(count);
+    for (int i = 0; i < count; ++i) {
+        state.handles[i] = rows[i].handle;
+        state.x[i] = static_cast<float>(rows[i].x);
+        state.y[i] = static_cast<float>(rows[i].y);
+        state.speed[i] = static_cast<float>(rows[i].speed);
+        state.alpha[i] = 1.0f;
+        state.widthEstimate[i] = rows[i].widthEstimate;
+        state.fadeRemainingMs[i] = fading && i % 10 == 0 ? 1000000 : 0;
+        state.flags[i] = static_cast<quint8>(rows[i].flags | (fading && i % 10 == 0 ? DanmakuSoAFlagFading : 0));
+    }
+    return state;
+}
+
+DanmakuFusedUpdateParams fusedUpdateParams(bool fading) {
+    DanmakuFusedUpdateParams params;
+    params.anyFading = fading;
+    params.anyDragging = false;
+    params.movementFactor = 0.016f;
+    params.elapsedMs = 16;
+    params.cullThreshold = -static_cast<float>(kViewportWidth);
+    params.viewportHeight = static_cast<float>(kViewportHeight);
+    params.itemHeight = static_cast<float>(kLaneHeight);
+    return params;
+}
+
+QStringList commentTexts(int count) {
+    static const QString samples[] = {
+        QStringLiteral("wwwwwwww"),
+        QStringLiteral("ここすき"),
+        QStringLiteral("初見です"),
+        QStringLiteral("8888888888"),
+        QStringLiteral("神回確定"),
+        QStringLiteral("lol that timing"),
+    };
+    QStringList texts;
+    texts.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        texts.push_back(samples[i % 6] + QString::number(i));
+    }
+    return texts;
+}
+
+} // namespace
+
+class DanmakuPrimitivesBench : public QObject {
+    Q_OBJECT
+
+private slots:
+    void atlasPackerInsert_data();
+    void atlasPackerInsert();
+    void simdFusedUpdate_data();
+    void simdFusedUpdate();
+    void poolFusedUpdate_data();
+    void poolFusedUpdate();
+    void textSpriteEnsure_data();
+    void textSpriteEnsure();
+    void textSpriteRasterize_data();
+    void textSpriteRasterize();
+    void workerSyncState_data();
+    void workerSyncState();
+    void workerRemoveRows_data();
+    void workerRemoveRows();
+};
+
+void DanmakuPrimitivesBench::atlasPackerInsert_data() {
+    addElementCounts();
+}
+
+void DanmakuPrimitivesBench::atlasPackerInsert() {
+    QFETCH(int, count);
+    QVector<QSize> sizes;
+    sizes.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        sizes.push_back(QSize(40 + (i * 53) % 560, 36 + (i % 3) * 6));
+    }
+
+    DanmakuAtlasPacker packer;
+    int pages = 0;
+    QBENCHMARK {
+        packer.reset(QSize(4096, 4096));
+        pages = 1;
+        for (const QSize &size : sizes) {
+            if (packer.insert(size).isNull()) {
+                packer.reset(QSize(4096, 4096));
+                ++pages;
+                packer.insert(size);
+            }
+        }
+    }
+    QVERIFY(pages >= 1);
+}
+
+void DanmakuPrimitivesBench::simdFusedUpdate_data() {
+    QTest::addColumn<int>("count");
+    QTest::addColumn<int>("mode");
+    QTest::addColumn<bool>("fading");
+    const int counts[] = {100, 1000, 10000, 100000};
+    const DanmakuSimdMode modes[] = {
+        DanmakuSimdMode::Scalar,
+        DanmakuSimdMode::Sse41,
+        DanmakuSimdMode::Avx2,
+        DanmakuSimdMode::Avx512,
+        DanmakuSimdMode::Auto,
+    };
+    for (const int count : counts) {
+        for (const DanmakuSimdMode mode : modes) {
+            for (const bool fading : {false, true}) {
+                QTest::newRow(qPrintable(QStringLiteral("%1/%2/%3")
+                                             .arg(count)
+                                             .arg(DanmakuSimdUpdater::modeName(mode))
+                                             .arg(fading ? QStringLiteral("fading") : QStringLiteral("moving"))))
+                    << count << static_cast<int>(mode) << fading;
+            }
+        }
+    }
+}
+
+void DanmakuPrimitivesBench::simdFusedUpdate() {
+    QFETCH(int, count);
+    QFETCH(int, mode);
+    QFETCH(bool, fading);
+    const DanmakuSimdMode simdMode = static_cast<DanmakuSimdMode>(mode);
+    if (!DanmakuSimdUpdater::isSupported(simdMode)) {
+        QSKIP("SIMD tier is not available on this CPU");
+    }
+
+    DanmakuSoAState state = fusedUpdateState(count, fading);
+    const DanmakuFusedUpdateParams params = fusedUpdateParams(fading);
+    DanmakuFusedUpdateResult result;
+
+    QBENCHMARK {
+        DanmakuSimdUpdater::updateFused(state, params, result, simdMode);
+    }
+    QVERIFY(result.changedCount + result.removedCount <= count);
+}
+
+void DanmakuPrimitivesBench::poolFusedUpdate_data() {
+    QTest::addColumn<int>("count");
+    QTest::addColumn<int>("threads");
+    for (const int count : {10000, 50000, 100000}) {
+        for (const int threads : {1, 2, 4, 8}) {
+            QTest::newRow(qPrintable(QStringLiteral("%1/%2t").arg(count).arg(threads))) << count << threads;
+        }
+    }
+}
+
+void DanmakuPrimitivesBench::poolFusedUpdate() {
+    QFETCH(int, count);
+    QFETCH(int, threads);
+
+    DanmakuSoAState state = fusedUpdateState(count, true);
+    const DanmakuFusedUpdateParams params = fusedUpdateParams(true);
+    DanmakuFusedUpdateResult result;
+    DanmakuUpdatePool pool(threads, 1);
+
+    QBENCHMARK {
+        pool.updateFused(state, params, result, DanmakuSimdMode::Auto);
+    }
+    QVERIFY(result.changedCount + result.removedCount <= count);
+}
+
+void DanmakuPrimitivesBench::textSpriteEnsure_data() {
+    addElementCounts();
+}
+
+void DanmakuPrimitivesBench::textSpriteEnsure() {
+    QFETCH(int, count);
+    const QStringList texts = commentTexts(count);
+
+    DanmakuTextSpriteCache cache;
+    qint64 widthTotal = 0;
+    QBENCHMARK {
+        cache.clear();
+        for (const QString &text : texts) {
+            widthTotal += cache.ensureSprite(text, kFontPixelSize, 1.0).widthEstimate;
+        }
+    }
+    QVERIFY(widthTotal > 0);
+    QCOMPARE(cache.pendingRasterCountForTesting(), count);
+}
+
+void DanmakuPrimitivesBench::textSpriteRasterize_data() {
+    QTest::addColumn<int>("count");
+    QTest::newRow("100") << 100;
+    QTest::newRow("1k") << 1000;
+    QTest::newRow("10k") << 10000;
+    if (qEnvironmentVariableIntValue("NICONEON_BENCH_RASTER_100K") > 0) {
+        QTest::newRow("100k") << 100000;
+    }
+}
+
+void DanmakuPrimitivesBench::textSpriteRasterize() {
+    QFETCH(int, count);
+    const QStringList texts = commentTexts(count);
+
+    DanmakuTextSpriteCache cache;
+    int uploads = 0;
+    QBENCHMARK {
+        cache.clear();
+        for (const QString &text : texts) {
+            cache.ensureSprite(text, kFontPixelSize, 1.0);
+        }
+        uploads = 0;
+        while (cache.pendingRasterCount() > 0) {
+            uploads += cache.rasterizePendingSprites(kRasterBatchSprites, 0).size();
+        }
+    }
+    QCOMPARE(uploads, count);
+}
+
+void DanmakuPrimitivesBench::workerSyncState_data() {
+    addElementCounts();
+}
+
+void DanmakuPrimitivesBench::workerSyncState() {
+    QFETCH(int, count);
+    const QVector<DanmakuWorkerRowState> rows = workerRows(count);
+
+    DanmakuWorkerChannel channel;
+    DanmakuUpdateWorker worker(&channel);
+    QBENCHMARK {
+        channel.pushFullState(rows);
+        worker.drainCommands();
+    }
+
+    DanmakuWorkerCommand frame;
+    frame.type = DanmakuWorkerCommandType::Frame;
+    frame.frame.viewportHeight = kViewportHeight;
+    frame.frame.cullThreshold = -1.0e9;
+    frame.frame.itemHeight = kLaneHeight;
+    frame.frame.elapsedMs = 16;
+    channel.push(frame);
+    worker.drainCommands();
+    const DanmakuWorkerFrameColumns *columns = channel.acquireFrame();
+    QVERIFY(columns);
+    QVERIFY(columns->changedCount() > 0);
+    channel.releaseFrame();
+}
+
+void DanmakuPrimitivesBench::workerRemoveRows_data() {
+    addElementCounts();
+}
+
+void DanmakuPrimitivesBench::workerRemoveRows() {
+    QFETCH(int, count);
+    const QVector<DanmakuWorkerRowState> rows = workerRows(count);
+
+    QVector<DanmakuWorkerRowState> reinsert;
+    for (int i = 0; i < count; i += 4) {
+        reinsert.push_back(rows.at(i));
+    }
+
+    DanmakuWorkerChannel channel(count + 2);
+    DanmakuUpdateWorker worker(&channel);
+    channel.pushFullState(rows);
+    worker.drainCommands();
+    QBENCHMARK {
+        DanmakuWorkerCommand removal;
+        removal.type = DanmakuWorkerCommandType::Remove;
+        for (const DanmakuWorkerRowState &row : reinsert) {
+            removal.row.handle = row.handle;
+            channel.push(removal);
+        }
+        pushWorkerUpserts(channel, reinsert);
+        worker.drainCommands();
+    }
+    QVERIFY(!reinsert.isEmpty());
+}
+
+QTEST_MAIN(DanmakuPrimitivesBench)
+
+#include "danmaku_primitives_bench.moc"
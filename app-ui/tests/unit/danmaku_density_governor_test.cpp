@@ -0,0 +1,198 @@
+#include "danmaku/DanmakuDensityGovernor.hpp"
+
+#include <QTest>
+
+namespace {
+DanmakuDensitySample costSample(qint64 frameCostUs) {
+    DanmakuDensitySample sample;
+    sample.frameCostUs = frameCostUs;
+    return sample;
+}
+
+int feedWindows(DanmakuDensityGovernor &governor, const DanmakuDensitySample &sample, int windows) {
+    int changes = 0;
+    for (int frame = 0; frame < windows * DanmakuDensityGovernor::kWindowFrames; ++frame) {
+        if (governor.observe(sample)) {
+            ++changes;
+        }
+    }
+    return changes;
+}
+
+DanmakuDensityGovernor makeGovernor() {
+    DanmakuDensityGovernor governor;
+    governor.setTargetFps(60);
+    return governor;
+}
+} // namespace
+
+class DanmakuDensityGovernorTest : public QObject {
+    Q_OBJECT
+
+private slots:
+    void staysNormalWithinBudget();
+    void degradesOneTierPerPressuredStreak();
+    void recoversOnlyAfterSustainedHeadroom();
+    void marginalWindowsHoldTier();
+    void backlogAndUploadBytesAreTreatedAsPressure();
+    void throttledRasterBacklogDoesNotLockTier();
+    void activeCountOnlyCountsWithoutCostHeadroom();
+    void tierScalesBudgetsAndResolution();
+    void disabledGovernorNeverChangesTier();
+};
+
+void DanmakuDensityGovernorTest::staysNormalWithinBudget() {
+    DanmakuDensityGovernor governor = makeGovernor();
+    QCOMPARE(governor.frameBudgetUs(), qint64(8333));
+
+    QCOMPARE(feedWindows(governor, costSample(2000), 20), 0);
+    QVERIFY(governor.tier() == DanmakuDensityTier::Normal);
+    QCOMPARE(governor.tierChangeCount(), 0);
+    QVERIFY(!governor.skipLowPriority());
+}
+
+void DanmakuDensityGovernorTest::degradesOneTierPerPressuredStreak() {
+    DanmakuDensityGovernor governor = makeGovernor();
+    const DanmakuDensitySample heavy = costSample(20000);
+
+    QCOMPARE(feedWindows(governor, heavy, DanmakuDensityGovernor::kDegradeWindows - 1), 0);
+    QVERIFY(governor.tier() == DanmakuDensityTier::Normal);
+
+    QCOMPARE(feedWindows(governor, heavy, 1), 1);
+    QVERIFY(governor.tier() == DanmakuDensityTier::SkipLowPriority);
+    QVERIFY(governor.lastWindowP95Us() > governor.frameBudgetUs());
+
+    QCOMPARE(feedWindows(governor, heavy, DanmakuDensityGovernor::kDegradeWindows * 3), 3);
+    QVERIFY(governor.tier() == DanmakuDensityTier::LowResolutionSprites);
+
+    QCOMPARE(feedWindows(governor, heavy, DanmakuDensityGovernor::kDegradeWindows * 2), 0);
+    QVERIFY(governor.tier() == DanmakuDensityTier::LowResolutionSprites);
+    QCOMPARE(governor.tierChangeCount(), 4);
+}
+
+void DanmakuDensityGovernorTest::recoversOnlyAfterSustainedHeadroom() {
+    DanmakuDensityGovernor governor = makeGovernor();
+    feedWindows(governor, costSample(20000), DanmakuDensityGovernor::kDegradeWindows * 2);
+    QVERIFY(governor.tier() == DanmakuDensityTier::ThrottleRaster);
+
+    const DanmakuDensitySample light = costSample(1000);
+    QCOMPARE(feedWindows(governor, light, DanmakuDensityGovernor::kRecoverWindows - 1), 0);
+    QVERIFY(governor.tier() == DanmakuDensityTier::ThrottleRaster);
+
+    QCOMPARE(feedWindows(governor, light, 1), 1);
+    QVERIFY(governor.tier() == DanmakuDensityTier::SkipLowPriority);
+
+    feedWindows(governor, light, DanmakuDensityGovernor::kRecoverWindows - 1);
+    feedWindows(governor, costSample(20000), 1);
+    QCOMPARE(feedWindows(governor, light, DanmakuDensityGovernor::kRecoverWindows - 1), 0);
+    QVERIFY(governor.tier() == DanmakuDensityTier::SkipLowPriority);
+
+    QCOMPARE(feedWindows(governor, light, 1), 1);
+    QVERIFY(governor.tier() == DanmakuDensityTier::Normal);
+}
+
+void DanmakuDensityGovernorTest::marginalWindowsHoldTier() {
+    DanmakuDensityGovernor governor = makeGovernor();
+    feedWindows(governor, costSample(20000), DanmakuDensityGovernor::kDegradeWindows);
+    QVERIFY(governor.tier() == DanmakuDensityTier::SkipLowPriority);
+
+    const qint64 marginalUs = governor.frameBudgetUs() * 8 / 10;
+    QCOMPARE(feedWindows(governor, costSample(marginalUs), DanmakuDensityGovernor::kRecoverWindows * 3), 0);
+    QVERIFY(governor.tier() == DanmakuDensityTier::SkipLowPriority);
+}
+
+void DanmakuDensityGovernorTest::backlogAndUploadBytesAreTreatedAsPressure() {
+    DanmakuDensityGovernor backlogGovernor = makeGovernor();
+    DanmakuDensitySample backlog = costSample(1000);
+    backlog.rasterBacklog = DanmakuDensityGovernor::kRasterBacklogHigh + 1;
+    QCOMPARE(feedWindows(backlogGovernor, backlog, DanmakuDensityGovernor::kDegradeWindows), 1);
+
+    DanmakuDensityGovernor uploadGovernor = makeGovernor();
+    DanmakuDensitySample uploads = costSample(1000);
+    uploads.uploadBytes = DanmakuDensityGovernor::kUploadBytesHigh + 1;
+    QCOMPARE(feedWindows(uploadGovernor, uploads, DanmakuDensityGovernor::kDegradeWindows), 1);
+}
+
+void DanmakuDensityGovernorTest::throttledRasterBacklogDoesNotLockTier() {
+    DanmakuDensityGovernor governor = makeGovernor();
+    DanmakuDensitySample backlog = costSample(1000);
+    backlog.rasterBacklog = DanmakuDensityGovernor::kRasterBacklogHigh + 1;
+    feedWindows(governor, backlog, DanmakuDensityGovernor::kDegradeWindows * 2);
+    QVERIFY(governor.tier() == DanmakuDensityTier::ThrottleRaster);
+
+    DanmakuDensitySample throttled = costSample(1000);
+    throttled.rasterBacklog = DanmakuDensityGovernor::kRasterBacklogHigh * 8;
+    throttled.uploadBytes = governor.spriteUploadBudgetBytes(512 * 1024);
+    QCOMPARE(feedWindows(governor, throttled, DanmakuDensityGovernor::kRecoverWindows - 1), 0);
+    QVERIFY(governor.tier() == DanmakuDensityTier::ThrottleRaster);
+    QCOMPARE(feedWindows(governor, throttled, 1), 1);
+    QVERIFY(governor.tier() == DanmakuDensityTier::SkipLowPriority);
+    QCOMPARE(governor.spriteRasterBudget(8), 8);
+
+    DanmakuDensitySample drained = costSample(1000);
+    drained.rasterBacklog = DanmakuDensityGovernor::kRasterBacklogLow - 1;
+    QCOMPARE(feedWindows(governor, drained, DanmakuDensityGovernor::kRecoverWindows), 1);
+    QVERIFY(governor.tier() == DanmakuDensityTier::Normal);
+
+    feedWindows(governor, costSample(20000), DanmakuDensityGovernor::kDegradeWindows * 3);
+    QVERIFY(governor.tier() == DanmakuDensityTier::TightenEmit);
+    QCOMPARE(feedWindows(governor, throttled, DanmakuDensityGovernor::kRecoverWindows * 2), 2);
+    QVERIFY(governor.tier() == DanmakuDensityTier::SkipLowPriority);
+}
+
+void DanmakuDensityGovernorTest::activeCountOnlyCountsWithoutCostHeadroom() {
+    DanmakuDensityGovernor cheapGovernor = makeGovernor();
+    DanmakuDensitySample cheapCrowd = costSample(1000);
+    cheapCrowd.activeCount = DanmakuDensityGovernor::kActiveCountHigh + 1;
+    QCOMPARE(feedWindows(cheapGovernor, cheapCrowd, DanmakuDensityGovernor::kDegradeWindows * 4), 0);
+    QVERIFY(cheapGovernor.tier() == DanmakuDensityTier::Normal);
+
+    DanmakuDensityGovernor marginalGovernor = makeGovernor();
+    DanmakuDensitySample marginalCrowd = costSample(marginalGovernor.frameBudgetUs() * 8 / 10);
+    marginalCrowd.activeCount = DanmakuDensityGovernor::kActiveCountHigh + 1;
+    QCOMPARE(feedWindows(marginalGovernor, marginalCrowd, DanmakuDensityGovernor::kDegradeWindows), 1);
+    QVERIFY(marginalGovernor.tier() == DanmakuDensityTier::SkipLowPriority);
+
+    QCOMPARE(feedWindows(marginalGovernor, cheapCrowd, DanmakuDensityGovernor::kRecoverWindows), 1);
+    QVERIFY(marginalGovernor.tier() == DanmakuDensityTier::Normal);
+}
+
+void DanmakuDensityGovernorTest::tierScalesBudgetsAndResolution() {
+    DanmakuDensityGovernor governor = makeGovernor();
+    QCOMPARE(governor.spriteRasterBudget(8), 8);
+    QCOMPARE(governor.spriteUploadBudgetBytes(512 * 1024), qint64(512 * 1024));
+    QCOMPARE(governor.spriteResolutionScale(), 1.0);
+
+    const DanmakuDensitySample heavy = costSample(20000);
+    feedWindows(governor, heavy, DanmakuDensityGovernor::kDegradeWindows * 2);
+    QVERIFY(governor.tier() == DanmakuDensityTier::ThrottleRaster);
+    QVERIFY(governor.skipLowPriority());
+    QVERIFY(!governor.tightenEmitBudget());
+    QCOMPARE(governor.spriteRasterBudget(8), 2);
+    QCOMPARE(governor.spriteRasterBudget(1), 1);
+    QCOMPARE(governor.spriteUploadBudgetBytes(512 * 1024), qint64(128 * 1024));
+    QCOMPARE(governor.spriteResolutionScale(), 1.0);
+
+    feedWindows(governor, heavy, DanmakuDensityGovernor::kDegradeWindows);
+    QVERIFY(governor.tightenEmitBudget());
+    QCOMPARE(governor.spriteResolutionScale(), 1.0);
+
+    feedWindows(governor, heavy, DanmakuDensityGovernor::kDegradeWindows);
+    QCOMPARE(governor.spriteResolutionScale(), DanmakuDensityGovernor::kLowResolutionScale);
+    QCOMPARE(DanmakuDensityGovernor::tierName(governor.tier()), QStringLiteral("low_res_sprites"));
+}
+
+void DanmakuDensityGovernorTest::disabledGovernorNeverChangesTier() {
+    DanmakuDensityGovernor governor = makeGovernor();
+    feedWindows(governor, costSample(20000), DanmakuDensityGovernor::kDegradeWindows);
+    QVERIFY(governor.tier() == DanmakuDensityTier::SkipLowPriority);
+
+    governor.setEnabled(false);
+    QVERIFY(governor.tier() == DanmakuDensityTier::Normal);
+    QCOMPARE(feedWindows(governor, costSample(20000), DanmakuDensityGovernor::kDegradeWindows * 4), 0);
+    QVERIFY(governor.tier() == DanmakuDensityTier::Normal);
+}
+
+QTEST_APPLESS_MAIN(DanmakuDensityGovernorTest)
+
+#include "danmaku_density_governor_test.moc"
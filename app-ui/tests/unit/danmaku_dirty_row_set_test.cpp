@@ -0,0 +1,104 @@
+#include "danmaku/DanmakuDirtyRowSet.hpp"
+
+#include <QSet>
+#include <QTest>
+#include <QVector>
+
+#include <algorithm>
+#include <functional>
+
+namespace {
+QVector<int> ascendingRows(const DanmakuDirtyRowSet &rows) {
+    QVector<int> visited;
+    rows.forEachAscending([&visited](int row) {
+        visited.push_back(row);
+    });
+    return visited;
+}
+
+QVector<int> descendingRows(const DanmakuDirtyRowSet &rows) {
+    QVector<int> visited;
+    rows.forEachDescending([&visited](int row) {
+        visited.push_back(row);
+    });
+    return visited;
+}
+} // namespace
+
+class DanmakuDirtyRowSetTest : public QObject {
+    Q_OBJECT
+
+private slots:
+    void insertRemoveTracksMembership();
+    void iterationMatchesSortedSet();
+    void clearResetsAllWords();
+};
+
+void DanmakuDirtyRowSetTest::insertRemoveTracksMembership() {
+    DanmakuDirtyRowSet rows;
+    QVERIFY(rows.isEmpty());
+
+    rows.insert(3);
+    rows.insert(3);
+    rows.insert(64);
+    rows.insert(-1);
+    QCOMPARE(rows.size(), 2);
+    QVERIFY(rows.contains(3));
+    QVERIFY(rows.contains(64));
+    QVERIFY(!rows.contains(63));
+    QVERIFY(!rows.contains(-1));
+    QVERIFY(!rows.contains(100000));
+
+    rows.remove(3);
+    rows.remove(3);
+    rows.remove(100000);
+    QCOMPARE(rows.size(), 1);
+    QVERIFY(!rows.contains(3));
+    QVERIFY(rows.contains(64));
+}
+
+void DanmakuDirtyRowSetTest::iterationMatchesSortedSet() {
+    DanmakuDirtyRowSet rows;
+    QSet<int> expectedSet;
+    quint32 seed = 12345;
+    for (int i = 0; i < 4000; ++i) {
+        seed = seed * 1103515245u + 12345u;
+        const int row = static_cast<int>((seed >> 8) % 9000u);
+        if ((seed & 1u) != 0) {
+            rows.remove(row);
+            expectedSet.remove(row);
+        } else {
+            rows.insert(row);
+            expectedSet.insert(row);
+        }
+    }
+
+    QVector<int> expected = expectedSet.values();
+    std::sort(expected.begin(), expected.end());
+    QCOMPARE(rows.size(), expected.size());
+    QCOMPARE(ascendingRows(rows), expected);
+
+    std::sort(expected.begin(), expected.end(), std::greater<int>());
+    QCOMPARE(descendingRows(rows), expected);
+}
+
+void DanmakuDirtyRowSetTest::clearResetsAllWords() {
+    DanmakuDirtyRowSet rows;
+    rows.reserve(1024);
+    for (int row = 0; row < 1024; row += 7) {
+        rows.insert(row);
+    }
+    rows.clear();
+
+    QVERIFY(rows.isEmpty());
+    QVERIFY(ascendingRows(rows).isEmpty());
+    QVERIFY(!rows.contains(0));
+    QVERIFY(!rows.contains(1022));
+
+    rows.insert(5);
+    QCOMPARE(ascendingRows(rows), QVector<int>({5}));
+}
+
+QTEST_APPLESS_MAIN(DanmakuDirtyRowSetTest)
+
+#include "danmaku_dirty_row_set_test.moc"
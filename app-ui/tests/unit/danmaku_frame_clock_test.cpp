@@ -0,0 +1,164 @@
+#include "danmaku/DanmakuController.hpp"
+#include "danmaku/DanmakuFrameClock.hpp"
+
+#include <QCoreApplication>
+#include <QTest>
+#include <QVariantList>
+#include <QVariantMap>
+
+namespace {
+
+QVariantList makeComments() {
+    QVariantMap comment;
+    comment.insert(QStringLiteral("comment_id"), QStringLiteral("clock-comment"));
+    comment.insert(QStringLiteral("user_id"), QStringLiteral("clock-user"));
+    comment.insert(QStringLiteral("text"), QStringLiteral("clock"));
+    comment.insert(QStringLiteral("at_ms"), 0);
+    QVariantList comments;
+    comments.push_back(comment);
+    return comments;
+}
+
+void prepareController(DanmakuController &controller) {
+    controller.setGlyphWarmupEnabled(false);
+    controller.setViewportSize(1280.0, 720.0);
+    controller.setLaneMetrics(36, 6);
+    controller.setPlaybackPaused(false);
+}
+
+} // namespace
+
+class DanmakuFrameClockTest : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanup();
+    void parseModeDefaultsToTimer();
+    void monotonicClockNeverGoesBackwards();
+    void timerModeSnapshotsDisableExtrapolation();
+    void vsyncModeSnapshotsCarryClockAndSpeed();
+    void vsyncTickAdvancesPositions();
+    void parametricSnapshotsOnlyChangeOnStateChanges();
+};
+
+void DanmakuFrameClockTest::initTestCase() {
+    qputenv("NICONEON_DANMAKU_WORKER", "off");
+    qputenv("NICONEON_SIMD_MODE", "scalar");
+}
+
+void DanmakuFrameClockTest::cleanup() {
+    qunsetenv("NICONEON_DANMAKU_CLOCK");
+}
+
+void DanmakuFrameClockTest::parseModeDefaultsToTimer() {
+    QCOMPARE(DanmakuFrameClock::parseMode(QString()), DanmakuFrameClockMode::Timer);
+    QCOMPARE(DanmakuFrameClock::parseMode(QStringLiteral("timer")), DanmakuFrameClockMode::Timer);
+    QCOMPARE(DanmakuFrameClock::parseMode(QStringLiteral(" VSync ")), DanmakuFrameClockMode::Vsync);
+    QCOMPARE(DanmakuFrameClock::modeName(DanmakuFrameClockMode::Vsync), QStringLiteral("vsync"));
+    QCOMPARE(DanmakuFrameClock::parseMode(QStringLiteral("parametric")), DanmakuFrameClockMode::Parametric);
+    QCOMPARE(DanmakuFrameClock::modeName(DanmakuFrameClockMode::Parametric), QStringLiteral("parametric"));
+}
+
+void DanmakuFrameClockTest::monotonicClockNeverGoesBackwards() {
+    qint64 previous = DanmakuFrameClock::nowNs();
+    for (int i = 0; i < 1000; ++i) {
+        const qint64 now = DanmakuFrameClock::nowNs();
+        QVERIFY(now >= previous);
+        previous = now;
+    }
+}
+
+void DanmakuFrameClockTest::timerModeSnapshotsDisableExtrapolation() {
+    DanmakuController controller;
+    prepareController(controller);
+    QCOMPARE(controller.frameClockMode(), DanmakuFrameClockMode::Timer);
+
+    controller.appendFromCore(makeComments(), 0);
+    const DanmakuRenderFrameConstPtr snapshot = controller.renderSnapshot();
+    QVERIFY(snapshot);
+    QCOMPARE(snapshot->instances.size(), 1);
+    QCOMPARE(snapshot->simulatedAtNs, qint64(0));
+    QVERIFY(!controller.wantsAnimationFrame());
+}
+
+void DanmakuFrameClockTest::vsyncModeSnapshotsCarryClockAndSpeed() {
+    qputenv("NICONEON_DANMAKU_CLOCK", "vsync");
+    DanmakuController controller;
+    prepareController(controller);
+    QCOMPARE(controller.frameClockMode(), DanmakuFrameClockMode::Vsync);
+
+    controller.appendFromCore(makeComments(), 0);
+    const DanmakuRenderFrameConstPtr playing = controller.renderSnapshot();
+    QVERIFY(playing);
+    QCOMPARE(playing->instances.size(), 1);
+    QVERIFY(playing->simulatedAtNs > 0);
+    QVERIFY(playing->simulatedAtNs <= DanmakuFrameClock::nowNs());
+    QCOMPARE(playing->scrollRate, 1.0);
+    QVERIFY(playing->instances.first().speed >= 120.0);
+    QVERIFY(controller.wantsAnimationFrame());
+
+    controller.setPlaybackPaused(true);
+    const DanmakuRenderFrameConstPtr paused = controller.renderSnapshot();
+    QCOMPARE(paused->scrollRate, 0.0);
+    QVERIFY(!controller.wantsAnimationFrame());
+}
+
+void DanmakuFrameClockTest::vsyncTickAdvancesPositions() {
+    qputenv("NICONEON_DANMAKU_CLOCK", "vsync");
+    DanmakuController controller;
+    prepareController(controller);
+
+    controller.appendFromCore(makeComments(), 0);
+    const DanmakuRenderFrameConstPtr before = controller.renderSnapshot();
+    const qreal xBefore = before->instances.first().x;
+    const qint64 simulatedBefore = before->simulatedAtNs;
+
+    QTest::qWait(20);
+    controller.advanceVsyncFrame();
+    QCoreApplication::processEvents();
+
+    const DanmakuRenderFrameConstPtr after = controller.renderSnapshot();
+    QCOMPARE(after->instances.size(), 1);
+    QVERIFY(after->instances.first().x < xBefore);
+    QVERIFY(after->simulatedAtNs > simulatedBefore);
+}
+
+void DanmakuFrameClockTest::parametricSnapshotsOnlyChangeOnStateChanges() {
+    qputenv("NICONEON_DANMAKU_CLOCK", "parametric");
+    DanmakuController controller;
+    prepareController(controller);
+    QCOMPARE(controller.frameClockMode(), DanmakuFrameClockMode::Parametric);
+
+    controller.appendFromCore(makeComments(), 0);
+    const DanmakuRenderFrameConstPtr spawned = controller.renderSnapshot();
+    QCOMPARE(spawned->instances.size(), 1);
+    QVERIFY(spawned->parametric);
+    QVERIFY(spawned->simulatedAtNs > 0);
+    QVERIFY(spawned->clockEpochNs > 0);
+    QCOMPARE(spawned->instances.first().fadeEndSec, 0.0);
+    QVERIFY(controller.wantsAnimationFrame());
+    const quint64 spawnedSequence = spawned->sequence;
+    const DanmakuRenderInstance spawnedInstance = spawned->instances.first();
+
+    QTest::qWait(100);
+    const DanmakuRenderFrameConstPtr flowing = controller.renderSnapshot();
+    QCOMPARE(flowing->sequence, spawnedSequence);
+    QCOMPARE(flowing->instances.first().x, spawnedInstance.x);
+
+    controller.applyNgUserFade(QStringLiteral("clock-user"));
+    const DanmakuRenderFrameConstPtr fading = controller.renderSnapshot();
+    QVERIFY(fading->sequence > spawnedSequence);
+    const DanmakuRenderInstance fadingInstance = fading->instances.first();
+    QVERIFY(fadingInstance.fadeEndSec > 0.0);
+    QVERIFY(fadingInstance.anchorScrollSec > spawnedInstance.anchorScrollSec);
+    const qreal predictedX = spawnedInstance.x
+        - spawnedInstance.speed * (fadingInstance.anchorScrollSec - spawnedInstance.anchorScrollSec);
+    QVERIFY(qAbs(fadingInstance.x - predictedX) < 0.5);
+
+    QTRY_COMPARE_WITH_TIMEOUT(controller.renderSnapshot()->instances.size(), 0, 1000);
+}
+
+QTEST_MAIN(DanmakuFrameClockTest)
+
+#include "danmaku_frame_clock_test.moc"
@@ -0,0 +1,125 @@
+#include "danmaku/DanmakuGlyphFallbackCache.hpp"
+#include "danmaku/DanmakuGlyphWarmer.hpp"
+#include "danmaku/DanmakuTextSpriteCache.hpp"
+
+#include <QFile>
+#include <QSignalSpy>
+#include <QTemporaryDir>
+#include <QTest>
+
+class DanmakuGlyphWarmerTest : public QObject {
+    Q_OBJECT
+
+private slots:
+    void fallbackCacheRoundTripsThroughDisk();
+    void fallbackCacheDiscardsOtherBaseFamily();
+    void fallbackFamiliesSkipBaseFamily();
+    void spriteFontAppendsFallbackFamilies();
+    void warmerResolvesBlocksInBackground();
+    void warmerSkipsPersistedBlocks();
+};
+
+void DanmakuGlyphWarmerTest::fallbackCacheRoundTripsThroughDisk() {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.filePath(QStringLiteral("nested/glyph-fallback-cache.json"));
+
+    DanmakuGlyphFallbackCache cache;
+    cache.load(path, QStringLiteral("Base Sans"));
+    QVERIFY(cache.insert(DanmakuGlyphFallbackCache::blockOf(U'あ'), QStringLiteral("Noto Sans CJK JP")));
+    QVERIFY(!cache.insert(DanmakuGlyphFallbackCache::blockOf(U'い'), QStringLiteral("Noto Sans CJK JP")));
+    QVERIFY(cache.save(path));
+
+    DanmakuGlyphFallbackCache loaded;
+    QVERIFY(loaded.load(path, QStringLiteral("Base Sans")));
+    QCOMPARE(loaded.size(), 1);
+    QCOMPARE(loaded.family(DanmakuGlyphFallbackCache::blockOf(U'う')), QStringLiteral("Noto Sans CJK JP"));
+}
+
+void DanmakuGlyphWarmerTest::fallbackCacheDiscardsOtherBaseFamily() {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.filePath(QStringLiteral("glyph-fallback-cache.json"));
+
+    DanmakuGlyphFallbackCache cache;
+    cache.load(path, QStringLiteral("Base Sans"));
+    cache.insert(DanmakuGlyphFallbackCache::blockOf(U'漢'), QStringLiteral("Noto Sans CJK JP"));
+    QVERIFY(cache.save(path));
+
+    DanmakuGlyphFallbackCache other;
+    QVERIFY(!other.load(path, QStringLiteral("Other Sans")));
+    QCOMPARE(other.size(), 0);
+    QCOMPARE(other.baseFamily(), QStringLiteral("Other Sans"));
+}
+
+void DanmakuGlyphWarmerTest::fallbackFamiliesSkipBaseFamily() {
+    DanmakuGlyphFallbackCache cache;
+    cache.load(QString(), QStringLiteral("Base Sans"));
+    cache.insert(DanmakuGlyphFallbackCache::blockOf(U'A'), QStringLiteral("Base Sans"));
+    cache.insert(DanmakuGlyphFallbackCache::blockOf(U'あ'), QStringLiteral("Noto Sans CJK JP"));
+    cache.insert(DanmakuGlyphFallbackCache::blockOf(U'漢'), QStringLiteral("Noto Sans CJK JP"));
+    cache.insert(DanmakuGlyphFallbackCache::blockOf(U'😀'), QStringLiteral("Noto Color Emoji"));
+
+    QCOMPARE(cache.size(), 4);
+    QCOMPARE(
+        cache.fallbackFamilies(),
+        QStringList({QStringLiteral("Noto Sans CJK JP"), QStringLiteral("Noto Color Emoji")}));
+}
+
+void DanmakuGlyphWarmerTest::spriteFontAppendsFallbackFamilies() {
+    const QFont plain = DanmakuTextSpriteCache::spriteFont(24, {});
+    QCOMPARE(plain.pixelSize(), 24);
+
+    const QFont withFallback = DanmakuTextSpriteCache::spriteFont(24, {QStringLiteral("Noto Sans CJK JP")});
+    QCOMPARE(withFallback.pixelSize(), 24);
+    QCOMPARE(withFallback.families().size(), 2);
+    QCOMPARE(withFallback.families().first(), plain.family());
+    QCOMPARE(withFallback.families().last(), QStringLiteral("Noto Sans CJK JP"));
+}
+
+void DanmakuGlyphWarmerTest::warmerResolvesBlocksInBackground() {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.filePath(QStringLiteral("glyph-fallback-cache.json"));
+
+    DanmakuGlyphWarmer warmer;
+    warmer.loadCache(path);
+    QCOMPARE(warmer.resolvedBlockCount(), 0);
+
+    warmer.warm(QStringLiteral("Aあ"), 24, 1.0);
+    QCOMPARE(warmer.inflightBatchCount(), 1);
+    QVERIFY(warmer.waitForDone(5000));
+    QTRY_COMPARE_WITH_TIMEOUT(warmer.inflightBatchCount(), 0, 1000);
+    QCOMPARE(warmer.resolvedBlockCount(), 2);
+    QVERIFY(warmer.waitForDone(5000));
+    QVERIFY(QFile::exists(path));
+}
+
+void DanmakuGlyphWarmerTest::warmerSkipsPersistedBlocks() {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.filePath(QStringLiteral("glyph-fallback-cache.json"));
+
+    {
+        DanmakuGlyphWarmer first;
+        first.loadCache(path);
+        first.warm(QStringLiteral("Aあ"), 24, 1.0);
+        QVERIFY(first.waitForDone(5000));
+        QTRY_COMPARE_WITH_TIMEOUT(first.inflightBatchCount(), 0, 1000);
+    }
+
+    DanmakuGlyphWarmer second;
+    second.loadCache(path);
+    QCOMPARE(second.resolvedBlockCount(), 2);
+    QSignalSpy familiesSpy(&second, &DanmakuGlyphWarmer::fallbackFamiliesChanged);
+
+    second.warm(QStringLiteral("Bい"), 24, 1.0);
+    QVERIFY(second.waitForDone(5000));
+    QTRY_COMPARE_WITH_TIMEOUT(second.inflightBatchCount(), 0, 1000);
+    QCOMPARE(second.resolvedBlockCount(), 2);
+    QCOMPARE(familiesSpy.count(), 0);
+}
+
+QTEST_MAIN(DanmakuGlyphWarmerTest)
+
+#include "danmaku_glyph_warmer_test.moc"
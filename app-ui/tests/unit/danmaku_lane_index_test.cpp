@@ -0,0 +1,298 @@
+#include "danmaku/DanmakuLaneIndex.hpp"
+
+#include <QRandomGenerator>
+#include <QTest>
+
+namespace {
+constexpr qreal kLaneTop = 10.0;
+constexpr qreal kLaneHeight = 42.0;
+constexpr qreal kItemHeight = 42.0;
+constexpr int kLanes = 8;
+
+qreal laneY(int lane) {
+    return kLaneTop + lane * kLaneHeight;
+}
+
+struct Fixture {
+    Fixture() : index(&items, &slotMap) {
+        index.setGeometry(kLanes, kLaneTop, kLaneHeight, kItemHeight);
+    }
+
+    DanmakuItemHandle add(qreal x, qreal y, int width, qreal speed = 0.0) {
+        const int row = items.appendRow();
+        items.x[row] = x;
+        items.y[row] = y;
+        items.speed[row] = speed;
+        items.widthEstimate[row] = width;
+        items.flags[row] = DanmakuItemFlagActive;
+        const DanmakuItemHandle handle = slotMap.insert(row);
+        index.upsert(handle);
+        return handle;
+    }
+
+    void release(DanmakuItemHandle handle) {
+        const int row = slotMap.row(handle);
+        index.remove(handle);
+        slotMap.remove(handle);
+        const int lastRow = items.size() - 1;
+        if (row != lastRow) {
+            items.moveRow(lastRow, row);
+            slotMap.relocate(lastRow, row);
+        }
+        items.truncate(lastRow);
+        slotMap.truncate(lastRow);
+    }
+
+    bool bruteForceOverlap(int lane, qreal left, qreal right, DanmakuItemHandle exclude) const {
+        for (int row = 0; row < items.size(); ++row) {
+            if (slotMap.handleAt(row) == exclude || index.laneForY(items.y[row]) != lane) {
+                continue;
+            }
+            const qreal otherLeft = items.x[row];
+            const qreal otherRight = otherLeft + items.widthEstimate[row];
+            if (!(right < otherLeft || otherRight < left)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    int bruteForceRowWithin(const QPointF &point, qreal slop) const {
+        int best = -1;
+        for (int row = 0; row < items.size(); ++row) {
+            const bool contains = point.x() + slop >= items.x[row]
+                && point.x() - slop <= items.x[row] + items.widthEstimate[row]
+                && point.y() + slop >= items.y[row]
+                && point.y() - slop <= items.y[row] + kItemHeight;
+            if (contains) {
+                best = row;
+            }
+        }
+        return best;
+    }
+
+    void move(qreal travel) {
+        for (int row = 0; row < items.size(); ++row) {
+            if (!items.hasFlag(row, DanmakuItemFlagFrozen)) {
+                items.x[row] -= items.speed[row] * travel;
+            }
+        }
+        index.markMoved(travel);
+    }
+
+    int bruteForceRowAt(const QPointF &point) const {
+        const int row = bruteForceRowWithin(point, 0.0);
+        return row >= 0 ? row : bruteForceRowWithin(point, DanmakuLaneIndex::kDragPickSlopPx);
+    }
+
+    DanmakuItemStore items;
+    DanmakuSlotMap slotMap;
+    DanmakuLaneIndex index;
+};
+} // namespace
+
+class DanmakuLaneIndexTest : public QObject {
+    Q_OBJECT
+
+private slots:
+    void rowsAreBucketedByLaneGeometry();
+    void hitTestReturnsTopmostContainingRow();
+    void hitTestFallsBackToPickSlop();
+    void tailCollisionAndOverlapQueries();
+    void queriesMatchBruteForceWhileLanesReorder();
+    void lanesOnlyResortWhenSpeedsCanReorderRows();
+    void cullingPopsLaneHeadsAcrossSwapRemove();
+    void upsertMovesRowsBetweenLanes();
+};
+
+void DanmakuLaneIndexTest::rowsAreBucketedByLaneGeometry() {
+    Fixture fixture;
+    const DanmakuItemHandle aligned = fixture.add(100.0, laneY(3), 80);
+    const DanmakuItemHandle dragged = fixture.add(100.0, laneY(3) + 17.0, 80);
+    const DanmakuItemHandle belowViewport = fixture.add(100.0, laneY(kLanes), 80);
+    const DanmakuItemHandle nearlyAligned = fixture.add(300.0, laneY(5) + 0.25, 80);
+
+    QCOMPARE(fixture.index.laneOf(aligned), 3);
+    QCOMPARE(fixture.index.laneOf(dragged), DanmakuLaneIndex::kFloatingLane);
+    QCOMPARE(fixture.index.laneOf(belowViewport), DanmakuLaneIndex::kFloatingLane);
+    QCOMPARE(fixture.index.laneOf(nearlyAligned), 5);
+    QCOMPARE(fixture.index.laneSize(3), 1);
+    QCOMPARE(fixture.index.floatingCount(), 2);
+
+    fixture.index.remove(dragged);
+    QCOMPARE(fixture.index.laneOf(dragged), DanmakuLaneIndex::kAbsentLane);
+    QCOMPARE(fixture.index.floatingCount(), 1);
+
+    fixture.index.rebuild();
+    QCOMPARE(fixture.index.laneOf(dragged), DanmakuLaneIndex::kFloatingLane);
+    QCOMPARE(fixture.index.laneOf(aligned), 3);
+    QCOMPARE(fixture.index.floatingCount(), 2);
+}
+
+void DanmakuLaneIndexTest::hitTestReturnsTopmostContainingRow() {
+    Fixture fixture;
+    fixture.add(100.0, laneY(1), 120);
+    fixture.add(180.0, laneY(1), 120);
+    fixture.add(400.0, laneY(2), 60);
+    fixture.add(150.0, laneY(1) + 20.0, 50);
+
+    QCOMPARE(fixture.index.rowAt(QPointF(110.0, laneY(1) + 5.0)), 0);
+    QCOMPARE(fixture.index.rowAt(QPointF(200.0, laneY(1) + 5.0)), 1);
+    QCOMPARE(fixture.index.rowAt(QPointF(160.0, laneY(1) + 30.0)), 3);
+    QCOMPARE(fixture.index.rowAt(QPointF(420.0, laneY(2) + 41.0)), 2);
+    QCOMPARE(fixture.index.rowAt(QPointF(350.0, laneY(1) + 5.0)), -1);
+    QCOMPARE(fixture.index.rowAt(QPointF(110.0, laneY(5) + 5.0)), -1);
+    QCOMPARE(fixture.index.rowAt(QPointF(110.0, 0.0)), -1);
+}
+
+void DanmakuLaneIndexTest::hitTestFallsBackToPickSlop() {
+    Fixture fixture;
+    fixture.add(100.0, laneY(1), 120);
+    fixture.add(223.0, laneY(1), 60);
+    fixture.add(400.0, laneY(3) + 12.0, 80);
+
+    QCOMPARE(fixture.index.rowAt(QPointF(221.0, laneY(1) + 5.0)), 1);
+    QCOMPARE(fixture.index.rowAt(QPointF(220.0, laneY(1) + 5.0)), 0);
+    QCOMPARE(fixture.index.rowAt(QPointF(97.0, laneY(1) + 5.0)), 0);
+    QCOMPARE(fixture.index.rowAt(QPointF(95.0, laneY(1) + 5.0)), -1);
+    QCOMPARE(fixture.index.rowAt(QPointF(420.0, laneY(3) + 9.0)), 2);
+    QCOMPARE(fixture.index.rowAt(QPointF(420.0, laneY(3) + 57.0)), 2);
+    QCOMPARE(fixture.index.rowAt(QPointF(420.0, laneY(3) + 59.0)), -1);
+}
+
+void DanmakuLaneIndexTest::tailCollisionAndOverlapQueries() {
+    Fixture fixture;
+    const DanmakuItemHandle head = fixture.add(100.0, laneY(0), 100);
+    const DanmakuItemHandle tail = fixture.add(400.0, laneY(0), 100);
+
+    QCOMPARE(fixture.index.laneTail(0), tail);
+    QCOMPARE(fixture.index.laneTail(1), DanmakuSlotMap::kInvalidHandle);
+    QVERIFY(!fixture.index.hasOverlapInLane(0, 520.0, 600.0, DanmakuSlotMap::kInvalidHandle));
+    QVERIFY(fixture.index.hasOverlapInLane(0, 480.0, 600.0, DanmakuSlotMap::kInvalidHandle));
+    QVERIFY(fixture.index.hasOverlapInLane(0, 150.0, 160.0, DanmakuSlotMap::kInvalidHandle));
+    QVERIFY(!fixture.index.hasOverlapInLane(0, 150.0, 160.0, head));
+    QVERIFY(!fixture.index.hasOverlapInLane(0, 210.0, 390.0, DanmakuSlotMap::kInvalidHandle));
+    QVERIFY(fixture.index.hasOverlapInLane(0, 200.0, 210.0, DanmakuSlotMap::kInvalidHandle));
+    QVERIFY(!fixture.index.hasOverlapInLane(1, 0.0, 1000.0, DanmakuSlotMap::kInvalidHandle));
+    QVERIFY(!fixture.index.hasOverlapInLane(kLanes, 0.0, 1000.0, DanmakuSlotMap::kInvalidHandle));
+}
+
+void DanmakuLaneIndexTest::queriesMatchBruteForceWhileLanesReorder() {
+    Fixture fixture;
+    QRandomGenerator random(20240611);
+    for (int i = 0; i < 400; ++i) {
+        const int lane = static_cast<int>(random.bounded(kLanes));
+        const qreal y = random.bounded(10) == 0 ? laneY(lane) + 13.0 : laneY(lane);
+        fixture.add(random.bounded(1600.0) - 200.0, y, 40 + static_cast<int>(random.bounded(400)), 1000.0 + (i % 7) * 150.0);
+    }
+
+    const int initialResorts = fixture.index.resortCount();
+    for (int step = 0; step < 30; ++step) {
+        fixture.move(0.1);
+
+        for (int query = 0; query < 40; ++query) {
+            const int lane = static_cast<int>(random.bounded(kLanes));
+            const qreal left = random.bounded(2400.0) - 1800.0;
+            const qreal right = left + random.bounded(300.0);
+            const DanmakuItemHandle exclude = fixture.slotMap.handleAt(static_cast<int>(random.bounded(fixture.items.size())));
+            QCOMPARE(
+                fixture.index.hasOverlapInLane(lane, left, right, exclude),
+                fixture.bruteForceOverlap(lane, left, right, exclude));
+
+            const QPointF point(random.bounded(2400.0) - 1800.0, random.bounded(kLanes * kLaneHeight + kLaneTop));
+            QCOMPARE(fixture.index.rowAt(point), fixture.bruteForceRowAt(point));
+        }
+    }
+    QVERIFY(fixture.index.resortCount() > initialResorts);
+}
+
+void DanmakuLaneIndexTest::lanesOnlyResortWhenSpeedsCanReorderRows() {
+    Fixture fixture;
+    fixture.add(100.0, laneY(0), 80, 150.0);
+    fixture.add(300.0, laneY(0), 80, 150.0);
+    fixture.add(500.0, laneY(0), 80, 120.0);
+    const DanmakuItemHandle slow = fixture.add(100.0, laneY(1), 80, 100.0);
+    const DanmakuItemHandle fast = fixture.add(200.0, laneY(1), 80, 200.0);
+    const DanmakuItemHandle frozen = fixture.add(100.0, laneY(2), 80);
+    fixture.items.setFlag(fixture.slotMap.row(frozen), DanmakuItemFlagFrozen, true);
+    const DanmakuItemHandle approaching = fixture.add(300.0, laneY(2), 80, 100.0);
+
+    const int initialResorts = fixture.index.resortCount();
+    for (int step = 0; step < 9; ++step) {
+        fixture.move(0.1);
+        for (int lane = 0; lane < 3; ++lane) {
+            QCOMPARE(fixture.index.hasOverlapInLane(lane, -200.0, 600.0, DanmakuSlotMap::kInvalidHandle), true);
+        }
+    }
+    QCOMPARE(fixture.index.resortCount(), initialResorts);
+    QCOMPARE(fixture.index.laneTail(1), fast);
+    QCOMPARE(fixture.index.laneTail(2), approaching);
+
+    fixture.move(0.2);
+    QCOMPARE(fixture.index.laneTail(1), slow);
+    QCOMPARE(fixture.index.resortCount(), initialResorts + 1);
+
+    fixture.move(1.0);
+    QCOMPARE(fixture.index.laneTail(2), frozen);
+    QCOMPARE(fixture.index.resortCount(), initialResorts + 2);
+
+    for (int step = 0; step < 10; ++step) {
+        fixture.move(0.1);
+        QCOMPARE(fixture.index.laneTail(0), fixture.slotMap.handleAt(2));
+        QCOMPARE(fixture.index.laneTail(1), slow);
+    }
+    QCOMPARE(fixture.index.resortCount(), initialResorts + 2);
+}
+
+void DanmakuLaneIndexTest::cullingPopsLaneHeadsAcrossSwapRemove() {
+    Fixture fixture;
+    QVector<DanmakuItemHandle> laneZero;
+    for (int i = 0; i < 100; ++i) {
+        laneZero.push_back(fixture.add(i * 150.0, laneY(0), 120));
+        fixture.add(i * 150.0 + 40.0, laneY(1), 120);
+    }
+
+    for (int i = 0; i < 90; ++i) {
+        QCOMPARE(fixture.index.laneSize(0), 100 - i);
+        fixture.release(laneZero[i]);
+        QCOMPARE(fixture.index.laneOf(laneZero[i]), DanmakuLaneIndex::kAbsentLane);
+    }
+    QCOMPARE(fixture.index.laneSize(0), 10);
+    QCOMPARE(fixture.index.laneSize(1), 100);
+    QCOMPARE(fixture.index.laneTail(0), laneZero.last());
+
+    const int lastRow = fixture.slotMap.row(laneZero.last());
+    QCOMPARE(fixture.index.rowAt(QPointF(99 * 150.0 + 10.0, laneY(0) + 10.0)), lastRow);
+    QVERIFY(fixture.index.hasOverlapInLane(0, 92 * 150.0, 92 * 150.0 + 10.0, DanmakuSlotMap::kInvalidHandle));
+    QVERIFY(!fixture.index.hasOverlapInLane(0, 0.0, 80 * 150.0, DanmakuSlotMap::kInvalidHandle));
+}
+
+void DanmakuLaneIndexTest::upsertMovesRowsBetweenLanes() {
+    Fixture fixture;
+    const DanmakuItemHandle moving = fixture.add(100.0, laneY(2), 100);
+    fixture.add(500.0, laneY(4), 100);
+
+    const int row = fixture.slotMap.row(moving);
+    fixture.items.x[row] = 480.0;
+    fixture.items.y[row] = laneY(2) + 25.0;
+    fixture.index.upsert(moving);
+    QCOMPARE(fixture.index.laneOf(moving), DanmakuLaneIndex::kFloatingLane);
+    QCOMPARE(fixture.index.rowAt(QPointF(490.0, laneY(2) + 30.0)), row);
+
+    fixture.items.y[row] = laneY(4);
+    fixture.index.upsert(moving);
+    QCOMPARE(fixture.index.laneOf(moving), 4);
+    QCOMPARE(fixture.index.laneSize(2), 0);
+    QCOMPARE(fixture.index.laneSize(4), 2);
+    QCOMPARE(fixture.index.floatingCount(), 0);
+    QCOMPARE(fixture.index.laneTail(4), fixture.slotMap.handleAt(1));
+    QVERIFY(fixture.index.hasOverlapInLane(4, 575.0, 580.0, moving));
+
+    fixture.items.flags[row] = 0;
+    fixture.index.upsert(moving);
+    QCOMPARE(fixture.index.laneOf(moving), DanmakuLaneIndex::kAbsentLane);
+}
+
+QTEST_APPLESS_MAIN(DanmakuLaneIndexTest)
+
+#include "danmaku_lane_index_test.moc"
@@ -0,0 +1,172 @@
+#include "danmaku/DanmakuLaneScheduler.hpp"
+
+#include <QRandomGenerator>
+#include <QTest>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+constexpr qreal kSpawnX = 1292.0;
+constexpr qreal kGapPx = 20.0;
+
+DanmakuLaneScheduler makeScheduler(int lanes) {
+    DanmakuLaneScheduler scheduler;
+    scheduler.setLaneCount(lanes);
+    scheduler.setSpawnGeometry(kSpawnX, kGapPx);
+    return scheduler;
+}
+} // namespace
+
+class DanmakuLaneSchedulerTest : public QObject {
+    Q_OBJECT
+
+private slots:
+    void emptyLanesArePickedRoundRobin();
+    void entryGapDelaysSameSpeedComment();
+    void fasterCommentWaitsUntilItCannotCatchTail();
+    void spawnsAtEarliestTimeNeverCatchTail();
+    void burstFillsAllLanesBeforeForcing();
+    void laneCountChangeKeepsExistingTails();
+    void congestedPickMatchesBruteForceScan();
+};
+
+void DanmakuLaneSchedulerTest::emptyLanesArePickedRoundRobin() {
+    DanmakuLaneScheduler scheduler = makeScheduler(3);
+
+    for (int expected : {0, 1, 2}) {
+        const DanmakuLaneScheduler::Pick pick = scheduler.pick(kSpawnX, 120.0);
+        QCOMPARE(pick.lane, expected);
+        QVERIFY(!pick.forced);
+    }
+}
+
+void DanmakuLaneSchedulerTest::entryGapDelaysSameSpeedComment() {
+    DanmakuLaneScheduler scheduler = makeScheduler(1);
+    scheduler.assign(0, kSpawnX + 100.0, 100.0);
+
+    QVERIFY(std::abs(scheduler.earliestSpawnSec(0, kSpawnX, 100.0) - 1.2) < 1e-9);
+
+    const DanmakuLaneScheduler::Pick blocked = scheduler.pick(kSpawnX, 100.0);
+    QVERIFY(blocked.forced);
+    QVERIFY(std::abs(blocked.waitSec - 1.2) < 1e-9);
+
+    scheduler.advance(1.2);
+    const DanmakuLaneScheduler::Pick ready = scheduler.pick(kSpawnX, 100.0);
+    QVERIFY(!ready.forced);
+    QCOMPARE(ready.lane, 0);
+}
+
+void DanmakuLaneSchedulerTest::fasterCommentWaitsUntilItCannotCatchTail() {
+    DanmakuLaneScheduler scheduler = makeScheduler(1);
+    scheduler.assign(0, kSpawnX + 100.0, 100.0);
+
+    const qreal tailExitAt = (kSpawnX + 100.0) / 100.0;
+    const qreal expected = tailExitAt - (kSpawnX - kGapPx) / 200.0;
+    const qreal earliest = scheduler.earliestSpawnSec(0, kSpawnX, 200.0);
+    QVERIFY(std::abs(earliest - expected) < 1e-9);
+    QVERIFY(earliest > scheduler.earliestSpawnSec(0, kSpawnX, 100.0));
+
+    scheduler.advance(earliest - 0.01);
+    QVERIFY(scheduler.pick(kSpawnX, 200.0).forced);
+    scheduler.advance(0.01);
+    QVERIFY(!scheduler.pick(kSpawnX, 200.0).forced);
+}
+
+void DanmakuLaneSchedulerTest::spawnsAtEarliestTimeNeverCatchTail() {
+    DanmakuLaneScheduler scheduler = makeScheduler(1);
+    quint32 seed = 7;
+    qreal tailRight = kSpawnX + 80.0;
+    qreal tailSpeed = 150.0;
+    scheduler.assign(0, tailRight, tailSpeed);
+
+    for (int i = 0; i < 200; ++i) {
+        seed = seed * 1664525u + 1013904223u;
+        const qreal speed = 120.0 + (seed >> 16) % 70;
+        const qreal width = 40.0 + (seed >> 8) % 400;
+
+        const qreal spawnAt = scheduler.earliestSpawnSec(0, kSpawnX, speed);
+        scheduler.advance(std::max<qreal>(0.0, spawnAt - scheduler.now()));
+        const qreal tailRightNow = tailRight - tailSpeed * scheduler.now();
+        const qreal tailExitAfter = std::max<qreal>(0.0, tailRightNow / tailSpeed);
+        for (int step = 0; step <= 32; ++step) {
+            const qreal t = tailExitAfter * step / 32.0;
+            const qreal newLeft = kSpawnX - speed * t;
+            const qreal oldRight = tailRightNow - tailSpeed * t;
+            QVERIFY(newLeft + 1e-6 >= oldRight + kGapPx);
+        }
+
+        const DanmakuLaneScheduler::Pick pick = scheduler.pick(kSpawnX, speed);
+        QVERIFY(!pick.forced);
+        scheduler.assign(0, kSpawnX + width, speed);
+        tailRight = kSpawnX + width + speed * scheduler.now();
+        tailSpeed = speed;
+    }
+}
+
+void DanmakuLaneSchedulerTest::burstFillsAllLanesBeforeForcing() {
+    DanmakuLaneScheduler scheduler = makeScheduler(120);
+
+    QVector<int> usedLanes;
+    for (int i = 0; i < 120; ++i) {
+        const DanmakuLaneScheduler::Pick pick = scheduler.pick(kSpawnX, 150.0);
+        QVERIFY(!pick.forced);
+        usedLanes.push_back(pick.lane);
+        scheduler.assign(pick.lane, kSpawnX + 200.0, 150.0);
+    }
+    std::sort(usedLanes.begin(), usedLanes.end());
+    QVERIFY(std::unique(usedLanes.begin(), usedLanes.end()) == usedLanes.end());
+
+    const DanmakuLaneScheduler::Pick forced = scheduler.pick(kSpawnX, 150.0);
+    QVERIFY(forced.forced);
+    QVERIFY(std::abs(forced.waitSec - (200.0 + kGapPx) / 150.0) < 1e-9);
+}
+
+void DanmakuLaneSchedulerTest::laneCountChangeKeepsExistingTails() {
+    DanmakuLaneScheduler scheduler = makeScheduler(2);
+    scheduler.assign(0, kSpawnX + 300.0, 120.0);
+    scheduler.assign(1, kSpawnX + 300.0, 120.0);
+
+    scheduler.setLaneCount(3);
+    QCOMPARE(scheduler.laneCount(), 3);
+    const DanmakuLaneScheduler::Pick pick = scheduler.pick(kSpawnX, 120.0);
+    QVERIFY(!pick.forced);
+    QCOMPARE(pick.lane, 2);
+
+    scheduler.reset();
+    QVERIFY(!scheduler.pick(kSpawnX, 120.0).forced);
+    QVERIFY(!scheduler.pick(kSpawnX, 120.0).forced);
+}
+
+void DanmakuLaneSchedulerTest::congestedPickMatchesBruteForceScan() {
+    DanmakuLaneScheduler scheduler = makeScheduler(150);
+    QRandomGenerator random(7);
+
+    for (int step = 0; step < 4000; ++step) {
+        const qreal speed = 80.0 + random.bounded(300.0);
+        qreal bestAt = std::numeric_limits<qreal>::infinity();
+        for (int lane = 0; lane < scheduler.laneCount(); ++lane) {
+            bestAt = std::min(bestAt, scheduler.earliestSpawnSec(lane, kSpawnX, speed));
+        }
+
+        const DanmakuLaneScheduler::Pick pick = scheduler.pick(kSpawnX, speed);
+        const qreal pickedAt = scheduler.earliestSpawnSec(pick.lane, kSpawnX, speed);
+        QCOMPARE(pick.forced, bestAt > scheduler.now());
+        if (pick.forced) {
+            QCOMPARE(pickedAt, bestAt);
+            QVERIFY(std::abs(pick.waitSec - (bestAt - scheduler.now())) < 1e-9);
+        } else {
+            QVERIFY(pickedAt <= scheduler.now());
+        }
+
+        scheduler.assign(pick.lane, kSpawnX + 40.0 + random.bounded(400.0), speed);
+        if (random.bounded(4) == 0) {
+            scheduler.advance(random.bounded(0.5));
+        }
+    }
+}
+
+QTEST_APPLESS_MAIN(DanmakuLaneSchedulerTest)
+
+#include "danmaku_lane_scheduler_test.moc"
@@ -0,0 +1,128 @@
+#include "danmaku/DanmakuRenderSnapshotChannel.hpp"
+
+#include <QTest>
+
+namespace {
+void publishInstances(DanmakuRenderSnapshotChannel &channel, int count) {
+    DanmakuRenderFrame &frame = channel.backFrame();
+    frame.instances.resize(count);
+    for (int i = 0; i < count; ++i) {
+        frame.instances[i].spriteId = static_cast<DanmakuSpriteId>(i + 1);
+    }
+    channel.publish();
+}
+} // namespace
+
+class DanmakuRenderSnapshotChannelTest : public QObject {
+    Q_OBJECT
+
+private slots:
+    void consumeWithoutPublishReturnsEmptyFrame();
+    void consumeReturnsLatestPublishedFrame();
+    void consumeKeepsFrontUntilNextPublish();
+    void producerNeverWritesIntoConsumedFrame();
+    void producerDetachesFramesStillHeldByConsumers();
+    void countersTrackSkippedFrames();
+};
+
+void DanmakuRenderSnapshotChannelTest::consumeWithoutPublishReturnsEmptyFrame() {
+    DanmakuRenderSnapshotChannel channel;
+
+    const DanmakuRenderFrameConstPtr frame = channel.consume();
+    QVERIFY(frame);
+    QCOMPARE(frame->sequence, quint64(0));
+    QVERIFY(frame->instances.isEmpty());
+}
+
+void DanmakuRenderSnapshotChannelTest::consumeReturnsLatestPublishedFrame() {
+    DanmakuRenderSnapshotChannel channel;
+
+    publishInstances(channel, 1);
+    publishInstances(channel, 2);
+    publishInstances(channel, 3);
+
+    const DanmakuRenderFrameConstPtr frame = channel.consume();
+    QCOMPARE(frame->sequence, quint64(3));
+    QCOMPARE(frame->instances.size(), 3);
+}
+
+void DanmakuRenderSnapshotChannelTest::consumeKeepsFrontUntilNextPublish() {
+    DanmakuRenderSnapshotChannel channel;
+
+    publishInstances(channel, 4);
+    const DanmakuRenderFrameConstPtr first = channel.consume();
+    const DanmakuRenderFrameConstPtr second = channel.consume();
+    QCOMPARE(first.data(), second.data());
+    QCOMPARE(second->sequence, quint64(1));
+}
+
+void DanmakuRenderSnapshotChannelTest::producerNeverWritesIntoConsumedFrame() {
+    DanmakuRenderSnapshotChannel channel;
+
+    publishInstances(channel, 5);
+    const DanmakuRenderFrameConstPtr front = channel.consume();
+
+    for (int i = 0; i < 8; ++i) {
+        QVERIFY(&channel.backFrame() != front.data());
+        publishInstances(channel, 10 + i);
+    }
+
+    QCOMPARE(front->sequence, quint64(1));
+    QCOMPARE(front->instances.size(), 5);
+
+    const DanmakuRenderFrameConstPtr latest = channel.consume();
+    QVERIFY(latest.data() != front.data());
+    QCOMPARE(latest->sequence, quint64(9));
+    QCOMPARE(latest->instances.size(), 17);
+}
+
+void DanmakuRenderSnapshotChannelTest::producerDetachesFramesStillHeldByConsumers() {
+    DanmakuRenderSnapshotChannel channel;
+
+    publishInstances(channel, 3);
+    const DanmakuRenderFrameConstPtr held = channel.consume();
+    publishInstances(channel, 4);
+    QCOMPARE(channel.consume()->sequence, quint64(2));
+
+    for (int i = 0; i < 6; ++i) {
+        QVERIFY(&channel.backFrame() != held.data());
+        publishInstances(channel, 20 + i);
+        channel.consume();
+    }
+    QCOMPARE(held->sequence, quint64(1));
+    QCOMPARE(held->instances.size(), 3);
+    QCOMPARE(channel.takeCounters().detached, quint64(1));
+
+    publishInstances(channel, 1);
+    channel.consume();
+    publishInstances(channel, 2);
+    publishInstances(channel, 3);
+    QCOMPARE(channel.takeCounters().detached, quint64(0));
+}
+
+void DanmakuRenderSnapshotChannelTest::countersTrackSkippedFrames() {
+    DanmakuRenderSnapshotChannel channel;
+
+    publishInstances(channel, 1);
+    publishInstances(channel, 1);
+    publishInstances(channel, 1);
+    channel.consume();
+    channel.consume();
+    publishInstances(channel, 1);
+    channel.consume();
+
+    const DanmakuRenderSnapshotChannel::Counters counters = channel.takeCounters();
+    QCOMPARE(counters.published, quint64(4));
+    QCOMPARE(counters.consumed, quint64(2));
+    QCOMPARE(counters.skipped, quint64(2));
+    QCOMPARE(counters.detached, quint64(0));
+
+    const DanmakuRenderSnapshotChannel::Counters cleared = channel.takeCounters();
+    QCOMPARE(cleared.published, quint64(0));
+    QCOMPARE(cleared.consumed, quint64(0));
+    QCOMPARE(cleared.skipped, quint64(0));
+}
+
+QTEST_APPLESS_MAIN(DanmakuRenderSnapshotChannelTest)
+
+#include "danmaku_render_snapshot_channel_test.moc"
@@ -0,0 +1,287 @@
+#include "danmaku/DanmakuController.hpp"
+#include "danmaku/DanmakuSessionRecorder.hpp"
+#include "danmaku/DanmakuSessionReplayer.hpp"
+
+#include <QFile>
+#include <QTemporaryDir>
+#include <QTest>
+#include <QVariantList>
+#include <QVariantMap>
+
+namespace {
+
+QVariantMap makeComment(const QString &commentId, const QString &userId, const QString &text, qint64 atMs) {
+    QVariantMap comment;
+    comment.insert(QStringLiteral("comment_id"), commentId);
+    comment.insert(QStringLiteral("user_id"), userId);
+    comment.insert(QStringLiteral("text"), text);
+    comment.insert(QStringLiteral("at_ms"), atMs);
+    return comment;
+}
+
+QVariantList makeBatch(int first, int count, qint64 atMs) {
+    QVariantList comments;
+    for (int i = first; i < first + count; ++i) {
+        comments.push_back(makeComment(
+            QStringLiteral("c%1").arg(i),
+            QStringLiteral("u%1").arg(i % 3),
+            QStringLiteral("comment %1").arg(i),
+            atMs));
+    }
+    return comments;
+}
+
+DanmakuSessionEvent makeEvent(DanmakuSessionEventType type, qint64 atUs) {
+    DanmakuSessionEvent event;
+    event.type = type;
+    event.atUs = atUs;
+    return event;
+}
+
+QVector<DanmakuSessionEvent> scriptedSession() {
+    QVector<DanmakuSessionEvent> events;
+    DanmakuSessionEvent viewport = makeEvent(DanmakuSessionEventType::ViewportSize, 0);
+    viewport.args[0] = 1280.0;
+    viewport.args[1] = 720.0;
+    events.push_back(viewport);
+
+    DanmakuSessionEvent play = makeEvent(DanmakuSessionEventType::PlaybackPaused, 0);
+    play.args[0] = 0.0;
+    events.push_back(play);
+
+    for (int batch = 0; batch < 6; ++batch) {
+        DanmakuSessionEvent append = makeEvent(DanmakuSessionEventType::AppendComments, batch * 250000);
+        append.playbackPositionMs = batch * 250;
+        const QVariantList comments = makeBatch(batch * 8, 8, batch * 250);
+        for (const QVariant &entry : comments) {
+            const QVariantMap map = entry.toMap();
+            DanmakuSessionComment comment;
+            comment.commentId = map.value(QStringLiteral("comment_id")).toString();
+            comment.userId = map.value(QStringLiteral("user_id")).toString();
+            comment.text = map.value(QStringLiteral("text")).toString();
+            comment.atMs = map.value(QStringLiteral("at_ms")).toLongLong();
+            append.comments.push_back(comment);
+        }
+        events.push_back(append);
+    }
+
+    DanmakuSessionEvent rate = makeEvent(DanmakuSessionEventType::PlaybackRate, 900000);
+    rate.args[0] = 1.5;
+    events.push_back(rate);
+
+    DanmakuSessionEvent fade = makeEvent(DanmakuSessionEventType::NgUserFade, 1200000);
+    fade.userId = QStringLiteral("u1");
+    events.push_back(fade);
+    events.push_back(makeEvent(DanmakuSessionEventType::ResetForSeek, 1800000));
+    return events;
+}
+
+bool writeSession(const QString &path, const QVector<DanmakuSessionEvent> &events) {
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    QDataStream stream(&file);
+    DanmakuSessionRecorder::prepareStream(stream);
+    stream << DanmakuSessionRecorder::kMagic << DanmakuSessionRecorder::kFormatVersion;
+    qint64 previousAtUs = 0;
+    for (const DanmakuSessionEvent &event : events) {
+        event.write(stream, previousAtUs);
+        previousAtUs = event.atUs;
+    }
+    return stream.status() == QDataStream::Ok;
+}
+
+void prepareController(DanmakuController &controller) {
+    controller.setGlyphWarmupEnabled(false);
+    controller.setLaneMetrics(36, 6);
+}
+
+} // namespace
+
+class DanmakuSessionReplayTest : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void eventsRoundTripThroughFile();
+    void truncatedRecordingKeepsCompleteEvents();
+    void controllerRecordsPublicInputs();
+    void replayIsFrameForFrameReproducible();
+    void frameDigestTracksInstanceState();
+};
+
+void DanmakuSessionReplayTest::initTestCase() {
+    qputenv("NICONEON_DANMAKU_WORKER", "off");
+    qputenv("NICONEON_SIMD_MODE", "scalar");
+    qputenv("NICONEON_GLYPH_FALLBACK_CACHE", "off");
+    qputenv("NICONEON_DANMAKU_GOVERNOR", "off");
+    qputenv("NICONEON_DANMAKU_RASTER_THREADS", "0");
+    qunsetenv("NICONEON_DANMAKU_RECORD");
+    qunsetenv("NICONEON_DANMAKU_CLOCK");
+}
+
+void DanmakuSessionReplayTest::eventsRoundTripThroughFile() {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.filePath(QStringLiteral("session.ndsr"));
+    const QVector<DanmakuSessionEvent> events = scriptedSession();
+    QVERIFY(writeSession(path, events));
+
+    DanmakuSessionReplayer replayer;
+    QString error;
+    QVERIFY2(replayer.load(path, &error), qPrintable(error));
+    QCOMPARE(replayer.events().size(), events.size());
+    for (int i = 0; i < events.size(); ++i) {
+        const DanmakuSessionEvent &expected = events.at(i);
+        const DanmakuSessionEvent &actual = replayer.events().at(i);
+        QVERIFY(actual.type == expected.type);
+        QCOMPARE(actual.atUs, expected.atUs);
+        QCOMPARE(actual.playbackPositionMs, expected.playbackPositionMs);
+        QCOMPARE(actual.userId, expected.userId);
+        for (int arg = 0; arg < DanmakuSessionEvent::kMaxArguments; ++arg) {
+            QCOMPARE(actual.args[arg], expected.args[arg]);
+        }
+        QCOMPARE(actual.comments.size(), expected.comments.size());
+        for (int c = 0; c < expected.comments.size(); ++c) {
+            QCOMPARE(actual.comments.at(c).commentId, expected.comments.at(c).commentId);
+            QCOMPARE(actual.comments.at(c).userId, expected.comments.at(c).userId);
+            QCOMPARE(actual.comments.at(c).text, expected.comments.at(c).text);
+            QCOMPARE(actual.comments.at(c).atMs, expected.comments.at(c).atMs);
+        }
+    }
+}
+
+void DanmakuSessionReplayTest::truncatedRecordingKeepsCompleteEvents() {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.filePath(QStringLiteral("session.ndsr"));
+    const QVector<DanmakuSessionEvent> events = scriptedSession();
+    QVERIFY(writeSession(path, events));
+
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::ReadWrite));
+    QVERIFY(file.resize(file.size() - 3));
+    file.close();
+
+    DanmakuSessionReplayer replayer;
+    QVERIFY(replayer.load(path));
+    QCOMPARE(replayer.events().size(), events.size() - 1);
+
+    QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Truncate));
+    file.write("not a session");
+    file.close();
+    QString error;
+    QVERIFY(!replayer.load(path, &error));
+    QVERIFY(!error.isEmpty());
+}
+
+void DanmakuSessionReplayTest::controllerRecordsPublicInputs() {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.filePath(QStringLiteral("recorded.ndsr"));
+    qputenv("NICONEON_DANMAKU_RECORD", path.toLocal8Bit());
+    {
+        DanmakuController controller;
+        prepareController(controller);
+        controller.setViewportSize(1280.0, 720.0);
+        controller.appendFromCore(makeBatch(0, 4, 0), 0);
+        controller.setPlaybackRate(2.0);
+        controller.setNgDropZoneRect(10.0, 20.0, 30.0, 40.0);
+        controller.applyNgUserFade(QStringLiteral("u1"));
+        controller.resetForSeek();
+    }
+    qunsetenv("NICONEON_DANMAKU_RECORD");
+
+    DanmakuSessionReplayer replayer;
+    QVERIFY(replayer.load(path));
+    QVector<int> types;
+    for (const DanmakuSessionEvent &event : replayer.events()) {
+        if (event.type != DanmakuSessionEventType::ResetGlyphSession) {
+            types.push_back(static_cast<int>(event.type));
+        }
+    }
+    const QVector<int> expected {
+        static_cast<int>(DanmakuSessionEventType::LaneMetrics),
+        static_cast<int>(DanmakuSessionEventType::ViewportSize),
+        static_cast<int>(DanmakuSessionEventType::AppendComments),
+        static_cast<int>(DanmakuSessionEventType::PlaybackRate),
+        static_cast<int>(DanmakuSessionEventType::NgDropZoneRect),
+        static_cast<int>(DanmakuSessionEventType::NgUserFade),
+        static_cast<int>(DanmakuSessionEventType::ResetForSeek),
+    };
+    QCOMPARE(types, expected);
+
+    for (const DanmakuSessionEvent &event : replayer.events()) {
+        if (event.type == DanmakuSessionEventType::AppendComments) {
+            QCOMPARE(event.comments.size(), 4);
+            QCOMPARE(event.comments.first().commentId, QStringLiteral("c0"));
+        } else if (event.type == DanmakuSessionEventType::NgDropZoneRect) {
+            QCOMPARE(event.args[3], 40.0);
+        }
+    }
+}
+
+void DanmakuSessionReplayTest::replayIsFrameForFrameReproducible() {
+    DanmakuSessionReplayer replayer;
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.filePath(QStringLiteral("session.ndsr"));
+    QVERIFY(writeSession(path, scriptedSession()));
+    QVERIFY(replayer.load(path));
+
+    QVector<DanmakuSessionReplayer::FrameResult> first;
+    {
+        DanmakuController controller;
+        prepareController(controller);
+        first = replayer.replay(controller, 16, 30);
+    }
+    QVector<DanmakuSessionReplayer::FrameResult> second;
+    {
+        DanmakuController controller;
+        prepareController(controller);
+        second = replayer.replay(controller, 16, 30);
+    }
+
+    QCOMPARE(first.size(), 1800000 / 16000 + 1 + 30);
+    QCOMPARE(second.size(), first.size());
+    int framesWithComments = 0;
+    for (int i = 0; i < first.size(); ++i) {
+        QCOMPARE(second.at(i).instanceCount, first.at(i).instanceCount);
+        QCOMPARE(second.at(i).digest, first.at(i).digest);
+        if (first.at(i).instanceCount > 0) {
+            ++framesWithComments;
+        }
+    }
+    QVERIFY(framesWithComments > 0);
+    QCOMPARE(first.last().instanceCount, 0);
+    QCOMPARE(DanmakuSessionReplayer::sessionDigest(second), DanmakuSessionReplayer::sessionDigest(first));
+}
+
+void DanmakuSessionReplayTest::frameDigestTracksInstanceState() {
+    DanmakuRenderFrame frame;
+    DanmakuRenderInstance instance;
+    instance.commentId = QStringLiteral("c1");
+    instance.spriteId = 3;
+    instance.x = 100.0;
+    instance.y = 40.0;
+    frame.instances.push_back(instance);
+    const quint64 baseline = DanmakuSessionReplayer::frameDigest(frame);
+
+    DanmakuRenderFrame same = frame;
+    same.sequence = 99;
+    same.simulatedAtNs = 12345;
+    QCOMPARE(DanmakuSessionReplayer::frameDigest(same), baseline);
+
+    DanmakuRenderFrame moved = frame;
+    moved.instances[0].x = 100.0 + 1.0e-9;
+    QVERIFY(DanmakuSessionReplayer::frameDigest(moved) != baseline);
+
+    DanmakuRenderFrame hovered = frame;
+    hovered.instances[0].ngDropHovered = true;
+    QVERIFY(DanmakuSessionReplayer::frameDigest(hovered) != baseline);
+}
+
+QTEST_MAIN(DanmakuSessionReplayTest)
+
+#include "danmaku_session_replay_test.moc"
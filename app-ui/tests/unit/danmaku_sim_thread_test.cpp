@@ -0,0 +1,122 @@
+#include "danmaku/DanmakuController.hpp"
+
+#include <QSignalSpy>
+#include <QTest>
+#include <QVariantList>
+#include <QVariantMap>
+
+namespace {
+
+QVariantMap makeComment(const QString &commentId, const QString &userId, const QString &text) {
+    QVariantMap comment;
+    comment.insert(QStringLiteral("comment_id"), commentId);
+    comment.insert(QStringLiteral("user_id"), userId);
+    comment.insert(QStringLiteral("text"), text);
+    comment.insert(QStringLiteral("at_ms"), 0);
+    return comment;
+}
+
+void prepareController(DanmakuController &controller) {
+    controller.setGlyphWarmupEnabled(false);
+    controller.setViewportSize(1280.0, 720.0);
+    controller.setLaneMetrics(36, 6);
+    controller.setPlaybackPaused(true);
+}
+
+int snapshotSize(DanmakuController &controller) {
+    const DanmakuRenderFrameConstPtr snapshot = controller.renderSnapshot();
+    return snapshot ? snapshot->instances.size() : -1;
+}
+
+} // namespace
+
+class DanmakuSimThreadTest : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void appendPublishesFromSimulationThread();
+    void settersUpdateFacadeImmediately();
+    void dragToNgZoneForwardsSignal();
+    void resetForSeekClearsPublishedState();
+};
+
+void DanmakuSimThreadTest::initTestCase() {
+    qputenv("NICONEON_DANMAKU_WORKER", "sim");
+    qputenv("NICONEON_SIMD_MODE", "scalar");
+}
+
+void DanmakuSimThreadTest::appendPublishesFromSimulationThread() {
+    DanmakuController controller;
+    prepareController(controller);
+    QSignalSpy snapshotSpy(&controller, &DanmakuController::renderSnapshotChanged);
+
+    QVariantList comments;
+    comments.push_back(makeComment(QStringLiteral("c1"), QStringLiteral("u1"), QStringLiteral("first")));
+    comments.push_back(makeComment(QStringLiteral("c2"), QStringLiteral("u2"), QStringLiteral("second")));
+    controller.appendFromCore(comments, 0);
+
+    QTRY_COMPARE_WITH_TIMEOUT(snapshotSize(controller), 2, 1000);
+    QTRY_VERIFY_WITH_TIMEOUT(snapshotSpy.count() > 0, 1000);
+    QTRY_COMPARE_WITH_TIMEOUT(controller.activeCommentCountMetric(), 2, 1000);
+    QVERIFY(controller.widthMeasurementCountForTesting() > 0);
+}
+
+void DanmakuSimThreadTest::settersUpdateFacadeImmediately() {
+    DanmakuController controller;
+    prepareController(controller);
+    QSignalSpy pausedSpy(&controller, &DanmakuController::playbackPausedChanged);
+    QSignalSpy rateSpy(&controller, &DanmakuController::playbackRateChanged);
+
+    controller.setPlaybackPaused(false);
+    controller.setPlaybackRate(2.0);
+
+    QVERIFY(!controller.playbackPaused());
+    QCOMPARE(controller.playbackRate(), 2.0);
+    QCOMPARE(pausedSpy.count(), 1);
+    QCOMPARE(rateSpy.count(), 1);
+}
+
+void DanmakuSimThreadTest::dragToNgZoneForwardsSignal() {
+    DanmakuController controller;
+    prepareController(controller);
+    controller.setNgDropZoneRect(100.0, 400.0, 200.0, 100.0);
+
+    QVariantList comments;
+    comments.push_back(makeComment(QStringLiteral("dragged"), QStringLiteral("u1"), QStringLiteral("drag me")));
+    controller.appendFromCore(comments, 0);
+    QTRY_COMPARE_WITH_TIMEOUT(snapshotSize(controller), 1, 1000);
+
+    const DanmakuRenderFrameConstPtr snapshot = controller.renderSnapshot();
+    const DanmakuRenderInstance dragged = snapshot->instances.first();
+
+    QSignalSpy ngSpy(&controller, &DanmakuController::ngDropRequested);
+    QVERIFY(!controller.beginDragAt(-500.0, -500.0));
+    QVERIFY(controller.beginDragAt(dragged.x + 8.0, dragged.y + 8.0));
+    QTRY_VERIFY_WITH_TIMEOUT(controller.ngDropZoneVisible(), 1000);
+
+    controller.moveActiveDrag(120.0, 420.0);
+    controller.dropActiveDrag(true);
+
+    QTRY_COMPARE_WITH_TIMEOUT(ngSpy.count(), 1, 1000);
+    QCOMPARE(ngSpy.takeFirst().value(0).toString(), QStringLiteral("u1"));
+    QTRY_VERIFY_WITH_TIMEOUT(!controller.ngDropZoneVisible(), 1000);
+}
+
+void DanmakuSimThreadTest::resetForSeekClearsPublishedState() {
+    DanmakuController controller;
+    prepareController(controller);
+
+    QVariantList comments;
+    comments.push_back(makeComment(QStringLiteral("c1"), QStringLiteral("u1"), QStringLiteral("seek")));
+    controller.appendFromCore(comments, 0);
+    QTRY_COMPARE_WITH_TIMEOUT(snapshotSize(controller), 1, 1000);
+
+    controller.resetForSeek();
+    QTRY_COMPARE_WITH_TIMEOUT(snapshotSize(controller), 0, 1000);
+    QTRY_COMPARE_WITH_TIMEOUT(controller.activeCommentCountMetric(), 0, 1000);
+}
+
+QTEST_MAIN(DanmakuSimThreadTest)
+
+#include "danmaku_sim_thread_test.moc"
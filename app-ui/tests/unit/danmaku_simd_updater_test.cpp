@@ -0,0 +1,271 @@
+#include "danmaku/DanmakuSimdUpdater.hpp"
+
+#include <QRandomGenerator>
+#include <QTest>
+
+namespace {
+constexpr float kViewportHeight = 720.0f;
+constexpr float kItemHeight = 42.0f;
+constexpr float kCullThreshold = -8.0f;
+
+void appendRow(DanmakuSoAState &state, float x, float y, int width, quint8 flags, int fadeRemainingMs = 0) {
+    state.handles.push_back(static_cast<DanmakuItemHandle>(state.size() + 1));
+    state.x.push_back(x);
+    state.y.push_back(y);
+    state.speed.push_back(200.0f);
+    state.alpha.push_back(1.0f);
+    state.widthEstimate.push_back(width);
+    state.fadeRemainingMs.push_back(fadeRemainingMs);
+    state.flags.push_back(flags);
+}
+
+QVector<int> changedIndices(const DanmakuFusedUpdateResult &result) {
+    return result.changedIndices.mid(0, result.changedCount);
+}
+
+QVector<int> removedIndices(const DanmakuFusedUpdateResult &result) {
+    return result.removedIndices.mid(0, result.removedCount);
+}
+
+DanmakuFusedUpdateParams frameParams(bool paused) {
+    DanmakuFusedUpdateParams params;
+    params.paused = paused;
+    params.movementFactor = 0.1f;
+    params.elapsedMs = 100;
+    params.cullThreshold = kCullThreshold;
+    params.viewportHeight = kViewportHeight;
+    params.itemHeight = kItemHeight;
+    return params;
+}
+
+DanmakuSoAState randomState(int count, bool withFading, bool withDragging, quint32 seed) {
+    QRandomGenerator random(seed);
+    DanmakuSoAState state;
+    for (int i = 0; i < count; ++i) {
+        quint8 flags = 0;
+        if (random.bounded(8) == 0) {
+            flags |= DanmakuSoAFlagFrozen;
+        }
+        if (withFading && random.bounded(4) == 0) {
+            flags |= DanmakuSoAFlagFading;
+        }
+        if (withDragging && random.bounded(6) == 0) {
+            flags |= DanmakuSoAFlagDragging;
+        }
+        appendRow(
+            state,
+            static_cast<float>(random.bounded(2400.0) - 400.0),
+            static_cast<float>(random.bounded(900.0) - 90.0),
+            20 + static_cast<int>(random.bounded(500)),
+            flags,
+            static_cast<int>(random.bounded(400)) - 50);
+        state.speed.last() = static_cast<float>(80.0 + random.bounded(400.0));
+        state.alpha.last() = random.bounded(20) == 0 ? 0.0f : 1.0f;
+    }
+    return state;
+}
+
+void compareStates(const DanmakuSoAState &actual, const DanmakuSoAState &expected) {
+    QCOMPARE(actual.size(), expected.size());
+    for (int i = 0; i < expected.size(); ++i) {
+        QCOMPARE(actual.x[i], expected.x[i]);
+        QCOMPARE(actual.alpha[i], expected.alpha[i]);
+        QCOMPARE(actual.fadeRemainingMs[i], expected.fadeRemainingMs[i]);
+    }
+}
+} // namespace
+
+class DanmakuSimdUpdaterTest : public QObject {
+    Q_OBJECT
+
+private slots:
+    void scalarKernelMovesFadesAndCulls();
+    void pausedKernelOnlyAdvancesFades();
+    void reusedResultKeepsBufferCapacity();
+    void specializedKernelsMatchGenericKernel_data();
+    void specializedKernelsMatchGenericKernel();
+    void modesParseAndResolveToSupportedTiers();
+    void supportedTiersMatchScalarReference_data();
+    void supportedTiersMatchScalarReference();
+};
+
+void DanmakuSimdUpdaterTest::scalarKernelMovesFadesAndCulls() {
+    DanmakuSoAState state;
+    appendRow(state, 500.0f, 0.0f, 100, 0);
+    appendRow(state, 500.0f, 42.0f, 100, DanmakuSoAFlagFrozen);
+    appendRow(state, 500.0f, 84.0f, 100, DanmakuSoAFlagFading, 250);
+    appendRow(state, 500.0f, 126.0f, 100, DanmakuSoAFlagFading, 80);
+    appendRow(state, 0.0f, 168.0f, 10, 0);
+    appendRow(state, 0.0f, 210.0f, 10, DanmakuSoAFlagDragging);
+    appendRow(state, 500.0f, kViewportHeight + 1.0f, 100, DanmakuSoAFlagFrozen);
+    appendRow(state, 500.0f, -kItemHeight - 1.0f, 100, DanmakuSoAFlagFrozen);
+
+    DanmakuFusedUpdateResult result;
+    DanmakuSimdUpdater::updateFused(state, frameParams(false), result, DanmakuSimdMode::Scalar);
+
+    QCOMPARE(state.x[0], 480.0f);
+    QCOMPARE(state.x[1], 500.0f);
+    QCOMPARE(state.fadeRemainingMs[2], 150);
+    QCOMPARE(state.alpha[2], 150.0f / 300.0f);
+    QCOMPARE(state.fadeRemainingMs[3], -20);
+    QCOMPARE(state.alpha[3], 0.0f);
+    QCOMPARE(state.x[5], -20.0f);
+    QCOMPARE(changedIndices(result), QVector<int>({0, 2, 5}));
+    QCOMPARE(removedIndices(result), QVector<int>({3, 4, 6, 7}));
+}
+
+void DanmakuSimdUpdaterTest::pausedKernelOnlyAdvancesFades() {
+    DanmakuSoAState state;
+    appendRow(state, 500.0f, 0.0f, 100, 0);
+    appendRow(state, 500.0f, 42.0f, 100, DanmakuSoAFlagFading, 400);
+    appendRow(state, -200.0f, 84.0f, 100, 0);
+
+    DanmakuFusedUpdateResult result;
+    DanmakuSimdUpdater::updateFused(state, frameParams(true), result, DanmakuSimdMode::Scalar);
+
+    QCOMPARE(state.x[0], 500.0f);
+    QCOMPARE(state.x[1], 500.0f);
+    QCOMPARE(state.fadeRemainingMs[1], 300);
+    QCOMPARE(state.alpha[1], 1.0f);
+    QCOMPARE(changedIndices(result), QVector<int>({1}));
+    QCOMPARE(removedIndices(result), QVector<int>({2}));
+}
+
+void DanmakuSimdUpdaterTest::reusedResultKeepsBufferCapacity() {
+    DanmakuSoAState crowded = randomState(300, true, true, 17);
+    DanmakuFusedUpdateResult result;
+    DanmakuSimdUpdater::updateFused(crowded, frameParams(false), result, DanmakuSimdMode::Scalar);
+    QVERIFY(result.changedIndices.size() >= crowded.size());
+    QVERIFY(result.removedIndices.size() >= crowded.size());
+    const int *changedBuffer = result.changedIndices.constData();
+    const int *removedBuffer = result.removedIndices.constData();
+
+    DanmakuSoAState sparse;
+    appendRow(sparse, 500.0f, 0.0f, 100, 0);
+    appendRow(sparse, 0.0f, 42.0f, 10, 0);
+    DanmakuSimdUpdater::updateFused(sparse, frameParams(false), result, DanmakuSimdMode::Scalar);
+
+    QCOMPARE(changedIndices(result), QVector<int>({0}));
+    QCOMPARE(removedIndices(result), QVector<int>({1}));
+    QVERIFY(result.changedIndices.size() >= crowded.size());
+    QVERIFY(result.removedIndices.size() >= crowded.size());
+    QCOMPARE(result.changedIndices.constData(), changedBuffer);
+    QCOMPARE(result.removedIndices.constData(), removedBuffer);
+}
+
+void DanmakuSimdUpdaterTest::specializedKernelsMatchGenericKernel_data() {
+    QTest::addColumn<bool>("paused");
+    QTest::addColumn<int>("mode");
+    for (const bool paused : {false, true}) {
+        for (const DanmakuSimdMode mode : {DanmakuSimdMode::Scalar, DanmakuSimdMode::Auto}) {
+            QTest::newRow(qPrintable(QStringLiteral("%1/%2")
+                                         .arg(paused ? QStringLiteral("paused") : QStringLiteral("playing"))
+                                         .arg(DanmakuSimdUpdater::modeName(mode))))
+                << paused << static_cast<int>(mode);
+        }
+    }
+}
+
+void DanmakuSimdUpdaterTest::specializedKernelsMatchGenericKernel() {
+    QFETCH(bool, paused);
+    QFETCH(int, mode);
+    const DanmakuSimdMode simdMode = static_cast<DanmakuSimdMode>(mode);
+
+    DanmakuSoAState generic = randomState(1001, false, false, 7);
+    DanmakuSoAState specialized = generic;
+    DanmakuFusedUpdateParams params = frameParams(paused);
+    DanmakuFusedUpdateResult genericResult;
+    DanmakuSimdUpdater::updateFused(generic, params, genericResult, simdMode);
+
+    params.anyFading = false;
+    params.anyDragging = false;
+    DanmakuFusedUpdateResult specializedResult;
+    DanmakuSimdUpdater::updateFused(specialized, params, specializedResult, simdMode);
+
+    compareStates(specialized, generic);
+    QCOMPARE(changedIndices(specializedResult), changedIndices(genericResult));
+    QCOMPARE(removedIndices(specializedResult), removedIndices(genericResult));
+}
+
+void DanmakuSimdUpdaterTest::modesParseAndResolveToSupportedTiers() {
+    const DanmakuSimdMode modes[] = {
+        DanmakuSimdMode::Auto,
+        DanmakuSimdMode::Scalar,
+        DanmakuSimdMode::Sse41,
+        DanmakuSimdMode::Avx2,
+        DanmakuSimdMode::Avx512,
+    };
+    for (const DanmakuSimdMode mode : modes) {
+        QVERIFY(DanmakuSimdUpdater::parseMode(DanmakuSimdUpdater::modeName(mode)) == mode);
+
+        const DanmakuSimdMode resolved = DanmakuSimdUpdater::resolveMode(mode);
+        QVERIFY(resolved != DanmakuSimdMode::Auto);
+        QVERIFY(DanmakuSimdUpdater::isSupported(resolved));
+        if (mode != DanmakuSimdMode::Auto) {
+            QVERIFY(static_cast<int>(resolved) <= static_cast<int>(mode));
+            QCOMPARE(resolved == mode, DanmakuSimdUpdater::isSupported(mode));
+        }
+    }
+    QVERIFY(DanmakuSimdUpdater::parseMode(QStringLiteral(" SSE4.1 ")) == DanmakuSimdMode::Sse41);
+    QVERIFY(DanmakuSimdUpdater::parseMode(QStringLiteral("neon")) == DanmakuSimdMode::Auto);
+    QVERIFY(DanmakuSimdUpdater::resolveMode(DanmakuSimdMode::Scalar) == DanmakuSimdMode::Scalar);
+}
+
+void DanmakuSimdUpdaterTest::supportedTiersMatchScalarReference_data() {
+    QTest::addColumn<int>("mode");
+    QTest::addColumn<int>("count");
+    QTest::addColumn<bool>("paused");
+    QTest::addColumn<bool>("fading");
+    QTest::addColumn<bool>("dragging");
+    const DanmakuSimdMode tiers[] = {DanmakuSimdMode::Sse41, DanmakuSimdMode::Avx2, DanmakuSimdMode::Avx512};
+    for (const DanmakuSimdMode tier : tiers) {
+        for (const int count : {0, 1, 3, 4, 7, 8, 9, 15, 16, 17, 33, 1000}) {
+            for (int variant = 0; variant < 8; ++variant) {
+                const bool paused = (variant & 4) != 0;
+                const bool fading = (variant & 2) != 0;
+                const bool dragging = (variant & 1) != 0;
+                QTest::newRow(qPrintable(QStringLiteral("%1/%2/p%3f%4d%5")
+                                             .arg(DanmakuSimdUpdater::modeName(tier))
+                                             .arg(count)
+                                             .arg(int(paused))
+                                             .arg(int(fading))
+                                             .arg(int(dragging))))
+                    << static_cast<int>(tier) << count << paused << fading << dragging;
+            }
+        }
+    }
+}
+
+void DanmakuSimdUpdaterTest::supportedTiersMatchScalarReference() {
+    QFETCH(int, mode);
+    QFETCH(int, count);
+    QFETCH(bool, paused);
+    QFETCH(bool, fading);
+    QFETCH(bool, dragging);
+    const DanmakuSimdMode tier = static_cast<DanmakuSimdMode>(mode);
+    if (!DanmakuSimdUpdater::isSupported(tier)) {
+        QSKIP("SIMD tier is not available on this CPU");
+    }
+    QVERIFY(DanmakuSimdUpdater::resolveMode(tier) == tier);
+
+    DanmakuSoAState reference = randomState(count, fading, dragging, static_cast<quint32>(count * 8 + 1));
+    DanmakuSoAState vectorized = reference;
+    DanmakuFusedUpdateParams params = frameParams(paused);
+    params.anyFading = fading;
+    params.anyDragging = dragging;
+
+    for (int frame = 0; frame < 4; ++frame) {
+        DanmakuFusedUpdateResult referenceResult;
+        DanmakuFusedUpdateResult vectorizedResult;
+        DanmakuSimdUpdater::updateFused(reference, params, referenceResult, DanmakuSimdMode::Scalar);
+        DanmakuSimdUpdater::updateFused(vectorized, params, vectorizedResult, tier);
+
+        compareStates(vectorized, reference);
+        QCOMPARE(changedIndices(vectorizedResult), changedIndices(referenceResult));
+        QCOMPARE(removedIndices(vectorizedResult), removedIndices(referenceResult));
+    }
+}
+
+QTEST_APPLESS_MAIN(DanmakuSimdUpdaterTest)
+
+#include "danmaku_simd_updater_test.moc"
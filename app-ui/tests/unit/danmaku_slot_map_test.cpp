@@ -0,0 +1,93 @@
+#include "danmaku/DanmakuSlotMap.hpp"
+
+#include <QTest>
+
+class DanmakuSlotMapTest : public QObject {
+    Q_OBJECT
+
+private slots:
+    void insertResolvesRows();
+    void removedHandleBecomesStale();
+    void swapRemoveKeepsMovedHandleValid();
+    void truncateReleasesTrailingRows();
+    void clearInvalidatesAllHandles();
+};
+
+void DanmakuSlotMapTest::insertResolvesRows() {
+    DanmakuSlotMap slotMap;
+    const DanmakuItemHandle first = slotMap.insert(0);
+    const DanmakuItemHandle second = slotMap.insert(1);
+
+    QVERIFY(first != DanmakuSlotMap::kInvalidHandle);
+    QVERIFY(second != first);
+    QCOMPARE(slotMap.row(first), 0);
+    QCOMPARE(slotMap.row(second), 1);
+    QCOMPARE(slotMap.handleAt(1), second);
+    QCOMPARE(slotMap.handleAt(2), DanmakuSlotMap::kInvalidHandle);
+    QCOMPARE(slotMap.row(DanmakuSlotMap::kInvalidHandle), -1);
+    QCOMPARE(slotMap.size(), 2);
+}
+
+void DanmakuSlotMapTest::removedHandleBecomesStale() {
+    DanmakuSlotMap slotMap;
+    const DanmakuItemHandle removed = slotMap.insert(0);
+    slotMap.remove(removed);
+    slotMap.truncate(0);
+
+    QVERIFY(!slotMap.contains(removed));
+    QCOMPARE(slotMap.freeSlotCount(), 1);
+
+    const DanmakuItemHandle reused = slotMap.insert(0);
+    QCOMPARE(DanmakuSlotMap::slotOf(reused), DanmakuSlotMap::slotOf(removed));
+    QVERIFY(reused != removed);
+    QCOMPARE(slotMap.row(removed), -1);
+    QCOMPARE(slotMap.row(reused), 0);
+    QCOMPARE(slotMap.freeSlotCount(), 0);
+}
+
+void DanmakuSlotMapTest::swapRemoveKeepsMovedHandleValid() {
+    DanmakuSlotMap slotMap;
+    const DanmakuItemHandle a = slotMap.insert(0);
+    const DanmakuItemHandle b = slotMap.insert(1);
+    const DanmakuItemHandle c = slotMap.insert(2);
+
+    slotMap.remove(a);
+    slotMap.relocate(2, 0);
+    slotMap.truncate(2);
+
+    QCOMPARE(slotMap.row(a), -1);
+    QCOMPARE(slotMap.row(b), 1);
+    QCOMPARE(slotMap.row(c), 0);
+    QCOMPARE(slotMap.handleAt(0), c);
+    QCOMPARE(slotMap.handleAt(2), DanmakuSlotMap::kInvalidHandle);
+    QCOMPARE(slotMap.size(), 2);
+}
+
+void DanmakuSlotMapTest::truncateReleasesTrailingRows() {
+    DanmakuSlotMap slotMap;
+    const DanmakuItemHandle kept = slotMap.insert(0);
+    const DanmakuItemHandle dropped = slotMap.insert(1);
+
+    slotMap.truncate(1);
+
+    QCOMPARE(slotMap.row(kept), 0);
+    QVERIFY(!slotMap.contains(dropped));
+    QCOMPARE(slotMap.size(), 1);
+}
+
+void DanmakuSlotMapTest::clearInvalidatesAllHandles() {
+    DanmakuSlotMap slotMap;
+    const DanmakuItemHandle a = slotMap.insert(0);
+    const DanmakuItemHandle b = slotMap.insert(1);
+
+    slotMap.clear();
+
+    QVERIFY(!slotMap.contains(a));
+    QVERIFY(!slotMap.contains(b));
+    QCOMPARE(slotMap.size(), 0);
+    QCOMPARE(slotMap.handleAt(0), DanmakuSlotMap::kInvalidHandle);
+}
+
+QTEST_APPLESS_MAIN(DanmakuSlotMapTest)
+
+#include "danmaku_slot_map_test.moc"
@@ -1,11 +1,17 @@
 #include "danmaku/DanmakuAtlasPacker.hpp"
+#include "danmaku/DanmakuRenderStyle.hpp"
+#include "danmaku/DanmakuStringPool.hpp"
 #include "danmaku/DanmakuTextSpriteCache.hpp"
 
+#include <QImage>
 #include <QRect>
+#include <QSet>
 #include <QSize>
 #include <QTest>
 #include <QVector>
 
+#include <algorithm>
+
 class DanmakuSpriteCacheTest : public QObject {
     Q_OBJECT
 
@@ -16,8 +22,27 @@ private slots:
     void pendingRasterBudgetDefersRemainingSprites();
     void takePendingUploadRemovesQueuedSprite();
     void clearKeepsSpriteIdsMonotonic();
+    void internedTextIdSharesSpriteWithStringLookup();
+    void stringPoolRecyclesReleasedIds();
+    void rasterThreadsDeliverReadyUploads();
+    void rasterThreadsRefineEstimatedWidths();
+    void clearDropsInFlightRasterResults();
+    void rasterThreadCountComesFromEnvironment();
+    void glyphRunsShareGlyphImagesAcrossSprites();
+    void glyphImagesCountAgainstUploadBudget();
+    void rasterThreadsDeliverGlyphsBeforeUse();
+    void glyphRunModeComesFromEnvironment();
+    void distanceFieldSpritesIgnoreDevicePixelRatio();
+    void distanceFieldEncodesSignedDistance();
+    void distanceFieldModeComesFromEnvironment();
 };
 
+namespace {
+int fieldAlpha(const QImage &field, int x, int y) {
+    return field.constScanLine(y)[x * 4 + 3];
+}
+}
+
 void DanmakuSpriteCacheTest::atlasPackerDoesNotOverlap() {
     DanmakuAtlasPacker packer(QSize(256, 256));
 
@@ -105,6 +130,323 @@ void DanmakuSpriteCacheTest::clearKeepsSpriteIdsMonotonic() {
     QVERIFY(second.spriteId > first.spriteId);
 }
 
+void DanmakuSpriteCacheTest::internedTextIdSharesSpriteWithStringLookup() {
+    DanmakuStringPool pool;
+    DanmakuTextSpriteCache cache(&pool);
+
+    const DanmakuStringId textId = pool.intern(QStringLiteral("shared text"));
+    const auto byId = cache.ensureSprite(textId, 24, 1.0);
+    const auto byString = cache.ensureSprite(QStringLiteral("shared text"), 24, 1.0);
+
+    QVERIFY(byId.queuedRaster);
+    QVERIFY(!byString.queuedRaster);
+    QCOMPARE(byString.spriteId, byId.spriteId);
+    QCOMPARE(cache.widthMeasurementCountForTesting(), 1);
+
+    pool.release(textId);
+    QCOMPARE(pool.find(QStringLiteral("shared text")), textId);
+
+    cache.clear();
+    QCOMPARE(pool.find(QStringLiteral("shared text")), DanmakuStringPool::kInvalidId);
+}
+
+void DanmakuSpriteCacheTest::stringPoolRecyclesReleasedIds() {
+    DanmakuStringPool pool;
+
+    const DanmakuStringId first = pool.intern(QStringLiteral("user-a"));
+    const DanmakuStringId again = pool.intern(QStringLiteral("user-a"));
+    QCOMPARE(again, first);
+    QCOMPARE(pool.size(), 1);
+
+    pool.release(first);
+    QCOMPARE(pool.text(first), QStringLiteral("user-a"));
+    pool.release(first);
+    QVERIFY(pool.text(first).isEmpty());
+    QCOMPARE(pool.size(), 0);
+
+    const DanmakuStringId recycled = pool.intern(QStringLiteral("user-b"));
+    QCOMPARE(recycled, first);
+    QCOMPARE(pool.intern(QString()), DanmakuStringPool::kInvalidId);
+}
+
+void DanmakuSpriteCacheTest::rasterThreadsDeliverReadyUploads() {
+    DanmakuTextSpriteCache cache;
+    cache.setRasterThreadCount(2);
+
+    QVector<DanmakuSpriteId> spriteIds;
+    for (const QString &text : {QStringLiteral("弾幕その一"), QStringLiteral("弾幕その二"), QStringLiteral("弾幕その三")}) {
+        const auto result = cache.ensureSprite(text, 24, 1.0);
+        QVERIFY(result.queuedRaster);
+        spriteIds.push_back(result.spriteId);
+    }
+
+    QVERIFY(cache.rasterizePendingSprites(8, 0).isEmpty());
+    QVERIFY(cache.waitForRasterJobs(5000));
+    QCOMPARE(cache.rasterJobsInFlight(), 0);
+    QCOMPARE(cache.pendingRasterCountForTesting(), 3);
+
+    const QVector<DanmakuSpriteUpload> firstBatch = cache.rasterizePendingSprites(2, 0);
+    QCOMPARE(firstBatch.size(), 2);
+    const QVector<DanmakuSpriteUpload> secondBatch = cache.rasterizePendingSprites(2, 0);
+    QCOMPARE(secondBatch.size(), 1);
+    QCOMPARE(cache.pendingRasterCountForTesting(), 0);
+
+    QVector<DanmakuSpriteUpload> uploads = firstBatch;
+    uploads.append(secondBatch);
+    QVector<DanmakuSpriteId> delivered;
+    for (const DanmakuSpriteUpload &upload : uploads) {
+        QVERIFY(!upload.image.isNull());
+        delivered.push_back(upload.spriteId);
+    }
+    std::sort(delivered.begin(), delivered.end());
+    QCOMPARE(delivered, spriteIds);
+}
+
+void DanmakuSpriteCacheTest::rasterThreadsRefineEstimatedWidths() {
+    DanmakuTextSpriteCache cache;
+    cache.setRasterThreadCount(1);
+
+    const QString text = QStringLiteral("refine me");
+    const int measured = DanmakuTextSpriteCache::measureWidth(text, DanmakuTextSpriteCache::spriteFont(24, {}));
+    const auto first = cache.ensureSprite(text, 24, 1.0);
+    QCOMPARE(first.widthEstimate, cache.estimateWidth(text, 24));
+    QVERIFY(first.widthEstimate >= measured);
+    QCOMPARE(cache.ensureSprite(text, 24, 1.0).widthEstimate, first.widthEstimate);
+    QCOMPARE(cache.widthMeasurementCountForTesting(), 1);
+
+    cache.rasterizePendingSprites(8, 0);
+    QVERIFY(cache.waitForRasterJobs(5000));
+    const QVector<DanmakuSpriteUpload> uploads = cache.rasterizePendingSprites(8, 0);
+    QCOMPARE(uploads.size(), 1);
+    QCOMPARE(uploads.first().spriteId, first.spriteId);
+    QCOMPARE(uploads.first().logicalSize.width(), measured);
+
+    const QVector<DanmakuTextSpriteCache::WidthRefinement> refinements = cache.takeWidthRefinements();
+    if (measured != first.widthEstimate) {
+        QCOMPARE(refinements.size(), 1);
+        QCOMPARE(refinements.first().spriteId, first.spriteId);
+        QCOMPARE(refinements.first().widthEstimate, measured);
+    } else {
+        QVERIFY(refinements.isEmpty());
+    }
+    QVERIFY(cache.takeWidthRefinements().isEmpty());
+
+    const auto second = cache.ensureSprite(text, 24, 1.0);
+    QVERIFY(!second.queuedRaster);
+    QCOMPARE(second.widthEstimate, measured);
+    QCOMPARE(cache.widthMeasurementCountForTesting(), 1);
+
+    const QString reordered = QStringLiteral("me refine refine me");
+    QVERIFY(cache.estimateWidth(reordered, 24) < reordered.size() * 24 + 16);
+}
+
+void DanmakuSpriteCacheTest::clearDropsInFlightRasterResults() {
+    DanmakuStringPool pool;
+    DanmakuTextSpriteCache cache(&pool);
+    cache.setRasterThreadCount(1);
+
+    const auto stale = cache.ensureSprite(QStringLiteral("stale sprite"), 24, 1.0);
+    cache.rasterizePendingSprites(8, 0);
+    cache.clear();
+    QCOMPARE(pool.find(QStringLiteral("stale sprite")), DanmakuStringPool::kInvalidId);
+
+    const auto fresh = cache.ensureSprite(QStringLiteral("fresh sprite"), 24, 1.0);
+    QVERIFY(fresh.spriteId > stale.spriteId);
+    cache.rasterizePendingSprites(8, 0);
+    QVERIFY(cache.waitForRasterJobs(5000));
+
+    const QVector<DanmakuSpriteUpload> uploads = cache.rasterizePendingSprites(8, 0);
+    QCOMPARE(uploads.size(), 1);
+    QCOMPARE(uploads.first().spriteId, fresh.spriteId);
+    QVERIFY(cache.takeWidthRefinements().size() <= 1);
+    QCOMPARE(cache.pendingRasterCountForTesting(), 0);
+}
+
+void DanmakuSpriteCacheTest::rasterThreadCountComesFromEnvironment() {
+    qputenv("NICONEON_DANMAKU_RASTER_THREADS", "0");
+    QCOMPARE(DanmakuTextSpriteCache::rasterThreadCountFromEnvironment(), 0);
+    qputenv("NICONEON_DANMAKU_RASTER_THREADS", "3");
+    QCOMPARE(DanmakuTextSpriteCache::rasterThreadCountFromEnvironment(), 3);
+    qputenv("NICONEON_DANMAKU_RASTER_THREADS", "99");
+    QCOMPARE(DanmakuTextSpriteCache::rasterThreadCountFromEnvironment(), DanmakuTextSpriteCache::kMaxRasterThreads);
+    qunsetenv("NICONEON_DANMAKU_RASTER_THREADS");
+    QVERIFY(DanmakuTextSpriteCache::rasterThreadCountFromEnvironment() >= 1);
+}
+
+void DanmakuSpriteCacheTest::glyphRunsShareGlyphImagesAcrossSprites() {
+    DanmakuTextSpriteCache cache;
+    cache.setGlyphRunMode(true);
+    QVERIFY(cache.ensureSprite(QStringLiteral("abab"), 24, 1.0).queuedRaster);
+    QVERIFY(cache.ensureSprite(QStringLiteral("b a"), 24, 1.0).queuedRaster);
+
+    const QVector<DanmakuSpriteUpload> uploads = cache.rasterizePendingSprites(8, 0);
+    QCOMPARE(uploads.size(), 2);
+    QSet<DanmakuGlyphKey> delivered;
+    int glyphImageCount = 0;
+    for (const DanmakuSpriteUpload &upload : uploads) {
+        QVERIFY(upload.image.isNull());
+        for (const DanmakuGlyphImage &glyph : upload.glyphImages) {
+            QVERIFY(!glyph.image.isNull());
+            QVERIFY(!glyph.logicalSize.isEmpty());
+            delivered.insert(glyph.key);
+            ++glyphImageCount;
+        }
+    }
+    QCOMPARE(uploads[0].glyphs.size(), 4);
+    QCOMPARE(uploads[1].glyphs.size(), 2);
+    QCOMPARE(glyphImageCount, 2);
+    for (const DanmakuSpriteUpload &upload : uploads) {
+        for (const DanmakuGlyphPlacement &glyph : upload.glyphs) {
+            QVERIFY(delivered.contains(glyph.key));
+        }
+    }
+    QVERIFY(uploads[0].glyphs[0].key == uploads[0].glyphs[2].key);
+    QVERIFY(uploads[0].glyphs[0].offset.x() < uploads[0].glyphs[1].offset.x());
+
+    QVERIFY(cache.ensureSprite(QStringLiteral("abc"), 24, 1.0).queuedRaster);
+    const QVector<DanmakuSpriteUpload> next = cache.rasterizePendingSprites(8, 0);
+    QCOMPARE(next.size(), 1);
+    QCOMPARE(next[0].glyphs.size(), 3);
+    QCOMPARE(next[0].glyphImages.size(), 1);
+
+    cache.clear();
+    QVERIFY(cache.ensureSprite(QStringLiteral("ab"), 24, 1.0).queuedRaster);
+    const QVector<DanmakuSpriteUpload> afterClear = cache.rasterizePendingSprites(8, 0);
+    QCOMPARE(afterClear.size(), 1);
+    QCOMPARE(afterClear[0].glyphImages.size(), 2);
+}
+
+void DanmakuSpriteCacheTest::glyphImagesCountAgainstUploadBudget() {
+    DanmakuTextSpriteCache cache;
+    cache.setGlyphRunMode(true);
+    QVERIFY(cache.ensureSprite(QStringLiteral("ab"), 24, 1.0).queuedRaster);
+    QVERIFY(cache.ensureSprite(QStringLiteral("cd"), 24, 1.0).queuedRaster);
+
+    const QVector<DanmakuSpriteUpload> first = cache.rasterizePendingSprites(8, 1);
+    QCOMPARE(first.size(), 1);
+    QCOMPARE(first[0].glyphImages.size(), 2);
+    QCOMPARE(cache.pendingRasterCountForTesting(), 1);
+
+    const QVector<DanmakuSpriteUpload> second = cache.rasterizePendingSprites(8, 1);
+    QCOMPARE(second.size(), 1);
+    QCOMPARE(second[0].glyphs.size(), 2);
+    QCOMPARE(second[0].glyphImages.size(), 2);
+    for (const DanmakuGlyphImage &glyph : second[0].glyphImages) {
+        QVERIFY(glyph.key == second[0].glyphs[0].key || glyph.key == second[0].glyphs[1].key);
+    }
+
+    QVERIFY(cache.ensureSprite(QStringLiteral("ba"), 24, 1.0).queuedRaster);
+    QVERIFY(cache.ensureSprite(QStringLiteral("dc"), 24, 1.0).queuedRaster);
+    const QVector<DanmakuSpriteUpload> reused = cache.rasterizePendingSprites(8, 1);
+    QCOMPARE(reused.size(), 2);
+    QVERIFY(reused[0].glyphImages.isEmpty());
+    QVERIFY(reused[1].glyphImages.isEmpty());
+    QCOMPARE(cache.pendingRasterCountForTesting(), 0);
+}
+
+void DanmakuSpriteCacheTest::rasterThreadsDeliverGlyphsBeforeUse() {
+    DanmakuTextSpriteCache cache;
+    cache.setRasterThreadCount(3);
+    cache.setGlyphRunMode(true);
+
+    const QStringList texts {
+        QStringLiteral("弾幕その一"),
+        QStringLiteral("弾幕その二"),
+        QStringLiteral("その三"),
+        QStringLiteral("一二三"),
+        QStringLiteral("弾幕"),
+    };
+    for (const QString &text : texts) {
+        QVERIFY(cache.ensureSprite(text, 24, 1.0).queuedRaster);
+    }
+    QVERIFY(cache.rasterizePendingSprites(0, 0).isEmpty());
+    QVERIFY(cache.waitForRasterJobs(5000));
+
+    QSet<DanmakuGlyphKey> delivered;
+    int uploadCount = 0;
+    while (uploadCount < texts.size()) {
+        const QVector<DanmakuSpriteUpload> uploads = cache.rasterizePendingSprites(1, 0);
+        QCOMPARE(uploads.size(), 1);
+        for (const DanmakuGlyphImage &glyph : uploads[0].glyphImages) {
+            delivered.insert(glyph.key);
+        }
+        QVERIFY(!uploads[0].glyphs.isEmpty());
+        for (const DanmakuGlyphPlacement &glyph : uploads[0].glyphs) {
+            QVERIFY2(delivered.contains(glyph.key), "glyph images must arrive no later than the runs using them");
+        }
+        ++uploadCount;
+    }
+    QCOMPARE(delivered.size(), 7);
+    QCOMPARE(cache.pendingRasterCountForTesting(), 0);
+}
+
+void DanmakuSpriteCacheTest::glyphRunModeComesFromEnvironment() {
+    qputenv("NICONEON_DANMAKU_RENDERER", "glyph_atlas");
+    QVERIFY(DanmakuTextSpriteCache::glyphRunModeFromEnvironment());
+    qputenv("NICONEON_DANMAKU_RENDERER", "atlas");
+    QVERIFY(!DanmakuTextSpriteCache::glyphRunModeFromEnvironment());
+    qunsetenv("NICONEON_DANMAKU_RENDERER");
+    QVERIFY(!DanmakuTextSpriteCache::glyphRunModeFromEnvironment());
+}
+
+void DanmakuSpriteCacheTest::distanceFieldSpritesIgnoreDevicePixelRatio() {
+    DanmakuTextSpriteCache cache;
+    cache.setDistanceFieldMode(true);
+
+    const auto first = cache.ensureSprite(QStringLiteral("dpi text"), 24, 1.0);
+    const auto second = cache.ensureSprite(QStringLiteral("dpi text"), 24, 2.0);
+    QVERIFY(first.queuedRaster);
+    QVERIFY(!second.queuedRaster);
+    QCOMPARE(first.spriteId, second.spriteId);
+
+    const QVector<DanmakuSpriteUpload> uploads = cache.rasterizePendingSprites(4, 0);
+    QCOMPARE(uploads.size(), 1);
+    QVERIFY(uploads[0].distanceField);
+    QCOMPARE(uploads[0].image.width(), uploads[0].logicalSize.width() * DanmakuRenderStyle::kDistanceFieldRasterScale);
+    QVERIFY(!cache.ensureSprite(QStringLiteral("dpi text"), 24, 1.5).queuedRaster);
+
+    cache.setGlyphRunMode(true);
+    QVERIFY(cache.ensureSprite(QStringLiteral("ab"), 24, 1.0).queuedRaster);
+    QVERIFY(!cache.ensureSprite(QStringLiteral("ab"), 24, 2.0).queuedRaster);
+    const QVector<DanmakuSpriteUpload> glyphUploads = cache.rasterizePendingSprites(4, 0);
+    QCOMPARE(glyphUploads.size(), 1);
+    QCOMPARE(glyphUploads[0].glyphImages.size(), 2);
+    for (const DanmakuGlyphImage &glyph : glyphUploads[0].glyphImages) {
+        QVERIFY(glyph.distanceField);
+        QCOMPARE(glyph.key.devicePixelRatioMilli, DanmakuRenderStyle::kDistanceFieldRasterScale * 1000);
+    }
+}
+
+void DanmakuSpriteCacheTest::distanceFieldEncodesSignedDistance() {
+    QImage coverage(48, 48, QImage::Format_RGBA8888_Premultiplied);
+    coverage.fill(Qt::transparent);
+    for (int y = 16; y < 32; ++y) {
+        for (int x = 16; x < 32; ++x) {
+            coverage.setPixel(x, y, 0xFFFFFFFFu);
+        }
+    }
+
+    const QImage field = DanmakuTextSpriteCache::distanceFieldFromCoverage(coverage, 4);
+    QCOMPARE(field.size(), coverage.size());
+    QCOMPARE(fieldAlpha(field, 0, 0), 0);
+    QCOMPARE(fieldAlpha(field, 24, 24), 255);
+    QVERIFY(fieldAlpha(field, 16, 24) > 128);
+    QVERIFY(fieldAlpha(field, 15, 24) < 128);
+    for (int x = 8; x < 24; ++x) {
+        QVERIFY2(fieldAlpha(field, x, 24) >= fieldAlpha(field, x - 1, 24), "field should rise toward the inside");
+    }
+    QCOMPARE(fieldAlpha(field, 16, 24), 255 - fieldAlpha(field, 15, 24));
+}
+
+void DanmakuSpriteCacheTest::distanceFieldModeComesFromEnvironment() {
+    qputenv("NICONEON_DANMAKU_SPRITE_FORMAT", "sdf");
+    QVERIFY(DanmakuTextSpriteCache::distanceFieldModeFromEnvironment());
+    qputenv("NICONEON_DANMAKU_SPRITE_FORMAT", "coverage");
+    QVERIFY(!DanmakuTextSpriteCache::distanceFieldModeFromEnvironment());
+    qunsetenv("NICONEON_DANMAKU_SPRITE_FORMAT");
+    QVERIFY(!DanmakuTextSpriteCache::distanceFieldModeFromEnvironment());
+}
+
 QTEST_MAIN(DanmakuSpriteCacheTest)
 
 #include "danmaku_sprite_cache_test.moc"
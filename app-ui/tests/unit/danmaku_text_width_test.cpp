@@ -20,10 +20,12 @@ private slots:
     void defaultTargetFpsIs60();
     void commentFpsTracksPresentedFramesOnly();
     void repeatedTextUsesWidthCache();
+    void distanceFieldDevicePixelRatioChangeKeepsSprites();
     void wideFullwidthTextDoesNotUnderestimate();
     void japaneseTextDoesNotUnderestimate();
     void minimumWidthIsPreserved();
     void seekResumeLagCompensationPlacesCommentMidScroll();
+    void lagCulledCommentDoesNotTakeALane();
 
 private:
     static int requiredBubbleWidth(const QString &text);
@@ -86,6 +88,41 @@ void DanmakuTextWidthTest::repeatedTextUsesWidthCache() {
     QCOMPARE(afterSecond, afterFirst);
 }
 
+void DanmakuTextWidthTest::distanceFieldDevicePixelRatioChangeKeepsSprites() {
+    qputenv("NICONEON_DANMAKU_SPRITE_FORMAT", "sdf");
+    qputenv("NICONEON_DANMAKU_RASTER_THREADS", "0");
+    DanmakuController controller;
+    qunsetenv("NICONEON_DANMAKU_SPRITE_FORMAT");
+    qunsetenv("NICONEON_DANMAKU_RASTER_THREADS");
+    controller.setGlyphWarmupEnabled(false);
+    controller.setViewportSize(1280.0, 720.0);
+    controller.setLaneMetrics(36, 6);
+    controller.setPlaybackPaused(true);
+
+    QVariantList comments;
+    for (int i = 0; i < 12; ++i) {
+        QVariantMap comment;
+        comment.insert(QStringLiteral("comment_id"), QStringLiteral("sdf-%1").arg(i));
+        comment.insert(QStringLiteral("user_id"), QStringLiteral("sdf-user"));
+        comment.insert(QStringLiteral("text"), QStringLiteral("sdf comment %1").arg(i));
+        comment.insert(QStringLiteral("at_ms"), 0);
+        comments.push_back(comment);
+    }
+    controller.appendFromCore(comments, 0);
+    for (int frame = 0; frame < 4 && controller.pendingRasterCountForTesting() > 0; ++frame) {
+        controller.stepFrameForTesting(16);
+    }
+    QCOMPARE(controller.pendingRasterCountForTesting(), 0);
+    QVERIFY(!controller.takePendingSpriteUploads().isEmpty());
+    const int measurements = controller.widthMeasurementCountForTesting();
+
+    controller.setRenderDevicePixelRatio(2.0);
+    QCOMPARE(controller.pendingRasterCountForTesting(), 0);
+    controller.stepFrameForTesting(16);
+    QVERIFY(controller.takePendingSpriteUploads().isEmpty());
+    QCOMPARE(controller.widthMeasurementCountForTesting(), measurements);
+}
+
 void DanmakuTextWidthTest::wideFullwidthTextDoesNotUnderestimate() {
     const QString text = QStringLiteral("ｗｗｗｗｗｗｗｗｗｗ");
     const DanmakuRenderFrameConstPtr snapshot =
@@ -139,6 +176,38 @@ void DanmakuTextWidthTest::seekResumeLagCompensationPlacesCommentMidScroll() {
         "seek-resumed comment should be positioned as if it had been flowing before the seek");
 }
 
+void DanmakuTextWidthTest::lagCulledCommentDoesNotTakeALane() {
+    const DanmakuRenderFrameConstPtr reference =
+        appendSingleComment(QStringLiteral("lane-live"), QStringLiteral("live"), 14000, 15000);
+    QVERIFY(reference);
+    QCOMPARE(reference->instances.size(), 1);
+
+    DanmakuController controller;
+    controller.setGlyphWarmupEnabled(false);
+    controller.setViewportSize(1280.0, 720.0);
+    controller.setLaneMetrics(36, 6);
+    controller.setPlaybackPaused(true);
+
+    QVariantMap culled;
+    culled.insert(QStringLiteral("comment_id"), QStringLiteral("lane-culled"));
+    culled.insert(QStringLiteral("user_id"), QStringLiteral("width-test-user"));
+    culled.insert(QStringLiteral("text"), QStringLiteral("late"));
+    culled.insert(QStringLiteral("at_ms"), 0);
+    QVariantMap live = culled;
+    live.insert(QStringLiteral("comment_id"), QStringLiteral("lane-live"));
+    live.insert(QStringLiteral("text"), QStringLiteral("live"));
+    live.insert(QStringLiteral("at_ms"), 14000);
+    controller.appendFromCore(QVariantList {culled}, 15000);
+    controller.appendFromCore(QVariantList {live}, 15000);
+    QCoreApplication::processEvents();
+
+    const DanmakuRenderFrameConstPtr snapshot = controller.renderSnapshot();
+    QVERIFY(snapshot);
+    QCOMPARE(snapshot->instances.size(), 1);
+    QCOMPARE(snapshot->instances[0].commentId, QStringLiteral("lane-live"));
+    QCOMPARE(snapshot->instances[0].y, reference->instances[0].y);
+}
+
 int DanmakuTextWidthTest::requiredBubbleWidth(const QString &text) {
     QFont font;
     font.setPixelSize(DanmakuRenderStyle::kTextPixelSize);
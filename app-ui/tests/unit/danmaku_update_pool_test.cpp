@@ -0,0 +1,157 @@
+#include "danmaku/DanmakuUpdatePool.hpp"
+
+#include <QRandomGenerator>
+#include <QTest>
+
+namespace {
+constexpr int kChunkRows = 256;
+constexpr int kParallelMinRows = 512;
+
+QVector<int> changedIndices(const DanmakuFusedUpdateResult &result) {
+    return result.changedIndices.mid(0, result.changedCount);
+}
+
+QVector<int> removedIndices(const DanmakuFusedUpdateResult &result) {
+    return result.removedIndices.mid(0, result.removedCount);
+}
+
+DanmakuSoAState randomState(int count, quint32 seed) {
+    QRandomGenerator random(seed);
+    DanmakuSoAState state;
+    state.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        quint8 flags = 0;
+        if (random.bounded(8) == 0) {
+            flags |= DanmakuSoAFlagFrozen;
+        }
+        if (random.bounded(4) == 0) {
+            flags |= DanmakuSoAFlagFading;
+        }
+        if (random.bounded(6) == 0) {
+            flags |= DanmakuSoAFlagDragging;
+        }
+        state.handles.push_back(static_cast<DanmakuItemHandle>(i + 1));
+        state.x.push_back(static_cast<float>(random.bounded(2400.0) - 400.0));
+        state.y.push_back(static_cast<float>(random.bounded(900.0) - 90.0));
+        state.speed.push_back(static_cast<float>(80.0 + random.bounded(400.0)));
+        state.alpha.push_back(random.bounded(20) == 0 ? 0.0f : 1.0f);
+        state.widthEstimate.push_back(20 + static_cast<int>(random.bounded(500)));
+        state.fadeRemainingMs.push_back(static_cast<int>(random.bounded(400)) - 50);
+        state.flags.push_back(flags);
+    }
+    return state;
+}
+
+DanmakuFusedUpdateParams frameParams() {
+    DanmakuFusedUpdateParams params;
+    params.movementFactor = 0.1f;
+    params.elapsedMs = 100;
+    params.cullThreshold = -8.0f;
+    params.viewportHeight = 720.0f;
+    params.itemHeight = 42.0f;
+    return params;
+}
+} // namespace
+
+class DanmakuUpdatePoolTest : public QObject {
+    Q_OBJECT
+
+private slots:
+    void partitionedUpdateMatchesSerialKernel_data();
+    void partitionedUpdateMatchesSerialKernel();
+    void belowThresholdStaysSerial();
+    void countersReportChunksAndScaling();
+    void threadCountComesFromEnvironment();
+};
+
+void DanmakuUpdatePoolTest::partitionedUpdateMatchesSerialKernel_data() {
+    QTest::addColumn<int>("threads");
+    QTest::addColumn<int>("count");
+    for (const int threads : {2, 3, 4}) {
+        for (const int count : {kParallelMinRows, kChunkRows * 4 + 1, 5003, 20000}) {
+            QTest::newRow(qPrintable(QStringLiteral("%1t/%2").arg(threads).arg(count))) << threads << count;
+        }
+    }
+}
+
+void DanmakuUpdatePoolTest::partitionedUpdateMatchesSerialKernel() {
+    QFETCH(int, threads);
+    QFETCH(int, count);
+
+    DanmakuSoAState serial = randomState(count, static_cast<quint32>(count + threads));
+    DanmakuSoAState partitioned = serial;
+    DanmakuUpdatePool pool(threads, kParallelMinRows, kChunkRows);
+    const DanmakuFusedUpdateParams params = frameParams();
+
+    for (int frame = 0; frame < 3; ++frame) {
+        DanmakuFusedUpdateResult serialResult;
+        DanmakuFusedUpdateResult partitionedResult;
+        DanmakuSimdUpdater::updateFused(serial, params, serialResult, DanmakuSimdMode::Auto);
+        pool.updateFused(partitioned, params, partitionedResult, DanmakuSimdMode::Auto);
+
+        QCOMPARE(partitioned.x, serial.x);
+        QCOMPARE(partitioned.alpha, serial.alpha);
+        QCOMPARE(partitioned.fadeRemainingMs, serial.fadeRemainingMs);
+        QCOMPARE(changedIndices(partitionedResult), changedIndices(serialResult));
+        QCOMPARE(removedIndices(partitionedResult), removedIndices(serialResult));
+    }
+    QCOMPARE(pool.takeCounters().parallelFrames, quint64(3));
+}
+
+void DanmakuUpdatePoolTest::belowThresholdStaysSerial() {
+    DanmakuUpdatePool pool(4, kParallelMinRows, kChunkRows);
+    DanmakuSoAState state = randomState(kParallelMinRows - 1, 3);
+    DanmakuFusedUpdateResult result;
+    pool.updateFused(state, frameParams(), result, DanmakuSimdMode::Scalar);
+
+    const DanmakuUpdatePool::Counters counters = pool.takeCounters();
+    QCOMPARE(counters.serialFrames, quint64(1));
+    QCOMPARE(counters.parallelFrames, quint64(0));
+    QCOMPARE(counters.chunks, quint64(0));
+    QCOMPARE(pool.startedHelperCount(), 0);
+
+    DanmakuUpdatePool single(1, 1, kChunkRows);
+    DanmakuSoAState large = randomState(4000, 5);
+    single.updateFused(large, frameParams(), result, DanmakuSimdMode::Scalar);
+    QCOMPARE(single.takeCounters().serialFrames, quint64(1));
+    QCOMPARE(single.startedHelperCount(), 0);
+}
+
+void DanmakuUpdatePoolTest::countersReportChunksAndScaling() {
+    DanmakuUpdatePool pool(3, kParallelMinRows, kChunkRows);
+    QCOMPARE(pool.startedHelperCount(), 0);
+    DanmakuSoAState state = randomState(kChunkRows * 10 + 7, 11);
+    DanmakuFusedUpdateResult result;
+    pool.updateFused(state, frameParams(), result, DanmakuSimdMode::Scalar);
+    QCOMPARE(pool.startedHelperCount(), 2);
+
+    const DanmakuUpdatePool::Counters counters = pool.takeCounters();
+    QCOMPARE(counters.parallelFrames, quint64(1));
+    QCOMPARE(counters.chunks, quint64(11));
+    QVERIFY(counters.stolenChunks <= counters.chunks);
+    QVERIFY(counters.wallNs > 0);
+    QVERIFY(counters.busyNs > 0);
+
+    const DanmakuUpdatePool::Counters drained = pool.takeCounters();
+    QCOMPARE(drained.parallelFrames, quint64(0));
+    QCOMPARE(drained.busyNs, qint64(0));
+}
+
+void DanmakuUpdatePoolTest::threadCountComesFromEnvironment() {
+    qputenv("NICONEON_DANMAKU_UPDATE_THREADS", "3");
+    QCOMPARE(DanmakuUpdatePool::threadCountFromEnvironment(), 3);
+    qputenv("NICONEON_DANMAKU_UPDATE_THREADS", "64");
+    QCOMPARE(DanmakuUpdatePool::threadCountFromEnvironment(), DanmakuUpdatePool::kMaxThreads);
+    qunsetenv("NICONEON_DANMAKU_UPDATE_THREADS");
+    QVERIFY(DanmakuUpdatePool::threadCountFromEnvironment() >= 1);
+
+    qputenv("NICONEON_DANMAKU_PARALLEL_MIN_ROWS", "1000");
+    QCOMPARE(DanmakuUpdatePool::parallelMinRowsFromEnvironment(), 1000);
+    qputenv("NICONEON_DANMAKU_PARALLEL_MIN_ROWS", "nope");
+    QCOMPARE(DanmakuUpdatePool::parallelMinRowsFromEnvironment(), DanmakuUpdatePool::kDefaultParallelMinRows);
+    qunsetenv("NICONEON_DANMAKU_PARALLEL_MIN_ROWS");
+}
+
+QTEST_APPLESS_MAIN(DanmakuUpdatePoolTest)
+
+#include "danmaku_update_pool_test.moc"
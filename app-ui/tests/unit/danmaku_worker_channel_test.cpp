@@ -0,0 +1,272 @@
+#include "danmaku/DanmakuSpscRing.hpp"
+#include "danmaku/DanmakuUpdateWorker.hpp"
+#include "danmaku/DanmakuWorkerChannel.hpp"
+
+#include <QTest>
+#include <QThread>
+
+namespace {
+DanmakuWorkerRowState rowState(quint32 slot, qreal x, quint8 flags = 0) {
+    DanmakuWorkerRowState row;
+    row.handle = (static_cast<DanmakuItemHandle>(1) << 32) | slot;
+    row.x = x;
+    row.y = slot * 42.0;
+    row.speed = 100.0;
+    row.widthEstimate = 50;
+    row.flags = flags;
+    return row;
+}
+
+void pushUpsert(DanmakuWorkerChannel &channel, const DanmakuWorkerRowState &row) {
+    DanmakuWorkerCommand command;
+    command.type = DanmakuWorkerCommandType::Upsert;
+    command.row = row;
+    channel.push(command);
+}
+
+void pushFrame(DanmakuWorkerChannel &channel, qint64 seq, int elapsedMs, qint64 targetNs = 0, quint32 generation = 0) {
+    DanmakuWorkerCommand command;
+    command.type = DanmakuWorkerCommandType::Frame;
+    command.frame.seq = seq;
+    command.frame.generation = generation;
+    command.frame.targetNs = targetNs;
+    command.frame.elapsedMs = elapsedMs;
+    command.frame.viewportHeight = 720.0;
+    command.frame.cullThreshold = -8.0;
+    command.frame.itemHeight = 42.0;
+    channel.push(command);
+}
+} // namespace
+
+class DanmakuWorkerChannelTest : public QObject {
+    Q_OBJECT
+
+private slots:
+    void ringRoundsCapacityAndReportsFull();
+    void ringPreservesOrderAcrossWraparound();
+    void ringTransfersAcrossThreads();
+    void workerPublishesChangedColumnsAndRemovals();
+    void framesAreConsumedInPublishOrder();
+    void fullResetDropsPreviousRows();
+    void fullStateLargerThanRingIsOneCommand();
+    void pipelinedFramesCarryTargetTimestamps();
+    void pipelineDepthComesFromEnvironment();
+};
+
+void DanmakuWorkerChannelTest::ringRoundsCapacityAndReportsFull() {
+    DanmakuSpscRing<int> ring(5);
+    QCOMPARE(ring.capacity(), 8);
+    for (int i = 0; i < 8; ++i) {
+        QVERIFY(ring.tryPush(i));
+    }
+    QVERIFY(!ring.tryPush(8));
+    QCOMPARE(ring.sizeApprox(), 8);
+
+    int value = -1;
+    QVERIFY(ring.tryPop(value));
+    QCOMPARE(value, 0);
+    QVERIFY(ring.tryPush(8));
+}
+
+void DanmakuWorkerChannelTest::ringPreservesOrderAcrossWraparound() {
+    DanmakuSpscRing<int> ring(4);
+    int next = 0;
+    int expected = 0;
+    for (int round = 0; round < 100; ++round) {
+        for (int i = 0; i < 3; ++i) {
+            QVERIFY(ring.tryPush(next++));
+        }
+        int value = -1;
+        for (int i = 0; i < 3; ++i) {
+            QVERIFY(ring.tryPop(value));
+            QCOMPARE(value, expected++);
+        }
+        QVERIFY(!ring.tryPop(value));
+    }
+}
+
+void DanmakuWorkerChannelTest::ringTransfersAcrossThreads() {
+    constexpr int kCount = 200000;
+    DanmakuSpscRing<int> ring(64);
+    QThread *producer = QThread::create([&ring]() {
+        for (int i = 0; i < kCount; ++i) {
+            while (!ring.tryPush(i)) {
+                QThread::yieldCurrentThread();
+            }
+        }
+    });
+    producer->start();
+
+    int expected = 0;
+    int value = -1;
+    while (expected < kCount) {
+        if (!ring.tryPop(value)) {
+            QThread::yieldCurrentThread();
+            continue;
+        }
+        if (value != expected) {
+            break;
+        }
+        ++expected;
+    }
+    producer->wait();
+    delete producer;
+    QCOMPARE(expected, kCount);
+}
+
+void DanmakuWorkerChannelTest::workerPublishesChangedColumnsAndRemovals() {
+    DanmakuWorkerChannel channel(16);
+    DanmakuUpdateWorker worker(&channel);
+    worker.setSimdMode(DanmakuSimdMode::Scalar);
+
+    const DanmakuWorkerRowState moving = rowState(0, 500.0);
+    const DanmakuWorkerRowState frozen = rowState(1, 500.0, DanmakuSoAFlagFrozen);
+    const DanmakuWorkerRowState leaving = rowState(2, -60.0);
+    pushUpsert(channel, moving);
+    pushUpsert(channel, frozen);
+    pushUpsert(channel, leaving);
+    pushFrame(channel, 7, 100);
+    QVERIFY(worker.drainCommands());
+
+    const DanmakuWorkerFrameColumns *frame = channel.acquireFrame();
+    QVERIFY(frame);
+    QCOMPARE(frame->seq, qint64(7));
+    QCOMPARE(frame->changedCount(), 1);
+    QCOMPARE(frame->changedHandles.at(0), moving.handle);
+    QCOMPARE(frame->x.at(0), 490.0f);
+    QCOMPARE(frame->alpha.at(0), 1.0f);
+    QCOMPARE(frame->removedHandles, QVector<DanmakuItemHandle>({leaving.handle}));
+    channel.releaseFrame();
+    QVERIFY(!channel.acquireFrame());
+
+    const DanmakuWorkerChannel::Counters counters = channel.takeCounters();
+    QCOMPARE(counters.commands, quint64(4));
+    QCOMPARE(counters.ringStalls, quint64(0));
+    QCOMPARE(counters.framesPublished, quint64(1));
+}
+
+void DanmakuWorkerChannelTest::framesAreConsumedInPublishOrder() {
+    DanmakuWorkerChannel channel(16);
+    DanmakuUpdateWorker worker(&channel);
+    pushUpsert(channel, rowState(0, 500.0));
+    pushFrame(channel, 1, 100);
+    pushFrame(channel, 2, 100);
+    QVERIFY(worker.drainCommands());
+
+    const DanmakuWorkerFrameColumns *first = channel.acquireFrame();
+    QVERIFY(first);
+    QCOMPARE(first->seq, qint64(1));
+    QCOMPARE(first->x.at(0), 490.0f);
+    channel.releaseFrame();
+
+    const DanmakuWorkerFrameColumns *second = channel.acquireFrame();
+    QVERIFY(second);
+    QVERIFY(second != first);
+    QCOMPARE(second->seq, qint64(2));
+    QCOMPARE(second->x.at(0), 480.0f);
+    channel.releaseFrame();
+    QVERIFY(!channel.acquireFrame());
+}
+
+void DanmakuWorkerChannelTest::fullResetDropsPreviousRows() {
+    DanmakuWorkerChannel channel(16);
+    DanmakuUpdateWorker worker(&channel);
+    pushUpsert(channel, rowState(0, 500.0));
+    pushUpsert(channel, rowState(1, 600.0));
+
+    const DanmakuWorkerRowState kept = rowState(3, 700.0);
+    channel.pushFullState({kept});
+    pushFrame(channel, 1, 100);
+
+    DanmakuWorkerCommand quit;
+    quit.type = DanmakuWorkerCommandType::Quit;
+    channel.push(quit);
+    QVERIFY(!worker.drainCommands());
+
+    const DanmakuWorkerFrameColumns *frame = channel.acquireFrame();
+    QVERIFY(frame);
+    QCOMPARE(frame->changedHandles, QVector<DanmakuItemHandle>({kept.handle}));
+    QCOMPARE(frame->x.at(0), 690.0f);
+    channel.releaseFrame();
+}
+
+void DanmakuWorkerChannelTest::fullStateLargerThanRingIsOneCommand() {
+    DanmakuWorkerChannel channel(16);
+    DanmakuUpdateWorker worker(&channel);
+    QVector<DanmakuWorkerRowState> rows;
+    for (quint32 slot = 0; slot < 100; ++slot) {
+        rows.push_back(rowState(slot, 500.0 + slot));
+        rows.back().y = (slot % 10) * 42.0;
+    }
+    channel.pushFullState(rows);
+    channel.pushFullState({rowState(5, 800.0)});
+    pushFrame(channel, 1, 100);
+    QVERIFY(worker.drainCommands());
+
+    const DanmakuWorkerFrameColumns *frame = channel.acquireFrame();
+    QVERIFY(frame);
+    QCOMPARE(frame->changedHandles, QVector<DanmakuItemHandle>({rowState(5, 800.0).handle}));
+    channel.releaseFrame();
+
+    const DanmakuWorkerChannel::Counters counters = channel.takeCounters();
+    QCOMPARE(counters.commands, quint64(3));
+    QCOMPARE(counters.ringStalls, quint64(0));
+
+    channel.pushFullState(rows);
+    pushFrame(channel, 2, 100);
+    QVERIFY(worker.drainCommands());
+    frame = channel.acquireFrame();
+    QVERIFY(frame);
+    QCOMPARE(frame->changedCount(), 100);
+    QCOMPARE(frame->x.at(99), 589.0f);
+    channel.releaseFrame();
+}
+
+void DanmakuWorkerChannelTest::pipelinedFramesCarryTargetTimestamps() {
+    DanmakuWorkerChannel channel(16);
+    DanmakuUpdateWorker worker(&channel);
+    pushUpsert(channel, rowState(0, 500.0));
+    pushFrame(channel, 1, 20, 20000000, 3);
+    pushFrame(channel, 2, 20, 40000000, 3);
+    QCOMPARE(channel.pendingFrames(), 0);
+    QVERIFY(worker.drainCommands());
+    QCOMPARE(channel.pendingFrames(), DanmakuWorkerChannel::kFrameSlots);
+
+    const DanmakuWorkerFrameColumns *first = channel.acquireFrame();
+    QVERIFY(first);
+    QCOMPARE(first->generation, quint32(3));
+    QCOMPARE(first->targetNs, qint64(20000000));
+    channel.releaseFrame();
+    QCOMPARE(channel.pendingFrames(), 1);
+
+    pushFrame(channel, 3, 20, 60000000, 4);
+    QVERIFY(worker.drainCommands());
+    QCOMPARE(channel.pendingFrames(), 2);
+
+    const DanmakuWorkerFrameColumns *second = channel.acquireFrame();
+    QCOMPARE(second->targetNs, qint64(40000000));
+    QCOMPARE(second->x.at(0), 496.0f);
+    channel.releaseFrame();
+
+    const DanmakuWorkerFrameColumns *third = channel.acquireFrame();
+    QCOMPARE(third->seq, qint64(3));
+    QCOMPARE(third->generation, quint32(4));
+    QCOMPARE(third->targetNs, qint64(60000000));
+    channel.releaseFrame();
+    QCOMPARE(channel.pendingFrames(), 0);
+}
+
+void DanmakuWorkerChannelTest::pipelineDepthComesFromEnvironment() {
+    qputenv("NICONEON_DANMAKU_WORKER_PIPELINE", "1");
+    QCOMPARE(DanmakuWorkerChannel::pipelineDepthFromEnvironment(), 1);
+    qputenv("NICONEON_DANMAKU_WORKER_PIPELINE", "8");
+    QCOMPARE(DanmakuWorkerChannel::pipelineDepthFromEnvironment(), DanmakuWorkerChannel::kFrameSlots);
+    qputenv("NICONEON_DANMAKU_WORKER_PIPELINE", "0");
+    QCOMPARE(DanmakuWorkerChannel::pipelineDepthFromEnvironment(), DanmakuWorkerChannel::kFrameSlots);
+    qunsetenv("NICONEON_DANMAKU_WORKER_PIPELINE");
+    QCOMPARE(DanmakuWorkerChannel::pipelineDepthFromEnvironment(), DanmakuWorkerChannel::kFrameSlots);
+}
+
+QTEST_APPLESS_MAIN(DanmakuWorkerChannelTest)
+
+#include "danmaku_worker_channel_test.moc"
@@ -0,0 +1,246 @@
+#include "danmaku/DanmakuController.hpp"
+
+#include <QHash>
+#include <QTest>
+#include <QVariantList>
+#include <QVariantMap>
+
+#include <cmath>
+
+namespace {
+
+constexpr int kTickMs = 16;
+constexpr qint64 kTickNs = kTickMs * qint64(1000000);
+
+QVariantMap makeComment(const QString &commentId, const QString &userId, const QString &text) {
+    QVariantMap comment;
+    comment.insert(QStringLiteral("comment_id"), commentId);
+    comment.insert(QStringLiteral("user_id"), userId);
+    comment.insert(QStringLiteral("text"), text);
+    comment.insert(QStringLiteral("at_ms"), 0);
+    return comment;
+}
+
+bool settleWorker(DanmakuController &controller) {
+    return QTest::qWaitFor([&controller]() { return !controller.workerBusyForTesting(); }, 1000);
+}
+
+DanmakuRenderInstance instanceFor(const DanmakuRenderFrameConstPtr &frame, const QString &commentId) {
+    for (const DanmakuRenderInstance &instance : frame->instances) {
+        if (instance.commentId == commentId) {
+            return instance;
+        }
+    }
+    return {};
+}
+
+struct Pipeline {
+    DanmakuController controller;
+    qint64 baseNs = 0;
+    qint64 tickNs = 0;
+    QHash<QString, qreal> baseX;
+    QHash<QString, qreal> speed;
+
+    bool start() {
+        controller.setGlyphWarmupEnabled(false);
+        controller.setViewportSize(1280.0, 720.0);
+        controller.setLaneMetrics(36, 6);
+        controller.setPlaybackPaused(true);
+        controller.stepFrameForTesting(0);
+
+        QVariantList comments;
+        comments.push_back(makeComment(QStringLiteral("a"), QStringLiteral("u1"), QStringLiteral("first")));
+        comments.push_back(makeComment(QStringLiteral("b"), QStringLiteral("u2"), QStringLiteral("second")));
+        controller.appendFromCore(comments, 0);
+        controller.setPlaybackPaused(false);
+
+        const DanmakuRenderFrameConstPtr frame = controller.renderSnapshot();
+        if (!frame || frame->instances.size() != 2) {
+            return false;
+        }
+        baseNs = frame->simulatedAtNs;
+        tickNs = baseNs;
+        for (const DanmakuRenderInstance &instance : frame->instances) {
+            baseX.insert(instance.commentId, instance.x);
+            speed.insert(instance.commentId, instance.speed);
+        }
+        return baseNs > 0;
+    }
+
+    DanmakuRenderFrameConstPtr step(int elapsedMs) {
+        controller.stepFrameForTesting(elapsedMs);
+        tickNs += elapsedMs * qint64(1000000);
+        return controller.renderSnapshot();
+    }
+
+    DanmakuRenderFrameConstPtr settledStep(int elapsedMs) {
+        const DanmakuRenderFrameConstPtr frame = step(elapsedMs);
+        return settleWorker(controller) ? frame : DanmakuRenderFrameConstPtr();
+    }
+
+    qreal expectedX(const QString &commentId, qint64 simulatedAtNs) const {
+        return baseX.value(commentId) - speed.value(commentId) * ((simulatedAtNs - baseNs) / 1.0e9);
+    }
+
+    bool matchesSimulatedTime(const DanmakuRenderFrameConstPtr &frame, const QString &commentId) const {
+        return std::abs(instanceFor(frame, commentId).x - expectedX(commentId, frame->simulatedAtNs)) < 0.05;
+    }
+};
+
+} // namespace
+
+class DanmakuWorkerPipelineTest : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void workerPositionsFollowTargetTimes();
+    void framesApplyWithinHalfTickOfTarget();
+    void lateFramesLandWithoutDoubleStep();
+    void fullResetDropsStaleGenerationFrames();
+    void rowsTouchedInFlightStayMasked();
+};
+
+void DanmakuWorkerPipelineTest::initTestCase() {
+    qputenv("NICONEON_DANMAKU_WORKER", "on");
+    qputenv("NICONEON_DANMAKU_WORKER_PIPELINE", "2");
+    qputenv("NICONEON_DANMAKU_CLOCK", "vsync");
+    qputenv("NICONEON_DANMAKU_RASTER_THREADS", "0");
+    qputenv("NICONEON_DANMAKU_GOVERNOR", "off");
+    qputenv("NICONEON_SIMD_MODE", "scalar");
+}
+
+void DanmakuWorkerPipelineTest::workerPositionsFollowTargetTimes() {
+    Pipeline pipeline;
+    QVERIFY(pipeline.start());
+
+    DanmakuRenderFrameConstPtr frame = pipeline.settledStep(kTickMs);
+    QVERIFY(frame);
+    QCOMPARE(frame->simulatedAtNs, pipeline.baseNs);
+    QCOMPARE(instanceFor(frame, QStringLiteral("a")).x, pipeline.baseX.value(QStringLiteral("a")));
+
+    for (int tick = 2; tick <= 12; ++tick) {
+        frame = pipeline.settledStep(kTickMs);
+        QVERIFY(frame);
+        QCOMPARE(frame->instances.size(), 2);
+        QCOMPARE(frame->simulatedAtNs, pipeline.tickNs);
+        QVERIFY(pipeline.matchesSimulatedTime(frame, QStringLiteral("a")));
+        QVERIFY(pipeline.matchesSimulatedTime(frame, QStringLiteral("b")));
+    }
+    QVERIFY(instanceFor(frame, QStringLiteral("a")).x < pipeline.baseX.value(QStringLiteral("a")));
+}
+
+void DanmakuWorkerPipelineTest::framesApplyWithinHalfTickOfTarget() {
+    Pipeline pipeline;
+    QVERIFY(pipeline.start());
+    for (int tick = 0; tick < 4; ++tick) {
+        QVERIFY(pipeline.settledStep(kTickMs));
+    }
+    const qint64 anchorNs = pipeline.tickNs;
+
+    const QVector<qint64> expectedOffsetsMs {0, 16, 16, 32, 40, 48};
+    for (const qint64 offsetMs : expectedOffsetsMs) {
+        const DanmakuRenderFrameConstPtr frame = pipeline.settledStep(kTickMs / 2);
+        QVERIFY(frame);
+        QCOMPARE(frame->simulatedAtNs, anchorNs + offsetMs * 1000000);
+        QVERIFY(pipeline.tickNs - frame->simulatedAtNs < kTickNs);
+        QVERIFY(frame->simulatedAtNs <= pipeline.tickNs + kTickNs / 4);
+        QVERIFY(pipeline.matchesSimulatedTime(frame, QStringLiteral("a")));
+        QVERIFY(pipeline.matchesSimulatedTime(frame, QStringLiteral("b")));
+    }
+}
+
+void DanmakuWorkerPipelineTest::lateFramesLandWithoutDoubleStep() {
+    Pipeline pipeline;
+    QVERIFY(pipeline.start());
+    for (int tick = 0; tick < 3; ++tick) {
+        QVERIFY(pipeline.settledStep(kTickMs));
+    }
+
+    for (int round = 0; round < 20; ++round) {
+        for (int burst = 0; burst < 3; ++burst) {
+            const DanmakuRenderFrameConstPtr frame = pipeline.step(kTickMs);
+            QVERIFY(frame);
+            QVERIFY(frame->simulatedAtNs <= pipeline.tickNs);
+            QVERIFY(pipeline.tickNs - frame->simulatedAtNs <= DanmakuWorkerChannel::kFrameSlots * kTickNs);
+            QCOMPARE((frame->simulatedAtNs - pipeline.baseNs) % kTickNs, qint64(0));
+            QVERIFY(pipeline.matchesSimulatedTime(frame, QStringLiteral("a")));
+            QVERIFY(pipeline.matchesSimulatedTime(frame, QStringLiteral("b")));
+        }
+        QVERIFY(settleWorker(pipeline.controller));
+        const DanmakuRenderFrameConstPtr frame = pipeline.settledStep(kTickMs);
+        QVERIFY(frame);
+        QCOMPARE(frame->simulatedAtNs, pipeline.tickNs);
+        QVERIFY(pipeline.matchesSimulatedTime(frame, QStringLiteral("a")));
+        QVERIFY(pipeline.matchesSimulatedTime(frame, QStringLiteral("b")));
+    }
+}
+
+void DanmakuWorkerPipelineTest::fullResetDropsStaleGenerationFrames() {
+    Pipeline pipeline;
+    QVERIFY(pipeline.start());
+    for (int tick = 0; tick < 4; ++tick) {
+        QVERIFY(pipeline.settledStep(kTickMs));
+    }
+
+    const DanmakuRenderFrameConstPtr before = pipeline.controller.renderSnapshot();
+    const qint64 resetAtNs = before->simulatedAtNs;
+    QCOMPARE(resetAtNs, pipeline.tickNs);
+    const qreal resetX = instanceFor(before, QStringLiteral("a")).x;
+    const qreal speed = pipeline.speed.value(QStringLiteral("a"));
+
+    pipeline.controller.setPlaybackRate(2.0);
+    QVERIFY(settleWorker(pipeline.controller));
+
+    DanmakuRenderFrameConstPtr frame = pipeline.settledStep(kTickMs);
+    QVERIFY(frame);
+    QCOMPARE(frame->simulatedAtNs, resetAtNs);
+    QCOMPARE(instanceFor(frame, QStringLiteral("a")).x, resetX);
+
+    for (int tick = 2; tick <= 5; ++tick) {
+        frame = pipeline.settledStep(kTickMs);
+        QVERIFY(frame);
+        QCOMPARE(frame->simulatedAtNs, pipeline.tickNs);
+        const qreal expected = resetX - speed * 2.0 * ((frame->simulatedAtNs - resetAtNs) / 1.0e9);
+        QVERIFY(std::abs(instanceFor(frame, QStringLiteral("a")).x - expected) < 0.05);
+    }
+}
+
+void DanmakuWorkerPipelineTest::rowsTouchedInFlightStayMasked() {
+    Pipeline pipeline;
+    QVERIFY(pipeline.start());
+    for (int tick = 0; tick < 4; ++tick) {
+        QVERIFY(pipeline.settledStep(kTickMs));
+    }
+
+    const DanmakuRenderFrameConstPtr before = pipeline.controller.renderSnapshot();
+    const DanmakuRenderInstance dragged = instanceFor(before, QStringLiteral("a"));
+    QVERIFY(pipeline.controller.beginDragAt(dragged.x + 8.0, dragged.y + 8.0));
+
+    for (int tick = 0; tick < 4; ++tick) {
+        const DanmakuRenderFrameConstPtr frame = pipeline.settledStep(kTickMs);
+        QVERIFY(frame);
+        QCOMPARE(frame->simulatedAtNs, pipeline.tickNs);
+        QCOMPARE(instanceFor(frame, QStringLiteral("a")).x, dragged.x);
+        QCOMPARE(instanceFor(frame, QStringLiteral("a")).speed, 0.0);
+        QVERIFY(pipeline.matchesSimulatedTime(frame, QStringLiteral("b")));
+    }
+
+    pipeline.controller.moveActiveDrag(600.0, 300.0);
+    for (int tick = 0; tick < 4; ++tick) {
+        const DanmakuRenderFrameConstPtr frame = pipeline.settledStep(kTickMs);
+        QVERIFY(frame);
+        QCOMPARE(instanceFor(frame, QStringLiteral("a")).x, 592.0);
+        QVERIFY(pipeline.matchesSimulatedTime(frame, QStringLiteral("b")));
+    }
+
+    pipeline.controller.dropActiveDrag(false);
+    QVERIFY(settleWorker(pipeline.controller));
+    const DanmakuRenderFrameConstPtr released = pipeline.settledStep(kTickMs);
+    QVERIFY(released);
+    QVERIFY(pipeline.matchesSimulatedTime(released, QStringLiteral("b")));
+}
+
+QTEST_MAIN(DanmakuWorkerPipelineTest)
+
+#include "danmaku_worker_pipeline_test.moc"
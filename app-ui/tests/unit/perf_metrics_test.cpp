@@ -0,0 +1,174 @@
+#include "perf/PerfHistogram.hpp"
+#include "perf/PerfMetricScope.hpp"
+#include "perf/PerfMetricsRegistry.hpp"
+
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTemporaryDir>
+#include <QTest>
+
+class PerfMetricsTest : public QObject {
+    Q_OBJECT
+
+private slots:
+    void histogramIsExactBelowSubBucketRange();
+    void histogramBucketsCoverTheirValues();
+    void histogramPercentilesStayWithinRelativeError();
+    void histogramClampsOutOfRangeValues();
+    void histogramResetClearsSamples();
+    void scopeTextLineKeepsInsertionOrder();
+    void scopeJsonSeparatesMetricKinds();
+    void registryWritesJsonLines();
+};
+
+void PerfMetricsTest::histogramIsExactBelowSubBucketRange() {
+    PerfHistogram histogram;
+    for (int value = 1; value <= 100; ++value) {
+        histogram.record(value);
+    }
+
+    QCOMPARE(histogram.count(), qint64(100));
+    QCOMPARE(histogram.min(), qint64(1));
+    QCOMPARE(histogram.max(), qint64(100));
+    QCOMPARE(histogram.mean(), 50.5);
+    QCOMPARE(histogram.valueAtPercentile(50.0), qint64(50));
+    QCOMPARE(histogram.valueAtPercentile(95.0), qint64(95));
+    QCOMPARE(histogram.valueAtPercentile(99.0), qint64(99));
+    QCOMPARE(histogram.valueAtPercentile(100.0), qint64(100));
+}
+
+void PerfMetricsTest::histogramBucketsCoverTheirValues() {
+    const qint64 values[] = {0, 1, 127, 128, 255, 256, 1000, 16667, 33333, 1000000, PerfHistogram::kMaxTrackableUs};
+    for (const qint64 value : values) {
+        const int index = PerfHistogram::bucketIndex(value);
+        QVERIFY(index >= 0);
+        QVERIFY(index < PerfHistogram::kBucketCount);
+        QVERIFY(PerfHistogram::lowestEquivalentValue(index) <= value);
+        QVERIFY(PerfHistogram::highestEquivalentValue(index) >= value);
+        const qint64 width = PerfHistogram::highestEquivalentValue(index) - PerfHistogram::lowestEquivalentValue(index) + 1;
+        QVERIFY(width * PerfHistogram::kSubBucketCount <= std::max<qint64>(value, PerfHistogram::kSubBucketCount));
+    }
+    QCOMPARE(PerfHistogram::bucketIndex(PerfHistogram::kMaxTrackableUs), PerfHistogram::kBucketCount - 1);
+}
+
+void PerfMetricsTest::histogramPercentilesStayWithinRelativeError() {
+    PerfHistogram histogram;
+    for (qint64 value = 1; value <= 100000; ++value) {
+        histogram.record(value);
+    }
+
+    const auto withinOnePercent = [](qint64 actual, qint64 expected) {
+        return std::abs(actual - expected) * 100 <= expected;
+    };
+    QVERIFY(withinOnePercent(histogram.valueAtPercentile(50.0), 50000));
+    QVERIFY(withinOnePercent(histogram.valueAtPercentile(95.0), 95000));
+    QVERIFY(withinOnePercent(histogram.valueAtPercentile(99.0), 99000));
+    QCOMPARE(histogram.valueAtPercentile(100.0), qint64(100000));
+    QCOMPARE(histogram.sum(), qint64(5000050000));
+}
+
+void PerfMetricsTest::histogramClampsOutOfRangeValues() {
+    PerfHistogram histogram;
+    histogram.record(-25);
+    histogram.record(PerfHistogram::kMaxTrackableUs * 4);
+
+    QCOMPARE(histogram.count(), qint64(2));
+    QCOMPARE(histogram.min(), qint64(0));
+    QCOMPARE(histogram.max(), PerfHistogram::kMaxTrackableUs);
+    QCOMPARE(histogram.valueAtPercentile(50.0), qint64(0));
+    QCOMPARE(histogram.valueAtPercentile(100.0), PerfHistogram::kMaxTrackableUs);
+}
+
+void PerfMetricsTest::histogramResetClearsSamples() {
+    PerfHistogram histogram;
+    histogram.record(16667);
+    histogram.record(33333);
+    histogram.reset();
+
+    QCOMPARE(histogram.count(), qint64(0));
+    QCOMPARE(histogram.max(), qint64(0));
+    QCOMPARE(histogram.mean(), 0.0);
+    QCOMPARE(histogram.valueAtPercentile(99.0), qint64(0));
+
+    histogram.record(500);
+    QCOMPARE(histogram.min(), qint64(500));
+    QCOMPARE(histogram.valueAtPercentile(50.0), qint64(500));
+}
+
+void PerfMetricsTest::scopeTextLineKeepsInsertionOrder() {
+    PerfMetricScope scope(QStringLiteral("test-text"));
+    scope.setCounter(QStringLiteral("window_ms"), 2000);
+    scope.setGauge(QStringLiteral("fps"), 59.94, 1);
+    scope.setLabel(QStringLiteral("clock"), QStringLiteral("vsync"));
+    scope.setGauge(QStringLiteral("avg_ms"), 16.6667);
+    scope.setCounter(QStringLiteral("window_ms"), 2001);
+
+    QCOMPARE(scope.textLine(), QStringLiteral("[perf-test-text] window_ms=2001 fps=59.9 clock=vsync avg_ms=16.67"));
+}
+
+void PerfMetricsTest::scopeJsonSeparatesMetricKinds() {
+    PerfMetricScope scope(QStringLiteral("test-json"));
+    scope.setCounter(QStringLiteral("frame_count"), 120);
+    scope.setGauge(QStringLiteral("rows_active"), 42, 0);
+    scope.setLabel(QStringLiteral("backend"), QStringLiteral("atlas"));
+    PerfHistogram &frames = scope.histogram(QStringLiteral("frame_interval_us"));
+    frames.record(16000);
+    frames.record(17000);
+    QCOMPARE(&scope.histogram(QStringLiteral("frame_interval_us")), &frames);
+
+    const QJsonObject json = scope.toJson(1234);
+    QCOMPARE(json.value(QStringLiteral("scope")).toString(), QStringLiteral("test-json"));
+    QCOMPARE(json.value(QStringLiteral("instance")).toInt(), scope.instanceId());
+    QCOMPARE(json.value(QStringLiteral("ts_ms")).toInt(), 1234);
+    QCOMPARE(json.value(QStringLiteral("counters")).toObject().value(QStringLiteral("frame_count")).toInt(), 120);
+    QCOMPARE(json.value(QStringLiteral("gauges")).toObject().value(QStringLiteral("rows_active")).toDouble(), 42.0);
+    QCOMPARE(json.value(QStringLiteral("labels")).toObject().value(QStringLiteral("backend")).toString(), QStringLiteral("atlas"));
+
+    const QJsonObject summary = json.value(QStringLiteral("histograms")).toObject().value(QStringLiteral("frame_interval_us")).toObject();
+    QCOMPARE(summary.value(QStringLiteral("count")).toInt(), 2);
+    QCOMPARE(summary.value(QStringLiteral("min_us")).toInt(), 16000);
+    QCOMPARE(summary.value(QStringLiteral("max_us")).toInt(), 17000);
+    QCOMPARE(summary.value(QStringLiteral("mean_us")).toDouble(), 16500.0);
+
+    scope.resetHistograms();
+    QCOMPARE(frames.count(), qint64(0));
+}
+
+void PerfMetricsTest::registryWritesJsonLines() {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.filePath(QStringLiteral("nested/perf.jsonl"));
+    PerfMetricsRegistry &registry = PerfMetricsRegistry::instance();
+    registry.setJsonLinesPath(path);
+
+    PerfMetricScope first(QStringLiteral("test-registry"));
+    PerfMetricScope second(QStringLiteral("test-registry"));
+    QCOMPARE(second.instanceId(), first.instanceId() + 1);
+
+    const qint64 publishedBefore = registry.publishedCount();
+    first.setCounter(QStringLiteral("frame_count"), 1);
+    registry.publish(first, 100);
+    second.setCounter(QStringLiteral("frame_count"), 2);
+    registry.publish(second, 200);
+    QCOMPARE(registry.publishedCount(), publishedBefore + 2);
+    QCOMPARE(registry.latestSnapshot(QStringLiteral("test-registry")).value(QStringLiteral("ts_ms")).toInt(), 200);
+    registry.setJsonLinesPath(QString());
+
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::ReadOnly | QIODevice::Text));
+    const QList<QByteArray> lines = file.readAll().trimmed().split('\n');
+    QCOMPARE(lines.size(), 2);
+    for (int i = 0; i < lines.size(); ++i) {
+        QJsonParseError error;
+        const QJsonDocument document = QJsonDocument::fromJson(lines[i], &error);
+        QCOMPARE(error.error, QJsonParseError::NoError);
+        const QJsonObject counters = document.object().value(QStringLiteral("counters")).toObject();
+        QCOMPARE(counters.value(QStringLiteral("frame_count")).toInt(), i + 1);
+    }
+}
+
+QTEST_APPLESS_MAIN(PerfMetricsTest)
+
+#include "perf_metrics_test.moc"
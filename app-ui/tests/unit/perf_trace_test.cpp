@@ -0,0 +1,169 @@
+#include "perf/PerfTrace.hpp"
+
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTemporaryDir>
+#include <QTest>
+#include <QThread>
+
+namespace {
+
+QJsonArray writeAndParse(const QString &path) {
+    if (!PerfTrace::writeChromeTrace(path)) {
+        return {};
+    }
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return {};
+    }
+    return QJsonDocument::fromJson(file.readAll()).object().value(QStringLiteral("traceEvents")).toArray();
+}
+
+int countEvents(const QJsonArray &events, const QString &phase, const QString &name) {
+    int count = 0;
+    for (const QJsonValue &value : events) {
+        const QJsonObject event = value.toObject();
+        if (event.value(QStringLiteral("ph")).toString() == phase
+            && event.value(QStringLiteral("name")).toString() == name) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+int threadIdNamed(const QJsonArray &events, const QString &threadName) {
+    for (const QJsonValue &value : events) {
+        const QJsonObject event = value.toObject();
+        if (event.value(QStringLiteral("ph")).toString() == QStringLiteral("M")
+            && event.value(QStringLiteral("args")).toObject().value(QStringLiteral("name")).toString() == threadName) {
+            return event.value(QStringLiteral("tid")).toInt();
+        }
+    }
+    return -1;
+}
+
+} // namespace
+
+class PerfTraceTest : public QObject {
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+    void disabledSpansRecordNothing();
+    void spansFromEachThreadGetTheirOwnTrack();
+    void asyncSpansExportBeginAndEnd();
+    void ringKeepsMostRecentEvents();
+
+private:
+    QTemporaryDir m_dir;
+};
+
+void PerfTraceTest::init() {
+    QVERIFY(m_dir.isValid());
+    PerfTrace::setEnabled(false);
+    PerfTrace::clear();
+}
+
+void PerfTraceTest::cleanup() {
+    PerfTrace::setEnabled(false);
+}
+
+void PerfTraceTest::disabledSpansRecordNothing() {
+    {
+        const PerfTraceSpan span("disabled-span");
+    }
+    PerfTrace::recordComplete("disabled-complete", 0, 10);
+    PerfTrace::recordAsync("disabled-async", 1, 0, 10);
+
+    const QJsonArray events = writeAndParse(m_dir.filePath(QStringLiteral("disabled.json")));
+    QCOMPARE(countEvents(events, QStringLiteral("X"), QStringLiteral("disabled-span")), 0);
+    QCOMPARE(countEvents(events, QStringLiteral("X"), QStringLiteral("disabled-complete")), 0);
+    QCOMPARE(countEvents(events, QStringLiteral("b"), QStringLiteral("disabled-async")), 0);
+}
+
+void PerfTraceTest::spansFromEachThreadGetTheirOwnTrack() {
+    PerfTrace::setEnabled(true);
+    PerfTrace::setThreadName(QStringLiteral("test-main"));
+    {
+        const PerfTraceSpan span("main-span");
+        QThread::usleep(200);
+    }
+
+    QThread *worker = QThread::create([]() {
+        PerfTrace::setThreadName(QStringLiteral("test-worker"));
+        const PerfTraceSpan span("worker-span");
+        QThread::usleep(200);
+    });
+    worker->start();
+    QVERIFY(worker->wait(5000));
+    delete worker;
+
+    const QJsonArray events = writeAndParse(m_dir.filePath(QStringLiteral("threads.json")));
+    const int mainTid = threadIdNamed(events, QStringLiteral("test-main"));
+    const int workerTid = threadIdNamed(events, QStringLiteral("test-worker"));
+    QVERIFY(mainTid > 0);
+    QVERIFY(workerTid > 0);
+    QVERIFY(mainTid != workerTid);
+
+    for (const QJsonValue &value : events) {
+        const QJsonObject event = value.toObject();
+        if (event.value(QStringLiteral("ph")).toString() != QStringLiteral("X")) {
+            continue;
+        }
+        const QString name = event.value(QStringLiteral("name")).toString();
+        QVERIFY(event.value(QStringLiteral("ts")).toDouble() >= 0.0);
+        QVERIFY(event.value(QStringLiteral("dur")).toDouble() >= 200.0);
+        if (name == QStringLiteral("main-span")) {
+            QCOMPARE(event.value(QStringLiteral("tid")).toInt(), mainTid);
+        } else if (name == QStringLiteral("worker-span")) {
+            QCOMPARE(event.value(QStringLiteral("tid")).toInt(), workerTid);
+        }
+    }
+    QCOMPARE(countEvents(events, QStringLiteral("X"), QStringLiteral("main-span")), 1);
+    QCOMPARE(countEvents(events, QStringLiteral("X"), QStringLiteral("worker-span")), 1);
+}
+
+void PerfTraceTest::asyncSpansExportBeginAndEnd() {
+    PerfTrace::setEnabled(true);
+    const qint64 startNs = PerfTrace::nowNs();
+    PerfTrace::recordAsync("round-trip", 42, startNs, startNs + 5000000);
+
+    const QJsonArray events = writeAndParse(m_dir.filePath(QStringLiteral("async.json")));
+    QCOMPARE(countEvents(events, QStringLiteral("b"), QStringLiteral("round-trip")), 1);
+    QCOMPARE(countEvents(events, QStringLiteral("e"), QStringLiteral("round-trip")), 1);
+
+    double beginUs = -1.0;
+    double endUs = -1.0;
+    for (const QJsonValue &value : events) {
+        const QJsonObject event = value.toObject();
+        if (event.value(QStringLiteral("name")).toString() != QStringLiteral("round-trip")) {
+            continue;
+        }
+        QCOMPARE(event.value(QStringLiteral("id")).toInt(), 42);
+        if (event.value(QStringLiteral("ph")).toString() == QStringLiteral("b")) {
+            beginUs = event.value(QStringLiteral("ts")).toDouble();
+        } else {
+            endUs = event.value(QStringLiteral("ts")).toDouble();
+        }
+    }
+    QCOMPARE(endUs - beginUs, 5000.0);
+}
+
+void PerfTraceTest::ringKeepsMostRecentEvents() {
+    PerfTrace::setEnabled(true);
+    const qint64 startNs = PerfTrace::nowNs();
+    for (int i = 0; i < PerfTrace::kRingCapacity + 16; ++i) {
+        PerfTrace::recordComplete(i < 16 ? "overwritten" : "kept", startNs + i, startNs + i + 1);
+    }
+
+    const QJsonArray events = writeAndParse(m_dir.filePath(QStringLiteral("ring.json")));
+    QCOMPARE(countEvents(events, QStringLiteral("X"), QStringLiteral("overwritten")), 0);
+    QCOMPARE(countEvents(events, QStringLiteral("X"), QStringLiteral("kept")), PerfTrace::kRingCapacity);
+}
+
+QTEST_APPLESS_MAIN(PerfTraceTest)
+
+#include "perf_trace_test.moc"